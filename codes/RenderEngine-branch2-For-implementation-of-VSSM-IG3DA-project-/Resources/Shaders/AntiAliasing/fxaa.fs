@@ -0,0 +1,140 @@
+#version 450 core
+
+// FXAA(quality version, simplified), refer: "FXAA, Timothy Lottes, NVIDIA, 2009" and FXAA 3.11 source.
+// Idea: find local contrast by luma, detect edge direction(horizontal or vertical), walk along the edge to find its two ends,
+// then shift the sampling position towards the edge by the distance to the nearest end(plus a sub-pixel blending).
+
+in vec2 fUV;
+
+uniform sampler2D sceneTex;
+uniform vec2 texelSize; // 1/width, 1/height
+
+out vec4 colorResponse;
+
+const float EDGE_THRESHOLD_MIN = 0.0312;
+const float EDGE_THRESHOLD_MAX = 0.125;
+const float SUBPIXEL_QUALITY = 0.75;
+const int SEARCH_STEPS = 10;
+const float SEARCH_STEP_SCALE[SEARCH_STEPS] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 4.0, 8.0);
+
+float Luma(vec3 _color)
+{
+	return sqrt(dot(_color, vec3(0.299, 0.587, 0.114))); // perceptual(gamma-ish) luma
+}
+
+float LumaAt(vec2 _uv)
+{
+	return Luma(texture(sceneTex, _uv).rgb);
+}
+
+void main()
+{
+	vec3 colorCenter = texture(sceneTex, fUV).rgb;
+	float lumaCenter = Luma(colorCenter);
+	float lumaN = Luma(textureOffset(sceneTex, fUV, ivec2(0, 1)).rgb);
+	float lumaS = Luma(textureOffset(sceneTex, fUV, ivec2(0, -1)).rgb);
+	float lumaE = Luma(textureOffset(sceneTex, fUV, ivec2(1, 0)).rgb);
+	float lumaW = Luma(textureOffset(sceneTex, fUV, ivec2(-1, 0)).rgb);
+
+	float lumaMin = min(lumaCenter, min(min(lumaN, lumaS), min(lumaE, lumaW)));
+	float lumaMax = max(lumaCenter, max(max(lumaN, lumaS), max(lumaE, lumaW)));
+	float lumaRange = lumaMax - lumaMin;
+
+	// not an edge(or too dark to see), early exit
+	if (lumaRange < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX))
+	{
+		colorResponse = vec4(colorCenter, 1);
+		return;
+	}
+
+	float lumaNE = Luma(textureOffset(sceneTex, fUV, ivec2(1, 1)).rgb);
+	float lumaNW = Luma(textureOffset(sceneTex, fUV, ivec2(-1, 1)).rgb);
+	float lumaSE = Luma(textureOffset(sceneTex, fUV, ivec2(1, -1)).rgb);
+	float lumaSW = Luma(textureOffset(sceneTex, fUV, ivec2(-1, -1)).rgb);
+
+	float lumaNS = lumaN + lumaS;
+	float lumaWE = lumaW + lumaE;
+	float lumaNCorners = lumaNW + lumaNE;
+	float lumaSCorners = lumaSW + lumaSE;
+	float lumaECorners = lumaNE + lumaSE;
+	float lumaWCorners = lumaNW + lumaSW;
+
+	// edge direction: compare horizontal and vertical gradients
+	float edgeH = abs(-2.0 * lumaW + lumaWCorners) + abs(-2.0 * lumaCenter + lumaNS) * 2.0 + abs(-2.0 * lumaE + lumaECorners);
+	float edgeV = abs(-2.0 * lumaN + lumaNCorners) + abs(-2.0 * lumaCenter + lumaWE) * 2.0 + abs(-2.0 * lumaS + lumaSCorners);
+	bool isHorizontal = edgeH >= edgeV;
+
+	// choose the side of the edge(the neighbour with the largest gradient)
+	float luma1 = isHorizontal ? lumaS : lumaW;
+	float luma2 = isHorizontal ? lumaN : lumaE;
+	float gradient1 = luma1 - lumaCenter;
+	float gradient2 = luma2 - lumaCenter;
+	bool isSide1Steeper = abs(gradient1) >= abs(gradient2);
+	float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+	float stepLength = isHorizontal ? texelSize.y : texelSize.x;
+	float lumaLocalAverage;
+	if (isSide1Steeper)
+	{
+		stepLength = -stepLength;
+		lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+	}
+	else
+		lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+
+	// move half pixel to the edge
+	vec2 edgeUV = fUV;
+	if (isHorizontal)
+		edgeUV.y += stepLength * 0.5;
+	else
+		edgeUV.x += stepLength * 0.5;
+
+	// walk along the edge in both directions until reaching its ends
+	vec2 offset = isHorizontal ? vec2(texelSize.x, 0) : vec2(0, texelSize.y);
+	vec2 uv1 = edgeUV - offset;
+	vec2 uv2 = edgeUV + offset;
+	float lumaEnd1 = LumaAt(uv1) - lumaLocalAverage;
+	float lumaEnd2 = LumaAt(uv2) - lumaLocalAverage;
+	bool reached1 = abs(lumaEnd1) >= gradientScaled;
+	bool reached2 = abs(lumaEnd2) >= gradientScaled;
+	for (int i = 1; i < SEARCH_STEPS && !(reached1 && reached2); i++)
+	{
+		if (!reached1)
+		{
+			uv1 -= offset * SEARCH_STEP_SCALE[i];
+			lumaEnd1 = LumaAt(uv1) - lumaLocalAverage;
+			reached1 = abs(lumaEnd1) >= gradientScaled;
+		}
+		if (!reached2)
+		{
+			uv2 += offset * SEARCH_STEP_SCALE[i];
+			lumaEnd2 = LumaAt(uv2) - lumaLocalAverage;
+			reached2 = abs(lumaEnd2) >= gradientScaled;
+		}
+	}
+
+	float distance1 = isHorizontal ? (fUV.x - uv1.x) : (fUV.y - uv1.y);
+	float distance2 = isHorizontal ? (uv2.x - fUV.x) : (uv2.y - fUV.y);
+	bool isDirection1 = distance1 < distance2;
+	float distanceFinal = min(distance1, distance2);
+	float edgeThickness = distance1 + distance2;
+
+	// only shift if the nearest end has the opposite variation to the center(otherwise we are on the wrong side of the edge)
+	bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+	bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+	float pixelOffset = correctVariation ? (-distanceFinal / edgeThickness + 0.5) : 0.0;
+
+	// sub-pixel aliasing(e.g. thin lines), based on the difference between center and the 3x3 average
+	float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaNS + lumaWE) + lumaWCorners + lumaECorners);
+	float subPixelOffset1 = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+	float subPixelOffset2 = (-2.0 * subPixelOffset1 + 3.0) * subPixelOffset1 * subPixelOffset1;
+	float subPixelOffsetFinal = subPixelOffset2 * subPixelOffset2 * SUBPIXEL_QUALITY;
+	pixelOffset = max(pixelOffset, subPixelOffsetFinal);
+
+	vec2 finalUV = fUV;
+	if (isHorizontal)
+		finalUV.y += pixelOffset * stepLength;
+	else
+		finalUV.x += pixelOffset * stepLength;
+	colorResponse = vec4(texture(sceneTex, finalUV).rgb, 1);
+}
\ No newline at end of file
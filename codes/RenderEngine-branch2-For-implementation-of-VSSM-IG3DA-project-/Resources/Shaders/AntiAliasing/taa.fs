@@ -0,0 +1,56 @@
+#version 450 core
+
+// TAA resolve: current frame is rendered with a sub-pixel jitter, then blended with the history(accumulation of previous frames).
+// History is reprojected by depth(static scene assumed, no motion vectors), and clamped by the 3x3 neighbourhood of current frame to reject ghosting.
+
+in vec2 fUV;
+
+uniform sampler2D sceneTex;
+uniform sampler2D depthTex;
+uniform sampler2D historyTex;
+uniform vec2 texelSize; // 1/width, 1/height
+uniform mat4 invViewProjMat; // inverse of current (projMat*viewMat) without jitter
+uniform mat4 prevViewProjMat; // previous (projMat*viewMat) without jitter
+uniform float blendFactor; // weight of history
+uniform bool useHistory;
+
+out vec4 colorResponse;
+
+void main()
+{
+	vec3 current = texture(sceneTex, fUV).rgb;
+	if (!useHistory)
+	{
+		colorResponse = vec4(current, 1);
+		return;
+	}
+
+	// neighbourhood min/max
+	vec3 colorMin = current;
+	vec3 colorMax = current;
+	for (int x = -1; x <= 1; x++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			vec3 neighbour = texture(sceneTex, fUV + vec2(x, y) * texelSize).rgb;
+			colorMin = min(colorMin, neighbour);
+			colorMax = max(colorMax, neighbour);
+		}
+	}
+
+	// reproject to previous frame
+	float depth = texture(depthTex, fUV).r;
+	vec4 worldPos = invViewProjMat * vec4(fUV * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	worldPos /= worldPos.w;
+	vec4 prevClipPos = prevViewProjMat * worldPos;
+	vec2 prevUV = prevClipPos.xy / prevClipPos.w * 0.5 + 0.5;
+
+	if (any(lessThan(prevUV, vec2(0))) || any(greaterThan(prevUV, vec2(1))))
+	{
+		colorResponse = vec4(current, 1); // disocclusion at screen border
+		return;
+	}
+
+	vec3 history = clamp(texture(historyTex, prevUV).rgb, colorMin, colorMax);
+	colorResponse = vec4(mix(current, history, blendFactor), 1);
+}
\ No newline at end of file
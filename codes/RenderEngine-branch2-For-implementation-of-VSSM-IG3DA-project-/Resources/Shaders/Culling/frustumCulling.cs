@@ -0,0 +1,77 @@
+#version 450 core
+
+layout (local_size_x = 64) in; /*must be the same as "groupSize" in GPUCulling::DispatchCull()*/
+
+/*[Important] memory layout must be the same as "GPUObjectData" in gpuCulling.hpp*/
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin; /*AABB of mesh(before transformation)*/
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+
+/*same as "DrawElementsIndirectCommand" in gpuCulling.hpp*/
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+layout (std430, binding = 1) writeonly buffer CommandBuffer { DrawCommand commands[]; }; /*one command per object, culled object gets instanceCount=0*/
+layout (std430, binding = 2) writeonly buffer CompactBuffer { DrawCommand compactCommands[]; }; /*only visible objects*/
+layout (std430, binding = 3) buffer DrawCountBuffer { uint drawCounts[]; };
+
+uniform vec4 planes[6]; /*frustum planes in world space, inside means dot(plane.xyz, p) + plane.w >= 0*/
+uniform int objectNum;
+uniform int commandOffset; /*start of current view inside CommandBuffer/CompactBuffer*/
+uniform int viewIndex;
+
+void main()
+{
+	uint id = gl_GlobalInvocationID.x;
+	if(id >= objectNum)
+		return;
+
+	ObjectData obj = objects[id];
+
+	/*transform AABB into world space(still an AABB, which is conservative)*/
+	vec3 center = 0.5*(obj.aabbMin.xyz + obj.aabbMax.xyz);
+	vec3 extent = 0.5*(obj.aabbMax.xyz - obj.aabbMin.xyz);
+	vec3 wCenter = (obj.modelMat*vec4(center, 1)).xyz;
+	vec3 wExtent = abs(obj.modelMat[0].xyz)*extent.x + abs(obj.modelMat[1].xyz)*extent.y + abs(obj.modelMat[2].xyz)*extent.z;
+
+	/*AABB is outside if it is totally behind any plane*/
+	bool visible = true;
+	for(int i=0;i<6;i++)
+	{
+		float d = dot(planes[i].xyz, wCenter) + planes[i].w;
+		float r = dot(abs(planes[i].xyz), wExtent);
+		if(d + r < 0)
+		{
+			visible = false;
+			break;
+		}
+	}
+
+	DrawCommand cmd;
+	cmd.count = obj.indexCount;
+	cmd.instanceCount = visible ? 1 : 0;
+	cmd.firstIndex = obj.firstIndex;
+	cmd.baseVertex = obj.baseVertex;
+	cmd.baseInstance = id; /*objectID*/
+	commands[commandOffset + id] = cmd;
+
+	if(visible)
+	{
+		uint slot = atomicAdd(drawCounts[viewIndex], 1);
+		compactCommands[commandOffset + slot] = cmd;
+	}
+}
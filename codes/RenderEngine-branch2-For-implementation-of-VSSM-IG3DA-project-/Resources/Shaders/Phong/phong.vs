@@ -3,19 +3,35 @@
 layout (location = 0) in vec3 vPos;
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vUV;
+layout (location = 3) in uint vObjectID; /*instanced attribute, equals to baseInstance of the draw(Rasterizer::Draw or indirect command)*/
+
+/*model matrix is read from ObjectBuffer(see GPUCulling), so objects can be drawn by one multi-draw call*/
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin;
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
 
-uniform mat4 modelMat;
 uniform mat4 viewMat;
 uniform mat4 projectMat;
 
 out vec3 fPos;
 out vec3 fNormal;
 out vec2 fUV;
+flat out uint fObjectID;
 
 void main()
 {
+	mat4 modelMat = objects[vObjectID].modelMat;
 	gl_Position = projectMat*viewMat*modelMat*vec4(vPos, 1);
 	fPos = vPos;
 	fNormal = vNormal;
 	fUV = vUV;
+	fObjectID = vObjectID;
 }
\ No newline at end of file
@@ -1,8 +1,8 @@
 #version 450 core
 
-layout (location = 0) in vec3 vPos;
-
 void main()
 {
-	gl_Position = vec4(vPos, 1); // input vPos is one of point from screen quad, therefore no need to change it.
+	// one triangle covering the whole screen(attribute-less, see FullscreenPass): vertex 0:(-1,-1), 1:(3,-1), 2:(-1,3)
+	vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+	gl_Position = vec4(pos, 0, 1);
 }
\ No newline at end of file
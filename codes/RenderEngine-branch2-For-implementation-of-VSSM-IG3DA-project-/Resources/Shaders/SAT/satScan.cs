@@ -0,0 +1,102 @@
+#version 450 core
+// summed-area table by prefix sums(scans) in shared memory, one dispatch scans all rows, a second one scans all columns.
+// refer: "Parallel Prefix Sum (Scan) with CUDA"(GPU Gems 3, chapter 39), Blelloch's work-efficient scan
+// one workgroup scans one whole line(row or column) chunk by chunk, the sum of previous chunks is carried to the next chunk
+
+layout (local_size_x = 256) in; /*must be the same as "scanGroupSize" in SummedAreaTableGenerator*/
+
+uniform sampler2D texInput;
+/*no format qualifier(allowed for writeonly images), so the same shader writes any float format. Components missing in the format are dropped*/
+layout (binding = 0) writeonly uniform image2D imageOutput;
+
+uniform int vertical; /*0: scan rows, 1: scan columns*/
+/*incremental update: only texels at or after "start"(x >= start.x and y >= start.y) are re-generated, they are the only ones depending on changed input*/
+/*sums of the texels before "start" come from the current SAT, which is still valid there*/
+uniform ivec2 start;
+uniform sampler2D texSAT;
+uniform int recenter; /*1: recenter input at origin(subtract 0.5) for float precision, same as "sat*Copy.fs". Only for the first pass*/
+
+const int chunkSize = 2*256; /*each thread loads 2 elements*/
+shared vec4 chunk[chunkSize];
+
+ivec2 GetTexel(int line, int pos)
+{
+	return vertical == 1 ? ivec2(line, pos) : ivec2(pos, line);
+}
+
+void main()
+{
+	ivec2 size = imageSize(imageOutput); /*same size as input*/
+	int line = int(gl_WorkGroupID.x) + (vertical == 1 ? start.x : start.y);
+	int lineStart = vertical == 1 ? start.y : start.x;
+	int lineLength = vertical == 1 ? size.y : size.x;
+	int t = int(gl_LocalInvocationID.x);
+
+	/*sum of previous chunks, starts from the sum of texels before "lineStart"*/
+	vec4 carry = vec4(0);
+	if(lineStart > 0)
+	{
+		if(vertical == 1) /*column sum above "start" is the SAT of the previous row*/
+			carry = texelFetch(texSAT, ivec2(line, lineStart - 1), 0);
+		else /*row sum on the left of "start": difference of two SAT rows*/
+			carry = texelFetch(texSAT, ivec2(lineStart - 1, line), 0) - (line > 0 ? texelFetch(texSAT, ivec2(lineStart - 1, line - 1), 0) : vec4(0));
+	}
+	for(int chunkStart = lineStart; chunkStart < lineLength; chunkStart += chunkSize)
+	{
+		/*load, elements outside of the line are zero*/
+		vec4 values[2];
+		for(int k = 0; k < 2; k++)
+		{
+			int pos = chunkStart + 2*t + k;
+			values[k] = vec4(0);
+			if(pos < lineLength)
+				values[k] = texelFetch(texInput, GetTexel(line, pos), 0) - (recenter == 1 ? vec4(0.5) : vec4(0));
+			chunk[2*t + k] = values[k];
+		}
+
+		/*up-sweep: build partial sums in place*/
+		int offset = 1;
+		for(int d = chunkSize >> 1; d > 0; d >>= 1)
+		{
+			barrier();
+			if(t < d)
+			{
+				int ai = offset*(2*t + 1) - 1;
+				int bi = offset*(2*t + 2) - 1;
+				chunk[bi] += chunk[ai];
+			}
+			offset *= 2;
+		}
+		barrier();
+		vec4 total = chunk[chunkSize - 1];
+		barrier();
+		if(t == 0)
+			chunk[chunkSize - 1] = vec4(0);
+
+		/*down-sweep: exclusive prefix sums*/
+		for(int d = 1; d < chunkSize; d *= 2)
+		{
+			offset >>= 1;
+			barrier();
+			if(t < d)
+			{
+				int ai = offset*(2*t + 1) - 1;
+				int bi = offset*(2*t + 2) - 1;
+				vec4 temp = chunk[ai];
+				chunk[ai] = chunk[bi];
+				chunk[bi] += temp;
+			}
+		}
+		barrier();
+
+		/*SAT is inclusive: exclusive sum + own value*/
+		for(int k = 0; k < 2; k++)
+		{
+			int pos = chunkStart + 2*t + k;
+			if(pos < lineLength)
+				imageStore(imageOutput, GetTexel(line, pos), carry + chunk[2*t + k] + values[k]);
+		}
+		carry += total;
+		barrier(); /*chunk is reused by the next iteration*/
+	}
+}
@@ -0,0 +1,110 @@
+#version 450 core
+// fixed-point summed-area table, same scans as "satScan.cs" but values are quantized and summed as 32-bit integers.
+// values are recentered(-0.5, same as the float SAT copy shader) and stored as signed deltas in two's complement, so the whole 32 bits are used by the delta instead of the offset.
+// integer additions are exact: prefix sums wrap around 2^32, but a box sum(difference of 4 SAT texels) is exact as long as it fits in a signed 32-bit integer.
+// refer: "Parallel Prefix Sum (Scan) with CUDA"(GPU Gems 3, chapter 39), Blelloch's work-efficient scan
+// one workgroup scans one whole line(row or column) chunk by chunk, the sum of previous chunks is carried to the next chunk
+
+layout (local_size_x = 256) in; /*must be the same as "scanGroupSize" in SummedAreaTableGenerator*/
+
+uniform sampler2D texInput;
+uniform usampler2D texScratch; /*row sums, only used by the column pass*/
+/*no format qualifier(allowed for writeonly images), so the same shader writes any unsigned integer format. Components missing in the format are dropped*/
+layout (binding = 0) writeonly uniform uimage2D imageOutput;
+
+uniform int vertical; /*0: scan rows, 1: scan columns*/
+/*incremental update: only texels at or after "start"(x >= start.x and y >= start.y) are re-generated, they are the only ones depending on changed input*/
+/*sums of the texels before "start" come from the current SAT, which is still valid there*/
+uniform ivec2 start;
+uniform usampler2D texSAT;
+uniform float fixedScale; /*input values in [0,1] are quantized as round((value-0.5)*fixedScale), see SummedAreaTableGenerator::GetFixedPointScale*/
+
+const int chunkSize = 2*256; /*each thread loads 2 elements*/
+shared uvec4 chunk[chunkSize];
+
+ivec2 GetTexel(int line, int pos)
+{
+	return vertical == 1 ? ivec2(line, pos) : ivec2(pos, line);
+}
+
+void main()
+{
+	ivec2 size = imageSize(imageOutput); /*same size as input*/
+	int line = int(gl_WorkGroupID.x) + (vertical == 1 ? start.x : start.y);
+	int lineStart = vertical == 1 ? start.y : start.x;
+	int lineLength = vertical == 1 ? size.y : size.x;
+	int t = int(gl_LocalInvocationID.x);
+
+	/*sum of previous chunks, starts from the sum of texels before "lineStart"*/
+	uvec4 carry = uvec4(0);
+	if(lineStart > 0)
+	{
+		if(vertical == 1) /*column sum above "start" is the SAT of the previous row*/
+			carry = texelFetch(texSAT, ivec2(line, lineStart - 1), 0);
+		else /*row sum on the left of "start": difference of two SAT rows*/
+			carry = texelFetch(texSAT, ivec2(lineStart - 1, line), 0) - (line > 0 ? texelFetch(texSAT, ivec2(lineStart - 1, line - 1), 0) : uvec4(0));
+	}
+	for(int chunkStart = lineStart; chunkStart < lineLength; chunkStart += chunkSize)
+	{
+		/*load, elements outside of the line are zero*/
+		uvec4 values[2];
+		for(int k = 0; k < 2; k++)
+		{
+			int pos = chunkStart + 2*t + k;
+			values[k] = uvec4(0);
+			if(pos < lineLength)
+			{
+				if(vertical == 1)
+					values[k] = texelFetch(texScratch, GetTexel(line, pos), 0);
+				else
+					values[k] = uvec4(ivec4(round((clamp(texelFetch(texInput, GetTexel(line, pos), 0), 0.0, 1.0) - 0.5) * fixedScale))); /*bit pattern of the signed delta*/
+			}
+			chunk[2*t + k] = values[k];
+		}
+
+		/*up-sweep: build partial sums in place*/
+		int offset = 1;
+		for(int d = chunkSize >> 1; d > 0; d >>= 1)
+		{
+			barrier();
+			if(t < d)
+			{
+				int ai = offset*(2*t + 1) - 1;
+				int bi = offset*(2*t + 2) - 1;
+				chunk[bi] += chunk[ai];
+			}
+			offset *= 2;
+		}
+		barrier();
+		uvec4 total = chunk[chunkSize - 1];
+		barrier();
+		if(t == 0)
+			chunk[chunkSize - 1] = uvec4(0);
+
+		/*down-sweep: exclusive prefix sums*/
+		for(int d = 1; d < chunkSize; d *= 2)
+		{
+			offset >>= 1;
+			barrier();
+			if(t < d)
+			{
+				int ai = offset*(2*t + 1) - 1;
+				int bi = offset*(2*t + 2) - 1;
+				uvec4 temp = chunk[ai];
+				chunk[ai] = chunk[bi];
+				chunk[bi] += temp;
+			}
+		}
+		barrier();
+
+		/*SAT is inclusive: exclusive sum + own value*/
+		for(int k = 0; k < 2; k++)
+		{
+			int pos = chunkStart + 2*t + k;
+			if(pos < lineLength)
+				imageStore(imageOutput, GetTexel(line, pos), carry + chunk[2*t + k] + values[k]);
+		}
+		carry += total;
+		barrier(); /*chunk is reused by the next iteration*/
+	}
+}
@@ -0,0 +1,89 @@
+#version 450 core
+
+layout (local_size_x = 8, local_size_y = 8) in; /*must be the same as "groupSize" in SSAO::ComputeAO()*/
+
+uniform sampler2D depthTex; /*depth of camera views at render resolution*/
+layout (rg16f, binding = 0) writeonly uniform image2D aoImage; /*low resolution, r: AO(1 means not occluded), g: linear depth*/
+
+uniform vec4 viewRect; /*(x, y, width, height) of current view at render resolution*/
+uniform vec4 lowViewRect; /*the same at low resolution*/
+uniform int downscale;
+uniform mat4 projectMat;
+uniform mat4 invProjectMat;
+
+uniform int sampleNum;
+uniform float radius; /*in view space*/
+uniform float intensity;
+
+const float PI = 3.14159265;
+const float farDepth = 65000.0; /*linear depth of background(close to the max of half float)*/
+
+/*view-space position of pixel "p"(render resolution)*/
+vec3 GetViewPos(ivec2 p)
+{
+	ivec4 rect = ivec4(viewRect);
+	p = clamp(p, rect.xy, rect.xy + rect.zw - 1);
+	float depth = texelFetch(depthTex, p, 0).r;
+	vec2 uv = (vec2(p - rect.xy) + 0.5) / vec2(rect.zw);
+	vec4 pos = invProjectMat*vec4(vec3(uv, depth)*2.0 - 1.0, 1);
+	return pos.xyz / pos.w;
+}
+
+void main()
+{
+	ivec2 lowPixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec4 lowRect = ivec4(lowViewRect);
+	if(any(greaterThanEqual(lowPixel, lowRect.zw)))
+		return;
+	lowPixel += lowRect.xy;
+
+	/*one render resolution pixel per low resolution pixel*/
+	ivec4 rect = ivec4(viewRect);
+	ivec2 pixel = clamp(lowPixel*downscale + downscale/2, rect.xy, rect.xy + rect.zw - 1);
+	if(texelFetch(depthTex, pixel, 0).r >= 1.0)
+	{
+		imageStore(aoImage, lowPixel, vec4(1, farDepth, 0, 0));
+		return;
+	}
+	vec3 pos = GetViewPos(pixel);
+
+	/*normal from neighbours, use the side with smaller depth difference so that edges don't produce wrong normals*/
+	vec3 dx0 = pos - GetViewPos(pixel - ivec2(1, 0));
+	vec3 dx1 = GetViewPos(pixel + ivec2(1, 0)) - pos;
+	vec3 dy0 = pos - GetViewPos(pixel - ivec2(0, 1));
+	vec3 dy1 = GetViewPos(pixel + ivec2(0, 1)) - pos;
+	vec3 dx = abs(dx0.z) < abs(dx1.z) ? dx0 : dx1;
+	vec3 dy = abs(dy0.z) < abs(dy1.z) ? dy0 : dy1;
+	vec3 normal = normalize(cross(dx, dy));
+
+	/*interleaved pattern: each pixel of a 4x4 block rotates the kernel by a different angle, the blur pass averages the block*/
+	int patternIndex = (lowPixel.x & 3) + (lowPixel.y & 3)*4;
+	float angle = float(patternIndex) * (2.0*PI / 16.0);
+	vec3 randomDir = vec3(cos(angle), sin(angle), 0);
+	vec3 tangent = normalize(randomDir - normal*dot(randomDir, normal) + vec3(1e-4, 0, 0));
+	vec3 bitangent = cross(normal, tangent);
+
+	float occlusion = 0;
+	for(int i=0;i<sampleNum;i++)
+	{
+		/*hemisphere samples on a spiral, closer to the center are denser*/
+		float t = (float(i) + 0.5) / float(sampleNum);
+		float phi = float(i) * 2.399963; /*golden angle*/
+		float r = sqrt(t);
+		vec3 dir = vec3(r*cos(phi), r*sin(phi), sqrt(max(1.0 - t, 0.0)));
+		float scale = mix(0.1, 1.0, t*t);
+		vec3 samplePos = pos + (tangent*dir.x + bitangent*dir.y + normal*dir.z) * radius * scale;
+
+		vec4 clip = projectMat*vec4(samplePos, 1);
+		vec2 uv = clip.xy / clip.w * 0.5 + 0.5;
+		ivec2 samplePixel = rect.xy + ivec2(uv * vec2(rect.zw));
+		float sceneZ = GetViewPos(samplePixel).z;
+
+		/*view space looks at -z, occluded if scene surface is in front of sample. Range check ignores far away occluders*/
+		float rangeCheck = smoothstep(0.0, 1.0, radius / max(abs(pos.z - sceneZ), 1e-4));
+		occlusion += (sceneZ >= samplePos.z + 0.02*radius ? 1.0 : 0.0) * rangeCheck;
+	}
+
+	float ao = clamp(1.0 - intensity*occlusion/float(sampleNum), 0.0, 1.0);
+	imageStore(aoImage, lowPixel, vec4(ao, -pos.z, 0, 0));
+}
\ No newline at end of file
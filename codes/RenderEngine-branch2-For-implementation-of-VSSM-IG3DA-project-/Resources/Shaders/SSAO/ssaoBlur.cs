@@ -0,0 +1,37 @@
+#version 450 core
+
+layout (local_size_x = 8, local_size_y = 8) in; /*must be the same as "groupSize" in SSAO::Blur()*/
+
+uniform sampler2D aoTex; /*output of "ssao.cs", r: AO, g: linear depth*/
+layout (rg16f, binding = 0) writeonly uniform image2D blurImage;
+
+uniform vec4 lowViewRect; /*(x, y, width, height) of current view at low resolution*/
+
+const float depthSharpness = 20.0; /*larger value keeps edges sharper*/
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec4 rect = ivec4(lowViewRect);
+	if(any(greaterThanEqual(pixel, rect.zw)))
+		return;
+	pixel += rect.xy;
+
+	vec2 center = texelFetch(aoTex, pixel, 0).rg;
+
+	/*4x4 block covers all rotations of the interleaved pattern, neighbours on a different surface(depth) get lower weights*/
+	float sum = 0, weightSum = 0;
+	for(int y=-2;y<2;y++)
+	{
+		for(int x=-2;x<2;x++)
+		{
+			ivec2 p = clamp(pixel + ivec2(x, y), rect.xy, rect.xy + rect.zw - 1); /*don't read other views*/
+			vec2 s = texelFetch(aoTex, p, 0).rg;
+			float w = exp(-abs(s.g - center.g) * depthSharpness / max(center.g, 1e-3));
+			sum += s.r*w;
+			weightSum += w;
+		}
+	}
+
+	imageStore(blurImage, pixel, vec4(sum/weightSum, center.g, 0, 0));
+}
\ No newline at end of file
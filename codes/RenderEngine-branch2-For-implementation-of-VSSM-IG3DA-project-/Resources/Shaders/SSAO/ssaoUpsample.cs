@@ -0,0 +1,54 @@
+#version 450 core
+
+layout (local_size_x = 8, local_size_y = 8) in; /*must be the same as "groupSize" in SSAO::Upsample()*/
+
+uniform sampler2D depthTex; /*depth of camera views at render resolution*/
+uniform sampler2D aoTex; /*output of "ssaoBlur.cs", r: AO, g: linear depth*/
+layout (r8, binding = 0) writeonly uniform image2D outputImage; /*render resolution, read by "Phong/phong.fs"*/
+
+uniform vec4 viewRect; /*(x, y, width, height) of current view at render resolution*/
+uniform vec4 lowViewRect; /*the same at low resolution*/
+uniform int downscale;
+uniform mat4 invProjectMat;
+
+const float depthSharpness = 20.0;
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec4 rect = ivec4(viewRect);
+	if(any(greaterThanEqual(pixel, rect.zw)))
+		return;
+	pixel += rect.xy;
+
+	float depth = texelFetch(depthTex, pixel, 0).r;
+	if(depth >= 1.0)
+	{
+		imageStore(outputImage, pixel, vec4(1));
+		return;
+	}
+	vec2 uv = (vec2(pixel - rect.xy) + 0.5) / vec2(rect.zw);
+	vec4 pos = invProjectMat*vec4(vec3(uv, depth)*2.0 - 1.0, 1);
+	float linearDepth = -pos.z / pos.w;
+
+	/*bilinear weights of the 4 nearest low resolution texels, multiplied by depth similarity(joint bilateral upsample)*/
+	ivec4 lowRect = ivec4(lowViewRect);
+	vec2 lowPos = (vec2(pixel) + 0.5) / float(downscale) - 0.5;
+	ivec2 base = ivec2(floor(lowPos));
+	vec2 f = lowPos - vec2(base);
+	float sum = 0, weightSum = 0;
+	for(int y=0;y<2;y++)
+	{
+		for(int x=0;x<2;x++)
+		{
+			ivec2 p = clamp(base + ivec2(x, y), lowRect.xy, lowRect.xy + lowRect.zw - 1);
+			vec2 s = texelFetch(aoTex, p, 0).rg;
+			float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+			float w = bilinear * exp(-abs(s.g - linearDepth) * depthSharpness / max(linearDepth, 1e-3)) + 1e-5;
+			sum += s.r*w;
+			weightSum += w;
+		}
+	}
+
+	imageStore(outputImage, pixel, vec4(sum/weightSum));
+}
\ No newline at end of file
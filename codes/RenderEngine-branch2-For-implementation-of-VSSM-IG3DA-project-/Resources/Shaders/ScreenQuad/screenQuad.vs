@@ -1,13 +1,11 @@
 #version 450 core
 
-layout (location = 0) in vec3 vPos;
-layout (location = 1) in vec3 vNormal;
-layout (location = 2) in vec2 vUV;
-
 out vec2 fUV;
 
 void main()
 {
-	gl_Position = vec4(vPos, 1);
-	fUV = vUV;
+	// one triangle covering the whole screen(attribute-less, see FullscreenPass): vertex 0:(-1,-1), 1:(3,-1), 2:(-1,3)
+	vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+	gl_Position = vec4(pos, 0, 1);
+	fUV = pos * 0.5 + 0.5;
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 450 core
+
+/*min/max depth pyramid for PCSS blocker search: level k stores (min, max) depth of 2^(k+1) x 2^(k+1) atlas texels*/
+/*one dispatch per level and per shadow view, only texels covering the changed area("rect") of the view are reduced*/
+layout (local_size_x = 8, local_size_y = 8) in; /*must be the same as "groupSize" in BasicShadowMapRender::BuildDepthPyramid()*/
+
+uniform sampler2D texInput; /*shadow atlas(depth in r) for level 0, the pyramid itself for other levels*/
+uniform int inputLevel; /*-1: "texInput" is the shadow atlas, otherwise the level of pyramid to reduce*/
+/*no format qualifier(allowed for writeonly images): RG32F*/
+layout (binding = 0) writeonly uniform image2D imageOutput;
+
+uniform vec4 texelRect; /*(x, y, width, height) of texels written by this dispatch, in texels of the output level*/
+
+vec2 LoadMinMax(ivec2 texel, ivec2 inputSize)
+{
+	/*pyramid is a bit larger than half atlas(see BasicShadowMapRender::InitDepthPyramid), texels out of the atlas repeat the last one*/
+	texel = min(texel, inputSize - 1);
+	if(inputLevel < 0)
+		return vec2(texelFetch(texInput, texel, 0).r);
+	return texelFetch(texInput, texel, inputLevel).rg;
+}
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec4 rect = ivec4(texelRect);
+	if(any(greaterThanEqual(texel, rect.zw)))
+		return;
+	texel += rect.xy;
+
+	ivec2 inputSize = textureSize(texInput, max(inputLevel, 0));
+	ivec2 base = 2*texel;
+	vec2 a = LoadMinMax(base, inputSize);
+	vec2 b = LoadMinMax(base + ivec2(1, 0), inputSize);
+	vec2 c = LoadMinMax(base + ivec2(0, 1), inputSize);
+	vec2 d = LoadMinMax(base + ivec2(1, 1), inputSize);
+	vec2 range = vec2(min(min(a.x, b.x), min(c.x, d.x)), max(max(a.y, b.y), max(c.y, d.y)));
+	imageStore(imageOutput, texel, vec4(range, 0, 0));
+}
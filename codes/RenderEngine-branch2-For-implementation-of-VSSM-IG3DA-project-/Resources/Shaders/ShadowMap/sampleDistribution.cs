@@ -0,0 +1,104 @@
+#version 450 core
+
+/*sample distribution shadow maps(see SampleDistribution): bounds of visible samples(camera depth pre-pass) in light space of each shadow light, and view depth range of main camera*/
+/*refer: "Sample Distribution Shadow Maps"(Lauritzen, Salvi, Lefohn 2011)*/
+layout (local_size_x = 8, local_size_y = 8) in; /*must be the same as "groupSize" in SampleDistribution::Reduce()*/
+
+const int maxLightNum = 5; /*same as "maxLightNum" of lighting shaders*/
+
+uniform sampler2D depthTex; /*depth pre-pass of all camera views*/
+uniform vec4 viewRect; /*(x, y, width, height) of current camera view in "depthTex"*/
+uniform mat4 invViewProjMat; /*inverse(projection*view) of current camera view*/
+uniform mat4 viewMat;
+uniform int accumulateDepth; /*1: view depth range is only reduced for the main camera(cascades follow it)*/
+uniform int lightNum; /*lights in "lightMats", slot i of "lights" in the buffer*/
+uniform mat4 lightMats[maxLightNum];
+
+/*floats are stored as unsigned integers which keep their order(see FloatToOrdered), so atomicMin/atomicMax work on them*/
+struct Bounds
+{
+	uint minX, minY, minZ;
+	uint maxX, maxY, maxZ;
+};
+/*layout must be the same as SampleDistribution::SampleBounds, binding is "SampleDistribution::boundsBinding"*/
+layout (std430, binding = 8) buffer SampleBoundsBuffer /*binding 0-7 are used by GPU culling and scene shaders*/
+{
+	uint minDepth;
+	uint maxDepth;
+	Bounds lights[maxLightNum]; /*NDC of "lightMats"*/
+};
+
+const int boundsNum = 2 + 6*maxLightNum;
+shared uint sharedBounds[boundsNum]; /*same order as the buffer, one global atomic per group and per value*/
+
+uint FloatToOrdered(float value)
+{
+	uint bits = floatBitsToUint(value);
+	return (bits & 0x80000000u) != 0u ? ~bits : bits | 0x80000000u;
+}
+
+void main()
+{
+	uint localIndex = gl_LocalInvocationIndex;
+	for(uint i = localIndex; i < boundsNum; i += gl_WorkGroupSize.x*gl_WorkGroupSize.y)
+	{
+		bool isMin = i < 2u ? i == 0u : (i - 2u) % 6u < 3u;
+		sharedBounds[i] = isMin ? 0xFFFFFFFFu : 0u; /*empty bounds, same as SampleDistribution::Reduce()*/
+	}
+	barrier();
+
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec4 rect = ivec4(viewRect);
+	if(all(lessThan(texel, rect.zw)))
+	{
+		texel += rect.xy;
+		float depth = texelFetch(depthTex, texel, 0).r;
+		if(depth < 1.0) /*far plane is background, not a sample*/
+		{
+			vec2 uv = (vec2(texel - rect.xy) + 0.5)/vec2(rect.zw);
+			vec4 worldPos = invViewProjMat*vec4(vec3(uv, depth)*2.0 - 1.0, 1.0);
+			worldPos /= worldPos.w;
+
+			if(accumulateDepth == 1)
+			{
+				uint viewDepth = FloatToOrdered(-(viewMat*worldPos).z);
+				atomicMin(sharedBounds[0], viewDepth);
+				atomicMax(sharedBounds[1], viewDepth);
+			}
+			for(int i = 0; i < lightNum; i++)
+			{
+				vec4 clipCoord = lightMats[i]*worldPos;
+				if(clipCoord.w <= 0) /*behind a perspective light*/
+					continue;
+				vec3 ndcCoord = clipCoord.xyz/clipCoord.w;
+				int base = 2 + 6*i;
+				for(int c = 0; c < 3; c++)
+				{
+					uint value = FloatToOrdered(ndcCoord[c]);
+					atomicMin(sharedBounds[base + c], value);
+					atomicMax(sharedBounds[base + 3 + c], value);
+				}
+			}
+		}
+	}
+	barrier();
+
+	if(localIndex == 0)
+	{
+		if(accumulateDepth == 1)
+		{
+			atomicMin(minDepth, sharedBounds[0]);
+			atomicMax(maxDepth, sharedBounds[1]);
+		}
+		for(int i = 0; i < lightNum; i++)
+		{
+			int base = 2 + 6*i;
+			atomicMin(lights[i].minX, sharedBounds[base]);
+			atomicMin(lights[i].minY, sharedBounds[base + 1]);
+			atomicMin(lights[i].minZ, sharedBounds[base + 2]);
+			atomicMax(lights[i].maxX, sharedBounds[base + 3]);
+			atomicMax(lights[i].maxY, sharedBounds[base + 4]);
+			atomicMax(lights[i].maxZ, sharedBounds[base + 5]);
+		}
+	}
+}
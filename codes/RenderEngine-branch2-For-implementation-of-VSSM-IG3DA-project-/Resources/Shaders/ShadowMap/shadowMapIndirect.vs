@@ -0,0 +1,24 @@
+#version 450 core
+
+/*same as "shadowMap.vs", but model matrix is read from ObjectBuffer, used with GPUCulling::DrawVisible()*/
+layout (location = 0) in vec3 vPos;
+layout (location = 3) in uint vObjectID; /*instanced attribute, equals to baseInstance of indirect command*/
+
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin;
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+
+uniform mat4 lightMat; /*light space matrix(perspective or orthogonal projection)*/
+
+void main()
+{
+	gl_Position = lightMat*objects[vObjectID].modelMat*vec4(vPos, 1);
+}
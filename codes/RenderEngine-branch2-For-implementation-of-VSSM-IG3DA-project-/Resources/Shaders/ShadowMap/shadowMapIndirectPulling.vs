@@ -0,0 +1,30 @@
+#version 450 core
+
+/*same as "shadowMapIndirect.vs", but position is fetched by gl_VertexID*/
+layout (location = 3) in uint vObjectID; /*instanced attribute, equals to baseInstance of indirect command*/
+
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin;
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+
+/*vertex pulling: position is read from geometry pool buffer(bound by Rasterizer), no vertex attribute is used.
+gl_VertexID already includes the base vertex of the draw(glDrawElementsBaseVertex or indirect command), so it indexes the whole pool.
+[Note] array of float instead of vec3, because vec3 array has 16 bytes stride in std430 while pool buffers are tightly packed*/
+layout (std430, binding = 4) readonly buffer PositionBuffer { float positions[]; };
+
+vec3 FetchPosition() { int i = gl_VertexID*3; return vec3(positions[i], positions[i+1], positions[i+2]); }
+
+uniform mat4 lightMat; /*light space matrix(perspective or orthogonal projection)*/
+
+void main()
+{
+	gl_Position = lightMat*objects[vObjectID].modelMat*vec4(FetchPosition(), 1);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#version 450 core
+
+/*same as "shadowMapLayered.vs", but model matrix is read from ObjectBuffer, used with GPUCulling::CullLayered() and DrawVisible()*/
+layout (location = 0) in vec3 vPos;
+layout (location = 3) in uint vObjectID; /*instanced attribute, same for all instances of a command(see GPUCulling::DrawVisible)*/
+
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin;
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+
+struct ShadowLight
+{
+	mat4 lightMat; /*light space matrix(perspective or orthogonal projection)*/
+	vec4 tileTransform; /*xy: scale, zw: offset from NDC of light to NDC of its tile in shadow atlas*/
+	vec4 lightCamPosNear; /*xyz: lightCamPos, w: near*/
+	vec4 lightViewDirFar; /*xyz: lightViewDir, w: far*/
+};
+layout (std430, binding = 1) readonly buffer ShadowLightBuffer { ShadowLight shadowLights[]; };
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+	float gl_ClipDistance[4];
+};
+
+void main()
+{
+	mat4 modelMat = objects[vObjectID].modelMat;
+	ShadowLight light = shadowLights[gl_InstanceID];
+	vec4 clipPos = light.lightMat*modelMat*vec4(vPos, 1);
+	/*viewport is the whole atlas, clip against light frustum by ourselves. Otherwise triangles leak into neighbour tiles*/
+	gl_ClipDistance[0] = clipPos.w + clipPos.x;
+	gl_ClipDistance[1] = clipPos.w - clipPos.x;
+	gl_ClipDistance[2] = clipPos.w + clipPos.y;
+	gl_ClipDistance[3] = clipPos.w - clipPos.y;
+	/*move into the tile: ndc*scale + offset, in homogeneous coordinates*/
+	gl_Position = vec4(clipPos.xy*light.tileTransform.xy + clipPos.w*light.tileTransform.zw, clipPos.zw);
+}
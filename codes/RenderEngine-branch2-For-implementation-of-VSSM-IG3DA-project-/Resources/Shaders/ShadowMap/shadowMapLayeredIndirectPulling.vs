@@ -0,0 +1,52 @@
+#version 450 core
+
+/*same as "shadowMapLayeredIndirect.vs", but position is fetched by gl_VertexID*/
+layout (location = 3) in uint vObjectID; /*instanced attribute, same for all instances of a command(see GPUCulling::DrawVisible)*/
+
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin;
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+
+/*vertex pulling: position is read from geometry pool buffer(bound by Rasterizer), no vertex attribute is used.
+gl_VertexID already includes the base vertex of the draw(glDrawElementsBaseVertex or indirect command), so it indexes the whole pool.
+[Note] array of float instead of vec3, because vec3 array has 16 bytes stride in std430 while pool buffers are tightly packed*/
+layout (std430, binding = 4) readonly buffer PositionBuffer { float positions[]; };
+
+vec3 FetchPosition() { int i = gl_VertexID*3; return vec3(positions[i], positions[i+1], positions[i+2]); }
+
+struct ShadowLight
+{
+	mat4 lightMat; /*light space matrix(perspective or orthogonal projection)*/
+	vec4 tileTransform; /*xy: scale, zw: offset from NDC of light to NDC of its tile in shadow atlas*/
+	vec4 lightCamPosNear; /*xyz: lightCamPos, w: near*/
+	vec4 lightViewDirFar; /*xyz: lightViewDir, w: far*/
+};
+layout (std430, binding = 1) readonly buffer ShadowLightBuffer { ShadowLight shadowLights[]; };
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+	float gl_ClipDistance[4];
+};
+
+void main()
+{
+	mat4 modelMat = objects[vObjectID].modelMat;
+	ShadowLight light = shadowLights[gl_InstanceID];
+	vec4 clipPos = light.lightMat*modelMat*vec4(FetchPosition(), 1);
+	/*viewport is the whole atlas, clip against light frustum by ourselves. Otherwise triangles leak into neighbour tiles*/
+	gl_ClipDistance[0] = clipPos.w + clipPos.x;
+	gl_ClipDistance[1] = clipPos.w - clipPos.x;
+	gl_ClipDistance[2] = clipPos.w + clipPos.y;
+	gl_ClipDistance[3] = clipPos.w - clipPos.y;
+	/*move into the tile: ndc*scale + offset, in homogeneous coordinates*/
+	gl_Position = vec4(clipPos.xy*light.tileTransform.xy + clipPos.w*light.tileTransform.zw, clipPos.zw);
+}
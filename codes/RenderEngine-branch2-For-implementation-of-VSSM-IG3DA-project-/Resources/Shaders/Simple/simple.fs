@@ -2,10 +2,33 @@
 
 in vec2 fUV;
 in vec3 fNormal; // need to be normalized
+flat in uint fObjectID;
 
-uniform int useAlbedoTex;
-uniform vec3 albedoColor;
-layout (binding = 0) uniform sampler2D albedoTex;
+/*material of each object is read from MaterialBuffer(see GPUCulling) by objectID, so objects can be drawn by one multi-draw call*/
+struct MaterialData
+{
+	vec4 color, ka, kd; /*w is not used*/
+	vec4 ks; /*w is shiness*/
+	ivec4 albedo; /*x: index of albedo texture array(-1 means no albedo texture), y: layer*/
+};
+layout (std430, binding = 7) readonly buffer MaterialBuffer { MaterialData materials[]; };
+
+/*albedo textures are layers of texture arrays(see TextureArrayManager), one array per layer size*/
+const int maxAlbedoArrayNum = 4;
+uniform sampler2DArray albedoArrays[maxAlbedoArrayNum];
+
+vec3 SampleAlbedo(ivec2 albedo, vec2 uv)
+{
+	/*index of sampler array must be dynamically uniform, objectID is not inside one multi-draw call. So only use constant index here*/
+	vec3 coord = vec3(uv, albedo.y);
+	if(albedo.x == 0)
+		return texture(albedoArrays[0], coord).rgb;
+	else if(albedo.x == 1)
+		return texture(albedoArrays[1], coord).rgb;
+	else if(albedo.x == 2)
+		return texture(albedoArrays[2], coord).rgb;
+	return texture(albedoArrays[3], coord).rgb;
+}
 
 out vec4 colorResponse;
 
@@ -13,8 +36,9 @@ void main()
 {
 	vec3 normal = normalize(fNormal);
 
-	if(useAlbedoTex==1)
-		colorResponse = texture(albedoTex, fUV);
+	MaterialData materialData = materials[fObjectID];
+	if(materialData.albedo.x >= 0)
+		colorResponse = vec4(SampleAlbedo(materialData.albedo.xy, fUV), 1);
 	else
-		colorResponse = vec4(albedoColor, 1);
+		colorResponse = vec4(materialData.color.rgb, 1);
 }
\ No newline at end of file
@@ -3,11 +3,33 @@
 in vec3 fPos;
 in vec3 fNormal;
 in vec2 fUV;
+flat in uint fObjectID;
 
 /*matrix*/
-uniform mat4 modelMat;
+mat4 modelMat; /*read from ObjectBuffer at the beginning of main()*/
 uniform mat4 viewMat;
 
+/*per-draw data(see GPUCulling), indexed by objectID. Nothing changes between objects, so they can be drawn by one multi-draw call*/
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin;
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+
+struct MaterialData
+{
+	vec4 color, ka, kd; /*w is not used*/
+	vec4 ks; /*w is shiness*/
+	ivec4 albedo; /*x: index of albedo texture array(-1 means no albedo texture), y: layer*/
+};
+layout (std430, binding = 7) readonly buffer MaterialBuffer { MaterialData materials[]; };
+
 /*ambient*/
 uniform vec3 ambientLight;
 
@@ -23,16 +45,30 @@ struct Light
 };
 uniform Light lights[maxLightNum];
 
-uniform int useAlbedoTex;
-
 /*material*/ 
 struct Material
 {
 	vec3 ka, kd, ks, color; /*coefficient for ambient, diffuse, specular and color*/
 	float shiness;
-	sampler2D albedoTex;
 };
-uniform Material material; 
+Material material; /*read from MaterialBuffer at the beginning of main()*/
+
+/*albedo textures are layers of texture arrays(see TextureArrayManager), one array per layer size*/
+const int maxAlbedoArrayNum = 4;
+uniform sampler2DArray albedoArrays[maxAlbedoArrayNum];
+
+vec3 SampleAlbedo(ivec2 albedo, vec2 uv)
+{
+	/*index of sampler array must be dynamically uniform, objectID is not inside one multi-draw call. So only use constant index here*/
+	vec3 coord = vec3(uv, albedo.y);
+	if(albedo.x == 0)
+		return texture(albedoArrays[0], coord).rgb;
+	else if(albedo.x == 1)
+		return texture(albedoArrays[1], coord).rgb;
+	else if(albedo.x == 2)
+		return texture(albedoArrays[2], coord).rgb;
+	return texture(albedoArrays[3], coord).rgb;
+}
 
 /*Sonar light parameters*/
 uniform float waveMaxDepth;
@@ -59,9 +95,17 @@ float ComputeLightVisibleRatio(float distance)
 
 void main()
 {
+	modelMat = objects[fObjectID].modelMat;
+	MaterialData materialData = materials[fObjectID];
+	material.ka = materialData.ka.rgb;
+	material.kd = materialData.kd.rgb;
+	material.ks = materialData.ks.rgb;
+	material.shiness = materialData.ks.w;
+	material.color = materialData.color.rgb;
+
 	vec3 albedo;
-	if(useAlbedoTex==1)
-		albedo = texture(material.albedoTex, fUV).rgb;
+	if(materialData.albedo.x >= 0)
+		albedo = SampleAlbedo(materialData.albedo.xy, fUV);
 	else
 		albedo = material.color;
 
@@ -0,0 +1,47 @@
+#version 450 core
+
+/*same as "sonarLight.vs", but vertex attributes are fetched by gl_VertexID*/
+/*vertex pulling: attributes are read from geometry pool buffers(bound by Rasterizer), no vertex attribute is used.
+gl_VertexID already includes the base vertex of the draw(glDrawElementsBaseVertex or indirect command), so it indexes the whole pool.
+[Note] arrays of float instead of vec3, because vec3 array has 16 bytes stride in std430 while pool buffers are tightly packed*/
+layout (std430, binding = 4) readonly buffer PositionBuffer { float positions[]; };
+layout (std430, binding = 5) readonly buffer NormalBuffer { float normals[]; };
+layout (std430, binding = 6) readonly buffer UVBuffer { float uvs[]; };
+
+vec3 FetchPosition() { int i = gl_VertexID*3; return vec3(positions[i], positions[i+1], positions[i+2]); }
+vec3 FetchNormal() { int i = gl_VertexID*3; return vec3(normals[i], normals[i+1], normals[i+2]); }
+vec2 FetchUV() { int i = gl_VertexID*2; return vec2(uvs[i], uvs[i+1]); }
+
+layout (location = 3) in uint vObjectID; /*instanced attribute, equals to baseInstance of the draw(Rasterizer::Draw or indirect command)*/
+
+/*model matrix is read from ObjectBuffer(see GPUCulling), so objects can be drawn by one multi-draw call*/
+struct ObjectData
+{
+	mat4 modelMat;
+	vec4 aabbMin;
+	vec4 aabbMax;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+layout (std430, binding = 0) readonly buffer ObjectBuffer { ObjectData objects[]; };
+
+uniform mat4 viewMat;
+uniform mat4 projectMat;
+
+out vec3 fPos;
+out vec3 fNormal;
+out vec2 fUV;
+flat out uint fObjectID;
+
+void main()
+{
+	mat4 modelMat = objects[vObjectID].modelMat;
+	vec3 vPos = FetchPosition();
+	gl_Position = projectMat*viewMat*modelMat*vec4(vPos, 1);
+	fPos = vPos;
+	fNormal = FetchNormal();
+	fUV = FetchUV();
+	fObjectID = vObjectID;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 450 core
+
+layout (local_size_x = 8, local_size_y = 8) in; /*must be the same as "groupSize" in TextureArrayManager::UploadLayer()*/
+
+uniform sampler2D srcTex; /*any color format, texelFetch reads its base level*/
+layout (rgba8, binding = 0) writeonly uniform image2D layerImage; /*level 0 of one layer of a texture array*/
+uniform int layerSize;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(texel, ivec2(layerSize))))
+		return;
+
+	/*bilinear resampling: map texel centers, then interpolate four nearest source texels(clamped, not wrapped)*/
+	ivec2 srcSize = textureSize(srcTex, 0);
+	vec2 src = clamp((vec2(texel)+0.5)*vec2(srcSize)/layerSize - 0.5, vec2(0), vec2(srcSize-1));
+	ivec2 p0 = ivec2(src);
+	ivec2 p1 = min(p0 + 1, srcSize - 1);
+	vec2 w = src - vec2(p0);
+	vec4 v00 = texelFetch(srcTex, p0, 0);
+	vec4 v10 = texelFetch(srcTex, ivec2(p1.x, p0.y), 0);
+	vec4 v01 = texelFetch(srcTex, ivec2(p0.x, p1.y), 0);
+	vec4 v11 = texelFetch(srcTex, p1, 0);
+	imageStore(layerImage, texel, mix(mix(v00, v10, w.x), mix(v01, v11, w.x), w.y));
+}
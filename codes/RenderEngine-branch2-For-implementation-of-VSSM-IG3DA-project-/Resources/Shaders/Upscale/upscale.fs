@@ -0,0 +1,48 @@
+#version 450 core
+
+// upscale the scene(rendered at internal resolution) to window size
+
+in vec2 fUV;
+
+uniform sampler2D sourceTex; // linear filtering
+uniform vec2 sourceTexelSize; // 1/width, 1/height of sourceTex
+uniform int filterType; // 0: bilinear, 1: edge-aware
+
+out vec4 colorResponse;
+
+const float EDGE_SHARPNESS = 16.0; // larger value keeps edges sharper
+
+float Luma(vec3 _color)
+{
+	return dot(_color, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+	if (filterType == 0)
+	{
+		colorResponse = vec4(texture(sourceTex, fUV).rgb, 1);
+		return;
+	}
+
+	// edge-aware: bilinear weights of the 2x2 footprint are attenuated by their luma difference to the nearest texel,
+	// so that texels on the other side of an edge contribute less(edges stay sharp instead of being blurred)
+	vec2 pos = fUV / sourceTexelSize - 0.5;
+	vec2 base = floor(pos);
+	vec2 f = pos - base;
+	ivec2 maxCoord = textureSize(sourceTex, 0) - 1;
+	ivec2 p00 = clamp(ivec2(base), ivec2(0), maxCoord);
+	ivec2 p11 = clamp(ivec2(base) + 1, ivec2(0), maxCoord);
+	vec3 c00 = texelFetch(sourceTex, p00, 0).rgb;
+	vec3 c10 = texelFetch(sourceTex, ivec2(p11.x, p00.y), 0).rgb;
+	vec3 c01 = texelFetch(sourceTex, ivec2(p00.x, p11.y), 0).rgb;
+	vec3 c11 = texelFetch(sourceTex, p11, 0).rgb;
+
+	vec4 w = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+	vec4 luma = vec4(Luma(c00), Luma(c10), Luma(c01), Luma(c11));
+	float lumaNearest = f.x < 0.5 ? (f.y < 0.5 ? luma.x : luma.z) : (f.y < 0.5 ? luma.y : luma.w);
+	w *= exp(-EDGE_SHARPNESS * abs(luma - lumaNearest));
+	w /= max(w.x + w.y + w.z + w.w, 1e-5);
+
+	colorResponse = vec4(c00 * w.x + c10 * w.y + c01 * w.z + c11 * w.w, 1);
+}
\ No newline at end of file
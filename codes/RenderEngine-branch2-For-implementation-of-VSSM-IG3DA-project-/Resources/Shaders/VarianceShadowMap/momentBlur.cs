@@ -0,0 +1,48 @@
+#version 450 core
+
+/*prefiltered VSM("use_blur"): separable box blur of moments in light space, one dispatch per direction and per shadow view*/
+/*each pass costs O(kernel size) per texel, lighting then only needs one bilinear fetch of the blurred moments*/
+layout (local_size_x = 8, local_size_y = 8) in; /*must be the same as "groupSize" in VarianceShadowMapRender::BlurMoment()*/
+
+uniform sampler2D texInput; /*moments(depth, depthSquare) of the atlas for the horizontal pass, output of horizontal pass for the vertical one*/
+/*no format qualifier(allowed for writeonly images): RG32F for VSM, RGBA32F for EVSM*/
+layout (binding = 0) writeonly uniform image2D imageOutput;
+
+uniform vec4 tileRect; /*(x, y, width, height) of the tile of current view, reads are clamped inside it so tiles never blur into each other*/
+uniform vec4 blurRect; /*(x, y, width, height) of texels written by this dispatch*/
+uniform int vertical; /*0: horizontal, 1: vertical*/
+uniform int halfKernelSize; /*half kernel size: e.g. 2 is 5X5 kernel*/
+
+/*EVSM: depth is warped to [-1,1], then to exponential moments (e^(c+ d), e^(2c+ d), -e^(-c- d), e^(-2c- d)) before being blurred*/
+/*refer: "Layered Variance Shadow Maps"(Lauritzen, McCool 2008), exponential warp*/
+uniform int toEVSM; /*1: convert depth into EVSM moments when reading input, only for the horizontal pass*/
+uniform vec2 evsmExponents; /*c+, c-. e^(2c+) must fit in 32-bit float(also scaled by c+^2 in lighting), so c+ <= 40*/
+
+vec4 LoadMoment(ivec2 texel)
+{
+	ivec4 tile = ivec4(tileRect);
+	vec4 value = texelFetch(texInput, clamp(texel, tile.xy, tile.xy + tile.zw - 1), 0);
+	if(toEVSM == 1)
+	{
+		float depth = 2.0*value.x - 1.0;
+		float pos = exp(evsmExponents.x*depth);
+		float neg = -exp(-evsmExponents.y*depth);
+		return vec4(pos, pos*pos, neg, neg*neg);
+	}
+	return value;
+}
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec4 rect = ivec4(blurRect);
+	if(any(greaterThanEqual(texel, rect.zw)))
+		return;
+	texel += rect.xy;
+
+	ivec2 axis = vertical == 1 ? ivec2(0, 1) : ivec2(1, 0);
+	vec4 sum = vec4(0);
+	for(int i = -halfKernelSize; i <= halfKernelSize; i++)
+		sum += LoadMoment(texel + i*axis);
+	imageStore(imageOutput, texel, sum / float(2*halfKernelSize + 1));
+}
@@ -0,0 +1,38 @@
+#version 450 core
+
+/*layered pass(see BasicShadowMapRender::RenderLayered): each object is drawn once with one instance per light, gl_InstanceID selects the light*/
+layout (location = 0) in vec3 vPos;
+
+struct ShadowLight
+{
+	mat4 lightMat; /*light space matrix(perspective or orthogonal projection)*/
+	vec4 tileTransform; /*xy: scale, zw: offset from NDC of light to NDC of its tile in shadow atlas*/
+	vec4 lightCamPosNear; /*xyz: lightCamPos, w: near*/
+	vec4 lightViewDirFar; /*xyz: lightViewDir, w: far*/
+};
+layout (std430, binding = 1) readonly buffer ShadowLightBuffer { ShadowLight shadowLights[]; };
+
+uniform mat4 modelMat;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+	float gl_ClipDistance[4];
+};
+out vec3 worldPos;
+flat out int lightIndex; /*index of "shadowLights"*/
+
+void main()
+{
+	ShadowLight light = shadowLights[gl_InstanceID];
+	vec4 clipPos = light.lightMat*modelMat*vec4(vPos, 1);
+	/*viewport is the whole atlas, clip against light frustum by ourselves. Otherwise triangles leak into neighbour tiles*/
+	gl_ClipDistance[0] = clipPos.w + clipPos.x;
+	gl_ClipDistance[1] = clipPos.w - clipPos.x;
+	gl_ClipDistance[2] = clipPos.w + clipPos.y;
+	gl_ClipDistance[3] = clipPos.w - clipPos.y;
+	/*move into the tile: ndc*scale + offset, in homogeneous coordinates*/
+	gl_Position = vec4(clipPos.xy*light.tileTransform.xy + clipPos.w*light.tileTransform.zw, clipPos.zw);
+	worldPos = (modelMat*vec4(vPos, 1)).xyz;
+	lightIndex = gl_InstanceID;
+}
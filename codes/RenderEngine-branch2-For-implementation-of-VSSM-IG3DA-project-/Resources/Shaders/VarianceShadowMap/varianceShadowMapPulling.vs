@@ -0,0 +1,21 @@
+#version 450 core
+
+/*same as "varianceShadowMap.vs", but position is fetched by gl_VertexID*/
+/*vertex pulling: position is read from geometry pool buffer(bound by Rasterizer), no vertex attribute is used.
+gl_VertexID already includes the base vertex of the draw(glDrawElementsBaseVertex or indirect command), so it indexes the whole pool.
+[Note] array of float instead of vec3, because vec3 array has 16 bytes stride in std430 while pool buffers are tightly packed*/
+layout (std430, binding = 4) readonly buffer PositionBuffer { float positions[]; };
+
+vec3 FetchPosition() { int i = gl_VertexID*3; return vec3(positions[i], positions[i+1], positions[i+2]); }
+
+uniform mat4 modelMat;
+uniform mat4 lightMat; /*light space matrix(perspective or orthogonal projection)*/
+
+out vec3 worldPos;
+
+void main()
+{
+	vec3 vPos = FetchPosition();
+	gl_Position = lightMat*modelMat*vec4(vPos, 1);
+	worldPos = (modelMat*vec4(vPos, 1)).xyz;
+}
\ No newline at end of file
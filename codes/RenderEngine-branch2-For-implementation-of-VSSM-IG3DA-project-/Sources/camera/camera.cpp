@@ -11,6 +11,8 @@ Camera::Camera(float _fov, float _aspect, float _near, float _far)
 	cParams[2] = _near;
 	cParams[3] = _far;
 
+	jitter = glm::vec2(0);
+
 	transform = make_shared<Transform>();
 }
 
@@ -62,7 +64,11 @@ glm::mat4 Camera::GetViewMatrix() const
 
 glm::mat4 Camera::GetProjectionMatrix() const
 {
-	return glm::perspective(glm::radians(cParams[0]), cParams[1], cParams[2], cParams[3]);
+	glm::mat4 projMat = glm::perspective(glm::radians(cParams[0]), cParams[1], cParams[2], cParams[3]);
+	// translate in NDC after perspective division: clip.xy += jitter * clip.w, where clip.w = -z_view
+	projMat[2][0] -= jitter.x;
+	projMat[2][1] -= jitter.y;
+	return projMat;
 }
 
 float Camera::GetCameraParameter(CameraIndex _index) const
@@ -73,4 +79,7 @@ float Camera::GetCameraParameter(CameraIndex _index) const
 void Camera::SetCameraParameter(CameraIndex _index, float _value)
 {
 	cParams[static_cast<int>(_index)] = _value;
-}
\ No newline at end of file
+}
+
+glm::vec2 Camera::GetJitter() const { return jitter; }
+void Camera::SetJitter(const glm::vec2& _jitter) { jitter = _jitter; }
\ No newline at end of file
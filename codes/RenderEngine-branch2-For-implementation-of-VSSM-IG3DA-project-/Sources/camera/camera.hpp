@@ -24,6 +24,8 @@ namespace IceRender
 		// parameters for camera
 		float cParams[static_cast<int>(CameraIndex::SIZE)]; // 0:fov(in degree), 1:aspect, 2:near, 3:far
 
+		glm::vec2 jitter; // sub-pixel offset in NDC added to projection(used by TAA), zero by default
+
 	public:
 		Camera(float _fov, float _aspect, float _near, float _far);
 		~Camera();
@@ -36,6 +38,9 @@ namespace IceRender
 
 		float GetCameraParameter(CameraIndex _index) const;
 		void SetCameraParameter(CameraIndex _index, float _value);
+
+		glm::vec2 GetJitter() const;
+		void SetJitter(const glm::vec2& _jitter);
 	};
 }
 
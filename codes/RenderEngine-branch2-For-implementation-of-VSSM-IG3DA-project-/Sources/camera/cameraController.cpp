@@ -21,6 +21,7 @@ CameraController::CameraController()
 	rotSpeed = 0;
 	zoomSpeed = 0;
 	isLogCam = false;
+	currentView = 0;
 }
 
 CameraController::~CameraController() {}
@@ -130,6 +131,33 @@ void CameraController::ResetCamera()
 }
 
 void CameraController::SetLogCamInfo(bool _isLog) { isLogCam = _isLog; }
-shared_ptr<Camera> CameraController::GetActiveCamera() const { return camera; }
+shared_ptr<Camera> CameraController::GetActiveCamera() const { return GetView(currentView); }
 void CameraController::SetCameraPosition(const glm::vec3& _pos) { camera->GetTransform()->SetPosition(_pos); }
 void CameraController::SetCameraRotation(const glm::vec3& _rot) { pitchAngle = _rot.x; yawAngle = _rot.y; camera->GetTransform()->SetRotation(_rot); }
+
+int CameraController::AddView(const glm::vec3& _pos, const glm::vec3& _rot)
+{
+	auto view = make_shared<Camera>(camera->GetCameraParameter(CameraIndex::FOV), camera->GetCameraParameter(CameraIndex::ASPECT),
+		camera->GetCameraParameter(CameraIndex::NEAR), camera->GetCameraParameter(CameraIndex::FAR));
+	view->GetTransform()->SetPosition(_pos);
+	view->GetTransform()->SetRotation(_rot);
+	extraViews.push_back(view);
+	return static_cast<int>(extraViews.size());
+}
+
+void CameraController::RemoveView(const int& _viewIndex)
+{
+	if (_viewIndex <= 0 || _viewIndex > static_cast<int>(extraViews.size()))
+	{
+		Print("[Error] Invalid view index: " + std::to_string(_viewIndex));
+		return;
+	}
+	extraViews.erase(extraViews.begin() + (_viewIndex - 1));
+	currentView = 0;
+}
+
+void CameraController::ClearViews() { extraViews.clear(); currentView = 0; }
+int CameraController::GetViewNum() const { return 1 + static_cast<int>(extraViews.size()); }
+shared_ptr<Camera> CameraController::GetView(const int& _viewIndex) const { return _viewIndex <= 0 || _viewIndex > static_cast<int>(extraViews.size()) ? camera : extraViews[_viewIndex - 1]; }
+int CameraController::GetCurrentView() const { return currentView; }
+void CameraController::SetCurrentView(const int& _viewIndex) { currentView = _viewIndex; }
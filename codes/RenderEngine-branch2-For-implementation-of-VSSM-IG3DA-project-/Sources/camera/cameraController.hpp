@@ -1,6 +1,7 @@
 #pragma once
 
 #include "camera.hpp"
+#include <vector>
 
 namespace IceRender
 {
@@ -42,11 +43,20 @@ namespace IceRender
 	
 	using namespace CameraDefinition;
 
+	/*
+	* [Note] multi-view: view 0 is always the controlled camera, other views are fixed cameras added by AddView()(e.g. split-screen previews, dataset viewpoints).
+	* While Rasterizer renders view i, GetActiveCamera() returns the camera of view i, so render methods don't need to know about views.
+	* Input(move/rotate/zoom) only affects the controlled camera.
+	*/
 	class CameraController
 	{
 	private:
 		shared_ptr<Camera> camera;
 
+		// multi-view
+		vector<shared_ptr<Camera>> extraViews; // view 1, 2, ...
+		int currentView; // view being rendered
+
 		// update flag
 		UpdateFlags flag;
 
@@ -84,7 +94,15 @@ namespace IceRender
 		// for debug
 		void SetLogCamInfo(bool _isLog);
 
-		shared_ptr<Camera> GetActiveCamera() const;
+		shared_ptr<Camera> GetActiveCamera() const; // camera of current view(the controlled camera outside of rendering)
+
+		int AddView(const glm::vec3& _pos, const glm::vec3& _rot); // add a camera view with the same parameters as the controlled camera, return its view index
+		void RemoveView(const int& _viewIndex); // view 0 can not be removed
+		void ClearViews(); // only keep view 0
+		int GetViewNum() const;
+		shared_ptr<Camera> GetView(const int& _viewIndex) const;
+		int GetCurrentView() const;
+		void SetCurrentView(const int& _viewIndex);
 
 		void SetCameraPosition(const glm::vec3& _pos);
 		void SetCameraRotation(const glm::vec3& _rot);
@@ -35,6 +35,8 @@ void Console::HandleCommand(const std::string& _command)
 	CommandMap("print_active_shader", GLOBAL.shaderMgr->PrintActiveShader())
 	CommandMap("exit_show_image", Utility::ExitShowImage())
 	CommandMap("clear_all", GLOBAL.sceneMgr->ClearAll(); GLOBAL.shadowMgr->RemoveShadowRender(); GLOBAL.shaderMgr->Clear(); Print("Clear All things."))
+	CommandMap("frame_graph", GLOBAL.render->GetFrameGraph()->PrintInfo())
+	CommandMap("clear_views", GLOBAL.camCtrller->ClearViews())
 	CommandMap("save_screenshot", if(Utility::SaveTextureToPNG("screenshot_"+Utility::GetCurrentTimeStr(), GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT, GL_RGBA, 0)) Print("Screenshot saved."))
 
 	// ------------------------------------------------------------------------------ //
@@ -126,6 +128,27 @@ void Console::HandleCommand(const std::string& _command)
 			}
 		})
 
+	CommandParamMap(
+		std::string("add_view"),
+		std::string params,
+		{ 
+			std::vector<std::string> v = Utility::SplitString(params, " ");
+			if (v.size() != 6)
+				Print("Error Params: Require 6 params(position and rotation). EX: add_view 0 1 5 0 0 0");
+			else
+			{
+				glm::vec3 pos(std::stof(v[0]), std::stof(v[1]), std::stof(v[2]));
+				glm::vec3 rot(std::stof(v[3]), std::stof(v[4]), std::stof(v[5]));
+				int viewIndex = GLOBAL.camCtrller->AddView(pos, rot);
+				Print("Add camera view " + std::to_string(viewIndex));
+			}
+		})
+
+	CommandParamMap(
+		std::string("remove_view"),
+		std::string params,
+		{ GLOBAL.camCtrller->RemoveView(std::stoi(params)); })
+
 	CommandParamMap(
 		std::string("show_image"),
 		std::string params,
@@ -205,6 +228,123 @@ void Console::HandleCommand(const std::string& _command)
 					Print("Reload ShadowRender failed.");
 			}
 		})
+
+	CommandParamMap(
+		std::string("gpu_culling"),
+		std::string params,
+		{ int isUse = std::stoi(params); GLOBAL.render->SetUseGPUCulling(isUse);
+		std::string msgPrefix = isUse ? "Enable" : "Disable";
+		Print(msgPrefix + " GPU frustum culling");})
+
+	CommandParamMap(
+		std::string("vertex_pulling"),
+		std::string params,
+		{ int isUse = std::stoi(params); GLOBAL.render->SetUseVertexPulling(isUse);
+		std::string msgPrefix = isUse ? "Enable" : "Disable";
+		Print(msgPrefix + " vertex pulling");})
+
+	CommandParamMap(
+		std::string("set_aa"),
+		std::string params,
+		{
+			AAMode aaMode;
+			if (AntiAliasing::ParseMode(params, aaMode))
+			{
+				GLOBAL.render->GetAntiAliasing()->SetMode(aaMode);
+				Print("Set anti-aliasing mode: " + params);
+			}
+			else
+				Print("Error Params: anti-aliasing mode must be one of OFF/MSAA2/MSAA4/MSAA8/FXAA/TAA.");
+		})
+
+	CommandParamMap(
+		std::string("set_render_scale"),
+		std::string params,
+		{
+			GLOBAL.render->SetRenderScale(std::stof(params));
+			Print("Render resolution: " + std::to_string(GLOBAL.RENDER_WIDTH) + "x" + std::to_string(GLOBAL.RENDER_HEIGHT));
+		})
+
+	CommandParamMap(
+		std::string("set_upscale_filter"),
+		std::string params,
+		{
+			UpscaleFilter filter;
+			if (AntiAliasing::ParseUpscaleFilter(params, filter))
+			{
+				GLOBAL.render->GetAntiAliasing()->SetUpscaleFilter(filter);
+				Print("Set upscale filter: " + params);
+			}
+			else
+				Print("Error Params: upscale filter must be BILINEAR or EDGE_AWARE.");
+		})
+
+	CommandParamMap(
+		std::string("ssao"),
+		std::string params,
+		{ int isUse = std::stoi(params); GLOBAL.render->GetSSAO()->SetEnabled(isUse);
+		std::string msgPrefix = isUse ? "Enable" : "Disable";
+		Print(msgPrefix + " SSAO");})
+
+	CommandParamMap(
+		std::string("set_ssao"),
+		std::string params,
+		{
+			std::vector<std::string> v = Utility::SplitString(params, " ");
+			if (v.size() != 4)
+				Print("Error Params: Require 4 params. EX: set_ssao 2 8 0.5 1");
+			else
+			{
+				auto ssao = GLOBAL.render->GetSSAO();
+				ssao->SetDownscale(std::stoi(v[0]));
+				ssao->SetSampleNum(std::stoi(v[1]));
+				ssao->SetRadius(std::stof(v[2]));
+				ssao->SetIntensity(std::stof(v[3]));
+				Print("SSAO: 1/" + std::to_string(ssao->GetDownscale()) + " resolution, " + std::to_string(ssao->GetSampleNum()) + " samples, radius " +
+					std::to_string(ssao->GetRadius()) + ", intensity " + std::to_string(ssao->GetIntensity()));
+			}
+		})
+
+	CommandParamMap(
+		std::string("set_texture_upload_budget"),
+		std::string params,
+		{
+			auto streamer = GLOBAL.render->GetTextureStreamer();
+			streamer->SetUploadBudget(static_cast<size_t>(std::stoi(params)) * 1024);
+			Print("Texture upload budget: " + std::to_string(streamer->GetUploadBudget() / 1024) + " KB per frame, pending textures: " + std::to_string(streamer->GetPendingNum()));
+		})
+
+	CommandParamMap(
+		std::string("software_threads"),
+		std::string params,
+		{
+			int threadNum = std::stoi(params);
+			GLOBAL.render->GetSoftwareRasterizer()->SetThreadNum(threadNum);
+			GLOBAL.render->GetRayTracer()->SetThreadNum(threadNum);
+			Print("CPU renderer worker threads: " + (threadNum > 0 ? std::to_string(threadNum) : std::string("hardware concurrency")));
+		})
+
+	CommandParamMap(
+		std::string("ray_tracer_samples"),
+		std::string params,
+		{
+			auto rayTracer = GLOBAL.render->GetRayTracer();
+			rayTracer->SetLightSampleNum(std::stoi(params));
+			Print("Ray tracer area light samples: " + std::to_string(rayTracer->GetLightSampleNum()));
+		})
+
+	CommandParamMap(
+		std::string("save_ray_traced_image"),
+		std::string params,
+		{
+			if (!params.empty())
+			{
+				glm::ivec4 viewRect = GLOBAL.render->GetViewRect(0); // controlled camera
+				const auto& pixels = GLOBAL.render->GetRayTracer()->RenderImage(viewRect.z, viewRect.w);
+				if (!pixels.empty())
+					Utility::SavePixelsToPNG(params, viewRect.z, viewRect.w, pixels.data());
+			}
+		})
 	// ------------------------------------------------------------------------------ //
 #undef CommandParamMap
 	
@@ -244,6 +384,9 @@ void Console::PrintHelp()
 	helpMsg.append("\t-Command: 'set_cam_pos/set_cam_rot x y z' to set camera's position or rotation.\n");
 	helpMsg.append("\t\te.g. 'set_cam_pos 0 1 2' -> camera's position will become (0, 1, 2).\n");
 
+	helpMsg.append("\t-Command: 'add_view px py pz rx ry rz' to add a camera view, views are rendered side by side and share shadow maps.\n");
+	helpMsg.append("\t-Command: 'remove_view i' to remove camera view i(view 0 is the controlled camera), 'clear_views' to remove all added views.\n");
+
 	helpMsg.append("\t-Command: 'show_image params/exit_show_image' to show an image or exit to show it.\n");
 	helpMsg.append("\t\tparams must be relative path to folder \"Resources/Images/\", e.g.\"Simple/earth.jpg\".\n");
 	
@@ -263,6 +406,28 @@ void Console::PrintHelp()
 	helpMsg.append("\t-Command: 'load_shadow_config params' to reload the shadow config from scene config file.\n");
 	helpMsg.append("\t\tparams must be a json file which can be located inside \"Resources/SceneConfigs/\", e.g.\"xx.json\".\n");
 	
+	helpMsg.append("\t-Command: 'gpu_culling 0/1' to disable/enable GPU frustum culling(indirect draws).\n");
+	helpMsg.append("\t-Command: 'vertex_pulling 0/1' to disable/enable vertex pulling(vertex attributes are fetched from storage buffers, one vertex array for all meshes).\n");
+
+	helpMsg.append("\t-Command: 'set_aa params' to set anti-aliasing mode.\n");
+	helpMsg.append("\t\tparams must be one of OFF/MSAA2/MSAA4/MSAA8/FXAA/TAA, e.g. 'set_aa TAA'.\n");
+
+	helpMsg.append("\t-Command: 'set_render_scale x' to render scene at x times window size(0.25 to 2.0), then upscale it to window.\n");
+	helpMsg.append("\t-Command: 'set_upscale_filter params' to set upscale filter, params must be BILINEAR or EDGE_AWARE.\n");
+
+	helpMsg.append("\t-Command: 'ssao 0/1' to disable/enable screen-space ambient occlusion(ambient term of Phong).\n");
+	helpMsg.append("\t-Command: 'set_ssao d n r i' to compute SSAO at 1/d resolution(2 or 4) with n samples(4 to 16), radius r and intensity i.\n");
+
+	helpMsg.append("\t-Command: 'set_texture_upload_budget x' to upload at most x KB(at least 256) of streamed textures per frame.\n");
+
+	helpMsg.append("\t-Command: 'software_threads n' to use n worker threads(0 means hardware concurrency) in render methods RenderSoftware and RenderRayTracing.\n");
+	helpMsg.append("\t-Command: 'ray_tracer_samples n' to trace n shadow rays(rounded to a square number, at most 256) per area light per pixel.\n");
+	helpMsg.append("\t-Command: 'save_ray_traced_image params' to save a ray traced reference image of current camera as PNG file into Output folder.\n");
+	helpMsg.append("\t\tparams is the file name, area light size comes from PCSS \"light_size\" of current shadow config.\n");
+	helpMsg.append("\t\tWithout window(no GPU needed): 'IceRender --ray_trace sceneConfig fileName [width height]'.\n");
+
+	helpMsg.append("\t-Command: 'frame_graph' to print passes(in execution order, culled ones) and transient texture memory of last frame.\n");
+
 	helpMsg.append("\t-Press F3 to execute last command.\n");
 
 	helpMsg.append("\n----------------------------------------------------------------------------------------------------------\n");
@@ -2,10 +2,13 @@
 
 using namespace IceRender;
 
-Globals::Globals() : defaultRenderMethod("RenderSimple"), shaderPathPrefix("Resources/Shaders/"), defaultShaderName("Simple/simple"), imagePathPrefix("Resources/Images/")
+Globals::Globals() : defaultRenderMethod("RenderSimple"), shaderPathPrefix("Resources/Shaders/"), defaultShaderName("Simple/simple"), imagePathPrefix("Resources/Images/"),
+	defaultAntiAliasing("FXAA"), headless(false)
 {
 	WIN_WIDTH = 800;
 	WIN_HEIGHT = 600;
+	RENDER_WIDTH = WIN_WIDTH;
+	RENDER_HEIGHT = WIN_HEIGHT;
 
 	// using https://www.desmos.com/calculator and formual 1/(1+l*x+q*x*x) which is "\frac{1}{1+l\cdot x+q\cdot x^{2}}" in this website
 	// and setting all these parameters by hand
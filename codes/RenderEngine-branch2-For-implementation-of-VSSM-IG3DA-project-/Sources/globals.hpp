@@ -31,6 +31,9 @@ namespace IceRender
 		// screen
 		int WIN_WIDTH;
 		int WIN_HEIGHT;
+		// internal render resolution(scene is rendered at this size then upscaled to window), use Rasterizer::SetRenderScale() to change it
+		int RENDER_WIDTH;
+		int RENDER_HEIGHT;
 
 #pragma region camera parameters
 		// camera parameters by default
@@ -52,6 +55,11 @@ namespace IceRender
 
 		const std::string imagePathPrefix;
 
+		const std::string defaultAntiAliasing; // one of "OFF", "MSAA2", "MSAA4", "MSAA8", "FXAA", "TAA"
+
+		// no OpenGL context(command line "--software"), scenes are only loaded into CPU data and rendered by CPU renderers. OpenGL objects are never created.
+		bool headless;
+
 		std::map<int, glm::vec2> attenuationMap;
 
 		std::shared_ptr<Logger> logger;
@@ -0,0 +1,68 @@
+#include "cpuTextureCache.hpp"
+#include "utility.hpp"
+#include "../globals.hpp"
+#include <stb_image.h>
+#include <cmath>
+#include <cstring>
+
+using namespace IceRender;
+
+glm::vec3 CPUTexture::Sample(const glm::vec2& _uv) const
+{
+	float fx = (_uv.x - std::floor(_uv.x)) * width - 0.5f;
+	float fy = (_uv.y - std::floor(_uv.y)) * height - 0.5f;
+	int x0 = static_cast<int>(std::floor(fx)), y0 = static_cast<int>(std::floor(fy));
+	float tx = fx - x0, ty = fy - y0;
+	auto Texel = [&](int _x, int _y)
+	{
+		_x = (_x % width + width) % width;
+		_y = (_y % height + height) % height;
+		const unsigned char* p = &pixels[(static_cast<size_t>(_y) * width + _x) * 4];
+		return glm::vec3(p[0], p[1], p[2]) / 255.0f;
+	};
+	return glm::mix(glm::mix(Texel(x0, y0), Texel(x0 + 1, y0), tx), glm::mix(Texel(x0, y0 + 1), Texel(x0 + 1, y0 + 1), tx), ty);
+}
+
+const CPUTexture* CPUTextureCache::Get(const GLuint& _texID)
+{
+	auto iter = textures.find(_texID);
+	if (iter != textures.end())
+		return &iter->second;
+	if (!glIsTexture(_texID))
+		return nullptr;
+
+	CPUTexture texture;
+	glGetTextureLevelParameteriv(_texID, 0, GL_TEXTURE_WIDTH, &texture.width);
+	glGetTextureLevelParameteriv(_texID, 0, GL_TEXTURE_HEIGHT, &texture.height);
+	if (texture.width <= 0 || texture.height <= 0)
+		return nullptr;
+	texture.pixels.resize(static_cast<size_t>(texture.width) * texture.height * 4);
+	glGetTextureImage(_texID, 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<GLsizei>(texture.pixels.size()), texture.pixels.data());
+	if (CheckGLError()) { Print("Error in CPUTextureCache::Get."); return nullptr; }
+	return &(textures[_texID] = std::move(texture));
+}
+
+const CPUTexture* CPUTextureCache::Get(const std::string& _fileName)
+{
+	auto iter = files.find(_fileName);
+	if (iter != files.end())
+		return iter->second.pixels.empty() ? nullptr : &iter->second;
+
+	// a failed file is cached as empty, so it is reported once
+	CPUTexture& texture = files[_fileName];
+	int channel;
+	std::string total = GLOBAL.imagePathPrefix + _fileName;
+	stbi_set_flip_vertically_on_load_thread(true); // bottom row first, same as GPU textures
+	unsigned char* data = stbi_load(total.c_str(), &texture.width, &texture.height, &channel, 4); // always RGBA
+	if (data == nullptr)
+	{
+		Print("[Error] Can not open file " + _fileName + " to load texture, reason: " + stbi_failure_reason());
+		return nullptr;
+	}
+	texture.pixels.resize(static_cast<size_t>(texture.width) * texture.height * 4);
+	std::memcpy(texture.pixels.data(), data, texture.pixels.size());
+	stbi_image_free(data);
+	return &texture;
+}
+
+void CPUTextureCache::Clear() { textures.clear(); files.clear(); }
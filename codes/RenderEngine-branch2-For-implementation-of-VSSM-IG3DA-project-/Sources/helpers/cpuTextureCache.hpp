@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace IceRender
+{
+	// RGBA8 copy of level 0 of a GPU texture(or of an image file without OpenGL context), used by CPU renderers(SoftwareRasterizer, RayTracer)
+	struct CPUTexture
+	{
+		int width, height;
+		std::vector<unsigned char> pixels;
+
+		glm::vec3 Sample(const glm::vec2& _uv) const; // bilinear, repeat
+	};
+
+	class CPUTextureCache
+	{
+	private:
+		std::map<GLuint, CPUTexture> textures;
+		std::map<std::string, CPUTexture> files;
+
+	public:
+		const CPUTexture* Get(const GLuint& _texID); // read back from GPU at the first call, return null if it is not a valid texture
+		const CPUTexture* Get(const std::string& _fileName); // decode image file(relative to GLOBAL.imagePathPrefix) at the first call, no OpenGL needed. Return null if it fails
+		void Clear();
+	};
+}
@@ -1,6 +1,6 @@
 #include "satGenerator.hpp"
 #include "../helpers/utility.hpp"
-#include "../mesh/meshGenerator.hpp"
+#include "../globals.hpp"
 
 using namespace IceRender;
 
@@ -9,6 +9,7 @@ SATConfig::SATConfig()
 	resWidth = resHeight = componentNum = 0;
 	inputTexID = 0;
 	texGenerator = nullptr;
+	fixedPointScale = 0;
 }
 
 SATConfig::SATConfig(const SATConfig& _config)
@@ -18,8 +19,11 @@ SATConfig::SATConfig(const SATConfig& _config)
 	inputTexID = _config.inputTexID;
 	componentNum = _config.componentNum;
 	texGenerator = _config.texGenerator;
+	fixedPointScale = _config.fixedPointScale;
 }
 
+SummedAreaTableGenerator::SummedAreaTableGenerator() : satTex(0), ownScratchTex(0), N(0), M(0), useComputeScan(false), satFormat(0), isGenerated(false) {}
+
 SummedAreaTableGenerator::~SummedAreaTableGenerator() { Clear(); };
 
 void SummedAreaTableGenerator::Init(const SATConfig& _config)
@@ -30,52 +34,94 @@ void SummedAreaTableGenerator::Init(const SATConfig& _config)
 	N = std::ceil(std::log2(config.resWidth));
 	M = std::ceil(std::log2(config.resHeight));
 
-	// create texA, texB
-	config.texGenerator(texA, config.resWidth, config.resHeight);
-	config.texGenerator(texB, config.resWidth, config.resHeight);
-	
-	// create framebuffer, texA is passed into uniform variable, then output to framebuffer(texB is bound to this framebuffer to received the output)
-	glCreateFramebuffers(1, &fbo);
-	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, texB, 0);
-	glNamedFramebufferDrawBuffer(fbo, GL_COLOR_ATTACHMENT0);
-	CheckGLError();
+	// create SAT texture, scratch texture for ping-pong is provided by caller(or created in Generate())
+	config.texGenerator(satTex, config.resWidth, config.resHeight);
+	ownScratchTex = 0;
+	isGenerated = false;
 
-	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("SummedAreaTableGenerator:: Framebuffer not complete!"); return; }
+	// only formats which can be bound as image(without format qualifier in shader) use the compute path
+	GLint format = 0;
+	glGetTextureLevelParameteriv(satTex, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+	satFormat = static_cast<GLenum>(format);
+	if (config.fixedPointScale > 0)
+	{
+		useComputeScan = satFormat == GL_R32UI || satFormat == GL_RG32UI || satFormat == GL_RGBA32UI;
+		if (!useComputeScan)
+			Print("[Error] SummedAreaTableGenerator: fixed-point SAT requires an unsigned integer format(e.g. GL_RG32UI).");
+	}
+	else
+		useComputeScan = satFormat == GL_R32F || satFormat == GL_RG32F || satFormat == GL_RGBA32F ||
+			satFormat == GL_R16F || satFormat == GL_RG16F || satFormat == GL_RGBA16F;
+
+	// framebuffer is created once and cached by FullscreenPass
+	GLOBAL.render->GetFullscreenPass()->GetFrameBuffer(satTex);
+	CheckGLError();
 
 	// init shader name.
-	horShaderName = GLOBAL.shaderPathPrefix + "SAT/sat" + std::to_string(config.componentNum) + "H";
-	verShaderName = GLOBAL.shaderPathPrefix + "SAT/sat" + std::to_string(config.componentNum) + "V";
+	std::string shaderNamePrefix = GLOBAL.shaderPathPrefix + "SAT/sat" + std::to_string(config.componentNum);
+	copyShaderName = shaderNamePrefix + "Copy";
+	horShaderName = shaderNamePrefix + "H";
+	verShaderName = shaderNamePrefix + "V";
+	reconShaderName = shaderNamePrefix + "Reconstruct";
+	boxFilterShaderName = shaderNamePrefix + "BoxFilter";
+	scanShaderName = GLOBAL.shaderPathPrefix + (config.fixedPointScale > 0 ? "SAT/satScanFixed" : "SAT/satScan");
+}
+
+float SummedAreaTableGenerator::GetFixedPointScale(const int& _maxBoxArea)
+{
+	// [Note] values are stored as signed deltas from 0.5(|delta| <= 0.5), prefix sums wrap around 2^32, a box sum is still exact if the real sum fits
+	// in a signed integer. A delta is round(+-0.5 * scale), up to ceil(0.5 * scale) when scale is odd, so area * (0.5 * scale + 0.5) <= 2^31-1 must hold.
+	// Only the largest box looked up matters, not the SAT size.
+	// Capped at 2^24 so that the quantized deltas are exact in float. E.g. 65x65 box -> ~2^20, 5x5 box -> 2^24 per texel,
+	// the mean of a box is never worse than 0.5/scale, unlike float sums whose rounding grows with the atlas.
+	double area = std::max(_maxBoxArea, 1);
+	double scale = std::floor((2147483647.0 - area) / (0.5 * area));
+	return static_cast<float>(std::min(scale, 16777216.0));
 }
 
 void SummedAreaTableGenerator::Generate()
+{
+	if (ownScratchTex == 0)
+		config.texGenerator(ownScratchTex, config.resWidth, config.resHeight);
+	Generate(ownScratchTex);
+}
+
+void SummedAreaTableGenerator::Generate(const GLuint& _scratchTex) { Generate(_scratchTex, glm::ivec2(0)); }
+
+void SummedAreaTableGenerator::Generate(const GLuint& _scratchTex, const glm::ivec2& _start)
 {
 	// this function will be called every frame.(if it is used to genereate VSM's SAT)
-	
-	glViewport(0, 0, config.resWidth, config.resHeight); CheckGLError();
+	if (useComputeScan)
+	{
+		// texels before "_start" are only valid once the whole SAT was generated
+		GenerateByScan(_scratchTex, isGenerated ? glm::clamp(_start, glm::ivec2(0), glm::ivec2(config.resWidth, config.resHeight)) : glm::ivec2(0));
+		isGenerated = true;
+		return;
+	}
+	if (config.fixedPointScale > 0)
+		return; // no fragment path for fixed-point SAT, see Init()
 
 	// below function requires that two textures internal formats are compatible.
 	//glCopyImageSubData(config.inputTexID, GL_TEXTURE_2D, 0, 0, 0, 0, texA, GL_TEXTURE_2D, 0, 0, 0, 0, config.resWidth, config.resHeight, 1); CheckGLError();
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo); CheckGLError();
-
-	shared_ptr<Mesh> mesh = MeshGenerator::GenPlane(2, 2, Utility::zeroV3, Utility::backV3);
-	shared_ptr<SceneObject> satObj = make_shared<SceneObject>("___SATObj___", mesh);
-	GLOBAL.sceneMgr->AddSceneObj(satObj);
+	auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
 	GLuint texUnit = 0;
 
+	// texA is passed into uniform variable, then output to framebuffer(texB is bound to this framebuffer to received the output)
+	// there are 1+N+M passes and each pass swaps them. Pick the first target so that the last pass writes into satTex.
+	GLuint texA = (N + M) % 2 == 0 ? satTex : _scratchTex;
+	GLuint texB = (N + M) % 2 == 0 ? _scratchTex : satTex;
+
 	shared_ptr<ShaderProgram> shaderPro;
 
 	// copy inputTex to texA
 	// copy-satrt
-	std::string copyShaderName = GLOBAL.shaderPathPrefix + "SAT/sat" + std::to_string(config.componentNum) + "Copy";
-	shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(copyShaderName);
+	shaderPro = fullscreenPass->Begin(copyShaderName, fullscreenPass->GetFrameBuffer(texA), config.resWidth, config.resHeight);
 	shaderPro->Set("texInput", static_cast<int>(texUnit));
 	glBindTextureUnit(texUnit, config.inputTexID);
-	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, texA, 0);
-	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("SummedAreaTableGenerator::CopyTexture, Framebuffer not complete!"); return; }
 	glClearColor(0, 0, 0, 0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-	GLOBAL.render->Draw(satObj);
+	glClear(GL_COLOR_BUFFER_BIT); // Erase the color buffer.
+	fullscreenPass->Draw();
 	//copy-end
 
 	// render horizontal
@@ -86,12 +132,10 @@ void SummedAreaTableGenerator::Generate()
 		shaderPro->Set("texInput", static_cast<int>(texUnit));
 		glBindTextureUnit(texUnit, texA);
 
-		glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, texB, 0);
-		if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("SummedAreaTableGenerator:: Framebuffer not complete!"); return; }
-
+		glBindFramebuffer(GL_FRAMEBUFFER, fullscreenPass->GetFrameBuffer(texB));
 		glClearColor(0, 0, 0, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-		GLOBAL.render->Draw(satObj);
+		glClear(GL_COLOR_BUFFER_BIT); // Erase the color buffer.
+		fullscreenPass->Draw();
 		// swap tA, tB
 		GLuint temp = texA;
 		texA = texB;
@@ -106,12 +150,10 @@ void SummedAreaTableGenerator::Generate()
 		shaderPro->Set("texInput", static_cast<int>(texUnit));
 		glBindTextureUnit(texUnit, texA);
 
-		glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, texB, 0);
-		if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("SummedAreaTableGenerator:: Framebuffer not complete!"); return; }
-
+		glBindFramebuffer(GL_FRAMEBUFFER, fullscreenPass->GetFrameBuffer(texB));
 		glClearColor(0, 0, 0, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-		GLOBAL.render->Draw(satObj);
+		glClear(GL_COLOR_BUFFER_BIT); // Erase the color buffer.
+		fullscreenPass->Draw();
 		// swap tA, tB
 		GLuint temp = texA;
 		texA = texB;
@@ -119,89 +161,113 @@ void SummedAreaTableGenerator::Generate()
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// remove it
-	GLOBAL.sceneMgr->RemoveSceneObj(satObj->GetName());
-	glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
+	glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // set it back to normal
+}
+
+void SummedAreaTableGenerator::GenerateByScan(const GLuint& _scratchTex, const glm::ivec2& _start)
+{
+	// [Note] values are the same as the fragment path, except float rounding(prefix sums are added in a different order)
+	if (_start.x >= config.resWidth || _start.y >= config.resHeight)
+		return; // nothing changed
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(scanShaderName);
+	if (shaderPro == nullptr)
+		return;
+	bool isFixed = config.fixedPointScale > 0;
+	// [Note] float and unsigned integer samplers must use different units in fixed-point shader
+	GLuint texUnit = 0, satTexUnit = 1, scratchTexUnit = 2;
+	shaderPro->Set("texInput", static_cast<int>(texUnit));
+	shaderPro->Set("texSAT", static_cast<int>(satTexUnit));
+	shaderPro->Set("start", _start);
+	glBindTextureUnit(satTexUnit, satTex); // sums before "_start", only texels which are not written are read
+	if (isFixed)
+	{
+		shaderPro->Set("fixedScale", config.fixedPointScale);
+		shaderPro->Set("texScratch", static_cast<int>(scratchTexUnit));
+		glBindTextureUnit(scratchTexUnit, _scratchTex);
+	}
+
+	// rows: recentered(or quantized) input -> scratch, one workgroup per row
+	shaderPro->Set("vertical", 0);
+	if (!isFixed)
+		shaderPro->Set("recenter", 1);
+	glBindTextureUnit(texUnit, config.inputTexID);
+	glBindImageTexture(0, _scratchTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, satFormat);
+	glDispatchCompute(config.resHeight - _start.y, 1, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// columns: scratch -> SAT, one workgroup per column
+	shaderPro->Set("vertical", 1);
+	if (!isFixed)
+	{
+		shaderPro->Set("recenter", 0);
+		glBindTextureUnit(texUnit, _scratchTex);
+	}
+	glBindImageTexture(0, satTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, satFormat);
+	glDispatchCompute(config.resWidth - _start.x, 1, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	if (CheckGLError()) { Print("Error in SummedAreaTableGenerator::GenerateByScan."); return; }
 }
 
 void SummedAreaTableGenerator::Clear()
 {
 	// don't forget to release OpenGL textures and etc.
-	if (glIsTexture(texA))
-		glDeleteTextures(1, &texA);
-	texA = 0;
+	if (GLOBAL.render != nullptr)
+	{
+		auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
+		fullscreenPass->ReleaseTexture(satTex);
+		fullscreenPass->ReleaseTexture(ownScratchTex);
+	}
 
-	if (glIsTexture(texB))
-		glDeleteTextures(1, &texB);
-	texB = 0;
+	if (glIsTexture(satTex))
+		glDeleteTextures(1, &satTex);
+	satTex = 0;
 
-	if (glIsFramebuffer(fbo))
-		glDeleteFramebuffers(1, &fbo);
-	fbo = 0;
+	if (glIsTexture(ownScratchTex))
+		glDeleteTextures(1, &ownScratchTex);
+	ownScratchTex = 0;
 }
 
-GLuint SummedAreaTableGenerator::GetSAT() const { return texA; }
+GLuint SummedAreaTableGenerator::GetSAT() const { return satTex; }
 
 void SummedAreaTableGenerator::Reconstruct(GLuint& _outputTex)
 {
-	glViewport(0, 0, config.resWidth, config.resHeight); CheckGLError();
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo); CheckGLError();
-
-	shared_ptr<Mesh> mesh = MeshGenerator::GenPlane(2, 2, Utility::zeroV3, Utility::backV3);
-	shared_ptr<SceneObject> satObj = make_shared<SceneObject>("___SATObj___", mesh);
-	GLOBAL.sceneMgr->AddSceneObj(satObj);
+	auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
 	GLuint texUnit = 0;
-	// reconstruction shader name
-	std::string reconShaderName = GLOBAL.shaderPathPrefix + "SAT/sat" + std::to_string(config.componentNum) + "Reconstruct";
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(reconShaderName);
+	shared_ptr<ShaderProgram> shaderPro = fullscreenPass->Begin(reconShaderName, fullscreenPass->GetFrameBuffer(_outputTex), config.resWidth, config.resHeight);
 
 	shaderPro->Set("texInput", static_cast<int>(texUnit));
-	glBindTextureUnit(texUnit, texA);
-
-	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, _outputTex, 0);
-	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("SummedAreaTableGenerator::Reconstruct, Framebuffer not complete!"); return; }
+	glBindTextureUnit(texUnit, satTex);
 
 	glClearColor(0, 0, 0, 0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-	GLOBAL.render->Draw(satObj);
+	glClear(GL_COLOR_BUFFER_BIT); // Erase the color buffer.
+	fullscreenPass->Draw();
 
+	// "_outputTex" is owned by caller, don't keep its framebuffer
+	fullscreenPass->ReleaseTexture(_outputTex);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// remove it
-	GLOBAL.sceneMgr->RemoveSceneObj(satObj->GetName());
-	glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
+	glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // set it back to normal
 }
 
 void SummedAreaTableGenerator::BoxFilter(GLuint& _outputTex, const int& _kernelSize)
 {
 	// outputTex should have the same resolution(texture size) as SAT
 	// also kernelSize should be odd number, such as 1, 3, 5, 7...
-	glViewport(0, 0, config.resWidth, config.resHeight); CheckGLError();
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo); CheckGLError();
-
-	shared_ptr<Mesh> mesh = MeshGenerator::GenPlane(2, 2, Utility::zeroV3, Utility::backV3);
-	shared_ptr<SceneObject> satObj = make_shared<SceneObject>("___SATObj___", mesh);
-	GLOBAL.sceneMgr->AddSceneObj(satObj);
+	auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
 	GLuint texUnit = 0;
-	// boxfilter shader name
-	std::string boxFilterShaderName = GLOBAL.shaderPathPrefix + "SAT/sat" + std::to_string(config.componentNum) + "BoxFilter";
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(boxFilterShaderName);
+	shared_ptr<ShaderProgram> shaderPro = fullscreenPass->Begin(boxFilterShaderName, fullscreenPass->GetFrameBuffer(_outputTex), config.resWidth, config.resHeight);
 
 	shaderPro->Set("halfKernelSize", _kernelSize / 2); CheckGLError();
 
 	shaderPro->Set("texInput", static_cast<int>(texUnit)); CheckGLError();
-	glBindTextureUnit(texUnit, texA); CheckGLError();
-
-	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, _outputTex, 0); CheckGLError();
-	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("SummedAreaTableGenerator::BoxFilter, Framebuffer not complete!"); return; }
+	glBindTextureUnit(texUnit, satTex); CheckGLError();
 
 	glClearColor(1, 1, 0, 0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-	GLOBAL.render->Draw(satObj);
+	glClear(GL_COLOR_BUFFER_BIT); // Erase the color buffer.
+	fullscreenPass->Draw();
 
+	// "_outputTex" is owned by caller, don't keep its framebuffer
+	fullscreenPass->ReleaseTexture(_outputTex);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// remove it
-	GLOBAL.sceneMgr->RemoveSceneObj(satObj->GetName());
-	glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
-}
+	glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // set it back to normal
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "glad/glad.h"
 #include <functional>
+#include <glm/glm.hpp>
 
 namespace IceRender
 {
@@ -12,30 +13,57 @@ namespace IceRender
 		GLuint inputTexID;
 		int componentNum;
 		std::function<void(GLuint& _texID, const int& _width, const int& _height)> texGenerator;
+		// > 0: fixed-point SAT, input values in [0,1] are quantized as signed deltas round((value-0.5) * fixedPointScale) and summed exactly as 32-bit integers.
+		// SAT must have an unsigned integer format(e.g. GL_RG32UI), see GetFixedPointScale. Reconstruct() and BoxFilter() only support float SATs.
+		float fixedPointScale;
 
 		SATConfig();
 		SATConfig(const SATConfig& _config);
+		SATConfig& operator=(const SATConfig& _config) = default;
 	};
 
 	class SummedAreaTableGenerator
 	{
 		//refer: paper-"Fast Summed-Area Table Generation and its Applications, Hensley, 2005"
+		// [Note] when SAT's format can be bound as an image(R/RG/RGBA, 16F/32F), a compute path is used instead: prefix sums of all rows in one dispatch,
+		// then of all columns in a second one(see "SAT/satScan.cs"). 2 passes instead of 1+N+M fullscreen passes, for any component number.
+		// RGB formats can't be used by image load/store, they keep the fragment passes below.
+	public:
+		static const int scanGroupSize = 256; // same as local_size in "SAT/satScan.cs"
+
 	private:
 		SATConfig config;
-		GLuint texA, texB; // two textures
-		GLuint fbo; // framebuffer object
-		std::string horShaderName, verShaderName; // horizontal, vertical pass shader name
+		GLuint satTex; // the result, it is always the same texture after each Generate()
+		GLuint ownScratchTex; // only created when Generate() is called without scratch texture
+		std::string copyShaderName, horShaderName, verShaderName; // copy, horizontal, vertical pass shader name
+		std::string reconShaderName, boxFilterShaderName;
+		std::string scanShaderName;
 		int N, M;
+		bool useComputeScan; // SAT format supports image load/store(fixed-point SATs are only generated by the compute path)
+		GLenum satFormat; // internal format of SAT, used to bind it as an image
+		bool isGenerated; // SAT holds the result of the whole input, so that later updates can start from the changed texels
+
+		void GenerateByScan(const GLuint& _scratchTex, const glm::ivec2& _start);
 
 		// TODO: for now just support two-component texture, because I only use it in VSM for now. Later when I implement shader auto-generator by using differernt sub shader file,
 		// then I can support dynamic number component. If not implementing sub shader files to create the final shader, 
 		// it requires to write if-else codes in shader which slow down performance.
 
 	public:
+		SummedAreaTableGenerator();
 		~SummedAreaTableGenerator();
 
+		// largest "fixedPointScale" for which box sums of "_maxBoxArea" texels(values in [0,1]) still fit in a signed 32-bit integer, so that they are exact.
+		// Lookups must never sum a larger box, clamp the kernel accordingly.
+		static float GetFixedPointScale(const int& _maxBoxArea);
+
 		void Init(const SATConfig& _config);
-		void Generate();
+		// ping-pong between SAT and "_scratchTex"(same size and format as SAT), the scratch is only used inside this call, so it can be shared by generators(see FrameGraph).
+		void Generate(const GLuint& _scratchTex);
+		// incremental update: input only changed at or after "_start"(x >= _start.x and y >= _start.y), so only that region of SAT is re-generated.
+		// Only the compute path supports it, the whole SAT is re-generated otherwise(or if it was never generated).
+		void Generate(const GLuint& _scratchTex, const glm::ivec2& _start);
+		void Generate(); // use its own scratch texture
 		void Clear();
 		GLuint GetSAT() const;
 		void Reconstruct(GLuint& _outputTex);
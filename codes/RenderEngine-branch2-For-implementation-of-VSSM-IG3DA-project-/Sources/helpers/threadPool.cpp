@@ -0,0 +1,84 @@
+#include "threadPool.hpp"
+
+using namespace IceRender;
+
+ThreadPool::ThreadPool() : stop(false), taskNum(0), nextTask(0), finishedTask(0), jobID(0) {}
+
+ThreadPool::~ThreadPool() { Stop(); }
+
+void ThreadPool::Start(const int& _threadNum)
+{
+	Stop();
+	stop = false;
+	int threadNum = _threadNum > 0 ? _threadNum : static_cast<int>(std::thread::hardware_concurrency()) - 1;
+	for (int i = 0; i < threadNum; i++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+void ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	workCondition.notify_all();
+	for (auto& worker : workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	workers.clear();
+}
+
+bool ThreadPool::RunOneTask(std::unique_lock<std::mutex>& _lock)
+{
+	if (nextTask >= taskNum)
+		return false;
+	int index = nextTask++;
+	_lock.unlock();
+	task(index);
+	_lock.lock();
+	if (++finishedTask == taskNum)
+		doneCondition.notify_all();
+	return true;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned int lastJobID = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		workCondition.wait(lock, [&]() { return stop || jobID != lastJobID; });
+		if (stop)
+			return;
+		lastJobID = jobID;
+		while (RunOneTask(lock)) {}
+	}
+}
+
+void ThreadPool::ParallelFor(const int& _taskNum, const std::function<void(const int&)>& _task)
+{
+	if (_taskNum <= 0)
+		return;
+	if (workers.empty())
+	{
+		for (int i = 0; i < _taskNum; i++)
+			_task(i);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	task = _task;
+	taskNum = _taskNum;
+	nextTask = 0;
+	finishedTask = 0;
+	jobID++;
+	workCondition.notify_all();
+
+	while (RunOneTask(lock)) {}
+	doneCondition.wait(lock, [&]() { return finishedTask == taskNum; });
+	task = nullptr;
+}
+
+int ThreadPool::GetThreadNum() const { return static_cast<int>(workers.size()) + 1; }
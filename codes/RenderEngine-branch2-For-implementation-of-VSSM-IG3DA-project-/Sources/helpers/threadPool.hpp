@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace IceRender
+{
+	/*
+	* Fixed-size pool of worker threads for data-parallel CPU work(e.g. software rasterizer tiles).
+	* ParallelFor() blocks until all tasks are done, the calling thread also takes tasks. Tasks are taken one by one from a shared counter,
+	* so tasks with different costs are balanced dynamically.
+	*/
+	class ThreadPool
+	{
+	private:
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable workCondition, doneCondition;
+		bool stop;
+
+		/*current job*/
+		std::function<void(const int&)> task;
+		int taskNum;
+		int nextTask;
+		int finishedTask;
+		unsigned int jobID; // increased per ParallelFor(), workers wake up when it changes
+
+		void WorkerLoop();
+		bool RunOneTask(std::unique_lock<std::mutex>& _lock); // return false if no task is left
+
+	public:
+		ThreadPool();
+		~ThreadPool();
+
+		void Start(const int& _threadNum); // _threadNum <= 0 means hardware concurrency. Calling thread is not counted.
+		void Stop();
+
+		// call "_task(i)" for i in [0, _taskNum) on all threads, return after all of them are done
+		void ParallelFor(const int& _taskNum, const std::function<void(const int&)>& _task);
+
+		int GetThreadNum() const; // including calling thread
+	};
+}
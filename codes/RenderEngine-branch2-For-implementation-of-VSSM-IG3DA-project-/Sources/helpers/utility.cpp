@@ -247,7 +247,7 @@ glm::vec3 Utility::LoadVec3FromJsonData(nlohmann::json _data)
 	return glm::vec3();
 }
 
-bool Utility::SaveTextureToPNG(const std::string& _fileName, const int& _width, const int& _height, const GLenum& _channelType, const GLuint& _framebuffer)
+bool Utility::SaveTextureToPNG(const std::string& _fileName, const int& _width, const int& _height, const GLenum& _channelType, const GLuint& _framebuffer, const int& _x, const int& _y)
 {
 	int channelNum;
 	if (_channelType == GL_RGBA)
@@ -264,7 +264,7 @@ bool Utility::SaveTextureToPNG(const std::string& _fileName, const int& _width,
 	int data_size = _width * _height * channelNum;
 	GLubyte* pixels = new GLubyte[data_size];
 	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer); CheckGLError();
-	glReadPixels(0, 0, _width, _height, _channelType, GL_UNSIGNED_BYTE, pixels); CheckGLError();
+	glReadPixels(_x, _y, _width, _height, _channelType, GL_UNSIGNED_BYTE, pixels); CheckGLError();
 	stbi_flip_vertically_on_write(1); // it enables to write an image as OpenGL expects!!!
 	int result = stbi_write_png(("Output/" + _fileName + ".png").c_str(), _width, _height, channelNum, pixels, channelNum * _width);
 	if (result == 0)
@@ -275,6 +275,17 @@ bool Utility::SaveTextureToPNG(const std::string& _fileName, const int& _width,
 	return result != 0;
 }
 
+bool Utility::SavePixelsToPNG(const std::string& _fileName, const int& _width, const int& _height, const unsigned char* _pixels)
+{
+	stbi_flip_vertically_on_write(1);
+	int result = stbi_write_png(("Output/" + _fileName + ".png").c_str(), _width, _height, 4, _pixels, 4 * _width);
+	if (result == 0)
+		Print("Fail to save image.");
+	else
+		Print("Succeed to save image.");
+	return result != 0;
+}
+
 std::string Utility::GetCurrentTimeStr()
 {
 	// TODO: pass a parameter to customize time string output
@@ -84,7 +84,9 @@ namespace IceRender
 
 		// refer: https://stackoverflow.com/questions/56140002/saving-a-glteximage2d-to-the-file-system-for-inspection
 		// to save texture to a file, we need to read it from framebuffer(which means we need to bind texture to a framebuffer)
-		bool SaveTextureToPNG(const std::string& _fileName, const int& _width, const int& _height, const GLenum& _channelType, const GLuint& _framebuffer);
+		bool SaveTextureToPNG(const std::string& _fileName, const int& _width, const int& _height, const GLenum& _channelType, const GLuint& _framebuffer, const int& _x = 0, const int& _y = 0); // (_x, _y) is the bottom left pixel of the region to save
+		// save RGBA8 pixels(bottom row first, as OpenGL) into "Output/_fileName.png"
+		bool SavePixelsToPNG(const std::string& _fileName, const int& _width, const int& _height, const unsigned char* _pixels);
 
 		std::string GetCurrentTimeStr();
 	}
@@ -1,9 +1,11 @@
 #include "baseLight.hpp"
 #include "../helpers//utility.hpp"
+#include "../globals.hpp"
 
 using namespace IceRender;
 
-BaseLight::BaseLight(const string& _name) :name(_name), type(LightType::NONE), transform(make_shared<Transform>()), color(Utility::oneV3), intensity(1.0f), renderShadow(false) {}
+BaseLight::BaseLight(const string& _name) :name(_name), type(LightType::NONE), transform(make_shared<Transform>()), color(Utility::oneV3), intensity(1.0f), renderShadow(false), shadowResolutionScale(1.0f), version(0),
+hasCachedLightMat(false), cachedLightMat(1.0f), cachedLightCamInfo(), cachedLightKey(0) {}
 BaseLight::~BaseLight() { transform = nullptr; }
 
 const string BaseLight::GetName() const { return name; }
@@ -13,4 +15,25 @@ glm::vec3 BaseLight::GetColor() const { return color; }
 void BaseLight::SetIntensity(const float& _intensity) { intensity = _intensity; }
 float BaseLight::GetIntensity() const { return intensity; }
 bool BaseLight::IsRenderShadow() const { return renderShadow; }
-void BaseLight::SetRenderShadow(const bool& _val) { renderShadow = _val; }
\ No newline at end of file
+void BaseLight::SetRenderShadow(const bool& _val) { renderShadow = _val; }
+float BaseLight::GetShadowResolutionScale() const { return shadowResolutionScale; }
+void BaseLight::SetShadowResolutionScale(const float& _scale) { shadowResolutionScale = _scale; }
+unsigned int BaseLight::GetVersion() const { return version + transform->GetVersion(); } // both only increase, so the sum changes if any of them changes
+
+glm::mat4 BaseLight::GetLightSpaceMat(LightCamInfo& _lightCamInfo)
+{
+	// [Note] the frame index is part of the key because some inputs have no version(e.g. shadow resolution, tight space), they are picked up next frame
+	glm::uvec4 key(GLOBAL.timeMgr->GetFrameIndex(), GetVersion(), GLOBAL.sceneMgr->GetBoundsVersion(), GLOBAL.shadowMgr->GetSampleDistribution()->GetVersion());
+	if (!hasCachedLightMat || key != cachedLightKey)
+	{
+		cachedLightMat = ComputeLightSpaceMat(cachedLightCamInfo);
+		cachedLightKey = key;
+		hasCachedLightMat = true;
+	}
+	_lightCamInfo = cachedLightCamInfo;
+	return cachedLightMat;
+}
+
+int BaseLight::GetShadowViewNum() const { return 1; }
+glm::mat4 BaseLight::GetShadowViewMat(const int&, LightCamInfo& _lightCamInfo) { return GetLightSpaceMat(_lightCamInfo); }
+unsigned int BaseLight::GetShadowViewVersion(const int&) const { return GetVersion(); }
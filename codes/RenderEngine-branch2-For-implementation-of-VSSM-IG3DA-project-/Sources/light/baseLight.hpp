@@ -33,6 +33,17 @@ namespace IceRender
 		glm::vec3 color;
 		float intensity;
 		bool renderShadow;
+		float shadowResolutionScale; // shadow map size of this light = shadow resolution * scale, so lights can have different sizes in the shadow atlas
+		unsigned int version; // increased when data used by light space matrix changes(e.g. direction, range), transform has its own version
+
+		virtual glm::mat4 ComputeLightSpaceMat(LightCamInfo& _lightCamInfo) = 0; // computes the result of GetLightSpaceMat, only called when the cache is out of date
+
+	private:
+		/*per-frame cache of GetLightSpaceMat: culling, shadow passes and lighting parameters all ask for the same matrix many times per frame*/
+		bool hasCachedLightMat;
+		glm::mat4 cachedLightMat;
+		LightCamInfo cachedLightCamInfo;
+		glm::uvec4 cachedLightKey; // frame index, light version, scene bounds version and SDSM version which the cache was computed with
 
 	public:
 		BaseLight(const string& _name);
@@ -46,7 +57,16 @@ namespace IceRender
 		float GetIntensity() const;
 		bool IsRenderShadow() const;
 		void SetRenderShadow(const bool& _val);
+		float GetShadowResolutionScale() const;
+		void SetShadowResolutionScale(const float& _scale); // call "ShadowManager::InitShadowRender" after it to rebuild the shadow atlas
+		unsigned int GetVersion() const; // changes whenever the light or its transform changes, used to cache shadow maps
+
+		// it equals to projMat*viewMat of light, and it also returns lightCamPos, lightViewDir. Computed at most once per frame unless the light or the scene bounding box changes
+		glm::mat4 GetLightSpaceMat(LightCamInfo& _lightCamInfo);
 
-		virtual glm::mat4 GetLightSpaceMat(LightCamInfo& _lightCamInfo) = 0; // it equals to projMat*viewMat of light, and it also returns lightCamPos, lightViewDir
+		/*shadow views: shadow of a light can be rendered into several shadow maps, e.g. cascades of DirectLight or cube faces of PointLight. Each view owns a tile in the shadow atlas*/
+		virtual int GetShadowViewNum() const; // 1 means one shadow map for the whole light
+		virtual glm::mat4 GetShadowViewMat(const int& _view, LightCamInfo& _lightCamInfo); // same as GetLightSpaceMat if there is only one view
+		virtual unsigned int GetShadowViewVersion(const int& _view) const; // same as GetVersion if there is only one view, used to cache shadow maps of views
 	};
 }
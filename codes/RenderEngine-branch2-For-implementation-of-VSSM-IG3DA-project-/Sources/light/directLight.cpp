@@ -3,18 +3,30 @@
 #include "directLight.hpp"
 #include "../globals.hpp"
 #include <limits>
+#include <algorithm>
 #include "../helpers/utility.hpp"
 #include <math.h>
 
 using namespace IceRender;
 
-DirectLight::DirectLight(const string& _name) : BaseLight(_name), direction(glm::normalize(glm::vec3(-1))) { type = LightType::DIRECT; }
+DirectLight::DirectLight(const string& _name) : BaseLight(_name), direction(glm::normalize(glm::vec3(-1))), cascadeNum(1), cascadeSplitLambda(0.75f), cascadeUpdateInterval(1),
+cascadeFittedVersions(0), cascadeFrame(0) { type = LightType::DIRECT; }
 DirectLight::~DirectLight() {}
 
-void DirectLight::SetDirection(const glm::vec3 _dir) { direction = glm::normalize(_dir); }
+void DirectLight::SetDirection(const glm::vec3 _dir) { direction = glm::normalize(_dir); version++; }
 glm::vec3 DirectLight::GetDirection() const { return direction; }
 
-glm::mat4 DirectLight::GetLightSpaceMat(LightCamInfo& _lightCamInfo)
+glm::mat4 DirectLight::ComputeLightSpaceMat(LightCamInfo& _lightCamInfo)
+{
+	float halfWidth, halfHeight;
+	glm::mat4 lightViewMat = ComputeLightViewMat(_lightCamInfo, halfWidth, halfHeight);
+	glm::mat4 lightProjMat = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, _lightCamInfo.near, _lightCamInfo.far);
+
+	// SDSM: only the part of the scene visible from cameras(unchanged if SDSM is off)
+	return GLOBAL.shadowMgr->GetSampleDistribution()->FitLightSpaceMat(name, lightProjMat * lightViewMat);
+}
+
+glm::mat4 DirectLight::ComputeLightViewMat(LightCamInfo& _lightCamInfo, float& _halfWidth, float& _halfHeight)
 {
 	// NOTE: A good way to test whether this LightMat is correct is to use these mat directly in some shader(just replace camera's matrix with them)
 	auto sceneBox = GLOBAL.sceneMgr->GetBoundingBox();
@@ -44,8 +56,7 @@ glm::mat4 DirectLight::GetLightSpaceMat(LightCamInfo& _lightCamInfo)
 	}
 	glm::mat4 lightViewMat = glm::lookAt(_lightCamInfo.lightCamPos, center, up);
 
-	// now to build light orthogonal projection matrix
-	float halfWidth, halfHeight;
+	// now to find the size of light orthogonal projection
 	// first to find near/far
 	glm::vec3 p[8]; // 8 corners of scene bounding box
 	p[0] = min;
@@ -59,16 +70,16 @@ glm::mat4 DirectLight::GetLightSpaceMat(LightCamInfo& _lightCamInfo)
 	p[7] = max - glm::vec3(size.x, size.y, 0);
 
 	_lightCamInfo.near = std::numeric_limits<float>::max();
-	_lightCamInfo.far = halfWidth = halfHeight = 0;
+	_lightCamInfo.far = _halfWidth = _halfHeight = 0;
 	for (int i = 0; i < 8; i++)
 	{
 		glm::vec4 p_homo = glm::vec4(p[i], 1); // homogeneous point
 		p_homo = lightViewMat * p_homo;
 		p[i] = glm::vec3(p_homo.x, p_homo.y, p_homo.z); // get position in light view space 
-		if (abs(p[i].x) > halfWidth)
-			halfWidth = abs(p[i].x);
-		if (abs(p[i].y) > halfHeight)
-			halfHeight = abs(p[i].y);
+		if (abs(p[i].x) > _halfWidth)
+			_halfWidth = abs(p[i].x);
+		if (abs(p[i].y) > _halfHeight)
+			_halfHeight = abs(p[i].y);
 		if (p[i].z < 0)
 		{
 			if (abs(p[i].z) < _lightCamInfo.near)
@@ -77,7 +88,132 @@ glm::mat4 DirectLight::GetLightSpaceMat(LightCamInfo& _lightCamInfo)
 				_lightCamInfo.far = abs(p[i].z);
 		}
 	}
-	glm::mat4 lightProjMat = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, _lightCamInfo.near, _lightCamInfo.far);
 
-	return lightProjMat * lightViewMat;
+	return lightViewMat;
+}
+
+void DirectLight::SetCascades(const int& _cascadeNum, const float& _splitLambda, const int& _updateInterval)
+{
+	cascadeNum = glm::clamp(_cascadeNum, 1, maxCascadeNum);
+	cascadeSplitLambda = glm::clamp(_splitLambda, 0.0f, 1.0f);
+	cascadeUpdateInterval = std::max(_updateInterval, 1);
+	cascadeMats.clear(); // re-fitted by next UpdateCascades()
+	version++;
+}
+
+int DirectLight::GetShadowViewNum() const { return cascadeNum; }
+
+glm::mat4 DirectLight::GetShadowViewMat(const int& _cascade, LightCamInfo& _lightCamInfo)
+{
+	// cascades are not fitted yet(e.g. before the first frame), use the whole scene instead
+	if (cascadeNum <= 1 || _cascade >= static_cast<int>(cascadeMats.size()))
+		return GetLightSpaceMat(_lightCamInfo);
+	_lightCamInfo = cascadeCamInfo;
+	return cascadeMats[_cascade];
+}
+
+unsigned int DirectLight::GetShadowViewVersion(const int& _cascade) const { return GetVersion() + (_cascade < static_cast<int>(cascadeVersions.size()) ? cascadeVersions[_cascade] : 0); }
+
+void DirectLight::UpdateCascades(const shared_ptr<Camera>& _camera, const glm::ivec2& _resolution)
+{
+	if (cascadeNum <= 1)
+		return;
+
+	// light view and near/far depend on the scene bounding box, so everything is re-fitted once the light or the bounding box changes.
+	// Casters moving inside unchanged cascades don't re-fit anything, their shadow maps are updated inside dirty rectangles(see BasicShadowMapRender::UpdateCachedScene).
+	glm::uvec2 versions(GetVersion(), GLOBAL.sceneMgr->GetBoundsVersion());
+	bool refitAll = static_cast<int>(cascadeMats.size()) != cascadeNum || versions != cascadeFittedVersions;
+	cascadeFittedVersions = versions;
+	cascadeFrame++;
+	if (refitAll)
+	{
+		cascadeMats.resize(cascadeNum, glm::mat4(0)); // never equals a fitted matrix, so a new cascade is always dirty
+		cascadeVersions.resize(cascadeNum, 0); // versions are never reset, a cached shadow map must not match a new cascade
+	}
+
+	float halfWidth, halfHeight;
+	glm::mat4 lightViewMat = ComputeLightViewMat(cascadeCamInfo, halfWidth, halfHeight);
+
+	// depth range to split: camera frustum stops at the farthest corner of the scene, no cascade is wasted on empty space
+	glm::vec3 viewDir, right, up;
+	_camera->GetCameraDirection(viewDir, right, up);
+	glm::vec3 camPos = _camera->GetTransform()->GetPosition();
+	auto sceneBox = GLOBAL.sceneMgr->GetBoundingBox();
+	glm::vec3 min = sceneBox->GetMin();
+	glm::vec3 max = sceneBox->GetMax();
+	float sceneFar = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+		sceneFar = std::max(sceneFar, glm::dot(corner - camPos, viewDir));
+	}
+	float camNear = _camera->GetCameraParameter(CameraIndex::NEAR);
+	float camFar = std::min(_camera->GetCameraParameter(CameraIndex::FAR), sceneFar);
+	// SDSM: splits only cover the depth range of visible samples(of one frame earlier)
+	float visibleNear, visibleFar;
+	if (GLOBAL.shadowMgr->GetSampleDistribution()->GetDepthRange(visibleNear, visibleFar))
+	{
+		camNear = std::max(camNear, visibleNear);
+		camFar = std::min(camFar, visibleFar);
+	}
+	camFar = std::max(camFar, 2.0f * camNear);
+
+	// [Note] refer "Parallel-Split Shadow Maps on Programmable GPUs"(GPU Gems 3, chapter 10): logarithmic splits give the same texel density in
+	// screen space, but the first split gets too thin. Blending them with uniform splits balances both.
+	auto SplitDepth = [&](const int& _index)
+	{
+		float t = static_cast<float>(_index) / cascadeNum;
+		float logDepth = camNear * powf(camFar / camNear, t);
+		float uniformDepth = camNear + (camFar - camNear) * t;
+		return cascadeSplitLambda * logDepth + (1.0f - cascadeSplitLambda) * uniformDepth;
+	};
+
+	for (int c = 0; c < cascadeNum; c++)
+	{
+		// the first cascade follows the camera every frame, distant ones are staggered over "cascadeUpdateInterval" frames(less shadow maps re-rendered per frame)
+		if (!refitAll && c > 0 && (cascadeFrame + c) % cascadeUpdateInterval != 0)
+			continue;
+		glm::mat4 cascadeMat = FitCascade(_camera, SplitDepth(c), SplitDepth(c + 1), lightViewMat, _resolution);
+		// only a changed matrix makes the cascade dirty, a re-fit to the same matrix keeps its cached shadow map
+		if (cascadeMat != cascadeMats[c])
+		{
+			cascadeMats[c] = cascadeMat;
+			cascadeVersions[c]++; // shadow map of this cascade is dirty
+		}
+	}
+}
+
+glm::mat4 DirectLight::FitCascade(const shared_ptr<Camera>& _camera, const float& _splitNear, const float& _splitFar, const glm::mat4& _lightViewMat, const glm::ivec2& _resolution) const
+{
+	// 8 corners of the split frustum in world space
+	glm::vec3 viewDir, right, up;
+	_camera->GetCameraDirection(viewDir, right, up);
+	glm::vec3 camPos = _camera->GetTransform()->GetPosition();
+	float tanHalfFov = tanf(glm::radians(_camera->GetCameraParameter(CameraIndex::FOV)) * 0.5f); // vertical fov, same as Camera::GetProjectionMatrix()
+	float aspect = _camera->GetCameraParameter(CameraIndex::ASPECT);
+	glm::vec3 corners[8];
+	glm::vec3 center(0);
+	for (int i = 0; i < 8; i++)
+	{
+		float depth = (i & 4) ? _splitFar : _splitNear;
+		float halfHeight = depth * tanHalfFov;
+		float halfWidth = halfHeight * aspect;
+		corners[i] = camPos + viewDir * depth + right * ((i & 1) ? halfWidth : -halfWidth) + up * ((i & 2) ? halfHeight : -halfHeight);
+		center += corners[i] / 8.0f;
+	}
+
+	// bounding sphere instead of a tight box: its size doesn't change when the camera rotates, so shadow texels don't shimmer
+	float radius = 0;
+	for (int i = 0; i < 8; i++)
+		radius = std::max(radius, glm::length(corners[i] - center));
+	radius = ceilf(radius * 16.0f) / 16.0f; // quantized, floating error should not change the frustum size every frame
+
+	// texel snapping: move the frustum by whole texels in light view space, then static objects are rasterized the same way when the camera moves
+	glm::vec3 lightSpaceCenter = glm::vec3(_lightViewMat * glm::vec4(center, 1));
+	glm::vec2 texelSize = 2.0f * radius / glm::vec2(_resolution);
+	glm::vec2 snappedCenter = glm::floor(glm::vec2(lightSpaceCenter) / texelSize) * texelSize;
+
+	// same near/far as the whole scene: casters outside of the split(e.g. behind the camera) still cast shadow into it
+	glm::mat4 lightProjMat = glm::ortho(snappedCenter.x - radius, snappedCenter.x + radius, snappedCenter.y - radius, snappedCenter.y + radius, cascadeCamInfo.near, cascadeCamInfo.far);
+	return lightProjMat * _lightViewMat;
 }
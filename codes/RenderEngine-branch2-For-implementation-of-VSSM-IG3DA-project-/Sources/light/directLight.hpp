@@ -1,14 +1,35 @@
 #pragma once
 
 #include "baseLight.hpp"
+#include "../camera/camera.hpp"
+#include <vector>
 
 namespace IceRender
 {
 	class DirectLight : public BaseLight
 	{
+	public:
+		static const int maxCascadeNum = 4; // at most "maxShadowViewNum" in "ShadowMap/shadowView.sub_fs"
+
 	private:
 		glm::vec3 direction;
 
+		/*cascaded shadow maps: view frustum of the camera is split along its depth, each split is covered by its own orthogonal light frustum(cascade)*/
+		int cascadeNum; // 1 means no cascade, one light frustum covers the whole scene
+		float cascadeSplitLambda; // blend of split schemes, 0: uniform splits, 1: logarithmic splits
+		int cascadeUpdateInterval; // cascades except the first one are re-fitted every N frames(staggered), their cached shadow maps are kept in between
+		std::vector<glm::mat4> cascadeMats; // light space matrix of each cascade, fitted by UpdateCascades()
+		std::vector<unsigned int> cascadeVersions; // increased when the matrix of a cascade changes
+		LightCamInfo cascadeCamInfo; // shared by all cascades: same light view and near/far as the whole scene, so depth of cascades is comparable
+		glm::uvec2 cascadeFittedVersions; // light and scene bounding box versions which cascades were fitted with, all cascades are re-fitted once one of them changes
+		unsigned int cascadeFrame; // number of UpdateCascades() calls, used to stagger updates of cascades
+
+		glm::mat4 ComputeLightViewMat(LightCamInfo& _lightCamInfo, float& _halfWidth, float& _halfHeight); // light view matrix of the whole scene, also returns near/far and half size of its orthogonal frustum
+		glm::mat4 FitCascade(const shared_ptr<Camera>& _camera, const float& _splitNear, const float& _splitFar, const glm::mat4& _lightViewMat, const glm::ivec2& _resolution) const;
+
+	protected:
+		glm::mat4 ComputeLightSpaceMat(LightCamInfo& _lightCamInfo) override;
+
 	public:
 		DirectLight(const string& _name);
 		~DirectLight();
@@ -16,6 +37,12 @@ namespace IceRender
 		void SetDirection(const glm::vec3 _dir);
 		glm::vec3 GetDirection() const;
 
-		glm::mat4 GetLightSpaceMat(LightCamInfo& _lightCamInfo) override;
+		// "_cascadeNum" is clamped to [1, maxCascadeNum]. Call "ShadowManager::InitShadowRender" after it to rebuild the shadow atlas
+		void SetCascades(const int& _cascadeNum, const float& _splitLambda, const int& _updateInterval);
+		int GetShadowViewNum() const override;
+		glm::mat4 GetShadowViewMat(const int& _cascade, LightCamInfo& _lightCamInfo) override;
+		unsigned int GetShadowViewVersion(const int& _cascade) const override;
+		// fit cascades to the view frustum of "_camera", call it once per frame before shadow maps are culled and rendered. "_resolution" is the tile size of one cascade(for texel snapping)
+		void UpdateCascades(const shared_ptr<Camera>& _camera, const glm::ivec2& _resolution);
 	};
 }
@@ -4,15 +4,17 @@
 #include "../globals.hpp"
 #include "../helpers/utility.hpp"
 #include <math.h>
+#include <algorithm>
 
 using namespace IceRender;
 
-PointLight::PointLight(const string& _name) :BaseLight(_name), range(std::numeric_limits<int>::max()), attenuation(0, 0) { type = LightType::POINT; }
+PointLight::PointLight(const string& _name) :BaseLight(_name), range(std::numeric_limits<int>::max()), attenuation(0, 0), useCubeShadow(false) { type = LightType::POINT; }
 PointLight::~PointLight() {}
 
 void PointLight::SetRange(const int& _range)
 {
 	range = _range;
+	version++;
 	if (range == std::numeric_limits<int>::max())
 		attenuation = glm::vec2(0, 0); // not using attenuation
 	else
@@ -36,7 +38,7 @@ void PointLight::SetRange(const int& _range)
 
 glm::vec2 PointLight::GetAttenuation() const { return attenuation; }
 
-glm::mat4 PointLight::GetLightSpaceMat(LightCamInfo& _lightCamInfo)
+glm::mat4 PointLight::ComputeLightSpaceMat(LightCamInfo& _lightCamInfo)
 {
 	// NOTE: A good way to test whether this LightMat is correct is to use these mat directly in some shader(just replace camera's matrix with them)
 	auto sceneBox = GLOBAL.sceneMgr->GetBoundingBox();
@@ -130,5 +132,44 @@ glm::mat4 PointLight::GetLightSpaceMat(LightCamInfo& _lightCamInfo)
 
 	glm::mat4 lightProjMat = glm::perspective(fov, aspect, _lightCamInfo.near, _lightCamInfo.far);
 
+	// SDSM: only the part of the scene visible from cameras(unchanged if SDSM is off)
+	return GLOBAL.shadowMgr->GetSampleDistribution()->FitLightSpaceMat(name, lightProjMat * lightViewMat);
+}
+
+void PointLight::SetCubeShadow(const bool& _value) { useCubeShadow = _value; version++; }
+bool PointLight::IsCubeShadow() const { return useCubeShadow; }
+int PointLight::GetShadowViewNum() const { return useCubeShadow ? 6 : 1; }
+
+glm::mat4 PointLight::GetShadowViewMat(const int& _view, LightCamInfo& _lightCamInfo)
+{
+	if (!useCubeShadow)
+		return GetLightSpaceMat(_lightCamInfo);
+
+	// same directions and up vectors as faces of GL_TEXTURE_CUBE_MAP
+	static const glm::vec3 faceDirs[6] = { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) };
+	static const glm::vec3 faceUps[6] = { glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0) };
+	_lightCamInfo.lightCamPos = transform->GetPosition();
+	_lightCamInfo.lightViewDir = faceDirs[_view];
+
+	// all faces share near/far, far reaches the farthest corner of the scene bounding box(or the light range)
+	auto sceneBox = GLOBAL.sceneMgr->GetBoundingBox();
+	glm::vec3 min = sceneBox->GetMin();
+	glm::vec3 max = sceneBox->GetMax();
+	float farthest = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+		farthest = std::max(farthest, glm::length(corner - _lightCamInfo.lightCamPos));
+	}
+	_lightCamInfo.near = GLOBAL.camNear;
+	_lightCamInfo.far = std::max(std::min(farthest, static_cast<float>(range)), 2.0f * _lightCamInfo.near);
+
+	// faces are a bit wider than 90 degrees: the inner part of a face(without "shadowViewMargin" of "ShadowMap/shadowView.sub_fs") covers exactly 90 degrees,
+	// so every fragment finds a face where its filter kernel(PCF, PCSS, VSM) stays inside the tile
+	const float viewMargin = 0.05f;
+	float fov = 2.0f * atanf(1.0f / (1.0f - 2.0f * viewMargin));
+	glm::mat4 lightViewMat = glm::lookAt(_lightCamInfo.lightCamPos, _lightCamInfo.lightCamPos + _lightCamInfo.lightViewDir, faceUps[_view]);
+	glm::mat4 lightProjMat = glm::perspective(fov, 1.0f, _lightCamInfo.near, _lightCamInfo.far);
+
 	return lightProjMat * lightViewMat;
 }
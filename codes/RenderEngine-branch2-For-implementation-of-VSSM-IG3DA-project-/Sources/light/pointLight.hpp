@@ -10,6 +10,7 @@ namespace IceRender
 	private:
 		int range; // lighting range, which will affect its attenuation. Setting range to int_max means not using attenuation.
 		glm::vec2 attenuation; // x/y are the linear/quadratic attenuation coefficient; keep constant equal to 1.
+		bool useCubeShadow; // omnidirectional shadow: 6 cube faces(one shadow view each) instead of one perspective frustum toward the scene center
 
 	public:
 		PointLight(const string& _name);
@@ -18,7 +19,8 @@ namespace IceRender
 		void SetRange(const int& _range);
 
 		glm::vec2 GetAttenuation() const;
-		
+
+	protected:
 		/*
 		TODO: check the survey of soft shader because some paper have already studied it well. My idea is like:
 		case 1: light source is inside the bounding box of scene. In this case,
@@ -32,6 +34,13 @@ namespace IceRender
 				Additionally, building and maintaining the bounding box of scene is simple thing, we can store min/max point of each mesh,
 				then build the scene bounding box easily. Even add/remove the mesh, it is still simple to recompute the bounding box because we just need one iteration of all mesh.
 		*/
-		glm::mat4 GetLightSpaceMat(LightCamInfo& _lightCamInfo) override;
+		glm::mat4 ComputeLightSpaceMat(LightCamInfo& _lightCamInfo) override;
+
+	public:
+		// call "ShadowManager::InitShadowRender" after it to rebuild the shadow atlas
+		void SetCubeShadow(const bool& _value);
+		bool IsCubeShadow() const;
+		int GetShadowViewNum() const override;
+		glm::mat4 GetShadowViewMat(const int& _view, LightCamInfo& _lightCamInfo) override; // "_view" is the cube face: +X, -X, +Y, -Y, +Z, -Z
 	};
 }
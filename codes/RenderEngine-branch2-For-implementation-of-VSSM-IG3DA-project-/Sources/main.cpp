@@ -11,6 +11,10 @@
 #include "singleton/singleton.hpp"
 #include "console.hpp"
 #include "input/keyInput.hpp"
+#include "helpers/utility.hpp"
+#include <string>
+#include <algorithm>
+#include <cstdlib>
 
 using namespace IceRender;
 
@@ -42,8 +46,48 @@ void Display()
 	GLOBAL.render->Render();
 }
 
-int main()
+// render one image without window and OpenGL context, only CPU renderers can be used: "--software"(SoftwareRasterizer) or "--ray_trace"(RayTracer, reference image).
+// e.g. "IceRender --ray_trace VSMScene/scene.json output_name 800 600", scene config is relative to "Resources/SceneConfigs/",
+// image is saved into Output folder, size is optional(window size by default, "render_scale" of scene config is applied).
+int RenderHeadless(int argc, char* argv[])
 {
+	if (argc != 4 && argc != 6)
+	{
+		Print("Usage: IceRender --software/--ray_trace sceneConfig outputName [width height]");
+		return -1;
+	}
+	bool rayTrace = std::string(argv[1]) == "--ray_trace";
+	GLOBAL.headless = true;
+	if (argc == 6)
+	{
+		GLOBAL.WIN_WIDTH = GLOBAL.RENDER_WIDTH = std::max(1, std::atoi(argv[4]));
+		GLOBAL.WIN_HEIGHT = GLOBAL.RENDER_HEIGHT = std::max(1, std::atoi(argv[5]));
+	}
+
+	GLOBAL.sceneMgr->Init();
+	GLOBAL.camCtrller->Init();
+	std::string configPath = "Resources/SceneConfigs/" + std::string(argv[2]);
+	Print("Try to load scene from config file: " + configPath);
+	GLOBAL.sceneMgr->LoadFromSceneConfig(configPath);
+	GLOBAL.shadowMgr->InitShadowRender();
+	if (GLOBAL.sceneMgr->GetAllSceneObject().empty())
+	{
+		Print("[Error] Nothing to render in " + configPath);
+		return -1;
+	}
+
+	glm::ivec4 viewRect = GLOBAL.render->GetViewRect(0); // controlled camera
+	const auto& pixels = rayTrace ? GLOBAL.render->GetRayTracer()->RenderImage(viewRect.z, viewRect.w) : GLOBAL.render->GetSoftwareRasterizer()->RenderImage(viewRect.z, viewRect.w);
+	if (pixels.empty() || !Utility::SavePixelsToPNG(argv[3], viewRect.z, viewRect.w, pixels.data()))
+		return -1;
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && (std::string(argv[1]) == "--software" || std::string(argv[1]) == "--ray_trace"))
+		return RenderHeadless(argc, argv);
+
 	// glfw: initialize and configure
 	glfwInit();
 
@@ -52,7 +96,7 @@ int main()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5); // in order to use OpenGL 4.5
 
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_SAMPLES, 16); // Enable OpenGL multisampling (MSAA)
+	glfwWindowHint(GLFW_SAMPLES, 0); // default framebuffer is not multisampled, anti-aliasing is done by render passes(see AntiAliasing)
 	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE); // not allowed to change window size by dragging the edges of window
 
 	Print("glfwInit succeeded.");
@@ -1,22 +1,33 @@
 #include "material.hpp"
 #include "../helpers/utility.hpp"
+#include "../globals.hpp"
 
 
 using namespace IceRender;
 
-Material::Material() : color(Utility::oneV3), albedo(0) {  }
+Material::Material() : color(Utility::oneV3), albedo(0), albedoLayer(-1), version(0) {  }
 Material::~Material()
 {
-	if (glIsTexture(albedo))
+	if (albedo != 0 && GLOBAL.render != nullptr)
+	{
+		GLOBAL.render->GetTextureStreamer()->Cancel(albedo);
+		GLOBAL.render->GetTextureArrayManager()->ReleaseTexture(albedo);
+	}
+	if (albedo != 0 && glIsTexture(albedo)) // never touch OpenGL if there is no texture(e.g. headless)
 		glDeleteTextures(1, &albedo);
 	albedo = 0;
 }
 
-void Material::SetColor(const glm::vec3& _color) { color = _color; }
-void Material::SetAlbedo(const GLuint& _albedo) { albedo = _albedo; }
-void Material::SetUV(const vector<glm::vec2>& _uv) { uv = _uv; }
+void Material::SetColor(const glm::vec3& _color) { color = _color; version++; }
+void Material::SetAlbedo(const GLuint& _albedo) { albedo = _albedo; albedoLayer = glm::ivec2(-1); version++; }
+void Material::SetUV(const vector<glm::vec2>& _uv) { uv = _uv; version++; }
+void Material::SetAlbedoLayer(const glm::ivec2& _layer) { albedoLayer = _layer; version++; }
+void Material::SetAlbedoPath(const std::string& _path) { albedoPath = _path; }
 
 glm::vec3 Material::GetColor()const { return color; }
 size_t Material::GetUVDataSize() const { return sizeof(glm::vec2) * uv.size(); }
 const void* Material::GetUVData() const { return uv.data(); }
-GLuint Material::GetAlbedo() const { return albedo; }
\ No newline at end of file
+GLuint Material::GetAlbedo() const { return albedo; }
+glm::ivec2 Material::GetAlbedoLayer() const { return albedoLayer; }
+std::string Material::GetAlbedoPath() const { return albedoPath; }
+unsigned int Material::GetVersion() const { return version; }
\ No newline at end of file
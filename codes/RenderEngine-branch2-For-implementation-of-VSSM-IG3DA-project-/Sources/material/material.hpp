@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 
@@ -14,19 +15,27 @@ namespace IceRender
 	protected:
 		glm::vec3 color; // if not using albedo texture, then we use this color,
 		GLuint albedo; // using texture. texture=0 is not valid value.(it reserves for default texture.)
+		glm::ivec2 albedoLayer; // (array index, layer) of albedo inside TextureArrayManager, (-1, -1) if it's not packed yet
+		std::string albedoPath; // image file of albedo(relative to GLOBAL.imagePathPrefix), empty if unknown. Used without OpenGL context
 		vector<glm::vec2> uv;
+		unsigned int version; // increased by each setter, so that data uploaded from this material(e.g. GPUMaterialData) can be cached
 
 	public:
 		Material();
-		~Material();
+		virtual ~Material(); // virtual, so that the material type can be checked by dynamic_pointer_cast
 
 		void SetColor(const glm::vec3& _color);
 		void SetAlbedo(const GLuint& _albedo);
 		void SetUV(const vector<glm::vec2>& _uv);
+		void SetAlbedoLayer(const glm::ivec2& _layer);
+		void SetAlbedoPath(const std::string& _path);
 
 		glm::vec3 GetColor() const;
 		size_t GetUVDataSize() const;
 		const void* GetUVData() const;
 		GLuint GetAlbedo() const;
+		glm::ivec2 GetAlbedoLayer() const;
+		std::string GetAlbedoPath() const;
+		unsigned int GetVersion() const;
 	};
 }
@@ -17,17 +17,20 @@ void PhongMaterial::SetAmbientCoef(const glm::vec3& _ka)
 	ka.x = std::clamp(_ka.x, 0.0f, 1.0f);
 	ka.y = std::clamp(_ka.y, 0.0f, 1.0f);
 	ka.z = std::clamp(_ka.z, 0.0f, 1.0f);
+	version++;
 }
 void PhongMaterial::SetDiffuseCoef(const glm::vec3& _kd)
 {
 	kd.x = std::clamp(_kd.x, 0.0f, 1.0f);
 	kd.y = std::clamp(_kd.y, 0.0f, 1.0f);
 	kd.z = std::clamp(_kd.z, 0.0f, 1.0f);
+	version++;
 }
 void PhongMaterial::SetSpecularCoef(const glm::vec3& _ks)
 {
 	ks.x = std::clamp(_ks.x, 0.0f, 1.0f);
 	ks.y = std::clamp(_ks.y, 0.0f, 1.0f);
 	ks.z = std::clamp(_ks.z, 0.0f, 1.0f);
+	version++;
 }
-void PhongMaterial::SetShiness(const float& _shiness) { shiness = _shiness; if (shiness < 0)shiness = 0; }
\ No newline at end of file
+void PhongMaterial::SetShiness(const float& _shiness) { shiness = _shiness; if (shiness < 0)shiness = 0; version++; }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 using namespace IceRender;
 
-Mesh::Mesh() {}
+Mesh::Mesh() : firstIndex(0), baseVertex(0), vaoIndex(0) {}
 Mesh::~Mesh(){}
 
 void Mesh::SetIndices(const vector<glm::uvec3>& _indices) { indices = _indices; }
@@ -74,12 +74,12 @@ GLint Mesh::GetDataComponentNum(MeshDataType _type) const
 	throw std::invalid_argument("[Exception] No such MeshDataType");
 }
 
-void Mesh::SetIboIndex(const size_t& _iboIndex) { iboIndex = _iboIndex; }
-void Mesh::SetVboIndex(const size_t& _vboIndex) { vboIndex = _vboIndex; }
+void Mesh::SetFirstIndex(const size_t& _firstIndex) { firstIndex = _firstIndex; }
+void Mesh::SetBaseVertex(const size_t& _baseVertex) { baseVertex = _baseVertex; }
 void Mesh::SetVaoIndex(const size_t& _vaoIndex) { vaoIndex = _vaoIndex; }
 
-size_t Mesh::GetIboIndex() const { return iboIndex; }
-size_t Mesh::GetVboIndex() const { return vboIndex; }
+size_t Mesh::GetFirstIndex() const { return firstIndex; }
+size_t Mesh::GetBaseVertex() const { return baseVertex; }
 size_t Mesh::GetVaoIndex() const { return vaoIndex; }
 
 vector<glm::vec3> Mesh::GetNormals() const { return normals; }
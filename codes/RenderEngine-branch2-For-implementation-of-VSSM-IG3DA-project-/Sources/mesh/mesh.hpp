@@ -23,8 +23,8 @@ namespace IceRender
 		vector<glm::vec3> positions;
 		vector<glm::vec3> normals;
 		
-		size_t iboIndex; // index of ibo in buffers
-		size_t vboIndex; // index of vbo in buffers
+		size_t firstIndex; // offset(in number of indices) of this mesh inside the shared index buffer of Rasterizer
+		size_t baseVertex; // offset(in number of vertices) of this mesh inside the shared vertex buffers of Rasterizer
 		size_t vaoIndex; // index of vao in vaos
 
 	public:
@@ -35,8 +35,8 @@ namespace IceRender
 		void SetPositions(const vector<glm::vec3>& _pos);
 		void SetNormals(const vector<glm::vec3>& _normals);
 		
-		void SetIboIndex(const size_t& _iboIndex);
-		void SetVboIndex(const size_t& _vboIndex);
+		void SetFirstIndex(const size_t& _firstIndex);
+		void SetBaseVertex(const size_t& _baseVertex);
 		void SetVaoIndex(const size_t& _vaoIndex);
 
 		const void* GetData(MeshDataType _type) const;
@@ -45,8 +45,8 @@ namespace IceRender
 		size_t GetBufferSize(MeshDataType _type) const;
 		GLint GetDataComponentType(MeshDataType _type) const;
 		GLint GetDataComponentNum(MeshDataType _type) const;
-		size_t GetIboIndex() const;
-		size_t GetVboIndex() const;
+		size_t GetFirstIndex() const;
+		size_t GetBaseVertex() const;
 		size_t GetVaoIndex() const;
 		vector<glm::vec3> GetNormals() const;
 		vector<glm::vec3> GetPositions() const;
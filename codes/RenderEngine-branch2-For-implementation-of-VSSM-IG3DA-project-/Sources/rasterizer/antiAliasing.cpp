@@ -0,0 +1,343 @@
+#include "antiAliasing.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+
+using namespace IceRender;
+
+AntiAliasing::AntiAliasing() : mode(AAMode::OFF), width(0), height(0), upscaleFilter(UpscaleFilter::BILINEAR),
+	sceneFBO(0), sceneColorTex(0), sceneDepthTex(0), msaaFBO(0), msaaColorRBO(0), msaaDepthRBO(0), resolveFBO(0), resolveTex(0),
+	historyFBO{ 0, 0 }, historyTex{ 0, 0 }, historyIndex(0), historyValid(false), frameIndex(0), curViewProjMat(1), prevViewProjMat(1), taaBlendFactor(0.9f) {}
+
+AntiAliasing::~AntiAliasing() { DeleteTargets(); }
+
+void AntiAliasing::Init() { CreateTargets(); }
+
+void AntiAliasing::Clear() { DeleteTargets(); }
+
+void AntiAliasing::CreateTargets()
+{
+	DeleteTargets();
+
+	width = GLOBAL.RENDER_WIDTH;
+	height = GLOBAL.RENDER_HEIGHT;
+
+	if (mode == AAMode::MSAA2 || mode == AAMode::MSAA4 || mode == AAMode::MSAA8)
+	{
+		int samples = mode == AAMode::MSAA2 ? 2 : (mode == AAMode::MSAA4 ? 4 : 8);
+		GLint maxSamples = 0;
+		glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+		if (samples > maxSamples)
+		{
+			Print("[Note] MSAA" + std::to_string(samples) + " is not supported, use MSAA" + std::to_string(maxSamples) + " instead.");
+			samples = maxSamples;
+		}
+
+		glCreateRenderbuffers(1, &msaaColorRBO);
+		glNamedRenderbufferStorageMultisample(msaaColorRBO, samples, GL_RGBA8, width, height);
+		glCreateRenderbuffers(1, &msaaDepthRBO);
+		glNamedRenderbufferStorageMultisample(msaaDepthRBO, samples, GL_DEPTH_COMPONENT24, width, height);
+
+		glCreateFramebuffers(1, &msaaFBO);
+		glNamedFramebufferRenderbuffer(msaaFBO, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, msaaColorRBO);
+		glNamedFramebufferRenderbuffer(msaaFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, msaaDepthRBO);
+		glNamedFramebufferDrawBuffer(msaaFBO, GL_COLOR_ATTACHMENT0);
+		if (CheckGLError()) { Print("Error in AntiAliasing::CreateTargets."); return; }
+		if (glCheckNamedFramebufferStatus(msaaFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("AntiAliasing:: MSAA Framebuffer not complete!"); return; }
+	}
+
+	// MSAA resolves into it when upscaling is required, OFF renders into it directly when upscaling is required
+	if (mode == AAMode::FXAA || mode == AAMode::TAA || IsScaled())
+	{
+		// linear filtering is required, FXAA and TAA both sample between texels
+		glCreateTextures(GL_TEXTURE_2D, 1, &sceneColorTex);
+		glTextureStorage2D(sceneColorTex, 1, GL_RGBA8, width, height);
+		glTextureParameteri(sceneColorTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(sceneColorTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(sceneColorTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(sceneColorTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &sceneDepthTex);
+		glTextureStorage2D(sceneDepthTex, 1, GL_DEPTH_COMPONENT24, width, height);
+		glTextureParameteri(sceneDepthTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(sceneDepthTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(sceneDepthTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(sceneDepthTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glCreateFramebuffers(1, &sceneFBO);
+		glNamedFramebufferTexture(sceneFBO, GL_COLOR_ATTACHMENT0, sceneColorTex, 0);
+		glNamedFramebufferTexture(sceneFBO, GL_DEPTH_ATTACHMENT, sceneDepthTex, 0);
+		glNamedFramebufferDrawBuffer(sceneFBO, GL_COLOR_ATTACHMENT0);
+		if (CheckGLError()) { Print("Error in AntiAliasing::CreateTargets."); return; }
+		if (glCheckNamedFramebufferStatus(sceneFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("AntiAliasing:: Scene Framebuffer not complete!"); return; }
+
+		if (mode == AAMode::TAA)
+		{
+			// history keeps more precision than RGBA8, otherwise the exponential blending will get stuck
+			for (int i = 0; i < 2; i++)
+			{
+				glCreateTextures(GL_TEXTURE_2D, 1, &historyTex[i]);
+				glTextureStorage2D(historyTex[i], 1, GL_RGBA16F, width, height);
+				glTextureParameteri(historyTex[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTextureParameteri(historyTex[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTextureParameteri(historyTex[i], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTextureParameteri(historyTex[i], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+				glCreateFramebuffers(1, &historyFBO[i]);
+				glNamedFramebufferTexture(historyFBO[i], GL_COLOR_ATTACHMENT0, historyTex[i], 0);
+				glNamedFramebufferDrawBuffer(historyFBO[i], GL_COLOR_ATTACHMENT0);
+				if (CheckGLError()) { Print("Error in AntiAliasing::CreateTargets."); return; }
+				if (glCheckNamedFramebufferStatus(historyFBO[i], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("AntiAliasing:: History Framebuffer not complete!"); return; }
+			}
+		}
+	}
+
+	if (mode == AAMode::FXAA && IsScaled())
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &resolveTex);
+		glTextureStorage2D(resolveTex, 1, GL_RGBA8, width, height);
+		glTextureParameteri(resolveTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(resolveTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(resolveTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(resolveTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glCreateFramebuffers(1, &resolveFBO);
+		glNamedFramebufferTexture(resolveFBO, GL_COLOR_ATTACHMENT0, resolveTex, 0);
+		glNamedFramebufferDrawBuffer(resolveFBO, GL_COLOR_ATTACHMENT0);
+		if (CheckGLError()) { Print("Error in AntiAliasing::CreateTargets."); return; }
+		if (glCheckNamedFramebufferStatus(resolveFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("AntiAliasing:: Resolve Framebuffer not complete!"); return; }
+	}
+	historyIndex = 0;
+	historyValid = false;
+	frameIndex = 0;
+}
+
+void AntiAliasing::DeleteTargets()
+{
+	GLuint framebuffers[] = { sceneFBO, msaaFBO, resolveFBO, historyFBO[0], historyFBO[1] };
+	for (auto fbo : framebuffers)
+	{
+		if (fbo != 0 && glIsFramebuffer(fbo))
+			glDeleteFramebuffers(1, &fbo);
+	}
+	GLuint textures[] = { sceneColorTex, sceneDepthTex, resolveTex, historyTex[0], historyTex[1] };
+	for (auto tex : textures)
+	{
+		if (tex != 0 && glIsTexture(tex))
+			glDeleteTextures(1, &tex);
+	}
+	GLuint renderbuffers[] = { msaaColorRBO, msaaDepthRBO };
+	for (auto rbo : renderbuffers)
+	{
+		if (rbo != 0 && glIsRenderbuffer(rbo))
+			glDeleteRenderbuffers(1, &rbo);
+	}
+	sceneFBO = sceneColorTex = sceneDepthTex = 0;
+	msaaFBO = msaaColorRBO = msaaDepthRBO = 0;
+	resolveFBO = resolveTex = 0;
+	historyFBO[0] = historyFBO[1] = historyTex[0] = historyTex[1] = 0;
+	historyValid = false;
+}
+
+void AntiAliasing::BeginFrame()
+{
+	if (width != GLOBAL.RENDER_WIDTH || height != GLOBAL.RENDER_HEIGHT)
+		CreateTargets();
+
+	if (IsTAAActive())
+	{
+		auto camera = GLOBAL.camCtrller->GetActiveCamera();
+		camera->SetJitter(glm::vec2(0));
+		curViewProjMat = camera->GetProjectionMatrix() * camera->GetViewMatrix();
+
+		// Halton(2,3) sequence with 8 samples, offset in [-0.5, 0.5] pixel
+		auto halton = [](unsigned int _index, const unsigned int& _base)
+		{
+			float f = 1, r = 0;
+			while (_index > 0)
+			{
+				f /= _base;
+				r += f * (_index % _base);
+				_index /= _base;
+			}
+			return r;
+		};
+		unsigned int sampleIndex = frameIndex % 8 + 1; // skip index 0, it is always 0
+		glm::vec2 offset(halton(sampleIndex, 2) - 0.5f, halton(sampleIndex, 3) - 0.5f);
+		camera->SetJitter(offset * glm::vec2(2.0f / width, 2.0f / height)); // pixel to NDC
+		frameIndex++;
+	}
+}
+
+void AntiAliasing::BeginScene()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, GetSceneFrameBuffer());
+	glViewport(0, 0, width, height);
+}
+
+void AntiAliasing::EndScene()
+{
+	// without upscaling, anti-aliasing outputs into default framebuffer directly. Otherwise it outputs into a texture of render resolution.
+	bool scaled = IsScaled();
+	GLuint resolvedTex = sceneColorTex;
+	switch (mode)
+	{
+	case AAMode::MSAA2:
+	case AAMode::MSAA4:
+	case AAMode::MSAA8:
+		// resolve samples(blit requires the same size for multisampled source)
+		glBlitNamedFramebuffer(msaaFBO, scaled ? sceneFBO : 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		break;
+	case AAMode::FXAA:
+		ResolveFXAA(scaled ? resolveFBO : 0);
+		resolvedTex = resolveTex;
+		break;
+	case AAMode::TAA:
+		if (!IsTAAActive())
+		{
+			// multi-view, output scene target directly and restart history later
+			if (!scaled)
+				glBlitNamedFramebuffer(sceneFBO, 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			historyValid = false;
+			break;
+		}
+		GLOBAL.camCtrller->GetActiveCamera()->SetJitter(glm::vec2(0)); // jitter only affects passes of this frame up to the scene pass
+		ResolveTAA(!scaled);
+		resolvedTex = historyTex[historyIndex];
+		break;
+	default:
+		break;
+	}
+
+	if (scaled)
+		Upscale(resolvedTex);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT);
+	CheckGLError();
+}
+
+bool AntiAliasing::IsScaled() const { return width != GLOBAL.WIN_WIDTH || height != GLOBAL.WIN_HEIGHT; }
+bool AntiAliasing::IsTAAActive() const { return mode == AAMode::TAA && GLOBAL.camCtrller->GetViewNum() == 1; }
+
+void AntiAliasing::ResolveFXAA(const GLuint& _targetFBO)
+{
+	auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
+	shared_ptr<ShaderProgram> shaderPro = fullscreenPass->Begin(GLOBAL.shaderPathPrefix + "AntiAliasing/fxaa", _targetFBO, width, height);
+	if (shaderPro == nullptr)
+		return;
+	GLuint texUnit = 0;
+	glBindTextureUnit(texUnit, sceneColorTex);
+	shaderPro->Set("sceneTex", static_cast<int>(texUnit));
+	shaderPro->Set("texelSize", glm::vec2(1.0f / width, 1.0f / height));
+	fullscreenPass->Draw();
+}
+
+void AntiAliasing::ResolveTAA(const bool& _outputToScreen)
+{
+	int writeIndex = 1 - historyIndex;
+	auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
+	shared_ptr<ShaderProgram> shaderPro = fullscreenPass->Begin(GLOBAL.shaderPathPrefix + "AntiAliasing/taa", historyFBO[writeIndex], width, height);
+	if (shaderPro == nullptr)
+		return;
+	GLuint texUnit = 0;
+	glBindTextureUnit(texUnit, sceneColorTex);
+	shaderPro->Set("sceneTex", static_cast<int>(texUnit++));
+	glBindTextureUnit(texUnit, sceneDepthTex);
+	shaderPro->Set("depthTex", static_cast<int>(texUnit++));
+	glBindTextureUnit(texUnit, historyTex[historyIndex]);
+	shaderPro->Set("historyTex", static_cast<int>(texUnit++));
+	shaderPro->Set("texelSize", glm::vec2(1.0f / width, 1.0f / height));
+	shaderPro->Set("invViewProjMat", glm::inverse(curViewProjMat));
+	shaderPro->Set("prevViewProjMat", prevViewProjMat);
+	shaderPro->Set("blendFactor", taaBlendFactor);
+	shaderPro->Set("useHistory", historyValid);
+	fullscreenPass->Draw();
+
+	// output the accumulated result
+	if (_outputToScreen)
+		glBlitNamedFramebuffer(historyFBO[writeIndex], 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	historyIndex = writeIndex;
+	historyValid = true;
+	prevViewProjMat = curViewProjMat;
+}
+
+void AntiAliasing::Upscale(const GLuint& _texID)
+{
+	auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
+	shared_ptr<ShaderProgram> shaderPro = fullscreenPass->Begin(GLOBAL.shaderPathPrefix + "Upscale/upscale", 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT);
+	if (shaderPro == nullptr)
+		return;
+	GLuint texUnit = 0;
+	glBindTextureUnit(texUnit, _texID);
+	shaderPro->Set("sourceTex", static_cast<int>(texUnit));
+	shaderPro->Set("sourceTexelSize", glm::vec2(1.0f / width, 1.0f / height));
+	shaderPro->Set("filterType", static_cast<int>(upscaleFilter));
+	fullscreenPass->Draw();
+}
+
+GLuint AntiAliasing::GetSceneFrameBuffer() const
+{
+	switch (mode)
+	{
+	case AAMode::MSAA2:
+	case AAMode::MSAA4:
+	case AAMode::MSAA8:
+		return msaaFBO;
+	default:
+		return sceneFBO; // 0 if neither post-process nor upscaling is required
+	}
+}
+
+AAMode AntiAliasing::GetMode() const { return mode; }
+void AntiAliasing::SetMode(const AAMode& _mode)
+{
+	if (mode == _mode)
+		return;
+	if (mode == AAMode::TAA)
+		GLOBAL.camCtrller->GetActiveCamera()->SetJitter(glm::vec2(0));
+	mode = _mode;
+	CreateTargets();
+}
+
+void AntiAliasing::SetTAABlendFactor(const float& _value) { taaBlendFactor = glm::clamp(_value, 0.0f, 1.0f); }
+
+UpscaleFilter AntiAliasing::GetUpscaleFilter() const { return upscaleFilter; }
+void AntiAliasing::SetUpscaleFilter(const UpscaleFilter& _filter) { upscaleFilter = _filter; }
+
+bool AntiAliasing::ParseMode(const std::string& _name, AAMode& _mode)
+{
+	for (int i = static_cast<int>(AAMode::OFF); i <= static_cast<int>(AAMode::TAA); i++)
+	{
+		if (_name == GetModeName(static_cast<AAMode>(i)))
+		{
+			_mode = static_cast<AAMode>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string AntiAliasing::GetModeName(const AAMode& _mode)
+{
+	switch (_mode)
+	{
+	case AAMode::MSAA2: return "MSAA2";
+	case AAMode::MSAA4: return "MSAA4";
+	case AAMode::MSAA8: return "MSAA8";
+	case AAMode::FXAA: return "FXAA";
+	case AAMode::TAA: return "TAA";
+	default: return "OFF";
+	}
+}
+
+bool AntiAliasing::ParseUpscaleFilter(const std::string& _name, UpscaleFilter& _filter)
+{
+	if (_name == "BILINEAR")
+		_filter = UpscaleFilter::BILINEAR;
+	else if (_name == "EDGE_AWARE")
+		_filter = UpscaleFilter::EDGE_AWARE;
+	else
+		return false;
+	return true;
+}
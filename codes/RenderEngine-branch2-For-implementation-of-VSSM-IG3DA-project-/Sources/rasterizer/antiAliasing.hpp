@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+
+namespace IceRender
+{
+	enum class AAMode
+	{
+		OFF = 0,
+		MSAA2,
+		MSAA4,
+		MSAA8,
+		FXAA,
+		TAA,
+	};
+
+	enum class UpscaleFilter
+	{
+		BILINEAR = 0,
+		EDGE_AWARE, // bilinear weights attenuated by luma difference, keeps edges sharp
+	};
+
+	/*
+	* Anti-aliasing as render passes with their own targets(instead of multisampling the default framebuffer):
+	* - OFF: scene is rendered into default framebuffer directly.
+	* - MSAA2/4/8: scene is rendered into a multisampled framebuffer, then resolved(blit) into default framebuffer.
+	* - FXAA: scene is rendered into a single-sampled texture, then filtered into default framebuffer.
+	* - TAA: projection is jittered each frame(sub-pixel), then current frame is blended with the reprojected history. With multiple camera views, the scene target is output without anti-aliasing.
+	* Usage: BeginScene() before the render method, EndScene() after it. Render methods should bind GetSceneFrameBuffer() instead of 0.
+	* Scene targets use the internal render resolution(GLOBAL.RENDER_WIDTH/HEIGHT). If it differs from window size, the anti-aliased image is upscaled to the window at last.
+	*/
+	class AntiAliasing
+	{
+	private:
+		AAMode mode;
+		int width, height; // internal render resolution
+		UpscaleFilter upscaleFilter;
+
+		// single-sampled scene target(FXAA, TAA), depth is a texture because TAA reads it to reproject
+		GLuint sceneFBO, sceneColorTex, sceneDepthTex;
+		// multisampled scene target(MSAA)
+		GLuint msaaFBO, msaaColorRBO, msaaDepthRBO;
+		// FXAA output when upscaling is required
+		GLuint resolveFBO, resolveTex;
+
+		/*TAA*/
+		GLuint historyFBO[2], historyTex[2]; // ping-pong, read one and write the other
+		int historyIndex; // index of history to read
+		bool historyValid; // history is invalid after mode/resolution changing
+		unsigned int frameIndex;
+		glm::mat4 curViewProjMat, prevViewProjMat; // without jitter
+		float taaBlendFactor; // weight of history
+
+		void CreateTargets();
+		void DeleteTargets();
+
+		bool IsScaled() const; // render resolution differs from window size
+		bool IsTAAActive() const; // history reprojection only follows one camera, TAA is skipped in multi-view
+
+		void ResolveFXAA(const GLuint& _targetFBO);
+		void ResolveTAA(const bool& _outputToScreen);
+		void Upscale(const GLuint& _texID); // draw "_texID"(render resolution) into default framebuffer(window size)
+
+	public:
+		AntiAliasing();
+		~AntiAliasing();
+
+		void Init(); // must be called after OpenGL context is created
+		void Clear();
+
+		// jitter camera for TAA, call it before the first pass reading camera matrices(e.g. camera depth pre-pass) so that all passes of the frame see the same jitter.
+		// EndScene() removes it.
+		void BeginFrame();
+		void BeginScene(); // bind scene target
+		void EndScene(); // resolve scene target into default framebuffer
+
+		GLuint GetSceneFrameBuffer() const; // framebuffer which render methods should draw into
+
+		AAMode GetMode() const;
+		void SetMode(const AAMode& _mode);
+
+		void SetTAABlendFactor(const float& _value);
+
+		UpscaleFilter GetUpscaleFilter() const;
+		void SetUpscaleFilter(const UpscaleFilter& _filter);
+
+		static bool ParseMode(const std::string& _name, AAMode& _mode); // "OFF", "MSAA2", "MSAA4", "MSAA8", "FXAA", "TAA"
+		static std::string GetModeName(const AAMode& _mode);
+		static bool ParseUpscaleFilter(const std::string& _name, UpscaleFilter& _filter); // "BILINEAR", "EDGE_AWARE"
+	};
+}
@@ -0,0 +1,376 @@
+#include "frameGraph.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include <algorithm>
+
+using namespace IceRender;
+
+#pragma region TransientTextureDesc
+TransientTextureDesc::TransientTextureDesc() : width(0), height(0), internalFormat(GL_NONE) {}
+
+TransientTextureDesc::TransientTextureDesc(const int& _width, const int& _height, const GLenum& _internalFormat) :
+	width(_width), height(_height), internalFormat(_internalFormat) {}
+
+bool TransientTextureDesc::operator==(const TransientTextureDesc& _other) const
+{
+	return width == _other.width && height == _other.height && internalFormat == _other.internalFormat;
+}
+#pragma endregion
+
+#pragma region TransientTexturePool
+TransientTexturePool::~TransientTexturePool() { Clear(); }
+
+GLuint TransientTexturePool::Acquire(const TransientTextureDesc& _desc)
+{
+	for (auto& entry : entries)
+	{
+		if (!entry.inUse && entry.desc == _desc)
+		{
+			entry.inUse = true;
+			entry.unusedFrames = 0;
+			return entry.texID;
+		}
+	}
+
+	PoolEntry entry;
+	entry.desc = _desc;
+	entry.inUse = true;
+	entry.unusedFrames = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &entry.texID);
+	glTextureStorage2D(entry.texID, 1, _desc.internalFormat, _desc.width, _desc.height);
+	// passes use texelFetch or render into it, no filtering. Outside of range is zero.
+	glTextureParameteri(entry.texID, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(entry.texID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(entry.texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(entry.texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	const float borderColor[] = { 0, 0, 0, 0 };
+	glTextureParameterfv(entry.texID, GL_TEXTURE_BORDER_COLOR, borderColor);
+	if (CheckGLError()) { Print("Error in TransientTexturePool::Acquire."); return 0; }
+
+	entries.push_back(entry);
+	return entry.texID;
+}
+
+void TransientTexturePool::Release(const GLuint& _texID)
+{
+	for (auto& entry : entries)
+	{
+		if (entry.texID == _texID)
+		{
+			entry.inUse = false;
+			return;
+		}
+	}
+}
+
+void TransientTexturePool::EndFrame()
+{
+	const int maxUnusedFrames = 3;
+	for (auto iter = entries.begin(); iter != entries.end();)
+	{
+		if (iter->inUse || iter->unusedFrames < maxUnusedFrames)
+		{
+			iter->unusedFrames++; // reset to 0 once it is acquired again
+			iter++;
+			continue;
+		}
+		// framebuffers cached by FullscreenPass may still refer to it
+		if (GLOBAL.render != nullptr)
+			GLOBAL.render->GetFullscreenPass()->ReleaseTexture(iter->texID);
+		if (glIsTexture(iter->texID))
+			glDeleteTextures(1, &iter->texID);
+		iter = entries.erase(iter);
+	}
+}
+
+void TransientTexturePool::Clear()
+{
+	for (auto& entry : entries)
+	{
+		if (GLOBAL.render != nullptr)
+			GLOBAL.render->GetFullscreenPass()->ReleaseTexture(entry.texID);
+		if (glIsTexture(entry.texID))
+			glDeleteTextures(1, &entry.texID);
+	}
+	entries.clear();
+}
+
+int TransientTexturePool::GetTextureNum() const { return static_cast<int>(entries.size()); }
+
+size_t TransientTexturePool::GetMemorySize() const
+{
+	size_t size = 0;
+	for (auto& entry : entries)
+		size += GetMemorySize(entry.desc);
+	return size;
+}
+
+size_t TransientTexturePool::GetMemorySize(const TransientTextureDesc& _desc)
+{
+	return static_cast<size_t>(_desc.width) * _desc.height * GetBytesPerTexel(_desc.internalFormat);
+}
+
+size_t TransientTexturePool::GetBytesPerTexel(const GLenum& _internalFormat)
+{
+	switch (_internalFormat)
+	{
+	case GL_R8: return 1;
+	case GL_DEPTH_COMPONENT16: case GL_RG8: case GL_R16F: return 2;
+	case GL_RGB32F: return 12;
+	case GL_RGBA32F: return 16;
+	case GL_RG32F: case GL_RGBA16F: case GL_DEPTH32F_STENCIL8: return 8;
+	default: return 4; // GL_DEPTH_COMPONENT24/32F, GL_R32F, GL_RG16F, GL_RGBA8 and etc.
+	}
+}
+#pragma endregion
+
+#pragma region FrameGraph
+FrameGraph::FrameGraph() : compiled(false) {}
+
+FrameGraph::~FrameGraph() { Clear(); }
+
+void FrameGraph::Reset()
+{
+	resources.clear();
+	passes.clear();
+	executionOrder.clear();
+	compiled = false;
+}
+
+void FrameGraph::Clear()
+{
+	Reset();
+	pool.Clear();
+}
+
+FrameGraph::ResourceHandle FrameGraph::ImportTexture(const std::string& _name, const GLuint& _texID)
+{
+	Resource resource;
+	resource.name = _name;
+	resource.imported = true;
+	resource.texID = _texID;
+	resource.firstUse = resource.lastUse = -1;
+	resources.push_back(resource);
+	return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+FrameGraph::ResourceHandle FrameGraph::CreateTexture(const std::string& _name, const TransientTextureDesc& _desc)
+{
+	Resource resource;
+	resource.name = _name;
+	resource.imported = false;
+	resource.texID = 0;
+	resource.desc = _desc;
+	resource.firstUse = resource.lastUse = -1;
+	resources.push_back(resource);
+	return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+void FrameGraph::AddPass(const std::string& _name, const std::vector<ResourceHandle>& _reads, const std::vector<ResourceHandle>& _writes,
+	const std::function<void()>& _execute, const bool& _hasSideEffect)
+{
+	Pass pass;
+	pass.name = _name;
+	pass.reads = _reads;
+	pass.writes = _writes;
+	pass.execute = _execute;
+	pass.hasSideEffect = _hasSideEffect;
+	pass.alive = false;
+	passes.push_back(pass);
+	compiled = false;
+}
+
+void FrameGraph::CullPasses()
+{
+	// walk backwards from passes with side effect, a pass is alive if any alive pass reads what it writes
+	std::vector<int> stack;
+	for (int i = 0; i < static_cast<int>(passes.size()); i++)
+	{
+		passes[i].alive = passes[i].hasSideEffect;
+		if (passes[i].alive)
+			stack.push_back(i);
+	}
+
+	while (!stack.empty())
+	{
+		int current = stack.back();
+		stack.pop_back();
+		for (auto& read : passes[current].reads)
+		{
+			for (int i = 0; i < static_cast<int>(passes.size()); i++)
+			{
+				if (passes[i].alive)
+					continue;
+				auto& writes = passes[i].writes;
+				if (std::find(writes.begin(), writes.end(), read) != writes.end())
+				{
+					passes[i].alive = true;
+					stack.push_back(i);
+				}
+			}
+		}
+	}
+}
+
+bool FrameGraph::SortPasses()
+{
+	// Kahn's algorithm, always pick the earliest added pass among the ready ones. So the insertion order is kept if it is already valid.
+	// pass j depends on pass i if j reads what i writes(read after write), or both write the same resource and i is added first(write after write)
+	int passNum = static_cast<int>(passes.size());
+	std::vector<std::vector<int>> dependents(passNum);
+	std::vector<int> inDegree(passNum, 0);
+	for (int j = 0; j < passNum; j++)
+	{
+		if (!passes[j].alive)
+			continue;
+		for (int i = 0; i < passNum; i++)
+		{
+			if (i == j || !passes[i].alive)
+				continue;
+			bool dependent = false;
+			for (auto& write : passes[i].writes)
+			{
+				auto& reads = passes[j].reads;
+				auto& writes = passes[j].writes;
+				if (std::find(reads.begin(), reads.end(), write) != reads.end() || (i < j && std::find(writes.begin(), writes.end(), write) != writes.end()))
+				{
+					dependent = true;
+					break;
+				}
+			}
+			if (dependent)
+			{
+				dependents[i].push_back(j);
+				inDegree[j]++;
+			}
+		}
+	}
+
+	executionOrder.clear();
+	std::vector<bool> done(passNum, false);
+	while (true)
+	{
+		int next = -1;
+		for (int i = 0; i < passNum; i++)
+		{
+			if (passes[i].alive && !done[i] && inDegree[i] == 0)
+			{
+				next = i;
+				break;
+			}
+		}
+		if (next == -1)
+			break;
+		done[next] = true;
+		executionOrder.push_back(next);
+		for (auto& dependent : dependents[next])
+			inDegree[dependent]--;
+	}
+
+	int aliveNum = 0;
+	for (auto& pass : passes)
+		aliveNum += pass.alive ? 1 : 0;
+	return static_cast<int>(executionOrder.size()) == aliveNum;
+}
+
+void FrameGraph::ComputeLifetimes()
+{
+	for (auto& resource : resources)
+		resource.firstUse = resource.lastUse = -1;
+
+	for (int order = 0; order < static_cast<int>(executionOrder.size()); order++)
+	{
+		auto& pass = passes[executionOrder[order]];
+		std::vector<ResourceHandle> used = pass.reads;
+		used.insert(used.end(), pass.writes.begin(), pass.writes.end());
+		for (auto& handle : used)
+		{
+			auto& resource = resources[handle];
+			if (resource.firstUse == -1)
+				resource.firstUse = order;
+			resource.lastUse = order;
+		}
+	}
+}
+
+void FrameGraph::Compile()
+{
+	CullPasses();
+	if (!SortPasses())
+	{
+		// only happens when two passes write each other's inputs, just keep the insertion order
+		Print("[Error] FrameGraph has cycle, passes are executed in insertion order.");
+		executionOrder.clear();
+		for (int i = 0; i < static_cast<int>(passes.size()); i++)
+		{
+			if (passes[i].alive)
+				executionOrder.push_back(i);
+		}
+	}
+	ComputeLifetimes();
+	compiled = true;
+}
+
+void FrameGraph::Execute()
+{
+	if (!compiled)
+		Compile();
+
+	for (int order = 0; order < static_cast<int>(executionOrder.size()); order++)
+	{
+		// allocate transient textures right before their first use
+		for (auto& resource : resources)
+		{
+			if (!resource.imported && resource.firstUse == order)
+				resource.texID = pool.Acquire(resource.desc);
+		}
+
+		passes[executionOrder[order]].execute();
+
+		// release them right after their last use, so the following passes can reuse the same texture
+		for (auto& resource : resources)
+		{
+			if (!resource.imported && resource.lastUse == order)
+			{
+				pool.Release(resource.texID);
+				resource.texID = 0;
+			}
+		}
+	}
+
+	pool.EndFrame();
+}
+
+GLuint FrameGraph::GetTexture(const ResourceHandle& _handle) const
+{
+	if (_handle < 0 || _handle >= static_cast<int>(resources.size()))
+		return 0;
+	return resources[_handle].texID;
+}
+
+void FrameGraph::PrintInfo() const
+{
+	std::string msg = "FrameGraph passes(in execution order):\n";
+	for (int order = 0; order < static_cast<int>(executionOrder.size()); order++)
+		msg.append("  " + std::to_string(order) + ". " + passes[executionOrder[order]].name + "\n");
+	for (auto& pass : passes)
+	{
+		if (!pass.alive)
+			msg.append("  [culled] " + pass.name + "\n");
+	}
+
+	// transient memory without aliasing is the sum of all transient resources, with aliasing it is the pool size
+	size_t requiredSize = 0;
+	int transientNum = 0;
+	for (auto& resource : resources)
+	{
+		if (resource.imported || resource.firstUse == -1)
+			continue;
+		requiredSize += TransientTexturePool::GetMemorySize(resource.desc);
+		transientNum++;
+	}
+	msg.append("Transient textures: " + std::to_string(transientNum) + " resources(" + std::to_string(requiredSize / (1024 * 1024)) + " MB) -> "
+		+ std::to_string(pool.GetTextureNum()) + " pooled textures(" + std::to_string(pool.GetMemorySize() / (1024 * 1024)) + " MB)");
+	Print(msg);
+}
+#pragma endregion
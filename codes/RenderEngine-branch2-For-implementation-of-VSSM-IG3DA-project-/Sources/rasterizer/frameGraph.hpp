@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace IceRender
+{
+	struct TransientTextureDesc
+	{
+	public:
+		int width;
+		int height;
+		GLenum internalFormat;
+
+		TransientTextureDesc();
+		TransientTextureDesc(const int& _width, const int& _height, const GLenum& _internalFormat);
+		bool operator==(const TransientTextureDesc& _other) const;
+	};
+
+	/*
+	* Textures for transient resources of frame graph. Textures are kept across frames(no allocation in steady state),
+	* and one texture is shared by all resources with the same description whose lifetimes don't overlap.
+	* [Note] OpenGL can not place two textures in the same memory, so aliasing is done at texture level: a released texture is handed to the next resource with the same description.
+	*/
+	class TransientTexturePool
+	{
+	private:
+		struct PoolEntry
+		{
+			TransientTextureDesc desc;
+			GLuint texID;
+			bool inUse;
+			int unusedFrames; // texture is deleted when it is not used for a few frames(e.g. resolution changed)
+		};
+		std::vector<PoolEntry> entries;
+
+		static size_t GetBytesPerTexel(const GLenum& _internalFormat);
+
+	public:
+		~TransientTexturePool();
+
+		GLuint Acquire(const TransientTextureDesc& _desc);
+		void Release(const GLuint& _texID);
+		void EndFrame(); // delete textures which are not used for a few frames
+		void Clear();
+
+		int GetTextureNum() const;
+		size_t GetMemorySize() const; // in bytes
+		static size_t GetMemorySize(const TransientTextureDesc& _desc);
+	};
+
+	/*
+	* Frame graph: passes declare which resources(textures) they read and write, then the graph
+	* - culls passes whose outputs are never read(unless the pass has side effect, e.g. drawing into the scene framebuffer)
+	* - orders passes by their dependencies(insertion order is kept when possible)
+	* - allocates transient textures from the pool right before their first use and releases them right after their last use
+	* Usage(each frame): Reset() -> ImportTexture()/CreateTexture()/AddPass() -> Compile() -> Execute().
+	* Imported textures are owned outside(e.g. shadow maps read by lighting), transient textures only live inside the frame.
+	*/
+	class FrameGraph
+	{
+	public:
+		typedef int ResourceHandle;
+
+	private:
+		struct Resource
+		{
+			std::string name;
+			bool imported;
+			GLuint texID; // imported: always valid, transient: valid between first and last use
+			TransientTextureDesc desc;
+			int firstUse, lastUse; // position in execution order, -1 if not used by any alive pass
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::vector<ResourceHandle> reads, writes;
+			std::function<void()> execute;
+			bool hasSideEffect;
+			bool alive;
+		};
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+		std::vector<int> executionOrder; // indices of alive passes
+		bool compiled;
+
+		TransientTexturePool pool;
+
+		void CullPasses();
+		bool SortPasses(); // return false if there is a cycle
+		void ComputeLifetimes();
+
+	public:
+		FrameGraph();
+		~FrameGraph();
+
+		void Reset(); // remove all passes and resources of last frame, pooled textures are kept
+		void Clear(); // also release pooled textures
+
+		ResourceHandle ImportTexture(const std::string& _name, const GLuint& _texID);
+		ResourceHandle CreateTexture(const std::string& _name, const TransientTextureDesc& _desc);
+
+		// "_execute" is called in Execute(), it can use GetTexture() to get textures of the declared resources
+		void AddPass(const std::string& _name, const std::vector<ResourceHandle>& _reads, const std::vector<ResourceHandle>& _writes,
+			const std::function<void()>& _execute, const bool& _hasSideEffect = false);
+
+		void Compile();
+		void Execute();
+
+		GLuint GetTexture(const ResourceHandle& _handle) const; // for transient resources, only valid inside the passes using it
+
+		void PrintInfo() const; // use command "frame_graph" to check passes and pool memory of the last frame
+	};
+}
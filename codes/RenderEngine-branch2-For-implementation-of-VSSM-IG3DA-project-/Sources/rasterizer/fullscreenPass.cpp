@@ -0,0 +1,96 @@
+#include "fullscreenPass.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+
+using namespace IceRender;
+
+FullscreenPass::FullscreenPass() : emptyVAO(0) {}
+
+FullscreenPass::~FullscreenPass() {}
+
+void FullscreenPass::Init()
+{
+	Clear();
+	glCreateVertexArrays(1, &emptyVAO);
+	if (CheckGLError()) { Print("Error in FullscreenPass::Init."); return; }
+}
+
+void FullscreenPass::Clear()
+{
+	for (auto iter = frameBufferCache.begin(); iter != frameBufferCache.end(); iter++)
+	{
+		GLuint fbo = iter->second;
+		if (glIsFramebuffer(fbo))
+			glDeleteFramebuffers(1, &fbo);
+	}
+	frameBufferCache.clear();
+
+	if (glIsVertexArray(emptyVAO))
+		glDeleteVertexArrays(1, &emptyVAO);
+	emptyVAO = 0;
+}
+
+GLuint FullscreenPass::GetFrameBuffer(const GLuint& _colorTex, const GLuint& _depthTex)
+{
+	auto key = std::make_pair(_colorTex, _depthTex);
+	auto iter = frameBufferCache.find(key);
+	if (iter != frameBufferCache.end())
+		return iter->second;
+
+	GLuint fbo;
+	glCreateFramebuffers(1, &fbo);
+	if (_colorTex != 0)
+	{
+		glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, _colorTex, 0);
+		glNamedFramebufferDrawBuffer(fbo, GL_COLOR_ATTACHMENT0);
+	}
+	else
+		glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+	if (_depthTex != 0)
+		glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, _depthTex, 0);
+	if (CheckGLError()) { Print("Error in FullscreenPass::GetFrameBuffer."); return 0; }
+	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("FullscreenPass:: Framebuffer not complete!"); }
+
+	frameBufferCache[key] = fbo;
+	return fbo;
+}
+
+void FullscreenPass::ReleaseTexture(const GLuint& _texID)
+{
+	if (_texID == 0)
+		return;
+	for (auto iter = frameBufferCache.begin(); iter != frameBufferCache.end();)
+	{
+		if (iter->first.first == _texID || iter->first.second == _texID)
+		{
+			GLuint fbo = iter->second;
+			if (glIsFramebuffer(fbo))
+				glDeleteFramebuffers(1, &fbo);
+			iter = frameBufferCache.erase(iter);
+		}
+		else
+			iter++;
+	}
+}
+
+shared_ptr<ShaderProgram> FullscreenPass::Begin(const std::string& _shaderName, const GLuint& _fbo, const int& _width, const int& _height)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+	glViewport(0, 0, _width, _height);
+	return GLOBAL.shaderMgr->TryActivateShaderProgram(_shaderName);
+}
+
+void FullscreenPass::Draw()
+{
+	// no depth test for full screen pass(the target may still contain the depth of scene pass)
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	if (depthTest)
+		glDisable(GL_DEPTH_TEST);
+
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+}
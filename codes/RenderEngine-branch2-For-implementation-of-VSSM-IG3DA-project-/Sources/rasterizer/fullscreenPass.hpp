@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace IceRender
+{
+	class ShaderProgram;
+
+	/*
+	* Persistent infrastructure for full screen passes(SAT passes, screen quad viewer, anti-aliasing, upscaling and other post effects):
+	* - one attribute-less triangle covering the whole viewport, vertex shader generates its position from gl_VertexID(see "SAT/sat2Copy.vs").
+	* - framebuffers are cached by their attachment set, so passes don't create/attach anything per frame.
+	* Nothing is allocated per pass.
+	*/
+	class FullscreenPass
+	{
+	private:
+		GLuint emptyVAO; // core profile requires a vertex array to be bound even if no attribute is read
+		std::map<std::pair<GLuint, GLuint>, GLuint> frameBufferCache; // key: (color texture, depth texture), value: framebuffer
+
+	public:
+		FullscreenPass();
+		~FullscreenPass();
+
+		void Init(); // must be called after OpenGL context is created
+		void Clear();
+
+		// get(create if not exists) framebuffer with "_colorTex" at GL_COLOR_ATTACHMENT0(mip level 0) and optional "_depthTex" at GL_DEPTH_ATTACHMENT
+		GLuint GetFrameBuffer(const GLuint& _colorTex, const GLuint& _depthTex = 0);
+
+		// [Important] call it before deleting a texture used by GetFrameBuffer(), because a deleted texture ID can be reused by a new texture
+		void ReleaseTexture(const GLuint& _texID);
+
+		// bind framebuffer, set viewport and activate the shader program, then set uniforms and call Draw()
+		std::shared_ptr<ShaderProgram> Begin(const std::string& _shaderName, const GLuint& _fbo, const int& _width, const int& _height);
+
+		void Draw();
+	};
+}
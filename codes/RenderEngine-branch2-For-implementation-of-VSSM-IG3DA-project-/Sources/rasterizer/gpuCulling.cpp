@@ -0,0 +1,311 @@
+#include "gpuCulling.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include "../material/phongMaterial.hpp"
+
+#ifndef GL_PARAMETER_BUFFER
+#define GL_PARAMETER_BUFFER 0x80EE // OpenGL 4.6, not inside our glad(4.5)
+#endif
+
+using namespace IceRender;
+
+GPUCulling::GPUCulling() : objectBuffer(0), commandBuffer(0), compactBuffer(0), drawCountBuffer(0), objectIDBuffer(0), materialBuffer(0),
+	objectNum(0), objectCapacity(0), viewCapacity(0), layeredViewIndex(0), uploadedSceneVersion(0), multiDrawElementsIndirectCount(nullptr) {}
+
+GPUCulling::~GPUCulling() { Clear(); }
+
+void GPUCulling::Init()
+{
+	Clear();
+
+	glCreateBuffers(1, &objectBuffer);
+	glCreateBuffers(1, &commandBuffer);
+	glCreateBuffers(1, &compactBuffer);
+	glCreateBuffers(1, &drawCountBuffer);
+	glCreateBuffers(1, &objectIDBuffer);
+	glCreateBuffers(1, &materialBuffer);
+	if (CheckGLError()) { Print("Error in GPUCulling::Init."); return; }
+
+	// objectID is read as instanced attribute, the first instance of each indirect command reads objectIDs[baseInstance]
+	glVertexArrayVertexBuffer(GLOBAL.render->GetPoolVertexArray(), 3, objectIDBuffer, 0, sizeof(GLuint));
+	glVertexArrayVertexBuffer(GLOBAL.render->GetPullingVertexArray(), 3, objectIDBuffer, 0, sizeof(GLuint));
+
+	ReserveObjects(1024);
+	ReserveViews(1 + 5); // camera + maxLightNum(SceneManager), it will grow if more views are required
+
+	// try to load glMultiDrawElementsIndirectCount, otherwise fallback to glMultiDrawElementsIndirect with non-compacted commands
+	GLint major, minor;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 6))
+		multiDrawElementsIndirectCount = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)glfwGetProcAddress("glMultiDrawElementsIndirectCount");
+	else if (glfwExtensionSupported("GL_ARB_indirect_parameters"))
+		multiDrawElementsIndirectCount = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)glfwGetProcAddress("glMultiDrawElementsIndirectCountARB");
+
+	if (multiDrawElementsIndirectCount == nullptr)
+		Print("[Note] glMultiDrawElementsIndirectCount is not supported, GPUCulling uses glMultiDrawElementsIndirect instead.");
+}
+
+void GPUCulling::Clear()
+{
+	GLuint buffers[] = { objectBuffer, commandBuffer, compactBuffer, drawCountBuffer, objectIDBuffer, materialBuffer };
+	for (auto buffer : buffers)
+	{
+		if (buffer != 0 && glIsBuffer(buffer))
+			glDeleteBuffers(1, &buffer);
+	}
+	objectBuffer = commandBuffer = compactBuffer = drawCountBuffer = objectIDBuffer = materialBuffer = 0;
+	objectNum = objectCapacity = viewCapacity = layeredViewIndex = 0;
+	objectData.clear();
+	materialData.clear();
+	uploadedVersions.clear();
+	multiDrawElementsIndirectCount = nullptr;
+}
+
+void GPUCulling::ReserveObjects(const int& _objectNum)
+{
+	if (_objectNum <= objectCapacity)
+		return;
+
+	// grow exponentially to avoid reallocation each time adding objects
+	int capacity = std::max(_objectNum, objectCapacity * 2);
+
+	// [Note] old contents are not kept, all objects are uploaded again. Commands are generated each frame.
+	glNamedBufferData(objectBuffer, capacity * sizeof(GPUObjectData), NULL, GL_DYNAMIC_DRAW);
+	glNamedBufferData(materialBuffer, capacity * sizeof(GPUMaterialData), NULL, GL_DYNAMIC_DRAW);
+	uploadedVersions.clear();
+
+	std::vector<GLuint> ids(capacity);
+	for (int i = 0; i < capacity; i++)
+		ids[i] = i;
+	glNamedBufferData(objectIDBuffer, capacity * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+
+	objectCapacity = capacity;
+
+	// command buffers depend on object capacity
+	int views = viewCapacity;
+	viewCapacity = 0;
+	ReserveViews(views);
+	if (CheckGLError()) { Print("Error in GPUCulling::ReserveObjects."); return; }
+}
+
+void GPUCulling::ReserveViews(const int& _viewNum)
+{
+	if (_viewNum <= viewCapacity)
+		return;
+
+	viewCapacity = _viewNum;
+	glNamedBufferData(commandBuffer, static_cast<size_t>(viewCapacity) * objectCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+	glNamedBufferData(compactBuffer, static_cast<size_t>(viewCapacity) * objectCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+	glNamedBufferData(drawCountBuffer, viewCapacity * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	if (CheckGLError()) { Print("Error in GPUCulling::ReserveViews."); return; }
+}
+
+void GPUCulling::UploadObjects()
+{
+	auto& sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject();
+	objectNum = static_cast<int>(sceneObjs.size());
+	ReserveObjects(objectNum);
+
+	// indices of objects are shifted by adding/removing, so their versions are not comparable any more
+	if (GLOBAL.sceneMgr->GetVersion() != uploadedSceneVersion)
+	{
+		uploadedVersions.clear();
+		uploadedSceneVersion = GLOBAL.sceneMgr->GetVersion();
+	}
+	objectData.resize(objectNum);
+	materialData.resize(objectNum);
+
+	// one upload per run of consecutive changed objects, nothing is uploaded if nothing changes
+	int dirtyBegin = -1;
+	for (int i = 0; i <= objectNum; i++)
+	{
+		bool dirty = i < objectNum && PackObject(i, sceneObjs[i]);
+		if (dirty && dirtyBegin < 0)
+			dirtyBegin = i;
+		else if (!dirty && dirtyBegin >= 0)
+		{
+			glNamedBufferSubData(objectBuffer, dirtyBegin * sizeof(GPUObjectData), (i - dirtyBegin) * sizeof(GPUObjectData), &objectData[dirtyBegin]);
+			glNamedBufferSubData(materialBuffer, dirtyBegin * sizeof(GPUMaterialData), (i - dirtyBegin) * sizeof(GPUMaterialData), &materialData[dirtyBegin]);
+			dirtyBegin = -1;
+		}
+	}
+	if (CheckGLError()) { Print("Error in GPUCulling::UploadObjects."); return; }
+}
+
+bool GPUCulling::PackObject(const int& _index, const shared_ptr<SceneObject>& _sceneObj)
+{
+	auto mesh = _sceneObj->GetMesh();
+	auto material = _sceneObj->GetMaterial();
+	GPUObjectData& data = objectData[_index];
+	GLuint indexCount = static_cast<GLuint>(mesh->GetElementCount(Mesh::MeshDataType::INDEX) * 3);
+	GLuint firstIndex = static_cast<GLuint>(mesh->GetFirstIndex());
+	GLint baseVertex = static_cast<GLint>(mesh->GetBaseVertex());
+
+	glm::uvec2 versions(_sceneObj->GetVersion(), material == nullptr ? 0 : material->GetVersion());
+	// [Note] draw range has no version(mesh is placed in geometry pool when it's uploaded), albedo which is not packed yet(e.g. still streaming) is tried again each frame
+	bool albedoPending = material != nullptr && material->GetUVDataSize() > 0 && material->GetAlbedo() != 0 && material->GetAlbedoLayer().x < 0;
+	if (_index < static_cast<int>(uploadedVersions.size()) && uploadedVersions[_index] == versions && !albedoPending &&
+		data.indexCount == indexCount && data.firstIndex == firstIndex && data.baseVertex == baseVertex)
+		return false;
+
+	auto aabb = _sceneObj->GetMeshAABB();
+	data.modelMat = _sceneObj->GetTransform()->ComputeTransformationMatrix();
+	data.aabbMin = glm::vec4(aabb->GetMin(), 1);
+	data.aabbMax = glm::vec4(aabb->GetMax(), 1);
+	data.indexCount = indexCount;
+	data.firstIndex = firstIndex;
+	data.baseVertex = baseVertex;
+	data.padding = 0;
+
+	GPUMaterialData& matData = materialData[_index];
+	matData.color = glm::vec4(Utility::oneV3, 1);
+	matData.ka = matData.kd = glm::vec4(Utility::oneV3, 0);
+	matData.ks = glm::vec4(0);
+	matData.albedo = glm::ivec4(-1);
+	if (material != nullptr)
+	{
+		matData.color = glm::vec4(material->GetColor(), 1);
+		auto phongMat = dynamic_pointer_cast<PhongMaterial>(material);
+		if (phongMat != nullptr)
+		{
+			matData.ka = glm::vec4(phongMat->GetAmbientCoef(), 0);
+			matData.kd = glm::vec4(phongMat->GetDiffuseCoef(), 0);
+			matData.ks = glm::vec4(phongMat->GetSpecularCoef(), phongMat->GetShiness());
+		}
+		if (material->GetUVDataSize() > 0 && material->GetAlbedo() != 0)
+		{
+			// albedo is packed into a texture array the first time it is uploaded
+			glm::ivec2 layer = material->GetAlbedoLayer();
+			if (layer.x < 0 && GLOBAL.render->GetTextureArrayManager()->AddTexture(material->GetAlbedo(), layer))
+				material->SetAlbedoLayer(layer);
+			matData.albedo = glm::ivec4(layer, 0, 0);
+		}
+		versions.y = material->GetVersion(); // SetAlbedoLayer changes it
+	}
+
+	if (static_cast<int>(uploadedVersions.size()) <= _index)
+		uploadedVersions.resize(_index + 1, glm::uvec2(0));
+	uploadedVersions[_index] = versions;
+	return true;
+}
+
+bool GPUCulling::PrepareCull(const int& _viewIndex)
+{
+	// never grow here, commands of views culled before in this frame would be lost(see ReserveViews)
+	if (_viewIndex >= viewCapacity)
+	{
+		Print("[Error] GPUCulling::Cull: view " + std::to_string(_viewIndex) + " is not reserved.");
+		return false;
+	}
+
+	// reset draw count of this view
+	GLuint zero = 0;
+	glClearNamedBufferSubData(drawCountBuffer, GL_R32UI, _viewIndex * sizeof(GLuint), sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	return objectNum > 0;
+}
+
+void GPUCulling::DispatchCull(const int& _viewIndex, const shared_ptr<ShaderProgram>& _shaderPro)
+{
+	_shaderPro->Set("objectNum", objectNum);
+	_shaderPro->Set("commandOffset", _viewIndex * objectCapacity);
+	_shaderPro->Set("viewIndex", _viewIndex);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, compactBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, drawCountBuffer);
+
+	const int groupSize = 64; // same as local_size_x in shaders
+	glDispatchCompute((objectNum + groupSize - 1) / groupSize, 1, 1);
+
+	// commands are consumed by indirect draw, and count is consumed as parameter buffer
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	if (CheckGLError()) { Print("Error in GPUCulling::DispatchCull."); return; }
+}
+
+void GPUCulling::Cull(const int& _viewIndex, const glm::mat4& _viewProjMat)
+{
+	if (!PrepareCull(_viewIndex))
+		return;
+
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "Culling/frustumCulling");
+	if (shaderPro == nullptr)
+		return;
+
+	// extract 6 frustum planes(in world space) from the matrix, refer: "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix, Gribb & Hartmann"
+	// glm is column-major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(_viewProjMat[0][i], _viewProjMat[1][i], _viewProjMat[2][i], _viewProjMat[3][i]);
+	glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+	for (int i = 0; i < 6; i++)
+		shaderPro->Set("planes[" + std::to_string(i) + "]", planes[i]);
+	DispatchCull(_viewIndex, shaderPro);
+}
+
+void GPUCulling::CullLayered(const int& _viewIndex, const std::vector<glm::mat4>& _viewProjMats)
+{
+	if (_viewProjMats.empty() || static_cast<int>(_viewProjMats.size()) > maxLayerNum)
+	{
+		Print("[Error] GPUCulling::CullLayered: layer number " + std::to_string(_viewProjMats.size()) + " is not in [1, " + std::to_string(maxLayerNum) + "].");
+		return;
+	}
+	if (!PrepareCull(_viewIndex))
+		return;
+
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "Culling/layeredCulling");
+	if (shaderPro == nullptr)
+		return;
+
+	// frustum planes of each layer are extracted in shader, then an object is only tested once per layer
+	for (int i = 0; i < static_cast<int>(_viewProjMats.size()); i++)
+		shaderPro->Set("viewProjMats[" + std::to_string(i) + "]", _viewProjMats[i]);
+	shaderPro->Set("layerNum", static_cast<int>(_viewProjMats.size()));
+	DispatchCull(_viewIndex, shaderPro);
+}
+
+void GPUCulling::DrawVisible(const int& _viewIndex, const int& _instanceNum)
+{
+	if (objectNum == 0)
+		return;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+	GLuint vao = GLOBAL.render->GetDrawVertexArray();
+	// objectID is objectIDs[baseInstance + gl_InstanceID / divisor], all layers(instances) of a command must read the one of its object
+	if (_instanceNum > 1)
+		glVertexArrayBindingDivisor(vao, 3, _instanceNum);
+	glBindVertexArray(vao);
+	size_t offset = static_cast<size_t>(_viewIndex) * objectCapacity * sizeof(DrawElementsIndirectCommand);
+	if (multiDrawElementsIndirectCount != nullptr)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, compactBuffer);
+		glBindBuffer(GL_PARAMETER_BUFFER, drawCountBuffer);
+		multiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)offset, _viewIndex * sizeof(GLuint), objectNum, 0);
+		glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	}
+	else
+	{
+		// culled commands have instanceCount=0, therefore they don't produce any primitive
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)offset, objectNum, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	if (_instanceNum > 1)
+		glVertexArrayBindingDivisor(vao, 3, 1);
+}
+
+void GPUCulling::BindDrawDataBuffers()
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, materialBuffer);
+}
+
+int GPUCulling::GetLayeredViewIndex() const { return layeredViewIndex; }
+void GPUCulling::SetLayeredViewIndex(const int& _viewIndex) { layeredViewIndex = _viewIndex; }
+int GPUCulling::GetObjectNum() const { return objectNum; }
+GLuint GPUCulling::GetObjectBuffer() const { return objectBuffer; }
+GLuint GPUCulling::GetMaterialBuffer() const { return materialBuffer; }
+GLuint GPUCulling::GetDrawCountBuffer() const { return drawCountBuffer; }
+int GPUCulling::GetLightViewIndex(const int& _shadowViewKey) { return GLOBAL.camCtrller->GetViewNum() + _shadowViewKey; }
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+
+namespace IceRender
+{
+	class SceneObject;
+	class ShaderProgram;
+
+	// [Important] memory layout must be the same as "ObjectData" in "Culling/frustumCulling.cs" and in "xxIndirect.vs" shaders(std430)
+	struct GPUObjectData
+	{
+		glm::mat4 modelMat;
+		glm::vec4 aabbMin; // AABB of mesh(before transformation), w is not used
+		glm::vec4 aabbMax;
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint padding;
+	};
+
+	// [Important] memory layout must be the same as "MaterialData" in "Phong/phong.fs"(and its ".main_fs")(std430)
+	struct GPUMaterialData
+	{
+		glm::vec4 color; // w is not used
+		glm::vec4 ka; // w is not used
+		glm::vec4 kd; // w is not used
+		glm::vec4 ks; // w is shiness
+		glm::ivec4 albedo; // x: index of texture array(-1 means no albedo texture), y: layer, see TextureArrayManager
+	};
+
+	// same layout as OpenGL required, refer: https://registry.khronos.org/OpenGL-Refpages/gl4/html/glDrawElementsIndirect.xhtml
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance; // we use it as objectID(index of GPUObjectData), read by instanced vertex attribute at location=3
+	};
+
+	/*
+	* Frustum culling on GPU:
+	* - all scene objects(mesh AABB, model matrix and draw range in geometry pool) are kept in one SSBO, only changed objects are uploaded each frame.
+	* - for each view(camera or a light frustum), one compute dispatch tests all AABBs and writes the indirect draw commands.
+	* - then the whole view can be drawn by one multi-draw call, CPU doesn't touch any object per view.
+	* Materials are uploaded together with objects(same index), so a shader can read both by objectID and draw different materials in one multi-draw call.
+	* View index [0, viewNum) is for camera views(see CameraController::AddView), "viewNum + shadow view key" for shadow maps of lights(use GetLightViewIndex).
+	* A shadow view key is the light index, or one per view of a light(see BasicShadowMapRender::GetShadowViewKey).
+	* One more view after them is for layered shadow passes(see CullLayered): each command covers all layers as instances.
+	*/
+	class GPUCulling
+	{
+	private:
+		GLuint objectBuffer; // SSBO of GPUObjectData
+		GLuint commandBuffer; // one command per object per view, culled object gets instanceCount=0. [view0: obj0...objN][view1: obj0...objN]...
+		GLuint compactBuffer; // compacted commands(only visible objects) per view, used with drawCountBuffer
+		GLuint drawCountBuffer; // number of visible objects per view
+		GLuint objectIDBuffer; // 0,1,2,...,objectCapacity-1, instanced attribute(divisor=1) so that baseInstance becomes objectID in vertex shader
+		GLuint materialBuffer; // SSBO of GPUMaterialData
+
+		int objectNum;
+		int objectCapacity;
+		int viewCapacity;
+		int layeredViewIndex; // view used by CullLayered(), after all camera and shadow views of this frame
+
+		std::vector<GPUObjectData> objectData; // same contents as objectBuffer
+		std::vector<GPUMaterialData> materialData;
+		std::vector<glm::uvec2> uploadedVersions; // object and material version of each uploaded object, see PackObject()
+		unsigned int uploadedSceneVersion; // objects are added/removed once scene version changes, then everything is uploaded again
+
+		// glMultiDrawElementsIndirectCount is OpenGL 4.6(or GL_ARB_indirect_parameters), our glad is 4.5. Load it at run-time if it's supported.
+		typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)(GLenum mode, GLenum type, const void* indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride);
+		PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC multiDrawElementsIndirectCount;
+
+		void ReserveObjects(const int& _objectNum);
+		bool PackObject(const int& _index, const std::shared_ptr<SceneObject>& _sceneObj); // fill objectData/materialData of an object, false if nothing changed since its last upload
+		bool PrepareCull(const int& _viewIndex); // reset draw count of the view, false if there is nothing to cull
+		void DispatchCull(const int& _viewIndex, const std::shared_ptr<ShaderProgram>& _shaderPro); // bind buffers and run the active culling shader for the view
+
+	public:
+		static const int maxLayerNum = 32; // same as "maxLayerNum" in "Culling/layeredCulling.cs", enough for all views of all lights(5 lights * 6 cube faces)
+
+		GPUCulling();
+		~GPUCulling();
+
+		void Init(); // must be called after OpenGL context is created
+		void Clear();
+
+		// upload scene objects and their materials which changed since last frame, call it once per frame before any Cull()
+		void UploadObjects();
+
+		// bind "ObjectBuffer"(binding=0) and "MaterialBuffer"(binding=7) for shaders reading per-draw data by objectID
+		void BindDrawDataBuffers();
+
+		// make sure views [0, _viewNum) have their commands. Call it before the first Cull() of a frame: growing reallocates command buffers without keeping their contents
+		void ReserveViews(const int& _viewNum);
+
+		// test all objects against the frustum of "_viewProjMat"(projMat*viewMat, or light space matrix) and generate indirect commands for view "_viewIndex"
+		void Cull(const int& _viewIndex, const glm::mat4& _viewProjMat);
+
+		// test all objects against the frustums of "_viewProjMats"(at most maxLayerNum), an object inside any of them gets one command with one instance per layer.
+		// gl_InstanceID is the layer then, so a layered shader can read its matrix by gl_InstanceID and clip against it
+		void CullLayered(const int& _viewIndex, const std::vector<glm::mat4>& _viewProjMats);
+
+		// draw all visible objects of view "_viewIndex" in one call. The active shader should read model matrix from "ObjectBuffer"(binding=0) by objectID(location=3)
+		// "_instanceNum" must be the layer number of CullLayered() for a layered view, then every instance of a command reads the same objectID
+		void DrawVisible(const int& _viewIndex, const int& _instanceNum = 1);
+
+		int GetLayeredViewIndex() const;
+		void SetLayeredViewIndex(const int& _viewIndex); // must be reserved(see ReserveViews) and not be used by any other view of this frame
+
+		int GetObjectNum() const;
+		GLuint GetObjectBuffer() const;
+		GLuint GetMaterialBuffer() const;
+		GLuint GetDrawCountBuffer() const;
+
+		static int GetLightViewIndex(const int& _shadowViewKey);
+	};
+}
@@ -7,13 +7,25 @@
 using namespace std;
 using namespace IceRender;
 
-Rasterizer::Rasterizer() {}
+Rasterizer::Rasterizer() : posBuffer(0), normalBuffer(0), uvBuffer(0), indexBuffer(0), poolVAO(0), pullingVAO(0), useVertexPulling(false),
+	vertexCapacity(0), vertexUsed(0), indexCapacity(0), indexUsed(0), gpuCulling(make_shared<GPUCulling>()), useGPUCulling(true),
+	fullscreenPass(make_shared<FullscreenPass>()), frameGraph(make_shared<FrameGraph>()), antiAliasing(make_shared<AntiAliasing>()),
+	textureArrayMgr(make_shared<TextureArrayManager>()), textureStreamer(make_shared<TextureStreamer>()), ssao(make_shared<SSAO>()), softwareRasterizer(make_shared<SoftwareRasterizer>()), rayTracer(make_shared<RayTracer>()), renderScale(1.0f) {}
 Rasterizer::~Rasterizer() {}
 
 void Rasterizer::Init()
 {
 	glViewport(0, 0, (GLint)GLOBAL.WIN_WIDTH, (GLint)GLOBAL.WIN_HEIGHT); // Dimension of the rendering region in the window
 	InitRenderFuncMap();
+	InitGeometryPool();
+	gpuCulling->Init();
+	fullscreenPass->Init();
+	textureStreamer->Init();
+
+	antiAliasing->Init();
+	AAMode aaMode;
+	if (AntiAliasing::ParseMode(GLOBAL.defaultAntiAliasing, aaMode))
+		antiAliasing->SetMode(aaMode);
 }
 
 void Rasterizer::Setting()
@@ -32,22 +44,152 @@ void Rasterizer::Render()
 {
 	// TODO: maybe it is not good way to call render function here,
 	// to reconstruct here later when implementing SSAO/SSDO/VSM and etc.
+	textureStreamer->Update(); // before uploading materials, so textures which just landed are packed this frame
 	string curRenderMethod = GLOBAL.sceneMgr->GetCurrentRenderMethod();
 	if (!curRenderMethod.empty())
 	{
+		if (useVertexPulling)
+			BindPoolStorageBuffers();
+
+		int viewNum = GLOBAL.camCtrller->GetViewNum();
+		UpdateViewAspects();
+
+		// upload objects and materials once(also read by render methods without culling), then cull them for each camera view and each shadow light.
+		// Each view just reads its own indirect commands later.
+		gpuCulling->UploadObjects();
+		// shadow views of lights can follow the camera(e.g. cascades), update them before shadow maps are culled and rendered
+		if (GLOBAL.shadowMgr->IsNeedShadowRender())
+			GLOBAL.shadowMgr->UpdateShadowViews();
+		if (useGPUCulling)
+		{
+			// reserve all views before any Cull(): growing reallocates command buffers, commands of views culled before would be lost
+			int cullViewNum = viewNum;
+			if (GLOBAL.shadowMgr->IsNeedShadowRender())
+			{
+				auto lights = GLOBAL.sceneMgr->GetAllLight();
+				for (int i = 0; i < static_cast<int>(lights.size()); i++)
+				{
+					if (lights[i]->IsRenderShadow())
+						cullViewNum = std::max(cullViewNum, GPUCulling::GetLightViewIndex(BasicShadowMapRender::GetShadowViewKey(i, lights[i]->GetShadowViewNum() - 1)) + 1);
+				}
+			}
+			// one more view after them for layered shadow passes, which cull all dirty shadow views together(see BasicShadowMapRender::DrawLayered)
+			gpuCulling->SetLayeredViewIndex(cullViewNum);
+			gpuCulling->ReserveViews(cullViewNum + 1);
+
+			for (int viewIndex = 0; viewIndex < viewNum; viewIndex++)
+			{
+				auto camera = GLOBAL.camCtrller->GetView(viewIndex);
+				gpuCulling->Cull(viewIndex, camera->GetProjectionMatrix() * camera->GetViewMatrix());
+			}
+			if (GLOBAL.shadowMgr->IsNeedShadowRender())
+			{
+				auto lights = GLOBAL.sceneMgr->GetAllLight();
+				for (int i = 0; i < static_cast<int>(lights.size()); i++)
+				{
+					if (!lights[i]->IsRenderShadow())
+						continue;
+					// one culling view per shadow view, e.g. each cube face only draws objects inside its own frustum
+					for (int v = 0; v < lights[i]->GetShadowViewNum(); v++)
+					{
+						LightCamInfo lightCamInfo;
+						gpuCulling->Cull(GPUCulling::GetLightViewIndex(BasicShadowMapRender::GetShadowViewKey(i, v)), lights[i]->GetShadowViewMat(v, lightCamInfo));
+					}
+				}
+			}
+		}
+
+		// passes declare what they read/write, frame graph culls and orders them, and allocates transient textures(e.g. SAT scratch) for them
+		frameGraph->Reset();
+		// one depth pre-pass of camera views shared by SSAO and SDSM, it is culled if neither of them reads it
+		auto cameraDepth = frameGraph->CreateTexture("CameraDepth", TransientTextureDesc(GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT, GL_DEPTH_COMPONENT24));
+		frameGraph->AddPass("CameraDepth", {}, { cameraDepth }, [this, cameraDepth]() { RenderCameraDepth(frameGraph->GetTexture(cameraDepth)); });
+
+		vector<FrameGraph::ResourceHandle> shadowOutputs;
 		if (GLOBAL.shadowMgr->IsNeedShadowRender())
-			GLOBAL.shadowMgr->RenderShadow();
-		// call different render method based on current active shader program
-		auto it = renderFuncMap.find(curRenderMethod);
-		if (it != renderFuncMap.end())
-			it->second();
+			GLOBAL.shadowMgr->AddShadowPasses(*frameGraph, cameraDepth, shadowOutputs);
+
+		vector<FrameGraph::ResourceHandle> sceneReads;
+		if (shadowReaderFuncs.find(curRenderMethod) != shadowReaderFuncs.end())
+			sceneReads = shadowOutputs;
+		if (ssao->IsEnabled())
+		{
+			FrameGraph::ResourceHandle aoOutput;
+			ssao->AddPasses(*frameGraph, cameraDepth, aoOutput);
+			if (ssaoReaderFuncs.find(curRenderMethod) != ssaoReaderFuncs.end())
+				sceneReads.push_back(aoOutput);
+		}
+		// scene pass draws into scene framebuffer(then default framebuffer), which is not tracked by frame graph. So it has side effect and it is never culled.
+		frameGraph->AddPass("Scene", sceneReads, {}, [this, curRenderMethod, viewNum]()
+			{
+				antiAliasing->BeginScene();
+				// call different render method based on current active shader program
+				auto it = renderFuncMap.find(curRenderMethod);
+				if (it == renderFuncMap.end())
+					Print("[Error] No corresponding render functions for current RenderMethod: " + curRenderMethod);
+				for (int viewIndex = 0; it != renderFuncMap.end() && viewIndex < viewNum; viewIndex++)
+				{
+					// render methods read GetActiveCamera(), which returns the camera of current view
+					GLOBAL.camCtrller->SetCurrentView(viewIndex);
+					ApplyViewViewport();
+					it->second();
+				}
+				GLOBAL.camCtrller->SetCurrentView(0);
+				glDisable(GL_SCISSOR_TEST);
+				antiAliasing->EndScene();
+			}, true);
+
+		frameGraph->Compile();
+		antiAliasing->BeginFrame(); // after culling and shadow views, which only need the unjittered camera
+		frameGraph->Execute();
+	}
+}
+
+void Rasterizer::RenderCameraDepth(const GLuint& _depthTex)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, fullscreenPass->GetFrameBuffer(0, _depthTex));
+	glClearDepth(1.0f);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	// the same shaders as shadow map, "lightMat" is the view projection matrix of camera view
+	string shaderName = useGPUCulling ? "ShadowMap/shadowMapIndirect" : "ShadowMap/shadowMap";
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + shaderName, GetVertexVariant());
+	int viewNum = GLOBAL.camCtrller->GetViewNum();
+	for (int viewIndex = 0; viewIndex < viewNum; viewIndex++)
+	{
+		glm::ivec4 rect = GetViewRect(viewIndex);
+		glViewport(rect.x, rect.y, rect.z, rect.w);
+		auto camera = GLOBAL.camCtrller->GetView(viewIndex);
+		shaderPro->Set("lightMat", camera->GetProjectionMatrix() * camera->GetViewMatrix());
+
+		if (useGPUCulling)
+			gpuCulling->DrawVisible(viewIndex); // camera views come first in GPUCulling
 		else
-			Print("[Error] No corresponding render functions for current RenderMethod: " + curRenderMethod);
+		{
+			auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
+			for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
+			{
+				auto sceneObj = *iter;
+				shaderPro->Set("modelMat", sceneObj->GetTransform()->ComputeTransformationMatrix());
+				Draw(sceneObj);
+			}
+		}
 	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // set it back to normal
+	if (CheckGLError()) { Print("Error in Rasterizer::RenderCameraDepth."); return; }
 }
 
 void Rasterizer::Clear()
 {
+	antiAliasing->Clear();
+	frameGraph->Clear();
+	textureStreamer->Clear();
+	softwareRasterizer->Clear();
+	rayTracer->Clear();
+	textureArrayMgr->Clear();
+	fullscreenPass->Clear();
+
 	// delete all buffers
 	DeleteAllBuffers();
 
@@ -57,7 +199,12 @@ void Rasterizer::Clear()
 	// Clear all shader program
 	GLOBAL.shaderMgr->Clear();
 
+	gpuCulling->Clear();
+	ClearGeometryPool();
+
 	renderFuncMap.clear();
+	shadowReaderFuncs.clear();
+	ssaoReaderFuncs.clear();
 }
 
 size_t Rasterizer::CreateBuffer()
@@ -150,93 +297,234 @@ void Rasterizer::DeleteAllVertexArray()
 	vaos.clear();
 }
 
+void Rasterizer::InitGeometryPool()
+{
+	ClearGeometryPool();
+
+	glCreateBuffers(1, &posBuffer);
+	glCreateBuffers(1, &normalBuffer);
+	glCreateBuffers(1, &uvBuffer);
+	glCreateBuffers(1, &indexBuffer);
+	if (CheckGLError()) { Print("Error in Rasterizer::InitGeometryPool."); return; }
+
+	// [Note] use glNamedBufferData(mutable storage) instead of glNamedBufferStorage, because pool need to grow and keep the same buffer ID(vertex arrays refer to these IDs)
+	const size_t initVertexNum = 1 << 16;
+	const size_t initIndexNum = 1 << 18;
+	ReservePoolBuffer(posBuffer, 0, initVertexNum, sizeof(glm::vec3));
+	ReservePoolBuffer(normalBuffer, 0, initVertexNum, sizeof(glm::vec3));
+	ReservePoolBuffer(uvBuffer, 0, initVertexNum, sizeof(glm::vec2));
+	ReservePoolBuffer(indexBuffer, 0, initIndexNum, sizeof(GLuint));
+	vertexCapacity = initVertexNum;
+	indexCapacity = initIndexNum;
+
+	// one vertex array to read the whole pool, mesh is selected by firstIndex/baseVertex of draw command
+	glCreateVertexArrays(1, &poolVAO);
+	glVertexArrayVertexBuffer(poolVAO, 0, posBuffer, 0, sizeof(glm::vec3));
+	glVertexArrayVertexBuffer(poolVAO, 1, normalBuffer, 0, sizeof(glm::vec3));
+	glVertexArrayVertexBuffer(poolVAO, 2, uvBuffer, 0, sizeof(glm::vec2));
+	glVertexArrayElementBuffer(poolVAO, indexBuffer);
+	InitVertexArrayFormat(poolVAO, true);
+	// location=3 is objectID, one value per instance(its buffer is bound by GPUCulling)
+	glEnableVertexArrayAttrib(poolVAO, 3);
+	glVertexArrayAttribIFormat(poolVAO, 3, 1, GL_UNSIGNED_INT, 0);
+	glVertexArrayAttribBinding(poolVAO, 3, 3);
+	glVertexArrayBindingDivisor(poolVAO, 3, 1);
+
+	// vertex pulling reads nothing from vertex array except indices, and objectID for indirect draws(same as poolVAO)
+	glCreateVertexArrays(1, &pullingVAO);
+	glVertexArrayElementBuffer(pullingVAO, indexBuffer);
+	glEnableVertexArrayAttrib(pullingVAO, 3);
+	glVertexArrayAttribIFormat(pullingVAO, 3, 1, GL_UNSIGNED_INT, 0);
+	glVertexArrayAttribBinding(pullingVAO, 3, 3);
+	glVertexArrayBindingDivisor(pullingVAO, 3, 1);
+	if (CheckGLError()) { Print("Error in Rasterizer::InitGeometryPool."); return; }
+}
+
+void Rasterizer::ClearGeometryPool()
+{
+	GLuint poolBuffers[] = { posBuffer, normalBuffer, uvBuffer, indexBuffer };
+	for (auto buffer : poolBuffers)
+	{
+		if (glIsBuffer(buffer))
+			glDeleteBuffers(1, &buffer);
+	}
+	posBuffer = normalBuffer = uvBuffer = indexBuffer = 0;
+
+	if (glIsVertexArray(poolVAO))
+		glDeleteVertexArrays(1, &poolVAO);
+	poolVAO = 0;
+
+	if (glIsVertexArray(pullingVAO))
+		glDeleteVertexArrays(1, &pullingVAO);
+	pullingVAO = 0;
+
+	vertexCapacity = vertexUsed = indexCapacity = indexUsed = 0;
+	freeVertexRanges.clear();
+	freeIndexRanges.clear();
+}
+
+size_t Rasterizer::AllocatePoolRange(vector<glm::vec<2, size_t>>& _freeRanges, size_t& _used, const size_t& _count)
+{
+	// first-fit in released ranges
+	for (auto iter = _freeRanges.begin(); iter != _freeRanges.end(); iter++)
+	{
+		if ((*iter).y >= _count)
+		{
+			size_t offset = (*iter).x;
+			(*iter).x += _count;
+			(*iter).y -= _count;
+			if ((*iter).y == 0)
+				_freeRanges.erase(iter);
+			return offset;
+		}
+	}
+	// otherwise append at the end
+	size_t offset = _used;
+	_used += _count;
+	return offset;
+}
+
+void Rasterizer::ReleasePoolRange(vector<glm::vec<2, size_t>>& _freeRanges, size_t& _used, const size_t& _offset, const size_t& _count)
+{
+	if (_count == 0)
+		return;
+
+	// keep ranges sorted by offset, then merge the neighbours to avoid fragmentation
+	auto iter = std::lower_bound(_freeRanges.begin(), _freeRanges.end(), _offset, [](const glm::vec<2, size_t>& _range, const size_t& _value) { return _range.x < _value; });
+	iter = _freeRanges.insert(iter, glm::vec<2, size_t>(_offset, _count));
+	if (iter + 1 != _freeRanges.end() && (*iter).x + (*iter).y == (*(iter + 1)).x)
+	{
+		(*iter).y += (*(iter + 1)).y;
+		_freeRanges.erase(iter + 1);
+	}
+	if (iter != _freeRanges.begin() && (*(iter - 1)).x + (*(iter - 1)).y == (*iter).x)
+	{
+		(*(iter - 1)).y += (*iter).y;
+		iter = _freeRanges.erase(iter) - 1;
+	}
+	// the last range can be given back to the unused tail
+	if ((*iter).x + (*iter).y == _used)
+	{
+		_used = (*iter).x;
+		_freeRanges.erase(iter);
+	}
+}
+
+void Rasterizer::ReservePoolBuffer(const GLuint& _buffer, const size_t& _oldCapacity, const size_t& _newCapacity, const size_t& _elementSize)
+{
+	if (_oldCapacity == 0)
+	{
+		glNamedBufferData(_buffer, _newCapacity * _elementSize, NULL, GL_DYNAMIC_DRAW);
+		return;
+	}
+
+	// copy old content into a temporary buffer, reallocate, then copy it back(all on GPU)
+	GLuint tempBuffer;
+	glCreateBuffers(1, &tempBuffer);
+	glNamedBufferData(tempBuffer, _oldCapacity * _elementSize, NULL, GL_STREAM_COPY);
+	glCopyNamedBufferSubData(_buffer, tempBuffer, 0, 0, _oldCapacity * _elementSize);
+	glNamedBufferData(_buffer, _newCapacity * _elementSize, NULL, GL_DYNAMIC_DRAW);
+	glCopyNamedBufferSubData(tempBuffer, _buffer, 0, 0, _oldCapacity * _elementSize);
+	glDeleteBuffers(1, &tempBuffer);
+	CheckGLError();
+}
+
+void Rasterizer::InitVertexArrayFormat(const GLuint& _vao, const bool& _useUV)
+{
+	/*
+	* The below format setting is actually related to the current active Vertex/Frag shader. The attribute index is related to 'location' in shader.
+	* binding index is the same as attribute index, e.g. attribute 0(pos) reads binding 0(posBuffer)
+	*/
+	glEnableVertexArrayAttrib(_vao, 0); // location=0 in shader
+	glVertexArrayAttribFormat(_vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(_vao, 0, 0);
+
+	glEnableVertexArrayAttrib(_vao, 1); // location=1 in shader
+	glVertexArrayAttribFormat(_vao, 1, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(_vao, 1, 1);
+
+	if (_useUV)
+	{
+		glEnableVertexArrayAttrib(_vao, 2); // location=2 in shader
+		glVertexArrayAttribFormat(_vao, 2, 2, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(_vao, 2, 2);
+	}
+}
+
+void Rasterizer::BindPoolStorageBuffers()
+{
+	// [Note] bind whole buffers each frame, because pool buffers may be reallocated(grow) when adding meshes
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, posBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, normalBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, uvBuffer);
+}
+
 void Rasterizer::InitGPUData(shared_ptr<SceneObject>& _sceneObj)
 {
 	/*
 	* The basic idea to use buffer here is that:
-	* For each model(which may contains only one mesh), we use two buffer to store its data:
-	* - one buffer for triangles indices only
-	* - one buffer for vertex attribute such as position, normal, uv and so on. I will put them into one single buffer by using offset
-	* - one vertex array for reading these two buffers
+	* All models share the same pool buffers(posBuffer, normalBuffer, uvBuffer and indexBuffer), each model just allocates a range in them:
+	* - one range in indexBuffer for triangles indices only
+	* - one range(the same offset) in each vertex attribute buffer, such as position, normal, uv and so on.
+	* - no vertex array per model, Draw() uses the pool vertex array with base vertex to read these ranges
+	* Because all models are inside the same buffers, they can also be drawn together by multi-draw indirect(see GPUCulling)
 	*/
 	shared_ptr<Mesh> meshPtr = _sceneObj->GetMesh();
-	size_t iboIndex = CreateBuffer();
-	meshPtr->SetIboIndex(iboIndex);
-	size_t vboIndex = CreateBuffer();
-	meshPtr->SetVboIndex(vboIndex);
-
-	// (1) initialize two-buffers
-	// initialize indices buffer
-	GLuint ibo = buffers[iboIndex];
-	size_t bufferSize = meshPtr->GetBufferSize(Mesh::MeshDataType::INDEX);
-	glNamedBufferStorage(ibo, bufferSize, meshPtr->GetData(Mesh::MeshDataType::INDEX), GL_DYNAMIC_STORAGE_BIT); // allocate and initilize buffer
-
-	// initialize vertices buffer
-	GLuint vbo = buffers[vboIndex];
-	size_t pBufSize = meshPtr->GetBufferSize(Mesh::MeshDataType::POS); // memory size of position data 
-	size_t nBufSize = meshPtr->GetBufferSize(Mesh::MeshDataType::NORMAL); // memory size of normal data
+	size_t vertexNum = meshPtr->GetElementCount(Mesh::MeshDataType::POS);
+	size_t indexNum = meshPtr->GetElementCount(Mesh::MeshDataType::INDEX) * 3; // each element is a triangle
+	size_t baseVertex = AllocatePoolRange(freeVertexRanges, vertexUsed, vertexNum);
+	size_t firstIndex = AllocatePoolRange(freeIndexRanges, indexUsed, indexNum);
+	meshPtr->SetBaseVertex(baseVertex);
+	meshPtr->SetFirstIndex(firstIndex);
+
+	// (1) grow pool if needed
+	if (vertexUsed > vertexCapacity)
+	{
+		size_t newCapacity = std::max(vertexUsed, vertexCapacity * 2);
+		ReservePoolBuffer(posBuffer, vertexCapacity, newCapacity, sizeof(glm::vec3));
+		ReservePoolBuffer(normalBuffer, vertexCapacity, newCapacity, sizeof(glm::vec3));
+		ReservePoolBuffer(uvBuffer, vertexCapacity, newCapacity, sizeof(glm::vec2));
+		vertexCapacity = newCapacity;
+	}
+	if (indexUsed > indexCapacity)
+	{
+		size_t newCapacity = std::max(indexUsed, indexCapacity * 2);
+		ReservePoolBuffer(indexBuffer, indexCapacity, newCapacity, sizeof(GLuint));
+		indexCapacity = newCapacity;
+	}
+
+	// (2) initialize data
+	glNamedBufferSubData(indexBuffer, firstIndex * sizeof(GLuint), meshPtr->GetBufferSize(Mesh::MeshDataType::INDEX), meshPtr->GetData(Mesh::MeshDataType::INDEX)); // initialize indices data
+	glNamedBufferSubData(posBuffer, baseVertex * sizeof(glm::vec3), meshPtr->GetBufferSize(Mesh::MeshDataType::POS), meshPtr->GetData(Mesh::MeshDataType::POS)); // initialize posistion data
+	glNamedBufferSubData(normalBuffer, baseVertex * sizeof(glm::vec3), meshPtr->GetBufferSize(Mesh::MeshDataType::NORMAL), meshPtr->GetData(Mesh::MeshDataType::NORMAL)); // initialize normal data
+
 	size_t uvBufSize = 0;
 	shared_ptr<Material> materialPtr = _sceneObj->GetMaterial();
 	if (materialPtr)
-		uvBufSize = materialPtr->GetUVDataSize();
-	size_t totalBufSize = pBufSize + nBufSize + uvBufSize;
-	glNamedBufferStorage(vbo, totalBufSize, NULL, GL_DYNAMIC_STORAGE_BIT); // allocate enough size buffer
-	// initialize buffer
-
-	glNamedBufferSubData(vbo, 0, pBufSize, meshPtr->GetData(Mesh::MeshDataType::POS)); // initialize posistion data
-	glNamedBufferSubData(vbo, pBufSize, nBufSize, meshPtr->GetData(Mesh::MeshDataType::NORMAL)); // initialize normal data
-
-	if (uvBufSize > 0)
-		glNamedBufferSubData(vbo, pBufSize + nBufSize, uvBufSize, materialPtr->GetUVData()); // initialize albedo data
-
-	// (2) initialize how to read these two buffers
-	// initialize vertex array
-	size_t vaoIndex = CreateVertexArray();
-	meshPtr->SetVaoIndex(vaoIndex);
-	glBindVertexArray(vaos[vaoIndex]); // enable this VertexArray
-	// Here, data-binding must call before setting up VertexAttributeArray/Pointer
-	glBindBuffer(GL_ARRAY_BUFFER, vbo); // for vertex data. 
-	/*
-	* The below glVertexAttribPointer() setting is actually related to the current active Vertex/Frag shader. The first parameter is related to 'location' in shader.
-	*/
-	GLint componentType = meshPtr->GetDataComponentType(Mesh::MeshDataType::POS);
-	GLint componentNum = meshPtr->GetDataComponentNum(Mesh::MeshDataType::POS);
-	// because pos,normal,albedo are using the same data-type, therefore they share the same componentType and componentNum
-	glVertexAttribPointer(0, 3, componentType, GL_FALSE, componentNum * sizeof(componentType), 0); // second parameter range is vec1,vec2,vec3,vec4, depending which data you are using.
-	glVertexAttribPointer(1, 3, componentType, GL_FALSE, componentNum * sizeof(componentType), (const void*)pBufSize); // last parameter is offset, it's related to above buffer setting
-	if (uvBufSize > 0)
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(GL_FLOAT), (const void*)(pBufSize + nBufSize));
-
-	glEnableVertexAttribArray(0); // location=0 in shader, you can EnableVertexAttribArray first then set its VeretxArrayPointer. The order doesn't matter.
-	glEnableVertexAttribArray(1); // location=1 in shader
+		uvBufSize = std::min(materialPtr->GetUVDataSize(), vertexNum * sizeof(glm::vec2));
 	if (uvBufSize > 0)
-		glEnableVertexAttribArray(2); // location=2 in shader
-
-	// Don't forget to bind indices!
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo); // for vertex-index. Index can be called at the end. Because we don't need VertexAttribArray/Pointer to get these data
-
-	glBindVertexArray(0); // After setting up, bind 0 to avoid modification of vao. If we want to use it, bind vao again.
+		glNamedBufferSubData(uvBuffer, baseVertex * sizeof(glm::vec2), uvBufSize, materialPtr->GetUVData()); // initialize uv data
+	else
+		glClearNamedBufferSubData(uvBuffer, GL_R32F, baseVertex * sizeof(glm::vec2), vertexNum * sizeof(glm::vec2), GL_RED, GL_FLOAT, NULL); // vertex pulling always reads uv, make it zero like a disabled attribute
+	if (CheckGLError()) { Print("Error in Rasterizer::InitGPUData."); return; }
 }
 
 void Rasterizer::DeleteGPUData(const shared_ptr<SceneObject>& _sceneObj)
 {
-	vector<size_t> buffersIndices; // Indices which point to the buffers
-	vector<size_t> vaoIndices; // Indices which point to the vao
 	shared_ptr<Mesh> meshPtr = _sceneObj->GetMesh();
-	buffersIndices.push_back(meshPtr->GetIboIndex());
-	buffersIndices.push_back(meshPtr->GetVboIndex());
-	vaoIndices.push_back(meshPtr->GetVaoIndex());
-	DeleteBuffers(buffersIndices);
-	DeleteVertexArray(vaoIndices);
+	ReleasePoolRange(freeVertexRanges, vertexUsed, meshPtr->GetBaseVertex(), meshPtr->GetElementCount(Mesh::MeshDataType::POS));
+	ReleasePoolRange(freeIndexRanges, indexUsed, meshPtr->GetFirstIndex(), meshPtr->GetElementCount(Mesh::MeshDataType::INDEX) * 3);
 }
 
-void Rasterizer::Draw(const shared_ptr<SceneObject>& _sceneObj)
+void Rasterizer::Draw(const shared_ptr<SceneObject>& _sceneObj, const int& _objIndex, const int& _instanceNum)
 {
+	// the same vertex array for all meshes, base vertex makes index 0 refer to this mesh's first vertex in pool buffers(or gl_VertexID index into its range for vertex pulling)
+	// one instance with base instance "_objIndex", then instanced attribute objectID is "_objIndex" like indirect draws of GPUCulling
 	auto meshPtr = _sceneObj->GetMesh();
-	GLuint vao = vaos[meshPtr->GetVaoIndex()];
-	glBindVertexArray(vao);
+	glBindVertexArray(GetDrawVertexArray());
 	GLsizei triangleCount = meshPtr->GetElementCount(Mesh::MeshDataType::INDEX);
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(triangleCount * 3), GL_UNSIGNED_INT, 0);
+	glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(triangleCount * 3), GL_UNSIGNED_INT, (const void*)(meshPtr->GetFirstIndex() * sizeof(GLuint)),
+		static_cast<GLsizei>(_instanceNum), static_cast<GLint>(meshPtr->GetBaseVertex()), static_cast<GLuint>(_objIndex));
 	glBindVertexArray(0);
 }
 
@@ -247,8 +535,84 @@ void Rasterizer::InitRenderFuncMap()
 	renderFuncMap["RenderSimple"] = RasterizerRender::RenderSimple;
 	renderFuncMap["RenderPhong"] = RasterizerRender::RenderPhong;
 	renderFuncMap["RenderSceenQuad"] = RasterizerRender::RenderSceenQuad;
+	renderFuncMap["RenderSoftware"] = RasterizerRender::RenderSoftware;
+	renderFuncMap["RenderRayTracing"] = RayTracerRender::RenderRayTracing;
 
 	// below is for fun
 	renderFuncMap["RenderSonarLight"] = RasterizerRender::RenderSonarLight;
+
+	// keep update here if any render function reads shadow maps(see BasicShadowMapRender::InitComputeLightRatioParameters)
+	shadowReaderFuncs.insert("RenderPhong");
+	ssaoReaderFuncs.insert("RenderPhong");
+}
+
+GLuint Rasterizer::GetPoolVertexArray() const { return poolVAO; }
+GLuint Rasterizer::GetPullingVertexArray() const { return pullingVAO; }
+GLuint Rasterizer::GetDrawVertexArray() const { return useVertexPulling ? pullingVAO : poolVAO; }
+
+bool Rasterizer::IsUseVertexPulling() const { return useVertexPulling; }
+void Rasterizer::SetUseVertexPulling(const bool& _value) { useVertexPulling = _value; }
+string Rasterizer::GetVertexVariant() const { return useVertexPulling ? "Pulling" : ""; }
+
+shared_ptr<GPUCulling> Rasterizer::GetGPUCulling() const { return gpuCulling; }
+bool Rasterizer::IsUseGPUCulling() const { return useGPUCulling; }
+void Rasterizer::SetUseGPUCulling(const bool& _value) { useGPUCulling = _value; }
+
+shared_ptr<FullscreenPass> Rasterizer::GetFullscreenPass() const { return fullscreenPass; }
+shared_ptr<FrameGraph> Rasterizer::GetFrameGraph() const { return frameGraph; }
+shared_ptr<AntiAliasing> Rasterizer::GetAntiAliasing() const { return antiAliasing; }
+shared_ptr<TextureArrayManager> Rasterizer::GetTextureArrayManager() const { return textureArrayMgr; }
+shared_ptr<TextureStreamer> Rasterizer::GetTextureStreamer() const { return textureStreamer; }
+shared_ptr<SSAO> Rasterizer::GetSSAO() const { return ssao; }
+shared_ptr<SoftwareRasterizer> Rasterizer::GetSoftwareRasterizer() const { return softwareRasterizer; }
+shared_ptr<RayTracer> Rasterizer::GetRayTracer() const { return rayTracer; }
+GLuint Rasterizer::GetSceneFrameBuffer() const { return antiAliasing->GetSceneFrameBuffer(); }
+
+float Rasterizer::GetRenderScale() const { return renderScale; }
+void Rasterizer::SetRenderScale(const float& _scale)
+{
+	renderScale = glm::clamp(_scale, 0.25f, 2.0f);
+	int width = std::max(1, static_cast<int>(GLOBAL.WIN_WIDTH * renderScale + 0.5f));
+	int height = std::max(1, static_cast<int>(GLOBAL.WIN_HEIGHT * renderScale + 0.5f));
+	if (width == GLOBAL.RENDER_WIDTH && height == GLOBAL.RENDER_HEIGHT)
+		return;
+	GLOBAL.RENDER_WIDTH = width;
+	GLOBAL.RENDER_HEIGHT = height;
+	GLOBAL.shadowMgr->OnRenderResolutionChanged(); // scene targets are recreated in AntiAliasing::BeginFrame()
 }
 
+glm::ivec4 Rasterizer::GetViewRect(const int& _viewIndex) const
+{
+	// grid of views from top-left to bottom-right, e.g. 2 views are side by side, 3 or 4 views are 2x2
+	int viewNum = GLOBAL.camCtrller->GetViewNum();
+	int cols = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(viewNum))));
+	int rows = (viewNum + cols - 1) / cols;
+	int width = GLOBAL.RENDER_WIDTH / cols;
+	int height = GLOBAL.RENDER_HEIGHT / rows;
+	int col = _viewIndex % cols;
+	int row = _viewIndex / cols;
+	return glm::ivec4(col * width, GLOBAL.RENDER_HEIGHT - (row + 1) * height, width, height);
+}
+
+void Rasterizer::ApplyViewViewport()
+{
+	if (GLOBAL.camCtrller->GetViewNum() == 1)
+	{
+		glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT);
+		return;
+	}
+	glm::ivec4 rect = GetViewRect(GLOBAL.camCtrller->GetCurrentView());
+	glViewport(rect.x, rect.y, rect.z, rect.w);
+	glScissor(rect.x, rect.y, rect.z, rect.w);
+	glEnable(GL_SCISSOR_TEST);
+}
+
+void Rasterizer::UpdateViewAspects()
+{
+	for (int viewIndex = 0; viewIndex < GLOBAL.camCtrller->GetViewNum(); viewIndex++)
+	{
+		glm::ivec4 rect = GetViewRect(viewIndex);
+		if (rect.z > 0 && rect.w > 0)
+			GLOBAL.camCtrller->GetView(viewIndex)->SetCameraParameter(CameraIndex::ASPECT, static_cast<float>(rect.z) / static_cast<float>(rect.w));
+	}
+}
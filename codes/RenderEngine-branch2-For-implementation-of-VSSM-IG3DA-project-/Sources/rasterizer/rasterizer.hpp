@@ -12,6 +12,16 @@
 #include <map>
 #include <string>
 #include <functional>
+#include "gpuCulling.hpp"
+#include "antiAliasing.hpp"
+#include "fullscreenPass.hpp"
+#include "frameGraph.hpp"
+#include "textureArrayManager.hpp"
+#include "textureStreamer.hpp"
+#include "ssao.hpp"
+#include "softwareRasterizer.hpp"
+#include "../raytracer/rayTracer.hpp"
+#include <set>
 
 namespace IceRender
 {
@@ -23,6 +33,60 @@ namespace IceRender
 		vector<GLuint> vaos; // store all bufferID, '0' means invalid ID, non-zero means valid ID(also works for OpenGL buffer ID)
 		vector<GLuint> buffers; // store all bufferID, '0' means invalid ID, non-zero means valid ID(same for OpenGL vaoID)
 		map<string, function<void()>> renderFuncMap;
+		set<string> shadowReaderFuncs; // render functions which read shadow maps, shadow passes are culled for the others
+		set<string> ssaoReaderFuncs; // render functions which read ambient occlusion, SSAO passes are culled for the others
+
+		/*geometry pool*/
+		// [Note] all meshes are stored inside the same buffers, each mesh only records its range(Mesh::GetBaseVertex/GetFirstIndex).
+		// In this way, a single vertex array(poolVAO) can read all meshes, which is required by multi-draw indirect(see GPUCulling).
+		GLuint posBuffer, normalBuffer, uvBuffer, indexBuffer;
+		GLuint poolVAO;
+		GLuint pullingVAO; // vertex pulling: only index buffer(and objectID for indirect draws), vertex attributes are fetched from pool buffers in vertex shader
+		bool useVertexPulling;
+		size_t vertexCapacity, vertexUsed; // in number of vertices
+		size_t indexCapacity, indexUsed; // in number of indices
+		vector<glm::vec<2, size_t>> freeVertexRanges, freeIndexRanges; // released ranges, x is offset, y is count. Reused by first-fit.
+
+		/*GPU culling*/
+		shared_ptr<GPUCulling> gpuCulling;
+		bool useGPUCulling;
+
+		/*full screen passes*/
+		shared_ptr<FullscreenPass> fullscreenPass;
+
+		/*frame graph*/
+		// [Note] it is rebuilt each frame in Render(), but its transient textures are pooled across frames
+		shared_ptr<FrameGraph> frameGraph;
+
+		/*anti-aliasing*/
+		shared_ptr<AntiAliasing> antiAliasing;
+
+		/*albedo textures packed into texture arrays, read by per-draw material index(see GPUMaterialData)*/
+		shared_ptr<TextureArrayManager> textureArrayMgr;
+
+		/*textures decoded by worker threads and uploaded within a budget per frame*/
+		shared_ptr<TextureStreamer> textureStreamer;
+
+		/*screen-space ambient occlusion, passes are added before scene pass*/
+		shared_ptr<SSAO> ssao;
+
+		/*CPU rasterizer used by render method "RenderSoftware"*/
+		shared_ptr<SoftwareRasterizer> softwareRasterizer;
+
+		/*CPU ray tracer used by render method "RenderRayTracing"*/
+		shared_ptr<RayTracer> rayTracer;
+
+		float renderScale; // internal render resolution = window size * renderScale, in range [0.25, 2.0]
+
+		/*multi-view*/
+		// [Note] shadow passes are added once per frame and shared by all camera views, each view only has its own culling and scene draw.
+		// Views are laid out as a grid of viewports inside the scene target(OVR_multiview is not available in our OpenGL 4.5 glad).
+		void UpdateViewAspects(); // keep aspect of each view camera the same as its viewport
+
+		/*camera depth pre-pass*/
+		// depth of all camera views into "_depthTex"(render resolution, views at their view rects), read by SSAO and SDSM.
+		// [Note] it is jittered by TAA like the scene pass(see AntiAliasing::BeginFrame), so SSAO and SDSM read the same samples as the scene.
+		void RenderCameraDepth(const GLuint& _depthTex);
 
 		size_t CreateBuffer(); // Call CreateBuffers() to create one buffer for each model, in order to store positions, normals, materials(which is related to albedo), or uv
 		size_t CreateVertexArray();
@@ -32,6 +96,14 @@ namespace IceRender
 
 		void InitRenderFuncMap();
 
+		void InitGeometryPool();
+		void ClearGeometryPool();
+		size_t AllocatePoolRange(vector<glm::vec<2, size_t>>& _freeRanges, size_t& _used, const size_t& _count); // return the offset of the allocated range
+		void ReleasePoolRange(vector<glm::vec<2, size_t>>& _freeRanges, size_t& _used, const size_t& _offset, const size_t& _count);
+		void ReservePoolBuffer(const GLuint& _buffer, const size_t& _oldCapacity, const size_t& _newCapacity, const size_t& _elementSize); // grow buffer and keep its content
+		void InitVertexArrayFormat(const GLuint& _vao, const bool& _useUV); // attribute location 0/1/2 for pos/normal/uv
+		void BindPoolStorageBuffers(); // binding point 4/5/6 for pos/normal/uv, used by vertex pulling shaders("xxxPulling.vs")
+
 	public:
 		Rasterizer();
 		~Rasterizer();
@@ -44,7 +116,9 @@ namespace IceRender
 		// TODO: to see reduce draw calls, for now we just set 2 buffers & 1 VeterxArray for each Mesh (because VAO could not read two different buffers at the same time)
 		void Render();
 
-		void Draw(const shared_ptr<SceneObject>& _sceneObj);
+		// "_objIndex" becomes objectID(location=3) of this draw, shaders reading per-draw buffers(see GPUCulling::BindDrawDataBuffers) need it
+		// "_instanceNum" > 1 is for shaders using gl_InstanceID(e.g. layered shadow pass), objectID is only valid for the first instance then.
+		void Draw(const shared_ptr<SceneObject>& _sceneObj, const int& _objIndex = 0, const int& _instanceNum = 1);
 
 		void Clear();
 
@@ -54,5 +128,33 @@ namespace IceRender
 		// Response to dynamically add/remove mesh
 		void InitGPUData(shared_ptr<SceneObject>& _sceneObj); // when scene add meshes, create buffers&vao for them
 		void DeleteGPUData(const shared_ptr<SceneObject>& _sceneObj); // when scene remove meshes, delete buffers&vao for them
+
+		GLuint GetPoolVertexArray() const;
+		GLuint GetPullingVertexArray() const;
+		GLuint GetDrawVertexArray() const; // vertex array used by pool draws(Draw() and GPUCulling), depends on vertex pulling
+
+		bool IsUseVertexPulling() const;
+		void SetUseVertexPulling(const bool& _value);
+		string GetVertexVariant() const; // vertex shader variant for ShaderManager::TryActivateShaderProgram(), "Pulling" or empty
+
+		shared_ptr<GPUCulling> GetGPUCulling() const;
+		bool IsUseGPUCulling() const;
+		void SetUseGPUCulling(const bool& _value);
+
+		shared_ptr<FullscreenPass> GetFullscreenPass() const;
+		shared_ptr<FrameGraph> GetFrameGraph() const;
+		shared_ptr<AntiAliasing> GetAntiAliasing() const;
+		shared_ptr<TextureArrayManager> GetTextureArrayManager() const;
+		shared_ptr<TextureStreamer> GetTextureStreamer() const;
+		shared_ptr<SSAO> GetSSAO() const;
+		shared_ptr<SoftwareRasterizer> GetSoftwareRasterizer() const;
+		shared_ptr<RayTracer> GetRayTracer() const;
+		GLuint GetSceneFrameBuffer() const; // render methods draw scene into it(not always the default framebuffer, depends on anti-aliasing mode)
+
+		float GetRenderScale() const;
+		void SetRenderScale(const float& _scale); // update GLOBAL.RENDER_WIDTH/HEIGHT, and shadow maps which follow it
+
+		glm::ivec4 GetViewRect(const int& _viewIndex) const; // viewport(x, y, width, height) of camera view "_viewIndex" inside scene target
+		void ApplyViewViewport(); // set viewport to current view, also scissor when there are multiple views(so that glClear only affects the current view)
 	};
 }
\ No newline at end of file
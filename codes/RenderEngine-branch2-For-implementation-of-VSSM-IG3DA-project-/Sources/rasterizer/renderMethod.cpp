@@ -2,12 +2,47 @@
 #include "../globals.hpp"
 #include "../light/pointLight.hpp"
 #include "../light/directLight.hpp"
-#include "../material/phongMaterial.hpp"
 #include "../helpers/utility.hpp"
 
 
 using namespace IceRender;
 
+namespace
+{
+	// draw result of CPU renderers into current view, it is already shaded
+	void DrawCPUResult(const GLuint& _texID)
+	{
+		if (_texID == 0)
+			return;
+		auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
+		shared_ptr<ShaderProgram> shaderPro = fullscreenPass->Begin(GLOBAL.shaderPathPrefix + "ScreenQuad/screenQuad", GLOBAL.render->GetSceneFrameBuffer(), GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT);
+		GLOBAL.render->ApplyViewViewport(); // draw into current view only
+		glClear(GL_DEPTH_BUFFER_BIT);
+		shaderPro->Set("useAlbedoTex", 1);
+		GLuint texUnit = 0;
+		glBindTextureUnit(texUnit, _texID);
+		shaderPro->Set("albedoTex", static_cast<int>(texUnit));
+		fullscreenPass->Draw();
+		GLOBAL.render->ApplyViewViewport(); // set it back to normal
+		if (CheckGLError()) { Print("Error in DrawCPUResult."); return; }
+	}
+
+	// draw scene objects of current view, the active shader reads model matrix and material from per-draw buffers(see GPUCulling) by objectID
+	void DrawSceneObjects()
+	{
+		auto gpuCulling = GLOBAL.render->GetGPUCulling();
+		gpuCulling->BindDrawDataBuffers();
+		if (GLOBAL.render->IsUseGPUCulling())
+			gpuCulling->DrawVisible(GLOBAL.camCtrller->GetCurrentView()); // camera views come first in GPUCulling
+		else
+		{
+			auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
+			for (int objIndex = 0; objIndex < gpuCulling->GetObjectNum() && objIndex < static_cast<int>(sceneObjs.size()); objIndex++) // objects added after uploading are skipped in this frame
+				GLOBAL.render->Draw(sceneObjs[objIndex], objIndex);
+		}
+	}
+}
+
 void RasterizerRender::NoRender() {/*do nothing*/ };
 
 void RasterizerRender::RenderSimple()
@@ -17,41 +52,20 @@ void RasterizerRender::RenderSimple()
 	glm::mat4 viewMat = GLOBAL.camCtrller->GetActiveCamera()->GetViewMatrix();
 	glm::mat4 projectMat = GLOBAL.camCtrller->GetActiveCamera()->GetProjectionMatrix();
 	// try to get "Simple/simple" shader pro, if not exist, create/activate it and return it
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "Simple/simple");
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "Simple/simple", GLOBAL.render->GetVertexVariant());
 	shaderPro->Set("viewMat", viewMat);
 	shaderPro->Set("projectMat", projectMat);
-	auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
-	for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
-	{
-		auto sceneObj = *iter;
-		glm::mat4 modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
-		shaderPro->Set("modelMat", modelMat);
 
-		auto material = sceneObj->GetMaterial();
-		if (material && material->GetUVDataSize() > 0 && material->GetAlbedo() != 0)
-		{
-			// OpenGL 4.5 way to use texture:
-			GLuint texUnit = 0;
-			glBindTextureUnit(texUnit, material->GetAlbedo()); // this function to bind texture object to sampler2D variable with "binding=0"
-			//glActiveTexture(GL_TEXTURE0 + texUnit); // no need actually for now
-			shaderPro->Set("useAlbedoTex", 1);
-		}
-		else if(material)
-		{
-			shaderPro->Set("useAlbedoTex", 0);
-			shaderPro->Set("albedoColor", material->GetColor());
-		}
-		else
-			shaderPro->Set("useAlbedoTex", 0);
-
-		GLOBAL.render->Draw(sceneObj);
-	}
+	// model matrix and material of each object are read from per-draw buffers by objectID, same as RenderPhong
+	GLuint texUnit = 0;
+	GLOBAL.render->GetTextureArrayManager()->BindArrays(shaderPro, "albedoArrays", texUnit);
+	DrawSceneObjects();
 }
 
 void RasterizerRender::RenderPhong()
 {
-	glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLOBAL.render->ApplyViewViewport(); // set it back to normal(shadow passes change it)
+	glBindFramebuffer(GL_FRAMEBUFFER, GLOBAL.render->GetSceneFrameBuffer());
 	glClearColor(0.67f, 0.84f, 0.90f, 1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
 
@@ -59,7 +73,7 @@ void RasterizerRender::RenderPhong()
 
 	glm::mat4 viewMat = GLOBAL.camCtrller->GetActiveCamera()->GetViewMatrix();
 	glm::mat4 projectMat = GLOBAL.camCtrller->GetActiveCamera()->GetProjectionMatrix();
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "Phong/phong");
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "Phong/phong", GLOBAL.render->GetVertexVariant());
 	shaderPro->Set("viewMat", viewMat);
 	shaderPro->Set("projectMat", projectMat);
 
@@ -100,43 +114,22 @@ void RasterizerRender::RenderPhong()
 	// [Be careful] must pass texUnit into this function in order to bind the correct texture location in shader.
 	basicShadowMapRender->InitComputeLightRatioParameters(shaderPro, texUnit);
 
-	// TODO: I need to experience then I can optimize the draw call to handle multiple same object rendering(use instance), and static scene environemnt rendering?
-	auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
-	for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
-	{
-		auto sceneObj = *iter;
-		glm::mat4 modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
-		shaderPro->Set("modelMat", modelMat);
-		// pass material information to shader
-		auto material = static_pointer_cast<PhongMaterial>(sceneObj->GetMaterial());
-		shaderPro->Set("material.ka", material->GetAmbientCoef());
-		shaderPro->Set("material.kd", material->GetDiffuseCoef());
-		shaderPro->Set("material.ks", material->GetSpecularCoef());
-		shaderPro->Set("material.shiness", material->GetShiness());
-		if (material && material->GetUVDataSize() > 0 && material->GetAlbedo() != 0)
-		{
-			// OpenGL 4.5 way to use texture:
-			// refer: https://www.khronos.org/opengl/wiki/Example_Code
-			// TODO: but not sure whether I am doing right or not. Finish reading OpenGL book later then back to here.
-			shaderPro->Set("albedoTex", static_cast<int>(texUnit));
-			glBindTextureUnit(texUnit++, material->GetAlbedo()); // this function to bind texture object to sampler2D variable with "binding=texUnit"
-			shaderPro->Set("useAlbedoTex", 1);
-		}
-		else
-		{
-			shaderPro->Set("useAlbedoTex", 0);
-			shaderPro->Set("material.color", material->GetColor());
-		}
-		GLOBAL.render->Draw(sceneObj);
-	}
+	// ambient occlusion of current frame(computed before this pass), ambient term is not affected if SSAO is disabled
+	GLOBAL.render->GetSSAO()->BindAO(shaderPro, texUnit);
+
+	// model matrix and material of each object are read from per-draw buffers by objectID(uploaded by GPUCulling::UploadObjects), albedo textures are layers of texture arrays.
+	// Nothing changes between objects, then all visible objects are drawn by one multi-draw call.
+	GLOBAL.render->GetTextureArrayManager()->BindArrays(shaderPro, "albedoArrays", texUnit);
+	DrawSceneObjects();
 }
 
 void RasterizerRender::RenderSceenQuad()
 {
 	glClearColor(0.0f, 0.0f, 0.0f, 1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "ScreenQuad/screenQuad");
+	auto fullscreenPass = GLOBAL.render->GetFullscreenPass();
+	shared_ptr<ShaderProgram> shaderPro = fullscreenPass->Begin(GLOBAL.shaderPathPrefix + "ScreenQuad/screenQuad", GLOBAL.render->GetSceneFrameBuffer(), GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT);
+	GLOBAL.render->ApplyViewViewport(); // draw into current view only
 	auto screenQuadObj = GLOBAL.sceneMgr->GetSceneObj("screen_quad");
 	auto material = screenQuadObj->GetMaterial();
 	GLuint texID = material->GetAlbedo();
@@ -158,13 +151,19 @@ void RasterizerRender::RenderSceenQuad()
 		shaderPro->Set("useAlbedoTex", 0);
 		shaderPro->Set("albedoColor", material->GetColor());
 	}
-	GLOBAL.render->Draw(screenQuadObj);
-	glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
+	fullscreenPass->Draw(); // "screen_quad" object only holds the texture, it is drawn as a full screen triangle
+	GLOBAL.render->ApplyViewViewport(); // set it back to normal
+}
+
+void RasterizerRender::RenderSoftware()
+{
+	glm::ivec4 viewRect = GLOBAL.render->GetViewRect(GLOBAL.camCtrller->GetCurrentView());
+	DrawCPUResult(GLOBAL.render->GetSoftwareRasterizer()->Render(viewRect.z, viewRect.w));
 }
 
 void RasterizerRender::RenderSonarLight()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, GLOBAL.render->GetSceneFrameBuffer());
 	//glClearColor(0.67f, 0.84f, 0.90f, 1.f);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
@@ -173,7 +172,7 @@ void RasterizerRender::RenderSonarLight()
 
 	glm::mat4 viewMat = GLOBAL.camCtrller->GetActiveCamera()->GetViewMatrix();
 	glm::mat4 projectMat = GLOBAL.camCtrller->GetActiveCamera()->GetProjectionMatrix();
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "SonarLight/sonarLight");
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "SonarLight/sonarLight", GLOBAL.render->GetVertexVariant());
 	shaderPro->Set("viewMat", viewMat);
 	shaderPro->Set("projectMat", projectMat);
 
@@ -241,33 +240,13 @@ void RasterizerRender::RenderSonarLight()
 		}
 	}
 
-	// TODO: I need to experience then I can optimize the draw call to handle multiple same object rendering(use instance), and static scene environemnt rendering?
-	auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
-	for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
-	{
-		auto sceneObj = *iter;
-		glm::mat4 modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
-		shaderPro->Set("modelMat", modelMat);
-		// pass material information to shader
-		auto material = static_pointer_cast<PhongMaterial>(sceneObj->GetMaterial());
-		shaderPro->Set("material.ka", material->GetAmbientCoef());
-		shaderPro->Set("material.kd", material->GetDiffuseCoef());
-		shaderPro->Set("material.ks", material->GetSpecularCoef());
-		shaderPro->Set("material.shiness", material->GetShiness());
-		if (material && material->GetUVDataSize() > 0 && material->GetAlbedo() != 0)
-		{
-			// OpenGL 4.5 way to use texture:
-			// refer: https://www.khronos.org/opengl/wiki/Example_Code
-			// TODO: but not sure whether I am doing right or not. Finish reading OpenGL book later then back to here.
-			shaderPro->Set("albedoTex", static_cast<int>(texUnit));
-			glBindTextureUnit(texUnit++, material->GetAlbedo()); // this function to bind texture object to sampler2D variable with "binding=texUnit"
-			shaderPro->Set("useAlbedoTex", 1);
-		}
-		else
-		{
-			shaderPro->Set("useAlbedoTex", 0);
-			shaderPro->Set("material.color", material->GetColor());
-		}
-		GLOBAL.render->Draw(sceneObj);
-	}
+	// model matrix and material of each object are read from per-draw buffers by objectID, same as RenderPhong
+	GLOBAL.render->GetTextureArrayManager()->BindArrays(shaderPro, "albedoArrays", texUnit);
+	DrawSceneObjects();
+}
+
+void RayTracerRender::RenderRayTracing()
+{
+	glm::ivec4 viewRect = GLOBAL.render->GetViewRect(GLOBAL.camCtrller->GetCurrentView());
+	DrawCPUResult(GLOBAL.render->GetRayTracer()->Render(viewRect.z, viewRect.w));
 }
@@ -13,6 +13,7 @@ namespace IceRender
 		void RenderSimple();
 		void RenderPhong();
 		void RenderSceenQuad();
+		void RenderSoftware(); // CPU rasterizer(see SoftwareRasterizer)
 
 #pragma region Rendering techinique for fun
 		void RenderSonarLight(); // just for fun
@@ -22,6 +23,6 @@ namespace IceRender
 
 	namespace RayTracerRender
 	{
-		// TODO:
+		void RenderRayTracing(); // CPU ray tracer(see RayTracer)
 	}
 }
@@ -0,0 +1,650 @@
+#include "softwareRasterizer.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include "../light/pointLight.hpp"
+#include "../light/directLight.hpp"
+#include "../material/phongMaterial.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define ICE_SOFTWARE_SSE 1
+#else
+#define ICE_SOFTWARE_SSE 0
+#endif
+
+using namespace IceRender;
+using namespace std;
+
+namespace
+{
+	const int setupJobSize = 4096; // vertices or triangles per setup job
+	const int binChunkSize = 4096; // triangles per binning task
+	const glm::vec3 clearColor(0.67f, 0.84f, 0.90f); // same as RenderPhong
+}
+
+#pragma region Target
+void SoftwareRasterizer::Target::Resize(const int& _width, const int& _height, const bool& _storeVisibility)
+{
+	width = _width;
+	height = _height;
+	storeVisibility = _storeVisibility;
+	size_t pixelNum = static_cast<size_t>(_width) * _height;
+	depth.resize(pixelNum);
+	triangleIDs.resize(_storeVisibility ? pixelNum : 0);
+	barycentrics.resize(_storeVisibility ? pixelNum : 0);
+}
+
+int SoftwareRasterizer::Target::GetTileNumX() const { return (width + tileSize - 1) / tileSize; }
+int SoftwareRasterizer::Target::GetTileNumY() const { return (height + tileSize - 1) / tileSize; }
+#pragma endregion
+
+SoftwareRasterizer::SoftwareRasterizer() : threadNum(0), poolStarted(false), ambientLight(0), shadowBias(0), pcfHalfKernelSize(-1),
+	outputTex(0), outputWidth(0), outputHeight(0) {}
+
+SoftwareRasterizer::~SoftwareRasterizer() { Clear(); }
+
+void SoftwareRasterizer::Clear()
+{
+	pool.Stop();
+	poolStarted = false;
+	if (outputTex != 0 && glIsTexture(outputTex))
+		glDeleteTextures(1, &outputTex);
+	outputTex = 0;
+	outputWidth = outputHeight = 0;
+	textureCache.Clear();
+	objects.clear();
+	objectVertices.clear();
+	jobTriangles.clear();
+	triangles.clear();
+	bins.clear();
+	shadowMaps.clear();
+}
+
+int SoftwareRasterizer::GetThreadNum() const { return poolStarted ? pool.GetThreadNum() : 0; }
+
+void SoftwareRasterizer::SetThreadNum(const int& _threadNum)
+{
+	threadNum = _threadNum;
+	if (poolStarted)
+		pool.Start(threadNum); // restart with new number
+}
+
+GLuint SoftwareRasterizer::Render(const int& _width, const int& _height)
+{
+	const auto& pixels = RenderImage(_width, _height);
+	if (pixels.empty())
+		return 0;
+
+	// upload result
+	if (outputWidth != _width || outputHeight != _height)
+	{
+		if (glIsTexture(outputTex))
+		{
+			GLOBAL.render->GetFullscreenPass()->ReleaseTexture(outputTex);
+			glDeleteTextures(1, &outputTex);
+		}
+		glCreateTextures(GL_TEXTURE_2D, 1, &outputTex);
+		glTextureStorage2D(outputTex, 1, GL_RGBA8, _width, _height);
+		glTextureParameteri(outputTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(outputTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(outputTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(outputTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		outputWidth = _width;
+		outputHeight = _height;
+	}
+	glTextureSubImage2D(outputTex, 0, 0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	if (CheckGLError()) { Print("Error in SoftwareRasterizer::Render."); return 0; }
+	return outputTex;
+}
+
+const std::vector<unsigned char>& SoftwareRasterizer::RenderImage(const int& _width, const int& _height)
+{
+	colorBuffer.clear();
+	if (_width <= 0 || _height <= 0)
+		return colorBuffer;
+	if (!poolStarted)
+	{
+		pool.Start(threadNum);
+		poolStarted = true;
+	}
+
+	auto camera = GLOBAL.camCtrller->GetActiveCamera();
+	glm::mat4 viewMat = camera->GetViewMatrix();
+	glm::mat4 projectMat = camera->GetProjectionMatrix();
+
+	PrepareObjects();
+	PrepareLights(viewMat);
+
+	target.Resize(_width, _height, true);
+	Rasterize(projectMat * viewMat, target);
+
+	colorBuffer.resize(static_cast<size_t>(_width) * _height * 4);
+	pool.ParallelFor(target.GetTileNumX() * target.GetTileNumY(), [&](const int& _tileIndex) { ShadeTile(_tileIndex, viewMat); });
+	return colorBuffer;
+}
+
+#pragma region scene data
+void SoftwareRasterizer::PrepareObjects()
+{
+	objects.clear();
+	auto textureStreamer = GLOBAL.headless ? nullptr : GLOBAL.render->GetTextureStreamer();
+	auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
+	for (auto& sceneObj : sceneObjs)
+	{
+		auto mesh = sceneObj->GetMesh();
+		auto material = sceneObj->GetMaterial();
+		if (mesh == nullptr || mesh->GetElementCount(Mesh::MeshDataType::INDEX) == 0)
+			continue;
+
+		Object obj;
+		obj.mesh = mesh;
+		obj.modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
+		obj.normalMat = glm::transpose(glm::inverse(glm::mat3(obj.modelMat)));
+		obj.uv = nullptr;
+		obj.isPhong = false;
+		obj.color = material ? material->GetColor() : Utility::oneV3;
+		obj.ka = obj.kd = obj.ks = glm::vec3(0);
+		obj.shiness = 1;
+		obj.albedo = nullptr;
+		if (material)
+		{
+			auto phongMat = dynamic_pointer_cast<PhongMaterial>(material);
+			if (phongMat != nullptr)
+			{
+				obj.isPhong = true;
+				obj.ka = phongMat->GetAmbientCoef();
+				obj.kd = phongMat->GetDiffuseCoef();
+				obj.ks = phongMat->GetSpecularCoef();
+				obj.shiness = phongMat->GetShiness();
+			}
+			size_t uvNum = material->GetUVDataSize() / sizeof(glm::vec2);
+			if (uvNum >= mesh->GetElementCount(Mesh::MeshDataType::POS))
+			{
+				obj.uv = static_cast<const glm::vec2*>(material->GetUVData());
+				// streamed textures are used after they are fully uploaded, without OpenGL context the image file is decoded directly
+				if (textureStreamer == nullptr)
+					obj.albedo = material->GetAlbedoPath().empty() ? nullptr : textureCache.Get(material->GetAlbedoPath());
+				else if (material->GetAlbedo() != 0 && !textureStreamer->IsPending(material->GetAlbedo()))
+					obj.albedo = textureCache.Get(material->GetAlbedo());
+			}
+		}
+		objects.push_back(obj);
+	}
+}
+
+void SoftwareRasterizer::PrepareLights(const glm::mat4& _viewMat)
+{
+	ambientLight = GLOBAL.sceneMgr->GetAmbient();
+	lights.clear();
+
+	// only "ShadowMap"(hard shadow or PCF) is ported
+	shared_ptr<ShadowMapRender> shadowMapRender;
+	if (GLOBAL.shadowMgr->IsNeedShadowRender())
+		shadowMapRender = dynamic_pointer_cast<ShadowMapRender>(GLOBAL.shadowMgr->GetShadowRender());
+	int shadowMapNum = 0;
+	if (shadowMapRender != nullptr)
+	{
+		shadowBias = shadowMapRender->GetBias();
+		int kernelSize = shadowMapRender->GetPCFKernelSize();
+		pcfHalfKernelSize = kernelSize > 0 ? kernelSize / 2 : -1;
+	}
+
+	auto sceneLights = GLOBAL.sceneMgr->GetAllLight();
+	for (auto& sceneLight : sceneLights)
+	{
+		Light light;
+		light.type = static_cast<int>(sceneLight->GetType());
+		light.color = sceneLight->GetColor();
+		light.intensity = sceneLight->GetIntensity();
+		light.attenuation = glm::vec2(0);
+		light.eyePos = glm::vec3(_viewMat * glm::vec4(sceneLight->GetTransform()->GetPosition(), 1));
+		light.eyeDir = glm::vec3(0);
+		light.shadowMapIndex = -1;
+		if (sceneLight->GetType() == LightType::POINT)
+			light.attenuation = static_pointer_cast<PointLight>(sceneLight)->GetAttenuation();
+		else if (sceneLight->GetType() == LightType::DIRECT)
+			light.eyeDir = glm::normalize(glm::vec3(_viewMat * glm::vec4(-static_pointer_cast<DirectLight>(sceneLight)->GetDirection(), 0)));
+
+		if (shadowMapRender != nullptr && sceneLight->IsRenderShadow())
+		{
+			if (static_cast<int>(shadowMaps.size()) <= shadowMapNum)
+				shadowMaps.resize(shadowMapNum + 1);
+			ShadowMap& shadowMap = shadowMaps[shadowMapNum];
+			LightCamInfo lightCamInfo;
+			shadowMap.lightMat = sceneLight->GetLightSpaceMat(lightCamInfo);
+			int resWidth, resHeight;
+			shadowMapRender->GetResolution(resWidth, resHeight);
+			shadowMap.target.Resize(resWidth, resHeight, false);
+			Rasterize(shadowMap.lightMat, shadowMap.target);
+			light.shadowMapIndex = shadowMapNum++;
+		}
+		lights.push_back(light);
+	}
+}
+#pragma endregion
+
+#pragma region geometry
+void SoftwareRasterizer::SplitJobs(const bool& _byTriangle)
+{
+	setupJobs.clear();
+	for (int i = 0; i < static_cast<int>(objects.size()); i++)
+	{
+		auto type = _byTriangle ? Mesh::MeshDataType::INDEX : Mesh::MeshDataType::POS;
+		int count = static_cast<int>(objects[i].mesh->GetElementCount(type));
+		for (int first = 0; first < count; first += setupJobSize)
+			setupJobs.push_back(glm::ivec3(i, first, std::min(first + setupJobSize, count)));
+	}
+}
+
+void SoftwareRasterizer::TransformVertices(const int& _jobIndex, const glm::mat4& _viewProjMat, const bool& _withAttributes)
+{
+	glm::ivec3 job = setupJobs[_jobIndex];
+	const Object& obj = objects[job.x];
+	const glm::vec3* positions = static_cast<const glm::vec3*>(obj.mesh->GetData(Mesh::MeshDataType::POS));
+	const glm::vec3* normals = static_cast<const glm::vec3*>(obj.mesh->GetData(Mesh::MeshDataType::NORMAL));
+	size_t normalNum = obj.mesh->GetElementCount(Mesh::MeshDataType::NORMAL);
+	glm::mat4 mvp = _viewProjMat * obj.modelMat;
+	auto& vertices = objectVertices[job.x];
+	for (int i = job.y; i < job.z; i++)
+	{
+		ClipVertex& v = vertices[i];
+		glm::vec4 pos(positions[i], 1);
+		v.clip = mvp * pos;
+		if (!_withAttributes)
+			continue;
+		v.worldPos = glm::vec3(obj.modelMat * pos);
+		v.normal = static_cast<size_t>(i) < normalNum ? obj.normalMat * normals[i] : glm::vec3(0, 0, 1);
+		v.uv = obj.uv ? obj.uv[i] : glm::vec2(0);
+	}
+}
+
+void SoftwareRasterizer::SetupTriangles(const int& _jobIndex, const Target& _target)
+{
+	glm::ivec3 job = setupJobs[_jobIndex];
+	const glm::uvec3* indices = static_cast<const glm::uvec3*>(objects[job.x].mesh->GetData(Mesh::MeshDataType::INDEX));
+	const auto& vertices = objectVertices[job.x];
+	auto& output = jobTriangles[_jobIndex];
+	output.clear();
+	for (int t = job.y; t < job.z; t++)
+	{
+		const ClipVertex* v[3] = { &vertices[indices[t].x], &vertices[indices[t].y], &vertices[indices[t].z] };
+
+		// trivially reject if all vertices are outside of the same frustum plane
+		bool outside = false;
+		for (int axis = 0; axis < 3 && !outside; axis++)
+		{
+			outside = (v[0]->clip[axis] > v[0]->clip.w && v[1]->clip[axis] > v[1]->clip.w && v[2]->clip[axis] > v[2]->clip.w) ||
+				(v[0]->clip[axis] < -v[0]->clip.w && v[1]->clip[axis] < -v[1]->clip.w && v[2]->clip[axis] < -v[2]->clip.w);
+		}
+		if (outside)
+			continue;
+
+		// clip against near plane(z >= -w), Sutherland-Hodgman with one plane gives at most 4 vertices
+		float d[3];
+		bool allInside = true;
+		for (int i = 0; i < 3; i++)
+		{
+			d[i] = v[i]->clip.z + v[i]->clip.w;
+			allInside = allInside && d[i] >= 0;
+		}
+		if (allInside)
+		{
+			SetupTriangle(*v[0], *v[1], *v[2], job.x, _target, output);
+			continue;
+		}
+		ClipVertex polygon[4];
+		int vertexNum = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			int j = (i + 1) % 3;
+			if (d[i] >= 0)
+				polygon[vertexNum++] = *v[i];
+			if ((d[i] >= 0) != (d[j] >= 0))
+			{
+				float s = d[i] / (d[i] - d[j]);
+				ClipVertex& c = polygon[vertexNum++];
+				c.clip = glm::mix(v[i]->clip, v[j]->clip, s);
+				c.worldPos = glm::mix(v[i]->worldPos, v[j]->worldPos, s);
+				c.normal = glm::mix(v[i]->normal, v[j]->normal, s);
+				c.uv = glm::mix(v[i]->uv, v[j]->uv, s);
+			}
+		}
+		for (int i = 1; i + 1 < vertexNum; i++)
+			SetupTriangle(polygon[0], polygon[i], polygon[i + 1], job.x, _target, output);
+	}
+}
+
+void SoftwareRasterizer::SetupTriangle(const ClipVertex& _v0, const ClipVertex& _v1, const ClipVertex& _v2, const int& _objectIndex, const Target& _target, vector<Triangle>& _output) const
+{
+	Triangle tri;
+	const ClipVertex* v[3] = { &_v0, &_v1, &_v2 };
+	for (int i = 0; i < 3; i++)
+	{
+		if (v[i]->clip.w <= 1e-6f)
+			return; // only happens on degenerated triangles after clipping
+		float invW = 1.0f / v[i]->clip.w;
+		glm::vec3 ndc = glm::vec3(v[i]->clip) * invW;
+		tri.screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * _target.width, (ndc.y * 0.5f + 0.5f) * _target.height, ndc.z * 0.5f + 0.5f);
+		tri.invW[i] = invW;
+	}
+
+	// counter-clockwise is front face, back faces are culled as OpenGL does(see Rasterizer::Setting)
+	glm::vec3* s = tri.screen;
+	float area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[1].y - s[0].y) * (s[2].x - s[0].x);
+	if (!(area > 0))
+		return;
+
+	float minX = std::min({ s[0].x, s[1].x, s[2].x }), maxX = std::max({ s[0].x, s[1].x, s[2].x });
+	float minY = std::min({ s[0].y, s[1].y, s[2].y }), maxY = std::max({ s[0].y, s[1].y, s[2].y });
+	tri.bounds.x = static_cast<int>(std::clamp(std::floor(minX), 0.0f, static_cast<float>(_target.width)));
+	tri.bounds.y = static_cast<int>(std::clamp(std::floor(minY), 0.0f, static_cast<float>(_target.height)));
+	tri.bounds.z = static_cast<int>(std::clamp(std::ceil(maxX), -1.0f, static_cast<float>(_target.width - 1)));
+	tri.bounds.w = static_cast<int>(std::clamp(std::ceil(maxY), -1.0f, static_cast<float>(_target.height - 1)));
+	if (tri.bounds.x > tri.bounds.z || tri.bounds.y > tri.bounds.w)
+		return;
+	tri.minZ = std::min({ s[0].z, s[1].z, s[2].z });
+
+	// edge opposite to vertex i goes from a to b, its function is positive inside
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3& a = s[(i + 1) % 3];
+		const glm::vec3& b = s[(i + 2) % 3];
+		tri.edgeA[i] = a.y - b.y;
+		tri.edgeB[i] = b.x - a.x;
+		tri.edgeC[i] = -(tri.edgeA[i] * a.x + tri.edgeB[i] * a.y);
+		tri.topLeft[i] = tri.edgeA[i] > 0 || (tri.edgeA[i] == 0 && tri.edgeB[i] < 0); // y is up: left edges go down, top edges go left
+	}
+	tri.invArea = 1.0f / area;
+	tri.objectIndex = _objectIndex;
+	if (_target.storeVisibility)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			tri.worldPos[i] = v[i]->worldPos;
+			tri.normal[i] = v[i]->normal;
+			tri.uv[i] = v[i]->uv;
+		}
+	}
+	_output.push_back(tri);
+}
+
+void SoftwareRasterizer::BinTriangles(const Target& _target)
+{
+	int tileNumX = _target.GetTileNumX();
+	int tileNum = tileNumX * _target.GetTileNumY();
+	int chunkNum = (static_cast<int>(triangles.size()) + binChunkSize - 1) / binChunkSize;
+	if (static_cast<int>(bins.size()) < chunkNum)
+		bins.resize(chunkNum);
+	pool.ParallelFor(chunkNum, [&](const int& _chunk)
+		{
+			auto& chunkBins = bins[_chunk];
+			chunkBins.resize(tileNum);
+			for (auto& bin : chunkBins)
+				bin.clear();
+			int end = std::min((_chunk + 1) * binChunkSize, static_cast<int>(triangles.size()));
+			for (int t = _chunk * binChunkSize; t < end; t++)
+			{
+				const glm::ivec4& bounds = triangles[t].bounds;
+				for (int ty = bounds.y / tileSize; ty <= bounds.w / tileSize; ty++)
+				{
+					for (int tx = bounds.x / tileSize; tx <= bounds.z / tileSize; tx++)
+						chunkBins[ty * tileNumX + tx].push_back(t);
+				}
+			}
+		});
+}
+#pragma endregion
+
+#pragma region raster
+void SoftwareRasterizer::Rasterize(const glm::mat4& _viewProjMat, Target& _target)
+{
+	// (1) transform vertices
+	objectVertices.resize(objects.size());
+	for (int i = 0; i < static_cast<int>(objects.size()); i++)
+		objectVertices[i].resize(objects[i].mesh->GetElementCount(Mesh::MeshDataType::POS));
+	SplitJobs(false);
+	pool.ParallelFor(static_cast<int>(setupJobs.size()), [&](const int& _job) { TransformVertices(_job, _viewProjMat, _target.storeVisibility); });
+
+	// (2) clip and setup triangles, then gather them in submission order
+	SplitJobs(true);
+	if (jobTriangles.size() < setupJobs.size())
+		jobTriangles.resize(setupJobs.size());
+	pool.ParallelFor(static_cast<int>(setupJobs.size()), [&](const int& _job) { SetupTriangles(_job, _target); });
+	triangles.clear();
+	for (int i = 0; i < static_cast<int>(setupJobs.size()); i++)
+		triangles.insert(triangles.end(), jobTriangles[i].begin(), jobTriangles[i].end());
+
+	// (3) bin and rasterize tiles
+	BinTriangles(_target);
+	pool.ParallelFor(_target.GetTileNumX() * _target.GetTileNumY(), [&](const int& _tileIndex) { RasterTile(_tileIndex, _target); });
+}
+
+void SoftwareRasterizer::RasterTile(const int& _tileIndex, Target& _target) const
+{
+	int tileNumX = _target.GetTileNumX();
+	glm::ivec4 tileRect;
+	tileRect.x = (_tileIndex % tileNumX) * tileSize;
+	tileRect.y = (_tileIndex / tileNumX) * tileSize;
+	tileRect.z = std::min(tileRect.x + tileSize, _target.width) - 1;
+	tileRect.w = std::min(tileRect.y + tileSize, _target.height) - 1;
+
+	for (int y = tileRect.y; y <= tileRect.w; y++)
+	{
+		size_t row = static_cast<size_t>(y) * _target.width;
+		std::fill(_target.depth.begin() + row + tileRect.x, _target.depth.begin() + row + tileRect.z + 1, 1.0f);
+		if (_target.storeVisibility)
+			std::fill(_target.triangleIDs.begin() + row + tileRect.x, _target.triangleIDs.begin() + row + tileRect.z + 1, -1);
+	}
+
+	// max depth of each block, a triangle whose min depth is not less than it can't pass depth test anywhere in the block
+	const int blockNumX = tileSize / blockSize;
+	float blockMaxZ[blockNumX * blockNumX];
+	std::fill(blockMaxZ, blockMaxZ + blockNumX * blockNumX, 1.0f);
+
+	int chunkNum = (static_cast<int>(triangles.size()) + binChunkSize - 1) / binChunkSize;
+	for (int chunk = 0; chunk < chunkNum; chunk++)
+	{
+		for (int triIndex : bins[chunk][_tileIndex])
+		{
+			const Triangle& tri = triangles[triIndex];
+			glm::ivec4 rect(std::max(tri.bounds.x, tileRect.x), std::max(tri.bounds.y, tileRect.y), std::min(tri.bounds.z, tileRect.z), std::min(tri.bounds.w, tileRect.w));
+			for (int by = (rect.y - tileRect.y) / blockSize; by <= (rect.w - tileRect.y) / blockSize; by++)
+			{
+				for (int bx = (rect.x - tileRect.x) / blockSize; bx <= (rect.z - tileRect.x) / blockSize; bx++)
+				{
+					int block = by * blockNumX + bx;
+					if (tri.minZ >= blockMaxZ[block])
+						continue;
+					glm::ivec4 blockRect(tileRect.x + bx * blockSize, tileRect.y + by * blockSize, 0, 0);
+					blockRect.z = std::min(blockRect.x + blockSize - 1, tileRect.z);
+					blockRect.w = std::min(blockRect.y + blockSize - 1, tileRect.w);
+					glm::ivec4 drawRect(std::max(rect.x, blockRect.x), std::max(rect.y, blockRect.y), std::min(rect.z, blockRect.z), std::min(rect.w, blockRect.w));
+					if (!RasterBlock(tri, triIndex, drawRect, _target))
+						continue;
+					float maxZ = 0;
+					for (int y = blockRect.y; y <= blockRect.w; y++)
+					{
+						size_t row = static_cast<size_t>(y) * _target.width;
+						for (int x = blockRect.x; x <= blockRect.z; x++)
+							maxZ = std::max(maxZ, _target.depth[row + x]);
+					}
+					blockMaxZ[block] = maxZ;
+				}
+			}
+		}
+	}
+}
+
+bool SoftwareRasterizer::RasterBlock(const Triangle& _tri, const int& _triIndex, const glm::ivec4& _rect, Target& _target) const
+{
+	bool written = false;
+	auto WritePixel = [&](const int& _x, const int& _y, const float& _w1, const float& _w2)
+	{
+		float b1 = _w1 * _tri.invArea, b2 = _w2 * _tri.invArea;
+		float z = _tri.screen[0].z * (1 - b1 - b2) + _tri.screen[1].z * b1 + _tri.screen[2].z * b2; // depth is linear in screen space
+		size_t index = static_cast<size_t>(_y) * _target.width + _x;
+		if (z > 1.0f || z >= _target.depth[index])
+			return;
+		_target.depth[index] = z;
+		if (_target.storeVisibility)
+		{
+			_target.triangleIDs[index] = _triIndex;
+			_target.barycentrics[index] = glm::vec2(b1, b2);
+		}
+		written = true;
+	};
+
+	for (int y = _rect.y; y <= _rect.w; y++)
+	{
+		float py = y + 0.5f;
+		float rowW[3];
+		for (int i = 0; i < 3; i++)
+			rowW[i] = _tri.edgeB[i] * py + _tri.edgeC[i];
+#if ICE_SOFTWARE_SSE
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 laneOffset = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f); // pixel centers of 4 lanes
+		for (int x = _rect.x; x <= _rect.z; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffset);
+			__m128 w[3];
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int i = 0; i < 3; i++)
+			{
+				w[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(_tri.edgeA[i]), px), _mm_set1_ps(rowW[i]));
+				inside = _mm_and_ps(inside, _tri.topLeft[i] ? _mm_cmpge_ps(w[i], zero) : _mm_cmpgt_ps(w[i], zero));
+			}
+			int mask = _mm_movemask_ps(inside);
+			if (mask == 0)
+				continue;
+			alignas(16) float w1[4], w2[4];
+			_mm_store_ps(w1, w[1]);
+			_mm_store_ps(w2, w[2]);
+			for (int lane = 0; lane < 4 && x + lane <= _rect.z; lane++)
+			{
+				if (mask & (1 << lane))
+					WritePixel(x + lane, y, w1[lane], w2[lane]);
+			}
+		}
+#else
+		for (int x = _rect.x; x <= _rect.z; x++)
+		{
+			float px = x + 0.5f;
+			float w[3];
+			bool inside = true;
+			for (int i = 0; i < 3; i++)
+			{
+				w[i] = _tri.edgeA[i] * px + rowW[i];
+				inside = inside && (_tri.topLeft[i] ? w[i] >= 0 : w[i] > 0);
+			}
+			if (inside)
+				WritePixel(x, y, w[1], w[2]);
+		}
+#endif
+	}
+	return written;
+}
+#pragma endregion
+
+#pragma region shading
+void SoftwareRasterizer::ShadeTile(const int& _tileIndex, const glm::mat4& _viewMat)
+{
+	int tileNumX = target.GetTileNumX();
+	int x0 = (_tileIndex % tileNumX) * tileSize, y0 = (_tileIndex / tileNumX) * tileSize;
+	int x1 = std::min(x0 + tileSize, target.width), y1 = std::min(y0 + tileSize, target.height);
+	for (int y = y0; y < y1; y++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			size_t index = static_cast<size_t>(y) * target.width + x;
+			int triIndex = target.triangleIDs[index];
+			glm::vec3 color = triIndex < 0 ? clearColor : ShadePixel(triangles[triIndex], target.barycentrics[index], _viewMat);
+			color = glm::clamp(color, 0.0f, 1.0f);
+			for (int c = 0; c < 3; c++)
+				colorBuffer[index * 4 + c] = static_cast<unsigned char>(color[c] * 255.0f + 0.5f);
+			colorBuffer[index * 4 + 3] = 255;
+		}
+	}
+}
+
+glm::vec3 SoftwareRasterizer::ShadePixel(const Triangle& _tri, const glm::vec2& _barycentric, const glm::mat4& _viewMat) const
+{
+	// perspective-correct weights
+	glm::vec3 weight(1 - _barycentric.x - _barycentric.y, _barycentric.x, _barycentric.y);
+	weight *= glm::vec3(_tri.invW[0], _tri.invW[1], _tri.invW[2]);
+	weight /= (weight.x + weight.y + weight.z);
+	glm::vec3 worldPos = _tri.worldPos[0] * weight.x + _tri.worldPos[1] * weight.y + _tri.worldPos[2] * weight.z;
+	glm::vec3 normal = _tri.normal[0] * weight.x + _tri.normal[1] * weight.y + _tri.normal[2] * weight.z;
+	glm::vec2 uv = _tri.uv[0] * weight.x + _tri.uv[1] * weight.y + _tri.uv[2] * weight.z;
+
+	const Object& obj = objects[_tri.objectIndex];
+	glm::vec3 albedo = obj.albedo != nullptr ? obj.albedo->Sample(uv) : obj.color;
+	if (!obj.isPhong)
+		return albedo; // "Simple/simple.fs"
+
+	// lighting computation is in eye space, the same as "Phong/phong.fs"
+	glm::vec3 ePos = glm::vec3(_viewMat * glm::vec4(worldPos, 1));
+	glm::vec3 eN = glm::normalize(glm::mat3(_viewMat) * normal);
+	glm::vec3 eV = glm::normalize(-ePos);
+	glm::vec3 lRes(0);
+	for (auto& light : lights)
+	{
+		float lI = light.intensity;
+		glm::vec3 lDir;
+		if (light.type == static_cast<int>(LightType::POINT))
+		{
+			lDir = light.eyePos - ePos;
+			float d = glm::length(lDir);
+			lI *= 1.0f / (1 + d * light.attenuation.x + d * d * light.attenuation.y);
+		}
+		else
+			lDir = light.eyeDir;
+		lDir = glm::normalize(lDir);
+		glm::vec3 lC = light.color * lI;
+
+		glm::vec3 diffuse(0);
+		float lDirDotN = glm::dot(lDir, eN);
+		if (lDirDotN > 0)
+			diffuse = obj.kd * lDirDotN * lC;
+
+		glm::vec3 specular(0);
+		glm::vec3 lRef = glm::normalize(2 * lDirDotN * eN - lDir);
+		float lRefDotN = glm::dot(lRef, eV);
+		if (lRefDotN > 0)
+			specular = obj.ks * std::pow(lRefDotN, obj.shiness) * lC;
+
+		float lightRatio = light.shadowMapIndex >= 0 ? ComputeLightRatio(shadowMaps[light.shadowMapIndex], worldPos) : 1.0f;
+		lRes += (diffuse + specular) * lightRatio;
+	}
+	lRes += ambientLight * obj.ka;
+	return lRes * albedo;
+}
+
+float SoftwareRasterizer::ComputeLightRatio(const ShadowMap& _shadowMap, const glm::vec3& _worldPos) const
+{
+	glm::vec4 clipCoord = _shadowMap.lightMat * glm::vec4(_worldPos, 1);
+	glm::vec3 shadowCoord = (glm::vec3(clipCoord) / clipCoord.w + 1.0f) * 0.5f;
+	const Target& shadowTarget = _shadowMap.target;
+	// nearest texel, outside of shadow map is 1(GL_CLAMP_TO_BORDER)
+	auto Fetch = [&](const int& _dx, const int& _dy)
+	{
+		int x = static_cast<int>(std::floor(shadowCoord.x * shadowTarget.width)) + _dx;
+		int y = static_cast<int>(std::floor(shadowCoord.y * shadowTarget.height)) + _dy;
+		if (x < 0 || y < 0 || x >= shadowTarget.width || y >= shadowTarget.height)
+			return 1.0f;
+		return shadowTarget.depth[static_cast<size_t>(y) * shadowTarget.width + x];
+	};
+
+	if (pcfHalfKernelSize < 0)
+		return shadowCoord.z < Fetch(0, 0) + shadowBias ? 1.0f : 0.0f;
+	float result = 0;
+	for (int i = -pcfHalfKernelSize; i <= pcfHalfKernelSize; i++)
+	{
+		for (int j = -pcfHalfKernelSize; j <= pcfHalfKernelSize; j++)
+			result += shadowCoord.z < Fetch(i, j) + shadowBias ? 1.0f : 0.0f;
+	}
+	int kernelSize = pcfHalfKernelSize * 2 + 1;
+	return result / (kernelSize * kernelSize);
+}
+#pragma endregion
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "../helpers/threadPool.hpp"
+#include "../helpers/cpuTextureCache.hpp"
+
+namespace IceRender
+{
+	class Mesh;
+
+	/*
+	* CPU rasterizer, used by render method "RenderSoftware"(see renderMethod.cpp). It renders the current camera view on a thread pool:
+	* - triangles are transformed and clipped(near plane) per object in parallel, then binned into screen tiles(tileSize x tileSize)
+	* - tiles are rasterized in parallel with edge functions, 4 pixels at once with SSE2(scalar fallback). Each 8x8 block of a tile keeps its max depth,
+	*   a triangle is skipped for the whole block if it is behind(hierarchical Z).
+	* - raster only writes depth and triangle ID/barycentrics(visibility buffer), shading runs once per visible pixel afterwards.
+	* - shading is the C++ port of "Simple/simple.fs"(non-Phong materials) and "Phong/phong.fs" with "ShadowMap/lightRatioPCF.sub_fs".
+	*   Shadow maps are rendered by the same rasterizer(depth only) if the shadow method is "ShadowMap", other shadow methods are ignored.
+	* The result is uploaded into a texture and drawn into the scene framebuffer, so it works with anti-aliasing, render scale and multiple views.
+	* RenderImage() doesn't need OpenGL, it is also used without window(command line "--software", see main.cpp).
+	*/
+	class SoftwareRasterizer
+	{
+	public:
+		static const int tileSize = 32;
+		static const int blockSize = 8; // hierarchical Z block inside tile
+
+	private:
+		struct ClipVertex
+		{
+			glm::vec4 clip;
+			glm::vec3 worldPos, normal;
+			glm::vec2 uv;
+		};
+
+		struct Triangle
+		{
+			glm::vec3 screen[3]; // x, y in pixels, z is window depth in [0, 1]
+			float invW[3]; // for perspective-correct interpolation
+			glm::vec3 worldPos[3], normal[3];
+			glm::vec2 uv[3];
+			glm::vec3 edgeA, edgeB, edgeC; // weight of vertex i is edgeA[i]*x + edgeB[i]*y + edgeC[i]
+			bool topLeft[3]; // fill rule: pixel exactly on an edge belongs to the triangle only if the edge is top or left
+			float invArea;
+			glm::ivec4 bounds; // minX, minY, maxX, maxY(inclusive)
+			float minZ;
+			int objectIndex;
+		};
+
+		struct Target
+		{
+			int width, height;
+			bool storeVisibility; // false for shadow maps(depth only)
+			std::vector<float> depth;
+			std::vector<int> triangleIDs; // -1 means background
+			std::vector<glm::vec2> barycentrics; // screen space weights of vertex 1 and 2
+
+			void Resize(const int& _width, const int& _height, const bool& _storeVisibility);
+			int GetTileNumX() const;
+			int GetTileNumY() const;
+		};
+
+		struct Object
+		{
+			std::shared_ptr<Mesh> mesh;
+			glm::mat4 modelMat;
+			glm::mat3 normalMat;
+			const glm::vec2* uv; // null if there is no uv
+			bool isPhong;
+			glm::vec3 color, ka, kd, ks;
+			float shiness;
+			const CPUTexture* albedo; // null if there is no albedo texture
+		};
+
+		struct Light
+		{
+			int type; // same as LightType
+			glm::vec3 color;
+			float intensity;
+			glm::vec2 attenuation;
+			glm::vec3 eyePos, eyeDir; // in eye space of current camera, "eyeDir" points from fragment to light(direct light)
+			int shadowMapIndex; // -1 means no shadow
+		};
+
+		struct ShadowMap
+		{
+			glm::mat4 lightMat;
+			Target target;
+		};
+
+		ThreadPool pool;
+		int threadNum; // worker threads, <= 0 means hardware concurrency
+		bool poolStarted;
+
+		std::vector<Object> objects;
+		std::vector<std::vector<ClipVertex>> objectVertices; // transformed vertices of each object
+		std::vector<glm::ivec3> setupJobs; // (object index, first, end) of vertex or triangle range, large meshes are split into several jobs
+		std::vector<std::vector<Triangle>> jobTriangles; // setup results of each job, kept to reuse memory
+		std::vector<Triangle> triangles; // all triangles in submission order
+		std::vector<std::vector<std::vector<int>>> bins; // [chunk][tile] -> triangle indices, chunks keep the submission order inside each tile
+		std::vector<Light> lights;
+		glm::vec3 ambientLight;
+		std::vector<ShadowMap> shadowMaps;
+		float shadowBias;
+		int pcfHalfKernelSize; // -1 means hard shadow
+
+		Target target;
+		std::vector<unsigned char> colorBuffer; // RGBA8, bottom row first(same as OpenGL)
+		GLuint outputTex;
+		int outputWidth, outputHeight;
+
+		CPUTextureCache textureCache; // albedo textures read back from GPU once
+
+		void PrepareObjects();
+		void PrepareLights(const glm::mat4& _viewMat); // also render shadow maps
+
+		// transform, clip and bin all objects, then rasterize all tiles into "_target"
+		void Rasterize(const glm::mat4& _viewProjMat, Target& _target);
+		void SplitJobs(const bool& _byTriangle); // fill "setupJobs"
+		void TransformVertices(const int& _jobIndex, const glm::mat4& _viewProjMat, const bool& _withAttributes);
+		void SetupTriangles(const int& _jobIndex, const Target& _target);
+		void SetupTriangle(const ClipVertex& _v0, const ClipVertex& _v1, const ClipVertex& _v2, const int& _objectIndex, const Target& _target, std::vector<Triangle>& _output) const;
+		void BinTriangles(const Target& _target);
+		void RasterTile(const int& _tileIndex, Target& _target) const;
+		bool RasterBlock(const Triangle& _tri, const int& _triIndex, const glm::ivec4& _rect, Target& _target) const; // return true if any pixel is written
+
+		void ShadeTile(const int& _tileIndex, const glm::mat4& _viewMat);
+		glm::vec3 ShadePixel(const Triangle& _tri, const glm::vec2& _barycentric, const glm::mat4& _viewMat) const; // port of "Phong/phong.fs"
+		float ComputeLightRatio(const ShadowMap& _shadowMap, const glm::vec3& _worldPos) const; // port of "ShadowMap/lightRatioPCF.sub_fs"
+
+	public:
+		SoftwareRasterizer();
+		~SoftwareRasterizer();
+
+		void Clear();
+
+		// render active camera into a texture of "_width" x "_height", return the texture
+		GLuint Render(const int& _width, const int& _height);
+		// render active camera into RGBA8 pixels(bottom row first)
+		const std::vector<unsigned char>& RenderImage(const int& _width, const int& _height);
+
+		int GetThreadNum() const; // including calling thread
+		void SetThreadNum(const int& _threadNum); // worker threads, <= 0 means hardware concurrency
+	};
+}
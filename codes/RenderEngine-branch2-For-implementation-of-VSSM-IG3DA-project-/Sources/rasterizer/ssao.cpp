@@ -0,0 +1,138 @@
+#include "ssao.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include <algorithm>
+
+using namespace IceRender;
+using namespace std;
+
+SSAO::SSAO() : enabled(false), downscale(2), sampleNum(8), radius(0.5f), intensity(1.0f), aoTexture(0) {}
+
+void SSAO::AddPasses(FrameGraph& _graph, const FrameGraph::ResourceHandle& _cameraDepth, FrameGraph::ResourceHandle& _output)
+{
+	aoTexture = 0; // set by upsample pass, so it is 0 if passes are culled
+	int lowWidth = (GLOBAL.RENDER_WIDTH + downscale - 1) / downscale;
+	int lowHeight = (GLOBAL.RENDER_HEIGHT + downscale - 1) / downscale;
+
+	auto aoTex = _graph.CreateTexture("SSAORaw", TransientTextureDesc(lowWidth, lowHeight, GL_RG16F)); // r: AO, g: linear depth(used by blur)
+	auto blurTex = _graph.CreateTexture("SSAOBlur", TransientTextureDesc(lowWidth, lowHeight, GL_RG16F));
+	_output = _graph.CreateTexture("SSAO", TransientTextureDesc(GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT, GL_R8));
+
+	_graph.AddPass("SSAO", { _cameraDepth }, { aoTex }, [this, depthTex = _cameraDepth, aoTex, &_graph]() { ComputeAO(_graph.GetTexture(depthTex), _graph.GetTexture(aoTex)); });
+	_graph.AddPass("SSAOBlur", { aoTex }, { blurTex }, [this, aoTex, blurTex, &_graph]() { Blur(_graph.GetTexture(aoTex), _graph.GetTexture(blurTex)); });
+	_graph.AddPass("SSAOUpsample", { _cameraDepth, blurTex }, { _output }, [this, depthTex = _cameraDepth, blurTex, output = _output, &_graph]()
+		{
+			aoTexture = _graph.GetTexture(output);
+			Upsample(_graph.GetTexture(depthTex), _graph.GetTexture(blurTex), aoTexture);
+		});
+}
+
+glm::ivec4 SSAO::GetLowViewRect(const int& _viewIndex) const
+{
+	glm::ivec4 rect = GLOBAL.render->GetViewRect(_viewIndex);
+	glm::ivec2 lowMin = glm::ivec2(rect.x, rect.y) / downscale;
+	glm::ivec2 lowMax = (glm::ivec2(rect.x + rect.z, rect.y + rect.w) + downscale - 1) / downscale;
+	return glm::ivec4(lowMin, lowMax - lowMin);
+}
+
+void SSAO::SetViewUniforms(const shared_ptr<ShaderProgram>& _shaderPro, const int& _viewIndex) const
+{
+	glm::ivec4 rect = GLOBAL.render->GetViewRect(_viewIndex);
+	glm::ivec4 lowRect = GetLowViewRect(_viewIndex);
+	glm::mat4 projectMat = GLOBAL.camCtrller->GetView(_viewIndex)->GetProjectionMatrix();
+	_shaderPro->Set("viewRect", glm::vec4(rect));
+	_shaderPro->Set("lowViewRect", glm::vec4(lowRect));
+	_shaderPro->Set("projectMat", projectMat);
+	_shaderPro->Set("invProjectMat", glm::inverse(projectMat));
+	_shaderPro->Set("downscale", downscale);
+}
+
+void SSAO::ComputeAO(const GLuint& _depthTex, const GLuint& _aoTex)
+{
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "SSAO/ssao");
+	if (shaderPro == nullptr)
+		return;
+	glBindTextureUnit(0, _depthTex);
+	shaderPro->Set("depthTex", 0);
+	glBindImageTexture(0, _aoTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F); // binding=0 in shader
+	shaderPro->Set("sampleNum", sampleNum);
+	shaderPro->Set("radius", radius);
+	shaderPro->Set("intensity", intensity);
+
+	const int groupSize = 8; // same as local_size_x/y in shader
+	for (int viewIndex = 0; viewIndex < GLOBAL.camCtrller->GetViewNum(); viewIndex++)
+	{
+		SetViewUniforms(shaderPro, viewIndex);
+		glm::ivec4 lowRect = GetLowViewRect(viewIndex);
+		glDispatchCompute((lowRect.z + groupSize - 1) / groupSize, (lowRect.w + groupSize - 1) / groupSize, 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT); // read by texelFetch in blur pass
+	if (CheckGLError()) { Print("Error in SSAO::ComputeAO."); return; }
+}
+
+void SSAO::Blur(const GLuint& _aoTex, const GLuint& _blurTex)
+{
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "SSAO/ssaoBlur");
+	if (shaderPro == nullptr)
+		return;
+	glBindTextureUnit(0, _aoTex);
+	shaderPro->Set("aoTex", 0);
+	glBindImageTexture(0, _blurTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+
+	const int groupSize = 8;
+	for (int viewIndex = 0; viewIndex < GLOBAL.camCtrller->GetViewNum(); viewIndex++)
+	{
+		glm::ivec4 lowRect = GetLowViewRect(viewIndex);
+		shaderPro->Set("lowViewRect", glm::vec4(lowRect));
+		glDispatchCompute((lowRect.z + groupSize - 1) / groupSize, (lowRect.w + groupSize - 1) / groupSize, 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	if (CheckGLError()) { Print("Error in SSAO::Blur."); return; }
+}
+
+void SSAO::Upsample(const GLuint& _depthTex, const GLuint& _blurTex, const GLuint& _outputTex)
+{
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "SSAO/ssaoUpsample");
+	if (shaderPro == nullptr)
+		return;
+	glBindTextureUnit(0, _depthTex);
+	shaderPro->Set("depthTex", 0);
+	glBindTextureUnit(1, _blurTex);
+	shaderPro->Set("aoTex", 1);
+	glBindImageTexture(0, _outputTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+
+	const int groupSize = 8;
+	for (int viewIndex = 0; viewIndex < GLOBAL.camCtrller->GetViewNum(); viewIndex++)
+	{
+		SetViewUniforms(shaderPro, viewIndex);
+		glm::ivec4 rect = GLOBAL.render->GetViewRect(viewIndex);
+		glDispatchCompute((rect.z + groupSize - 1) / groupSize, (rect.w + groupSize - 1) / groupSize, 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT); // read by scene pass
+	if (CheckGLError()) { Print("Error in SSAO::Upsample."); return; }
+}
+
+void SSAO::BindAO(const shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit) const
+{
+	// sampler is always bound to its own unit, even if AO is not used
+	glBindTextureUnit(_texUnit, aoTexture);
+	_shaderPro->Set("ssaoTex", static_cast<int>(_texUnit));
+	_shaderPro->Set("useSSAO", aoTexture != 0 ? 1 : 0);
+	_texUnit++;
+}
+
+bool SSAO::IsEnabled() const { return enabled; }
+void SSAO::SetEnabled(const bool& _value)
+{
+	enabled = _value;
+	if (!enabled)
+		aoTexture = 0; // passes are not added any more
+}
+int SSAO::GetDownscale() const { return downscale; }
+void SSAO::SetDownscale(const int& _value) { downscale = _value <= 2 ? 2 : 4; }
+int SSAO::GetSampleNum() const { return sampleNum; }
+void SSAO::SetSampleNum(const int& _value) { sampleNum = std::clamp(_value, 4, 16); }
+float SSAO::GetRadius() const { return radius; }
+void SSAO::SetRadius(const float& _value) { radius = std::max(_value, 0.01f); }
+float SSAO::GetIntensity() const { return intensity; }
+void SSAO::SetIntensity(const float& _value) { intensity = std::max(_value, 0.0f); }
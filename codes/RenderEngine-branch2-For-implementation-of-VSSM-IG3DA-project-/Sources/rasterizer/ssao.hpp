@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include "frameGraph.hpp"
+
+namespace IceRender
+{
+	class ShaderProgram;
+
+	/*
+	* Screen-space ambient occlusion, computed before the scene pass and read by the ambient term of "Phong/phong.fs":
+	* - view-space position is reconstructed from the camera depth pre-pass(see Rasterizer::RenderCameraDepth), which is shared with SDSM.
+	* - AO is computed at 1/2 or 1/4 resolution by a compute shader. Each pixel of a 4x4 block rotates the sample kernel differently(interleaved pattern),
+	*   so few samples per pixel cover many directions.
+	* - depth-aware blur over the 4x4 block(removes the interleaved pattern), then depth-aware bilinear upsample to render resolution.
+	* All textures are transient textures of frame graph, nothing is kept between frames.
+	*/
+	class SSAO
+	{
+	private:
+		bool enabled;
+		int downscale; // 2(half resolution) or 4(quarter resolution)
+		int sampleNum; // samples per pixel, in range [4, 16]
+		float radius; // sample radius in view space
+		float intensity;
+
+		GLuint aoTexture; // render resolution result of current frame, 0 if it is not computed
+
+		void ComputeAO(const GLuint& _depthTex, const GLuint& _aoTex);
+		void Blur(const GLuint& _aoTex, const GLuint& _blurTex);
+		void Upsample(const GLuint& _depthTex, const GLuint& _blurTex, const GLuint& _outputTex);
+
+		// view rect at low resolution, views are laid out in the same way as the render target
+		glm::ivec4 GetLowViewRect(const int& _viewIndex) const;
+		void SetViewUniforms(const std::shared_ptr<ShaderProgram>& _shaderPro, const int& _viewIndex) const;
+
+	public:
+		SSAO();
+
+		// add AO/blur/upsample passes reading camera depth "_cameraDepth", "_output" is the AO texture which scene pass should read(then the passes are not culled)
+		void AddPasses(FrameGraph& _graph, const FrameGraph::ResourceHandle& _cameraDepth, FrameGraph::ResourceHandle& _output);
+
+		// set "useSSAO" and "ssaoTex" of scene shader, AO is disabled in shader if it is not computed this frame
+		void BindAO(const std::shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit) const;
+
+		bool IsEnabled() const;
+		void SetEnabled(const bool& _value);
+		int GetDownscale() const;
+		void SetDownscale(const int& _value); // 2 or 4
+		int GetSampleNum() const;
+		void SetSampleNum(const int& _value);
+		float GetRadius() const;
+		void SetRadius(const float& _value);
+		float GetIntensity() const;
+		void SetIntensity(const float& _value);
+	};
+}
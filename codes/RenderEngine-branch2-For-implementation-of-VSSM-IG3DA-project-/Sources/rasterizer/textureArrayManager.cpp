@@ -0,0 +1,229 @@
+#include "textureArrayManager.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include <algorithm>
+
+using namespace IceRender;
+
+TextureArrayManager::TextureArrayManager() {}
+
+TextureArrayManager::~TextureArrayManager() { Clear(); }
+
+void TextureArrayManager::Clear()
+{
+	for (auto& array : arrays)
+	{
+		if (glIsTexture(array.texID))
+			glDeleteTextures(1, &array.texID);
+	}
+	arrays.clear();
+	textureLayers.clear();
+}
+
+int TextureArrayManager::GetLayerSize(const int& _width, const int& _height)
+{
+	int size = minLayerSize;
+	while (size < std::max(_width, _height) && size < maxLayerSize)
+		size *= 2;
+	return size;
+}
+
+int TextureArrayManager::FindOrCreateArray(const int& _size)
+{
+	for (int i = 0; i < static_cast<int>(arrays.size()); i++)
+	{
+		if (arrays[i].size == _size)
+			return i;
+	}
+	if (arrays.size() >= maxArrayNum)
+	{
+		Print("[Error] TextureArrayManager: no more texture array is allowed.");
+		return -1;
+	}
+
+	TextureArray array;
+	array.texID = 0; // storage is created in ReserveLayers()
+	array.size = _size;
+	array.levels = 1;
+	for (int size = _size; size > 1; size /= 2)
+		array.levels++;
+	array.layerCapacity = 0;
+	array.layerUsed = 0;
+	arrays.push_back(array);
+	return static_cast<int>(arrays.size() - 1);
+}
+
+void TextureArrayManager::ReserveLayers(TextureArray& _array, const int& _layerNum)
+{
+	if (_layerNum <= _array.layerCapacity)
+		return;
+
+	// texture storage is immutable, create a larger one and copy all levels of existing layers
+	int capacity = std::max(_layerNum, std::max(_array.layerCapacity * 2, 4));
+	GLuint texID;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texID);
+	glTextureStorage3D(texID, _array.levels, GL_RGBA8, _array.size, _array.size, capacity);
+	glTextureParameteri(texID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(texID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(texID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(texID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (_array.layerCapacity > 0)
+	{
+		for (int level = 0, size = _array.size; level < _array.levels; level++, size = std::max(size / 2, 1))
+			glCopyImageSubData(_array.texID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, texID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, size, size, _array.layerCapacity);
+	}
+	if (glIsTexture(_array.texID))
+		glDeleteTextures(1, &_array.texID);
+	_array.texID = texID;
+	_array.layerCapacity = capacity;
+	if (CheckGLError()) { Print("Error in TextureArrayManager::ReserveLayers."); return; }
+}
+
+std::vector<unsigned char> TextureArrayManager::Resample(const std::vector<unsigned char>& _src, const int& _width, const int& _height, const int& _size)
+{
+	std::vector<unsigned char> dst(static_cast<size_t>(_size) * _size * 4);
+	for (int y = 0; y < _size; y++)
+	{
+		// map texel centers, then interpolate four nearest source texels
+		float srcY = std::clamp((y + 0.5f) * _height / _size - 0.5f, 0.0f, static_cast<float>(_height - 1));
+		int y0 = static_cast<int>(srcY);
+		int y1 = std::min(y0 + 1, _height - 1);
+		float wy = srcY - y0;
+		for (int x = 0; x < _size; x++)
+		{
+			float srcX = std::clamp((x + 0.5f) * _width / _size - 0.5f, 0.0f, static_cast<float>(_width - 1));
+			int x0 = static_cast<int>(srcX);
+			int x1 = std::min(x0 + 1, _width - 1);
+			float wx = srcX - x0;
+			for (int c = 0; c < 4; c++)
+			{
+				float v00 = _src[(static_cast<size_t>(y0) * _width + x0) * 4 + c];
+				float v10 = _src[(static_cast<size_t>(y0) * _width + x1) * 4 + c];
+				float v01 = _src[(static_cast<size_t>(y1) * _width + x0) * 4 + c];
+				float v11 = _src[(static_cast<size_t>(y1) * _width + x1) * 4 + c];
+				float v = (v00 * (1 - wx) + v10 * wx) * (1 - wy) + (v01 * (1 - wx) + v11 * wx) * wy;
+				dst[(static_cast<size_t>(y) * _size + x) * 4 + c] = static_cast<unsigned char>(std::clamp(v + 0.5f, 0.0f, 255.0f));
+			}
+		}
+	}
+	return dst;
+}
+
+bool TextureArrayManager::UploadLayer(const GLuint& _texID, const glm::ivec2& _layer)
+{
+	// resample the base level into level 0 of the layer on GPU. The shader reads any color format(e.g. GL_RGB12 used by Utility::Load2DTexture), nothing is read back.
+	// [Note] base level is not 0 while TextureStreamer is still uploading, its placeholder mip is packed then.
+	std::shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "TextureArray/copyLayer");
+	if (shaderPro == nullptr)
+		return false;
+	TextureArray& array = arrays[_layer.x];
+	glBindTextureUnit(0, _texID);
+	shaderPro->Set("srcTex", 0);
+	shaderPro->Set("layerSize", array.size);
+	glBindImageTexture(0, array.texID, 0, GL_FALSE, _layer.y, GL_WRITE_ONLY, GL_RGBA8); // binding=0 in shader, single layer
+	const int groupSize = 8;
+	glDispatchCompute((array.size + groupSize - 1) / groupSize, (array.size + groupSize - 1) / groupSize, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	if (CheckGLError()) { Print("Error in TextureArrayManager::UploadLayer."); return false; }
+	GenerateLayerMipmap(_layer);
+	return true;
+}
+
+void TextureArrayManager::GenerateLayerMipmap(const glm::ivec2& _layer)
+{
+	// glGenerateTextureMipmap of the array would regenerate all layers, a view of one layer(storage is immutable) limits it to that layer
+	if (_layer.x < 0 || _layer.x >= static_cast<int>(arrays.size()))
+		return;
+	const TextureArray& array = arrays[_layer.x];
+	GLuint viewID;
+	glGenTextures(1, &viewID); // a view needs a name which has never been bound
+	glTextureView(viewID, GL_TEXTURE_2D, array.texID, GL_RGBA8, 0, array.levels, _layer.y, 1);
+	glGenerateTextureMipmap(viewID);
+	glDeleteTextures(1, &viewID);
+	if (CheckGLError()) { Print("Error in TextureArrayManager::GenerateLayerMipmap."); return; }
+}
+
+bool TextureArrayManager::AddTexture(const GLuint& _texID, glm::ivec2& _layer)
+{
+	auto iter = textureLayers.find(_texID);
+	if (iter != textureLayers.end())
+	{
+		_layer = iter->second;
+		return true;
+	}
+	if (!glIsTexture(_texID))
+		return false;
+
+	// layer size depends on level 0, even if only a smaller mip is available now
+	int width = 0, height = 0;
+	glGetTextureLevelParameteriv(_texID, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(_texID, 0, GL_TEXTURE_HEIGHT, &height);
+	if (width <= 0 || height <= 0)
+		return false;
+	int size = GetLayerSize(width, height);
+
+	int arrayIndex = FindOrCreateArray(size);
+	if (arrayIndex < 0)
+		return false;
+	TextureArray& array = arrays[arrayIndex];
+	int layer;
+	if (!array.freeLayers.empty())
+	{
+		layer = array.freeLayers.back();
+		array.freeLayers.pop_back();
+	}
+	else
+	{
+		layer = array.layerUsed++;
+		ReserveLayers(array, array.layerUsed);
+	}
+
+	if (!UploadLayer(_texID, glm::ivec2(arrayIndex, layer)))
+	{
+		array.freeLayers.push_back(layer);
+		return false;
+	}
+	_layer = glm::ivec2(arrayIndex, layer);
+	textureLayers[_texID] = _layer;
+	return true;
+}
+
+void TextureArrayManager::RefreshTexture(const GLuint& _texID)
+{
+	auto iter = textureLayers.find(_texID);
+	if (iter == textureLayers.end())
+		return;
+	UploadLayer(_texID, iter->second);
+}
+
+void TextureArrayManager::ReleaseTexture(const GLuint& _texID)
+{
+	auto iter = textureLayers.find(_texID);
+	if (iter == textureLayers.end())
+		return;
+	arrays[iter->second.x].freeLayers.push_back(iter->second.y);
+	textureLayers.erase(iter);
+}
+
+bool TextureArrayManager::GetTextureLayer(const GLuint& _texID, glm::ivec2& _layer) const
+{
+	auto iter = textureLayers.find(_texID);
+	if (iter == textureLayers.end())
+		return false;
+	_layer = iter->second;
+	return true;
+}
+
+void TextureArrayManager::BindArrays(const shared_ptr<ShaderProgram>& _shaderPro, const std::string& _name, GLuint& _texUnit) const
+{
+	// every sampler must be bound to its own unit, even if the array doesn't exist(samplers of different types can't share one unit)
+	for (int i = 0; i < maxArrayNum; i++)
+	{
+		glBindTextureUnit(_texUnit, i < static_cast<int>(arrays.size()) ? arrays[i].texID : 0);
+		_shaderPro->Set(_name + "[" + std::to_string(i) + "]", static_cast<int>(_texUnit));
+		_texUnit++;
+	}
+}
+
+int TextureArrayManager::GetArrayNum() const { return static_cast<int>(arrays.size()); }
+GLuint TextureArrayManager::GetArrayTexture(const int& _arrayIndex) const { return _arrayIndex >= 0 && _arrayIndex < static_cast<int>(arrays.size()) ? arrays[_arrayIndex].texID : 0; }
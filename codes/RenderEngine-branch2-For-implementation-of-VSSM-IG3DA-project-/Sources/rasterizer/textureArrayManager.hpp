@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../shadermgr/shaderProgram.hpp"
+
+namespace IceRender
+{
+	/*
+	* Albedo textures packed into GL_TEXTURE_2D_ARRAY layers, so that a shader can sample any material's albedo without rebinding textures between draws.
+	* - all layers are RGBA8 and square, one texture array per layer size(256, 512, 1024 or 2048)
+	* - a texture is resampled into the smallest layer size which is not less than its width and height(clamped).
+	*   It is done on GPU by "TextureArray/copyLayer.cs"(no readback), streamed textures are resampled by TextureStreamer workers and uploaded by it.
+	* - mipmaps are generated per layer through a single-layer texture view, other layers are untouched
+	* - each texture is referenced by (array index, layer), (-1, -1) means no texture
+	* [Note] arrays grow by copying existing layers into a larger array, it only happens while loading textures.
+	*/
+	class TextureArrayManager
+	{
+	private:
+		struct TextureArray
+		{
+			GLuint texID;
+			int size; // width and height of each layer
+			int levels; // mipmap levels
+			int layerCapacity;
+			int layerUsed;
+			std::vector<int> freeLayers; // released layers, reused first
+		};
+		std::vector<TextureArray> arrays; // index is the array index referenced by materials
+		std::map<GLuint, glm::ivec2> textureLayers; // 2D texture -> (array index, layer), each 2D texture is packed only once
+
+		int FindOrCreateArray(const int& _size);
+		void ReserveLayers(TextureArray& _array, const int& _layerNum); // grow array and keep its layers
+		bool UploadLayer(const GLuint& _texID, const glm::ivec2& _layer); // copy the base level of "_texID" into the layer
+
+	public:
+		static const int maxArrayNum = 4; // same as "maxAlbedoArrayNum" in shaders
+		static const int minLayerSize = 256;
+		static const int maxLayerSize = 2048;
+
+		static int GetLayerSize(const int& _width, const int& _height); // layer size of a texture whose level 0 is "_width" x "_height"
+		static std::vector<unsigned char> Resample(const std::vector<unsigned char>& _src, const int& _width, const int& _height, const int& _size); // bilinear, RGBA8, thread-safe
+
+		TextureArrayManager();
+		~TextureArrayManager();
+
+		void Clear();
+
+		// pack the base level of 2D texture "_texID" into a layer, return false if it fails. Calling it again with the same texture returns the same layer.
+		bool AddTexture(const GLuint& _texID, glm::ivec2& _layer);
+		void RefreshTexture(const GLuint& _texID); // copy it into its layer again after its content changes(e.g. streamed in), do nothing if it is not packed
+		void ReleaseTexture(const GLuint& _texID); // the layer can be reused by other textures
+		bool GetTextureLayer(const GLuint& _texID, glm::ivec2& _layer) const; // false if it is not packed
+		void GenerateLayerMipmap(const glm::ivec2& _layer); // after level 0 of the layer changes, only this layer is regenerated
+
+		// bind all arrays from "_texUnit"(then increase it) and set sampler array "_name" of shader. Units of missing arrays are bound to 0.
+		void BindArrays(const shared_ptr<ShaderProgram>& _shaderPro, const std::string& _name, GLuint& _texUnit) const;
+
+		int GetArrayNum() const;
+		GLuint GetArrayTexture(const int& _arrayIndex) const;
+	};
+}
@@ -0,0 +1,376 @@
+#include "textureStreamer.hpp"
+#include "textureArrayManager.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include <stb_image.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace IceRender;
+
+TextureStreamer::TextureStreamer() : stopWorkers(false), nextRequestID(0), ringBuffer(0), ringPtr(nullptr), segmentFences{}, currentSegment(0),
+	uploadBudget(4 * 1024 * 1024) {}
+
+TextureStreamer::~TextureStreamer() { Clear(); }
+
+void TextureStreamer::Init()
+{
+	Clear();
+	CreateRing();
+	StartWorkers();
+}
+
+void TextureStreamer::Clear()
+{
+	StopWorkers();
+	decodeJobs.clear();
+	decodedJobs.clear();
+	uploadJobs.clear();
+	pendingTextures.clear();
+	DeleteRing();
+}
+
+#pragma region worker threads
+void TextureStreamer::StartWorkers()
+{
+	stopWorkers = false;
+	int workerNum = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1, 4);
+	for (int i = 0; i < workerNum; i++)
+		workers.emplace_back(&TextureStreamer::WorkerLoop, this);
+}
+
+void TextureStreamer::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopWorkers = true;
+	}
+	jobCondition.notify_all();
+	for (auto& worker : workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	workers.clear();
+}
+
+void TextureStreamer::WorkerLoop()
+{
+	// [Note] the flag of stb_image is global by default, use the thread-local one so workers don't affect Utility::Load2DTexture
+	stbi_set_flip_vertically_on_load_thread(true); // it enables to load an image as OpenGL expects
+	while (true)
+	{
+		DecodeJob job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobCondition.wait(lock, [this]() { return stopWorkers || !decodeJobs.empty(); });
+			if (stopWorkers)
+				return;
+			job = decodeJobs.front();
+			decodeJobs.pop_front();
+		}
+
+		UploadJob upload;
+		upload.texID = job.texID;
+		upload.requestID = job.requestID;
+		upload.fileName = job.fileName;
+		Decode(upload);
+
+		std::lock_guard<std::mutex> lock(jobMutex);
+		decodedJobs.push_back(std::move(upload));
+	}
+}
+
+void TextureStreamer::Decode(UploadJob& _job) const
+{
+	_job.failed = true;
+	_job.placeholderUploaded = false;
+	_job.uploadedRows = 0;
+	_job.layer = glm::ivec2(-1);
+	_job.uploadedLayerRows = 0;
+
+	int width, height, channel;
+	std::string total = GLOBAL.imagePathPrefix + _job.fileName;
+	unsigned char* data = stbi_load(total.c_str(), &width, &height, &channel, 4); // always RGBA
+	if (data == nullptr)
+		return;
+	_job.width = width;
+	_job.height = height;
+	_job.pixels.assign(data, data + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(data);
+
+	// placeholder is the first mip no larger than 16x16, box filtered from level 0
+	const int maxPlaceholderSize = 16;
+	_job.placeholderLevel = 0;
+	while (std::max(width >> _job.placeholderLevel, height >> _job.placeholderLevel) > maxPlaceholderSize)
+		_job.placeholderLevel++;
+	int pw = std::max(width >> _job.placeholderLevel, 1);
+	int ph = std::max(height >> _job.placeholderLevel, 1);
+	_job.placeholderWidth = pw;
+	_job.placeholderHeight = ph;
+	_job.placeholder.resize(static_cast<size_t>(pw) * ph * 4);
+	for (int y = 0; y < ph; y++)
+	{
+		int y0 = y * height / ph, y1 = std::max((y + 1) * height / ph, y0 + 1);
+		for (int x = 0; x < pw; x++)
+		{
+			int x0 = x * width / pw, x1 = std::max((x + 1) * width / pw, x0 + 1);
+			unsigned int sum[4] = { 0, 0, 0, 0 };
+			for (int sy = y0; sy < y1; sy++)
+			{
+				for (int sx = x0; sx < x1; sx++)
+				{
+					for (int c = 0; c < 4; c++)
+						sum[c] += _job.pixels[(static_cast<size_t>(sy) * width + sx) * 4 + c];
+				}
+			}
+			unsigned int count = (y1 - y0) * (x1 - x0);
+			for (int c = 0; c < 4; c++)
+				_job.placeholder[(static_cast<size_t>(y) * pw + x) * 4 + c] = static_cast<unsigned char>(sum[c] / count);
+		}
+	}
+
+	// texture array layers are square, resample here so that the render thread only copies rows if the texture is packed
+	_job.layerSize = TextureArrayManager::GetLayerSize(width, height);
+	if (width != _job.layerSize || height != _job.layerSize)
+		_job.layerPixels = TextureArrayManager::Resample(_job.pixels, width, height, _job.layerSize);
+	_job.failed = false;
+}
+#pragma endregion
+
+#pragma region PBO ring
+void TextureStreamer::CreateRing()
+{
+	// persistently mapped and coherent, CPU writes are visible to the following upload commands without unmapping
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	size_t ringSize = uploadBudget * ringSegmentNum;
+	glCreateBuffers(1, &ringBuffer);
+	glNamedBufferStorage(ringBuffer, ringSize, NULL, flags);
+	ringPtr = static_cast<unsigned char*>(glMapNamedBufferRange(ringBuffer, 0, ringSize, flags));
+	for (auto& fence : segmentFences)
+		fence = 0;
+	currentSegment = 0;
+	if (CheckGLError() || ringPtr == nullptr) { Print("Error in TextureStreamer::CreateRing."); return; }
+}
+
+void TextureStreamer::DeleteRing()
+{
+	for (auto& fence : segmentFences)
+	{
+		if (fence != 0 && glIsSync(fence))
+			glDeleteSync(fence);
+		fence = 0;
+	}
+	if (ringBuffer != 0 && glIsBuffer(ringBuffer))
+	{
+		glUnmapNamedBuffer(ringBuffer);
+		glDeleteBuffers(1, &ringBuffer);
+	}
+	ringBuffer = 0;
+	ringPtr = nullptr;
+}
+#pragma endregion
+
+GLuint TextureStreamer::Request(const std::string& _fileName)
+{
+	// only the header is read here, decoding is done by workers
+	int width, height, channel;
+	std::string total = GLOBAL.imagePathPrefix + _fileName;
+	if (!stbi_info(total.c_str(), &width, &height, &channel))
+	{
+		Print("[Error] Can not open file " + _fileName + " to load texture, reason: " + stbi_failure_reason());
+		return 0;
+	}
+
+	int levels = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2)
+		levels++;
+
+	GLuint texID;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texID);
+	glTextureStorage2D(texID, levels, GL_RGBA8, width, height);
+	glTextureParameteri(texID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(texID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(texID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(texID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// grey 1x1 mip until the placeholder is decoded
+	const unsigned char grey[] = { 128, 128, 128, 255 };
+	glTextureSubImage2D(texID, levels - 1, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	glTextureParameteri(texID, GL_TEXTURE_BASE_LEVEL, levels - 1);
+	if (CheckGLError()) { Print("Error in TextureStreamer::Request."); return texID; }
+
+	unsigned int requestID = nextRequestID++;
+	pendingTextures[texID] = requestID;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		decodeJobs.push_back({ texID, requestID, _fileName });
+	}
+	jobCondition.notify_one();
+	return texID;
+}
+
+void TextureStreamer::Cancel(const GLuint& _texID)
+{
+	if (pendingTextures.erase(_texID) == 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		decodeJobs.erase(std::remove_if(decodeJobs.begin(), decodeJobs.end(), [&](const DecodeJob& _job) { return _job.texID == _texID; }), decodeJobs.end());
+	}
+	// the one being decoded becomes stale, it is dropped in Update()
+	uploadJobs.remove_if([&](const UploadJob& _job) { return _job.texID == _texID; });
+}
+
+bool TextureStreamer::IsStale(const UploadJob& _job) const
+{
+	auto iter = pendingTextures.find(_job.texID);
+	return iter == pendingTextures.end() || iter->second != _job.requestID;
+}
+
+void TextureStreamer::Update()
+{
+	// (1) collect decoded images
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		while (!decodedJobs.empty())
+		{
+			uploadJobs.push_back(std::move(decodedJobs.front()));
+			decodedJobs.pop_front();
+		}
+	}
+	if (uploadJobs.empty())
+		return;
+
+	// (2) placeholders are tiny(at most 16x16), upload all of them at once so every decoded texture shows something close to its final look
+	for (auto iter = uploadJobs.begin(); iter != uploadJobs.end();)
+	{
+		if (IsStale(*iter))
+		{
+			iter = uploadJobs.erase(iter);
+			continue;
+		}
+		if (iter->failed)
+		{
+			Print("[Error] Can not decode file " + iter->fileName + ", keep its placeholder.");
+			pendingTextures.erase(iter->texID);
+			iter = uploadJobs.erase(iter);
+			continue;
+		}
+		if (!iter->placeholderUploaded)
+		{
+			glTextureSubImage2D(iter->texID, iter->placeholderLevel, 0, 0, iter->placeholderWidth, iter->placeholderHeight, GL_RGBA, GL_UNSIGNED_BYTE, iter->placeholder.data());
+			glTextureParameteri(iter->texID, GL_TEXTURE_BASE_LEVEL, iter->placeholderLevel);
+			glTextureParameteri(iter->texID, GL_TEXTURE_MAX_LEVEL, iter->placeholderLevel); // mips below it are not ready
+			iter->placeholder.clear();
+			iter->placeholderUploaded = true;
+			if (GLOBAL.render != nullptr)
+				GLOBAL.render->GetTextureArrayManager()->RefreshTexture(iter->texID); // if it is already packed with the grey mip, resampled on GPU
+		}
+		iter++;
+	}
+	if (uploadJobs.empty() || ringPtr == nullptr)
+		return;
+
+	// (3) rows of level 0 within budget. Skip this frame if GPU is still reading the segment(never wait).
+	GLsync& fence = segmentFences[currentSegment];
+	if (fence != 0)
+	{
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			return;
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	// [Note] one row always fits into one segment, the minimal budget(256KB) is larger than one row of the maximal texture size
+	std::shared_ptr<TextureArrayManager> arrayMgr = GLOBAL.render != nullptr ? GLOBAL.render->GetTextureArrayManager() : nullptr;
+	size_t segmentOffset = currentSegment * uploadBudget;
+	size_t used = 0;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ringBuffer);
+	while (!uploadJobs.empty())
+	{
+		UploadJob& job = uploadJobs.front();
+		if (job.uploadedRows < job.height)
+		{
+			size_t rowBytes = static_cast<size_t>(job.width) * 4;
+			int rows = static_cast<int>(std::min(static_cast<size_t>(job.height - job.uploadedRows), (uploadBudget - used) / rowBytes));
+			if (rows <= 0)
+				break;
+			memcpy(ringPtr + segmentOffset + used, job.pixels.data() + job.uploadedRows * rowBytes, rows * rowBytes);
+			glTextureSubImage2D(job.texID, 0, 0, job.uploadedRows, job.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)(segmentOffset + used)); // offset in PBO
+			used += rows * rowBytes;
+			job.uploadedRows += rows;
+			if (job.uploadedRows == job.height)
+			{
+				FinishLevelZero(job);
+				if (!job.layerPixels.empty())
+					job.pixels = std::vector<unsigned char>(); // only the layer is uploaded from now on
+			}
+			continue;
+		}
+
+		// then level 0 of its layer, if it is packed. The layer is looked up again each frame, it can be released or moved to a grown array meanwhile.
+		glm::ivec2 layer;
+		if (arrayMgr == nullptr || !arrayMgr->GetTextureLayer(job.texID, layer))
+		{
+			Finish(job);
+			uploadJobs.pop_front();
+			continue;
+		}
+		if (layer != job.layer)
+		{
+			job.layer = layer;
+			job.uploadedLayerRows = 0;
+		}
+		const std::vector<unsigned char>& layerPixels = job.layerPixels.empty() ? job.pixels : job.layerPixels;
+		size_t rowBytes = static_cast<size_t>(job.layerSize) * 4;
+		int rows = static_cast<int>(std::min(static_cast<size_t>(job.layerSize - job.uploadedLayerRows), (uploadBudget - used) / rowBytes));
+		if (rows <= 0)
+			break;
+		memcpy(ringPtr + segmentOffset + used, layerPixels.data() + job.uploadedLayerRows * rowBytes, rows * rowBytes);
+		glTextureSubImage3D(arrayMgr->GetArrayTexture(layer.x), 0, 0, job.uploadedLayerRows, layer.y, job.layerSize, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)(segmentOffset + used));
+		used += rows * rowBytes;
+		job.uploadedLayerRows += rows;
+		if (job.uploadedLayerRows == job.layerSize)
+		{
+			arrayMgr->GenerateLayerMipmap(layer);
+			Finish(job);
+			uploadJobs.pop_front();
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (used > 0)
+	{
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		currentSegment = (currentSegment + 1) % ringSegmentNum;
+	}
+	if (CheckGLError()) { Print("Error in TextureStreamer::Update."); return; }
+}
+
+void TextureStreamer::FinishLevelZero(const UploadJob& _job)
+{
+	// level 0 is complete, generate the others on GPU and show all of them
+	glTextureParameteri(_job.texID, GL_TEXTURE_BASE_LEVEL, 0);
+	glTextureParameteri(_job.texID, GL_TEXTURE_MAX_LEVEL, 1000); // default value
+	glGenerateTextureMipmap(_job.texID);
+}
+
+void TextureStreamer::Finish(const UploadJob& _job)
+{
+	// [Note] if the texture is packed after this, TextureArrayManager copies the full resolution from the texture itself
+	pendingTextures.erase(_job.texID);
+}
+
+bool TextureStreamer::IsPending(const GLuint& _texID) const { return pendingTextures.find(_texID) != pendingTextures.end(); }
+int TextureStreamer::GetPendingNum() const { return static_cast<int>(pendingTextures.size()); }
+
+size_t TextureStreamer::GetUploadBudget() const { return uploadBudget; }
+void TextureStreamer::SetUploadBudget(const size_t& _bytes)
+{
+	uploadBudget = std::max(_bytes, static_cast<size_t>(256 * 1024));
+	if (ringBuffer == 0)
+		return;
+	// offsets of the uploading jobs don't depend on the ring, just recreate it
+	DeleteRing();
+	CreateRing();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace IceRender
+{
+	/*
+	* Texture streaming without blocking the render thread:
+	* - Request() only reads the image header, creates the texture(RGBA8, full mipmap chain) and returns it at once. A grey 1x1 mip is shown first.
+	* - worker threads decode images(stb_image), downsample a small placeholder mip(no larger than 16x16) and resample level 0 to its texture array layer size
+	* - Update()(once per frame on render thread) uploads the placeholder, then rows of level 0 through a persistently mapped PBO ring.
+	*   Each frame writes at most "uploadBudget" bytes into one ring segment, segments are protected by fences and a busy segment is skipped(never waits).
+	* - after level 0 is complete, mipmaps are generated and the texture shows the full resolution.
+	* - if the texture is packed into a texture array(see TextureArrayManager), rows of its layer follow through the same ring and budget,
+	*   then mipmaps of that layer only are generated.
+	* [Note] GL_TEXTURE_BASE_LEVEL/MAX_LEVEL select the mip being shown, the texture ID never changes so materials can use it right away.
+	*/
+	class TextureStreamer
+	{
+	private:
+		struct DecodeJob
+		{
+			GLuint texID;
+			unsigned int requestID; // texture ID can be reused after deleting, request ID tells whether a job is stale
+			std::string fileName;
+		};
+
+		struct UploadJob
+		{
+			GLuint texID;
+			unsigned int requestID;
+			std::string fileName;
+			int width, height;
+			std::vector<unsigned char> pixels; // RGBA8 of level 0
+			int placeholderLevel;
+			int placeholderWidth, placeholderHeight;
+			std::vector<unsigned char> placeholder; // RGBA8 of "placeholderLevel"
+			bool failed; // decoding failed, keep the grey mip
+			bool placeholderUploaded;
+			int uploadedRows; // rows of level 0 already uploaded
+			int layerSize; // see TextureArrayManager::GetLayerSize
+			std::vector<unsigned char> layerPixels; // RGBA8 of level 0 resampled to "layerSize", empty if "pixels" already has that size
+			glm::ivec2 layer; // layer being uploaded, (-1, -1) if none
+			int uploadedLayerRows;
+		};
+
+		/*worker threads*/
+		std::vector<std::thread> workers;
+		std::mutex jobMutex;
+		std::condition_variable jobCondition;
+		std::deque<DecodeJob> decodeJobs;
+		std::deque<UploadJob> decodedJobs; // produced by workers, consumed by Update()
+		bool stopWorkers;
+
+		std::list<UploadJob> uploadJobs; // owned by render thread, uploaded in order
+		std::map<GLuint, unsigned int> pendingTextures; // requested but not fully uploaded, texture -> request ID
+		unsigned int nextRequestID;
+
+		/*PBO ring*/
+		GLuint ringBuffer;
+		unsigned char* ringPtr; // persistently mapped
+		static const int ringSegmentNum = 3;
+		GLsync segmentFences[ringSegmentNum];
+		int currentSegment;
+		size_t uploadBudget; // in bytes per frame, also the size of one ring segment
+
+		void StartWorkers();
+		void StopWorkers();
+		void WorkerLoop();
+		void Decode(UploadJob& _job) const; // run on worker threads
+
+		void CreateRing();
+		void DeleteRing();
+
+		bool IsStale(const UploadJob& _job) const; // cancelled after decoding
+		void FinishLevelZero(const UploadJob& _job); // generate mipmaps and show the full resolution
+		void Finish(const UploadJob& _job); // level 0 and its array layer(if it is packed) are uploaded
+
+	public:
+		TextureStreamer();
+		~TextureStreamer();
+
+		void Init(); // must be called after OpenGL context is created
+		void Clear();
+
+		// create the texture and decode it in background, return 0 if the file is not a readable image. Texture parameters are the same as Utility::Load2DTexture(default setting).
+		GLuint Request(const std::string& _fileName);
+		void Cancel(const GLuint& _texID); // stop streaming into it, call it before deleting a pending texture
+
+		void Update(); // upload decoded images within budget, call it once per frame
+
+		bool IsPending(const GLuint& _texID) const; // full resolution is not uploaded yet
+		int GetPendingNum() const;
+
+		size_t GetUploadBudget() const;
+		void SetUploadBudget(const size_t& _bytes); // at least 256KB
+	};
+}
@@ -0,0 +1,331 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <limits>
+
+using namespace IceRender;
+
+namespace
+{
+	const int traversalStackSize = 64;
+
+	float SurfaceArea(const glm::vec3& _boundMin, const glm::vec3& _boundMax)
+	{
+		glm::vec3 size = _boundMax - _boundMin;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+}
+
+#pragma region build
+void BVH::Build(const std::vector<glm::vec3>& _positions)
+{
+	Clear();
+	int triNum = static_cast<int>(_positions.size() / 3);
+	if (triNum == 0)
+		return;
+
+	std::vector<BuildItem> items(triNum);
+	std::vector<int> indices(triNum);
+	for (int i = 0; i < triNum; i++)
+	{
+		const glm::vec3* v = &_positions[i * 3];
+		items[i].boundMin = glm::min(v[0], glm::min(v[1], v[2]));
+		items[i].boundMax = glm::max(v[0], glm::max(v[1], v[2]));
+		items[i].centroid = (items[i].boundMin + items[i].boundMax) * 0.5f;
+		indices[i] = i;
+	}
+
+	nodes.reserve(triNum * 2);
+	Node root;
+	root.leftFirst = 0;
+	root.count = triNum;
+	root.axis = 0;
+	UpdateBounds(root, indices, items);
+	nodes.push_back(root);
+
+	// split nodes from top to bottom, "buildStack" holds (node index, depth)
+	std::vector<glm::ivec2> buildStack;
+	buildStack.push_back(glm::ivec2(0, 0));
+	while (!buildStack.empty())
+	{
+		glm::ivec2 task = buildStack.back();
+		buildStack.pop_back();
+		Node node = nodes[task.x]; // copy, "nodes" grows below
+		if (node.count <= 2 || task.y >= maxDepth)
+			continue;
+
+		int first = node.leftFirst, end = node.leftFirst + node.count;
+		int axis, splitBin;
+		float binMin, binScale;
+		int mid;
+		if (FindSplit(node, indices, items, axis, splitBin, binMin, binScale))
+		{
+			auto IsLeft = [&](const int& _index)
+			{
+				int bin = std::min(binNum - 1, static_cast<int>((items[_index].centroid[axis] - binMin) * binScale));
+				return bin <= splitBin;
+			};
+			mid = static_cast<int>(std::partition(indices.begin() + first, indices.begin() + end, IsLeft) - indices.begin());
+		}
+		else if (node.count > maxLeafSize)
+		{
+			// too many triangles with (almost) the same centroid, split by median
+			glm::vec3 centroidMin(std::numeric_limits<float>::max()), centroidMax(-std::numeric_limits<float>::max());
+			for (int i = first; i < end; i++)
+			{
+				centroidMin = glm::min(centroidMin, items[indices[i]].centroid);
+				centroidMax = glm::max(centroidMax, items[indices[i]].centroid);
+			}
+			glm::vec3 extent = centroidMax - centroidMin;
+			axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+			mid = first + node.count / 2;
+			std::nth_element(indices.begin() + first, indices.begin() + mid, indices.begin() + end,
+				[&](const int& _a, const int& _b) { return items[_a].centroid[axis] < items[_b].centroid[axis]; });
+		}
+		else
+			continue;
+		if (mid == first || mid == end)
+			continue;
+
+		Node left, right;
+		left.leftFirst = first;
+		left.count = mid - first;
+		left.axis = 0;
+		right.leftFirst = mid;
+		right.count = end - mid;
+		right.axis = 0;
+		UpdateBounds(left, indices, items);
+		UpdateBounds(right, indices, items);
+		int leftIndex = static_cast<int>(nodes.size());
+		nodes.push_back(left);
+		nodes.push_back(right);
+		nodes[task.x].leftFirst = leftIndex;
+		nodes[task.x].count = 0;
+		nodes[task.x].axis = axis;
+		buildStack.push_back(glm::ivec2(leftIndex, task.y + 1));
+		buildStack.push_back(glm::ivec2(leftIndex + 1, task.y + 1));
+	}
+
+	// store triangles in leaf order, so a leaf reads a continuous range
+	triangles.resize(triNum);
+	for (int i = 0; i < triNum; i++)
+	{
+		const glm::vec3* v = &_positions[indices[i] * 3];
+		triangles[i].v0 = v[0];
+		triangles[i].e1 = v[1] - v[0];
+		triangles[i].e2 = v[2] - v[0];
+		triangles[i].id = indices[i];
+	}
+}
+
+void BVH::Clear()
+{
+	nodes.clear();
+	triangles.clear();
+}
+
+void BVH::UpdateBounds(Node& _node, const std::vector<int>& _indices, const std::vector<BuildItem>& _items) const
+{
+	_node.boundMin = glm::vec3(std::numeric_limits<float>::max());
+	_node.boundMax = glm::vec3(-std::numeric_limits<float>::max());
+	for (int i = _node.leftFirst; i < _node.leftFirst + _node.count; i++)
+	{
+		_node.boundMin = glm::min(_node.boundMin, _items[_indices[i]].boundMin);
+		_node.boundMax = glm::max(_node.boundMax, _items[_indices[i]].boundMax);
+	}
+}
+
+bool BVH::FindSplit(const Node& _node, const std::vector<int>& _indices, const std::vector<BuildItem>& _items, int& _axis, int& _splitBin, float& _binMin, float& _binScale) const
+{
+	int first = _node.leftFirst, end = _node.leftFirst + _node.count;
+	glm::vec3 centroidMin(std::numeric_limits<float>::max()), centroidMax(-std::numeric_limits<float>::max());
+	for (int i = first; i < end; i++)
+	{
+		centroidMin = glm::min(centroidMin, _items[_indices[i]].centroid);
+		centroidMax = glm::max(centroidMax, _items[_indices[i]].centroid);
+	}
+
+	// cost of intersecting one triangle and traversing one node are both 1
+	float bestCost = _node.count * SurfaceArea(_node.boundMin, _node.boundMax); // leaf cost
+	bool found = false;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0)
+			continue;
+		float scale = binNum / extent;
+
+		int binCount[binNum] = {};
+		glm::vec3 binBoundMin[binNum], binBoundMax[binNum];
+		std::fill(binBoundMin, binBoundMin + binNum, glm::vec3(std::numeric_limits<float>::max()));
+		std::fill(binBoundMax, binBoundMax + binNum, glm::vec3(-std::numeric_limits<float>::max()));
+		for (int i = first; i < end; i++)
+		{
+			const BuildItem& item = _items[_indices[i]];
+			int bin = std::min(binNum - 1, static_cast<int>((item.centroid[axis] - centroidMin[axis]) * scale));
+			binCount[bin]++;
+			binBoundMin[bin] = glm::min(binBoundMin[bin], item.boundMin);
+			binBoundMax[bin] = glm::max(binBoundMax[bin], item.boundMax);
+		}
+
+		// sweep from right to get area*count of right side for each boundary, then from left
+		float rightCost[binNum];
+		glm::vec3 sweepMin(std::numeric_limits<float>::max()), sweepMax(-std::numeric_limits<float>::max());
+		int sweepCount = 0;
+		for (int i = binNum - 1; i > 0; i--)
+		{
+			sweepCount += binCount[i];
+			sweepMin = glm::min(sweepMin, binBoundMin[i]);
+			sweepMax = glm::max(sweepMax, binBoundMax[i]);
+			rightCost[i - 1] = sweepCount > 0 ? sweepCount * SurfaceArea(sweepMin, sweepMax) : -1;
+		}
+		sweepMin = glm::vec3(std::numeric_limits<float>::max());
+		sweepMax = glm::vec3(-std::numeric_limits<float>::max());
+		sweepCount = 0;
+		for (int i = 0; i < binNum - 1; i++)
+		{
+			sweepCount += binCount[i];
+			sweepMin = glm::min(sweepMin, binBoundMin[i]);
+			sweepMax = glm::max(sweepMax, binBoundMax[i]);
+			if (sweepCount == 0 || rightCost[i] < 0)
+				continue;
+			float cost = SurfaceArea(_node.boundMin, _node.boundMax) + sweepCount * SurfaceArea(sweepMin, sweepMax) + rightCost[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				found = true;
+				_axis = axis;
+				_splitBin = i;
+				_binMin = centroidMin[axis];
+				_binScale = scale;
+			}
+		}
+	}
+	return found;
+}
+#pragma endregion
+
+#pragma region traversal
+Float4 BVH::IntersectBox(const Node& _node, const RayPacket& _packet, const Float4& _laneMask) const
+{
+	// slab test
+	Float4 tNear(0), tFar = _packet.tMax;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		Float4 t1 = (Float4(_node.boundMin[axis]) - _packet.origin[axis]) * _packet.invDirection[axis];
+		Float4 t2 = (Float4(_node.boundMax[axis]) - _packet.origin[axis]) * _packet.invDirection[axis];
+		tNear = Max(tNear, Min(t1, t2));
+		tFar = Min(tFar, Max(t1, t2));
+	}
+	return (tNear <= tFar) & _laneMask;
+}
+
+Float4 BVH::IntersectTriangle(const Triangle& _tri, const RayPacket& _packet, const Float4& _laneMask, Float4& _t, Float4& _u, Float4& _v) const
+{
+	// refer: "Fast, Minimum Storage Ray/Triangle Intersection, Moller and Trumbore, 1997"
+	const Float4* d = _packet.direction;
+	Float4 e1[3] = { Float4(_tri.e1.x), Float4(_tri.e1.y), Float4(_tri.e1.z) };
+	Float4 e2[3] = { Float4(_tri.e2.x), Float4(_tri.e2.y), Float4(_tri.e2.z) };
+	Float4 p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+	Float4 det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+	Float4 invDet = Float4(1.0f) / det;
+	Float4 s[3] = { _packet.origin[0] - Float4(_tri.v0.x), _packet.origin[1] - Float4(_tri.v0.y), _packet.origin[2] - Float4(_tri.v0.z) };
+	_u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+	Float4 q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+	_v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+	_t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+
+	Float4 zero(0);
+	return _laneMask & (Abs(det) > zero) & (_u >= zero) & (_v >= zero) & ((_u + _v) <= Float4(1.0f)) & (_t > zero) & (_t < _packet.tMax);
+}
+
+void BVH::Intersect(RayPacket& _packet) const
+{
+	if (nodes.empty() || _packet.active.GetMask() == 0)
+		return;
+
+	// visit nearer child first, decided by direction of the first active ray
+	float direction[3][4];
+	for (int axis = 0; axis < 3; axis++)
+		_packet.direction[axis].Store(direction[axis]);
+	int firstLane = 0;
+	while (!(_packet.active.GetMask() & (1 << firstLane)))
+		firstLane++;
+
+	int stack[traversalStackSize];
+	int stackSize = 0;
+	int nodeIndex = 0;
+	while (true)
+	{
+		const Node& node = nodes[nodeIndex];
+		if (IntersectBox(node, _packet, _packet.active).GetMask() != 0)
+		{
+			if (node.count == 0)
+			{
+				bool leftFirst = direction[node.axis][firstLane] >= 0;
+				stack[stackSize++] = leftFirst ? node.leftFirst + 1 : node.leftFirst;
+				nodeIndex = leftFirst ? node.leftFirst : node.leftFirst + 1;
+				continue;
+			}
+			for (int i = node.leftFirst; i < node.leftFirst + node.count; i++)
+			{
+				Float4 t, u, v;
+				Float4 hit = IntersectTriangle(triangles[i], _packet, _packet.active, t, u, v);
+				int mask = hit.GetMask();
+				if (mask == 0)
+					continue;
+				_packet.tMax = Select(hit, t, _packet.tMax);
+				_packet.u = Select(hit, u, _packet.u);
+				_packet.v = Select(hit, v, _packet.v);
+				for (int lane = 0; lane < 4; lane++)
+				{
+					if (mask & (1 << lane))
+						_packet.triangleID[lane] = triangles[i].id;
+				}
+			}
+		}
+		if (stackSize == 0)
+			break;
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+void BVH::Occluded(RayPacket& _packet) const
+{
+	_packet.occluded = Float4(0);
+	Float4 remaining = _packet.active;
+	if (nodes.empty() || remaining.GetMask() == 0)
+		return;
+
+	int stack[traversalStackSize];
+	int stackSize = 0;
+	int nodeIndex = 0;
+	while (true)
+	{
+		const Node& node = nodes[nodeIndex];
+		if (IntersectBox(node, _packet, remaining).GetMask() != 0)
+		{
+			if (node.count == 0)
+			{
+				stack[stackSize++] = node.leftFirst + 1;
+				nodeIndex = node.leftFirst;
+				continue;
+			}
+			for (int i = node.leftFirst; i < node.leftFirst + node.count; i++)
+			{
+				Float4 t, u, v;
+				Float4 hit = IntersectTriangle(triangles[i], _packet, remaining, t, u, v);
+				_packet.occluded = _packet.occluded | hit;
+				remaining = AndNot(remaining, hit);
+			}
+			if (remaining.GetMask() == 0)
+				return; // all rays are blocked
+		}
+		if (stackSize == 0)
+			break;
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+int BVH::GetNodeNum() const { return static_cast<int>(nodes.size()); }
+int BVH::GetTriangleNum() const { return static_cast<int>(triangles.size()); }
+#pragma endregion
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "rayPacket.hpp"
+
+namespace IceRender
+{
+	/*
+	* Bounding volume hierarchy over triangles, built with binned SAH(surface area heuristic).
+	* refer: "On fast Construction of SAH-based Bounding Volume Hierarchies, Wald, 2007"
+	* Traversal is done per packet of 4 rays: a node is visited if any active ray hits its box.
+	*/
+	class BVH
+	{
+	public:
+		static const int binNum = 16;
+		static const int maxLeafSize = 16; // leaves are split by median if SAH prefers a bigger leaf
+		static const int maxDepth = 60; // must be less than traversal stack size
+
+	private:
+		struct Node
+		{
+			glm::vec3 boundMin;
+			int leftFirst; // left child index(right child is leftFirst+1) of inner node, or first triangle of leaf
+			glm::vec3 boundMax;
+			int count; // triangle number, 0 means inner node
+			int axis; // split axis of inner node, used to visit the nearer child first
+		};
+
+		struct Triangle
+		{
+			glm::vec3 v0, e1, e2; // e1 = v1 - v0, e2 = v2 - v0
+			int id; // index of input triangle
+		};
+
+		struct BuildItem
+		{
+			glm::vec3 boundMin, boundMax, centroid;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<Triangle> triangles; // in leaf order
+
+		void UpdateBounds(Node& _node, const std::vector<int>& _indices, const std::vector<BuildItem>& _items) const;
+		// find the best bin boundary, items with bin index <= "_splitBin" go to left child. Return false if leaf is cheaper.
+		bool FindSplit(const Node& _node, const std::vector<int>& _indices, const std::vector<BuildItem>& _items, int& _axis, int& _splitBin, float& _binMin, float& _binScale) const;
+		Float4 IntersectBox(const Node& _node, const RayPacket& _packet, const Float4& _laneMask) const;
+		// return mask of rays in "_laneMask" hitting "_tri" in (0, tMax), with distance and barycentric weights of vertex 1 and 2
+		Float4 IntersectTriangle(const Triangle& _tri, const RayPacket& _packet, const Float4& _laneMask, Float4& _t, Float4& _u, Float4& _v) const;
+
+	public:
+		// "_positions" contains 3 vertices per triangle
+		void Build(const std::vector<glm::vec3>& _positions);
+		void Clear();
+
+		// closest hit of active rays in (0, tMax), write tMax, u, v and triangleID of packet
+		void Intersect(RayPacket& _packet) const;
+		// any hit of active rays in (0, tMax), write occluded mask of packet
+		void Occluded(RayPacket& _packet) const;
+
+		int GetNodeNum() const;
+		int GetTriangleNum() const;
+	};
+}
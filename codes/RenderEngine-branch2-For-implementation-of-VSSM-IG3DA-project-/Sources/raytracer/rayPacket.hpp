@@ -0,0 +1,126 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define ICE_RAY_PACKET_SSE 1
+#else
+#define ICE_RAY_PACKET_SSE 0
+#endif
+
+namespace IceRender
+{
+	/*
+	* 4 floats computed together(SSE2, scalar fallback). Comparisons return masks in the same type(all bits of a lane are set if true).
+	*/
+	struct Float4
+	{
+#if ICE_RAY_PACKET_SSE
+		__m128 v;
+
+		Float4() : v(_mm_setzero_ps()) {}
+		Float4(const __m128& _v) : v(_v) {}
+		explicit Float4(const float& _f) : v(_mm_set1_ps(_f)) {}
+		Float4(const float& _a, const float& _b, const float& _c, const float& _d) : v(_mm_setr_ps(_a, _b, _c, _d)) {}
+
+		void Store(float* _out) const { _mm_storeu_ps(_out, v); }
+		int GetMask() const { return _mm_movemask_ps(v); } // bit i is set if lane i is true
+		static Float4 True() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+#else
+		float v[4];
+
+		Float4() { v[0] = v[1] = v[2] = v[3] = 0; }
+		explicit Float4(const float& _f) { v[0] = v[1] = v[2] = v[3] = _f; }
+		Float4(const float& _a, const float& _b, const float& _c, const float& _d) { v[0] = _a; v[1] = _b; v[2] = _c; v[3] = _d; }
+
+		void Store(float* _out) const { std::memcpy(_out, v, sizeof(v)); }
+		int GetMask() const
+		{
+			int mask = 0;
+			for (int i = 0; i < 4; i++)
+				mask |= (GetBits(i) >> 31) << i;
+			return mask;
+		}
+		static Float4 True() { Float4 r; for (int i = 0; i < 4; i++) r.SetBits(i, 0xffffffffu); return r; }
+
+		uint32_t GetBits(const int& _i) const { uint32_t b; std::memcpy(&b, &v[_i], 4); return b; }
+		void SetBits(const int& _i, const uint32_t& _b) { std::memcpy(&v[_i], &_b, 4); }
+#endif
+	};
+
+#if ICE_RAY_PACKET_SSE
+	inline Float4 operator+(const Float4& _a, const Float4& _b) { return _mm_add_ps(_a.v, _b.v); }
+	inline Float4 operator-(const Float4& _a, const Float4& _b) { return _mm_sub_ps(_a.v, _b.v); }
+	inline Float4 operator*(const Float4& _a, const Float4& _b) { return _mm_mul_ps(_a.v, _b.v); }
+	inline Float4 operator/(const Float4& _a, const Float4& _b) { return _mm_div_ps(_a.v, _b.v); }
+	inline Float4 operator<(const Float4& _a, const Float4& _b) { return _mm_cmplt_ps(_a.v, _b.v); }
+	inline Float4 operator>(const Float4& _a, const Float4& _b) { return _mm_cmpgt_ps(_a.v, _b.v); }
+	inline Float4 operator<=(const Float4& _a, const Float4& _b) { return _mm_cmple_ps(_a.v, _b.v); }
+	inline Float4 operator>=(const Float4& _a, const Float4& _b) { return _mm_cmpge_ps(_a.v, _b.v); }
+	inline Float4 operator&(const Float4& _a, const Float4& _b) { return _mm_and_ps(_a.v, _b.v); }
+	inline Float4 operator|(const Float4& _a, const Float4& _b) { return _mm_or_ps(_a.v, _b.v); }
+	inline Float4 AndNot(const Float4& _a, const Float4& _b) { return _mm_andnot_ps(_b.v, _a.v); } // _a & ~_b
+	inline Float4 Min(const Float4& _a, const Float4& _b) { return _mm_min_ps(_a.v, _b.v); }
+	inline Float4 Max(const Float4& _a, const Float4& _b) { return _mm_max_ps(_a.v, _b.v); }
+	inline Float4 Abs(const Float4& _a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), _a.v); }
+	inline Float4 Select(const Float4& _mask, const Float4& _a, const Float4& _b) { return _mm_or_ps(_mm_and_ps(_mask.v, _a.v), _mm_andnot_ps(_mask.v, _b.v)); } // _mask ? _a : _b
+#else
+#define ICE_FLOAT4_OP(_name, _expr) inline Float4 _name(const Float4& _a, const Float4& _b) { Float4 r; for (int i = 0; i < 4; i++) { float a = _a.v[i], b = _b.v[i]; r.v[i] = (_expr); } return r; }
+#define ICE_FLOAT4_CMP(_name, _op) inline Float4 _name(const Float4& _a, const Float4& _b) { Float4 r; for (int i = 0; i < 4; i++) r.SetBits(i, _a.v[i] _op _b.v[i] ? 0xffffffffu : 0); return r; }
+#define ICE_FLOAT4_BIT(_name, _op) inline Float4 _name(const Float4& _a, const Float4& _b) { Float4 r; for (int i = 0; i < 4; i++) r.SetBits(i, _a.GetBits(i) _op); return r; }
+	ICE_FLOAT4_OP(operator+, a + b)
+	ICE_FLOAT4_OP(operator-, a - b)
+	ICE_FLOAT4_OP(operator*, a * b)
+	ICE_FLOAT4_OP(operator/, a / b)
+	ICE_FLOAT4_OP(Min, a < b ? a : b)
+	ICE_FLOAT4_OP(Max, a > b ? a : b)
+	ICE_FLOAT4_CMP(operator<, <)
+	ICE_FLOAT4_CMP(operator>, >)
+	ICE_FLOAT4_CMP(operator<=, <=)
+	ICE_FLOAT4_CMP(operator>=, >=)
+	ICE_FLOAT4_BIT(operator&, & _b.GetBits(i))
+	ICE_FLOAT4_BIT(operator|, | _b.GetBits(i))
+	ICE_FLOAT4_BIT(AndNot, & ~_b.GetBits(i))
+#undef ICE_FLOAT4_OP
+#undef ICE_FLOAT4_CMP
+#undef ICE_FLOAT4_BIT
+	inline Float4 Abs(const Float4& _a) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = _a.v[i] < 0 ? -_a.v[i] : _a.v[i]; return r; }
+	inline Float4 Select(const Float4& _mask, const Float4& _a, const Float4& _b) { Float4 r; for (int i = 0; i < 4; i++) r.SetBits(i, (_mask.GetBits(i) & _a.GetBits(i)) | (~_mask.GetBits(i) & _b.GetBits(i))); return r; }
+#endif
+
+	/*
+	* 4 rays traversed together(packet traversal), lanes can have different origins and directions.
+	* Directions don't need to be normalized, "t" is measured in units of direction length.
+	*/
+	struct RayPacket
+	{
+		Float4 origin[3], direction[3];
+		Float4 invDirection[3];
+		Float4 tMax; // closest hit so far(Intersect), or end of segment(Occluded)
+		Float4 active; // lanes to trace
+		Float4 u, v; // barycentric weights of vertex 1 and 2 at hit
+		int triangleID[4]; // -1 means miss
+		Float4 occluded; // result of BVH::Occluded()
+
+		void Init(const glm::vec3 _origins[4], const glm::vec3 _directions[4], const float _tMax[4], const int& _activeMask);
+	};
+
+	inline void RayPacket::Init(const glm::vec3 _origins[4], const glm::vec3 _directions[4], const float _tMax[4], const int& _activeMask)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			origin[axis] = Float4(_origins[0][axis], _origins[1][axis], _origins[2][axis], _origins[3][axis]);
+			direction[axis] = Float4(_directions[0][axis], _directions[1][axis], _directions[2][axis], _directions[3][axis]);
+			invDirection[axis] = Float4(1.0f) / direction[axis];
+		}
+		tMax = Float4(_tMax[0], _tMax[1], _tMax[2], _tMax[3]);
+		active = Float4(0) < Float4((_activeMask & 1) ? 1.0f : 0.0f, (_activeMask & 2) ? 1.0f : 0.0f, (_activeMask & 4) ? 1.0f : 0.0f, (_activeMask & 8) ? 1.0f : 0.0f);
+		u = v = Float4(0);
+		occluded = Float4(0);
+		for (int i = 0; i < 4; i++)
+			triangleID[i] = -1;
+	}
+}
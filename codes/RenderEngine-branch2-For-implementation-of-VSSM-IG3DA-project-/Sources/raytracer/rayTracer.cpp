@@ -0,0 +1,476 @@
+#define _USE_MATH_DEFINES
+
+#include "rayTracer.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include "../light/pointLight.hpp"
+#include "../light/directLight.hpp"
+#include "../material/phongMaterial.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace IceRender;
+using namespace std;
+
+namespace
+{
+	const glm::vec3 clearColor(0.67f, 0.84f, 0.90f); // same as RenderPhong
+
+	// random number in [0, 1) from pixel and sample index, so the image is the same every frame
+	float Hash(const uint32_t& _x, const uint32_t& _y, const uint32_t& _s)
+	{
+		uint32_t h = (_x * 73856093u) ^ (_y * 19349663u) ^ (_s * 83492791u);
+		h ^= h >> 16;
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		h *= 0x846ca68bu;
+		h ^= h >> 16;
+		return (h & 0xffffffu) / 16777216.0f;
+	}
+}
+
+RayTracer::RayTracer() : threadNum(0), poolStarted(false), rayEpsilon(1e-4f), ambientLight(0), lightSampleNum(16), invViewProjMat(1), eyePos(0),
+	width(0), height(0), outputTex(0), outputWidth(0), outputHeight(0) {}
+
+RayTracer::~RayTracer() { Clear(); }
+
+void RayTracer::Clear()
+{
+	pool.Stop();
+	poolStarted = false;
+	if (outputTex != 0 && glIsTexture(outputTex))
+		glDeleteTextures(1, &outputTex);
+	outputTex = 0;
+	outputWidth = outputHeight = 0;
+	bvh.Clear();
+	triangleData.clear();
+	builtMeshes.clear();
+	builtModelMats.clear();
+	objects.clear();
+	textureCache.Clear();
+	lights.clear();
+}
+
+int RayTracer::GetThreadNum() const { return poolStarted ? pool.GetThreadNum() : 0; }
+
+void RayTracer::SetThreadNum(const int& _threadNum)
+{
+	threadNum = _threadNum;
+	if (poolStarted)
+		pool.Start(threadNum); // restart with new number
+}
+
+int RayTracer::GetLightSampleNum() const { return lightSampleNum; }
+
+void RayTracer::SetLightSampleNum(const int& _sampleNum)
+{
+	int gridSize = std::clamp(static_cast<int>(std::round(std::sqrt(static_cast<float>(_sampleNum)))), 1, 16);
+	lightSampleNum = gridSize * gridSize;
+}
+
+GLuint RayTracer::Render(const int& _width, const int& _height)
+{
+	const auto& pixels = RenderImage(_width, _height);
+	if (pixels.empty())
+		return 0;
+
+	if (outputWidth != _width || outputHeight != _height)
+	{
+		if (glIsTexture(outputTex))
+		{
+			GLOBAL.render->GetFullscreenPass()->ReleaseTexture(outputTex);
+			glDeleteTextures(1, &outputTex);
+		}
+		glCreateTextures(GL_TEXTURE_2D, 1, &outputTex);
+		glTextureStorage2D(outputTex, 1, GL_RGBA8, _width, _height);
+		glTextureParameteri(outputTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(outputTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(outputTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(outputTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		outputWidth = _width;
+		outputHeight = _height;
+	}
+	glTextureSubImage2D(outputTex, 0, 0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	if (CheckGLError()) { Print("Error in RayTracer::Render."); return 0; }
+	return outputTex;
+}
+
+const std::vector<unsigned char>& RayTracer::RenderImage(const int& _width, const int& _height)
+{
+	colorBuffer.clear();
+	if (_width <= 0 || _height <= 0)
+		return colorBuffer;
+	if (!poolStarted)
+	{
+		pool.Start(threadNum);
+		poolStarted = true;
+	}
+
+	auto camera = GLOBAL.camCtrller->GetActiveCamera();
+	glm::mat4 viewMat = camera->GetViewMatrix();
+	invViewProjMat = glm::inverse(camera->GetProjectionMatrix() * viewMat);
+	eyePos = glm::vec3(glm::inverse(viewMat)[3]);
+
+	PrepareScene();
+	PrepareLights();
+
+	width = _width;
+	height = _height;
+	colorBuffer.resize(static_cast<size_t>(_width) * _height * 4);
+	int tileNumX = (_width + tileSize - 1) / tileSize, tileNumY = (_height + tileSize - 1) / tileSize;
+	pool.ParallelFor(tileNumX * tileNumY, [&](const int& _tileIndex) { TraceTile(_tileIndex); });
+	return colorBuffer;
+}
+
+#pragma region scene data
+void RayTracer::PrepareScene()
+{
+	// objects in the same order as triangleData[i].objectIndex
+	std::vector<shared_ptr<SceneObject>> sceneObjs;
+	std::vector<shared_ptr<Mesh>> meshes;
+	std::vector<glm::mat4> modelMats;
+	for (auto& sceneObj : GLOBAL.sceneMgr->GetAllSceneObject())
+	{
+		auto mesh = sceneObj->GetMesh();
+		if (mesh == nullptr || mesh->GetElementCount(Mesh::MeshDataType::INDEX) == 0)
+			continue;
+		sceneObjs.push_back(sceneObj);
+		meshes.push_back(mesh);
+		modelMats.push_back(sceneObj->GetTransform()->ComputeTransformationMatrix());
+	}
+
+	if (meshes != builtMeshes || modelMats != builtModelMats)
+	{
+		std::vector<glm::vec3> positions;
+		triangleData.clear();
+		glm::vec3 sceneMin(std::numeric_limits<float>::max()), sceneMax(-std::numeric_limits<float>::max());
+		for (int i = 0; i < static_cast<int>(meshes.size()); i++)
+		{
+			auto& mesh = meshes[i];
+			auto material = sceneObjs[i]->GetMaterial();
+			glm::mat3 normalMat = glm::transpose(glm::inverse(glm::mat3(modelMats[i])));
+			const glm::vec3* meshPositions = static_cast<const glm::vec3*>(mesh->GetData(Mesh::MeshDataType::POS));
+			const glm::vec3* normals = static_cast<const glm::vec3*>(mesh->GetData(Mesh::MeshDataType::NORMAL));
+			const glm::uvec3* indices = static_cast<const glm::uvec3*>(mesh->GetData(Mesh::MeshDataType::INDEX));
+			size_t vertexNum = mesh->GetElementCount(Mesh::MeshDataType::POS);
+			size_t normalNum = mesh->GetElementCount(Mesh::MeshDataType::NORMAL);
+			const glm::vec2* uvs = nullptr;
+			if (material && material->GetUVDataSize() / sizeof(glm::vec2) >= vertexNum)
+				uvs = static_cast<const glm::vec2*>(material->GetUVData());
+
+			size_t triNum = mesh->GetElementCount(Mesh::MeshDataType::INDEX);
+			for (size_t t = 0; t < triNum; t++)
+			{
+				TriangleData data;
+				data.objectIndex = i;
+				glm::vec3 v[3];
+				for (int k = 0; k < 3; k++)
+				{
+					unsigned int index = indices[t][k];
+					v[k] = glm::vec3(modelMats[i] * glm::vec4(meshPositions[index], 1));
+					data.normal[k] = index < normalNum ? normalMat * normals[index] : glm::vec3(0);
+					data.uv[k] = uvs ? uvs[index] : glm::vec2(0);
+					positions.push_back(v[k]);
+					sceneMin = glm::min(sceneMin, v[k]);
+					sceneMax = glm::max(sceneMax, v[k]);
+				}
+				glm::vec3 faceNormal = glm::cross(v[1] - v[0], v[2] - v[0]);
+				float length = glm::length(faceNormal);
+				data.faceNormal = length > 0 ? faceNormal / length : glm::vec3(0, 1, 0);
+				triangleData.push_back(data);
+			}
+		}
+		bvh.Build(positions);
+		rayEpsilon = positions.empty() ? 1e-4f : 1e-4f * glm::length(sceneMax - sceneMin);
+		builtMeshes = meshes;
+		builtModelMats = modelMats;
+		Print("RayTracer: BVH is built, triangles: " + std::to_string(bvh.GetTriangleNum()) + ", nodes: " + std::to_string(bvh.GetNodeNum()));
+	}
+
+	// materials may change without changing geometry, so they are updated every frame
+	objects.resize(sceneObjs.size());
+	auto textureStreamer = GLOBAL.headless ? nullptr : GLOBAL.render->GetTextureStreamer();
+	for (int i = 0; i < static_cast<int>(sceneObjs.size()); i++)
+	{
+		auto material = sceneObjs[i]->GetMaterial();
+		Object& obj = objects[i];
+		obj.isPhong = false;
+		obj.color = material ? material->GetColor() : Utility::oneV3;
+		obj.ka = obj.kd = obj.ks = glm::vec3(0);
+		obj.shiness = 1;
+		obj.albedo = nullptr;
+		if (material == nullptr)
+			continue;
+		auto phongMat = dynamic_pointer_cast<PhongMaterial>(material);
+		if (phongMat != nullptr)
+		{
+			obj.isPhong = true;
+			obj.ka = phongMat->GetAmbientCoef();
+			obj.kd = phongMat->GetDiffuseCoef();
+			obj.ks = phongMat->GetSpecularCoef();
+			obj.shiness = phongMat->GetShiness();
+		}
+		// streamed textures are used after they are fully uploaded, without OpenGL context the image file is decoded directly
+		if (material->GetUVDataSize() == 0)
+			continue;
+		if (textureStreamer == nullptr)
+			obj.albedo = material->GetAlbedoPath().empty() ? nullptr : textureCache.Get(material->GetAlbedoPath());
+		else if (material->GetAlbedo() != 0 && !textureStreamer->IsPending(material->GetAlbedo()))
+			obj.albedo = textureCache.Get(material->GetAlbedo());
+	}
+}
+
+void RayTracer::PrepareLights()
+{
+	ambientLight = GLOBAL.sceneMgr->GetAmbient();
+	lights.clear();
+
+	// same as rasterizer: lights only cast shadows if there is a shadow config
+	bool renderShadow = GLOBAL.shadowMgr->IsNeedShadowRender();
+	shared_ptr<BasicShadowMapRender> shadowMapRender;
+	if (renderShadow)
+		shadowMapRender = dynamic_pointer_cast<BasicShadowMapRender>(GLOBAL.shadowMgr->GetShadowRender());
+	int lightSize = shadowMapRender != nullptr ? shadowMapRender->GetLightSize() : 0;
+
+	for (auto& sceneLight : GLOBAL.sceneMgr->GetAllLight())
+	{
+		Light light;
+		light.type = static_cast<int>(sceneLight->GetType());
+		light.color = sceneLight->GetColor();
+		light.intensity = sceneLight->GetIntensity();
+		light.attenuation = glm::vec2(0);
+		light.position = sceneLight->GetTransform()->GetPosition();
+		light.toLight = glm::vec3(0);
+		light.castShadow = renderShadow && sceneLight->IsRenderShadow();
+		light.axisU = light.axisV = glm::vec3(0);
+		light.distance = 0;
+		if (sceneLight->GetType() == LightType::POINT)
+			light.attenuation = static_pointer_cast<PointLight>(sceneLight)->GetAttenuation();
+		else if (sceneLight->GetType() == LightType::DIRECT)
+			light.toLight = -static_pointer_cast<DirectLight>(sceneLight)->GetDirection();
+
+		if (light.castShadow && lightSize > 0)
+		{
+			// PCSS light size is measured in shadow map texels at the near plane of light camera, convert it into world space
+			LightCamInfo lightCamInfo;
+			glm::mat4 invLightMat = glm::inverse(sceneLight->GetLightSpaceMat(lightCamInfo));
+			glm::vec4 nearLeft = invLightMat * glm::vec4(-1, 0, -1, 1);
+			glm::vec4 nearRight = invLightMat * glm::vec4(1, 0, -1, 1);
+			int resWidth, resHeight;
+			shadowMapRender->GetResolution(resWidth, resHeight);
+			float texelSize = glm::length(glm::vec3(nearRight) / nearRight.w - glm::vec3(nearLeft) / nearLeft.w) / resWidth;
+			float radius = 0.5f * lightSize * texelSize;
+
+			// the disk faces the light camera direction
+			glm::vec3 normal = glm::normalize(lightCamInfo.lightViewDir);
+			glm::vec3 axisU = glm::normalize(glm::cross(normal, std::abs(normal.y) < 0.99f ? Utility::upV3 : Utility::rightV3));
+			glm::vec3 axisV = glm::cross(normal, axisU);
+			light.axisU = axisU * radius;
+			light.axisV = axisV * radius;
+			light.distance = glm::length(lightCamInfo.lightCamPos - GLOBAL.sceneMgr->GetBoundingBox()->GetCenter());
+		}
+		lights.push_back(light);
+	}
+}
+#pragma endregion
+
+#pragma region tracing
+void RayTracer::TraceTile(const int& _tileIndex)
+{
+	int tileNumX = (width + tileSize - 1) / tileSize;
+	int x0 = (_tileIndex % tileNumX) * tileSize, y0 = (_tileIndex / tileNumX) * tileSize;
+	int x1 = std::min(x0 + tileSize, width), y1 = std::min(y0 + tileSize, height);
+	for (int y = y0; y < y1; y += 2)
+	{
+		for (int x = x0; x < x1; x += 2)
+			TracePacket(x, y);
+	}
+}
+
+void RayTracer::TracePacket(const int& _x, const int& _y)
+{
+	// primary rays go from near plane(t=0) to far plane(t=1), the same range as rasterizer
+	glm::vec3 origins[4], directions[4];
+	float tMax[4];
+	int laneMask = 0;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		int px = std::min(_x + (lane & 1), width - 1), py = std::min(_y + (lane >> 1), height - 1);
+		if (px == _x + (lane & 1) && py == _y + (lane >> 1))
+			laneMask |= 1 << lane;
+		glm::vec2 ndc((px + 0.5f) / width * 2.0f - 1.0f, (py + 0.5f) / height * 2.0f - 1.0f);
+		glm::vec4 nearPos = invViewProjMat * glm::vec4(ndc, -1, 1);
+		glm::vec4 farPos = invViewProjMat * glm::vec4(ndc, 1, 1);
+		origins[lane] = glm::vec3(nearPos) / nearPos.w;
+		directions[lane] = glm::vec3(farPos) / farPos.w - origins[lane];
+		tMax[lane] = 1.0f;
+	}
+	RayPacket packet;
+	packet.Init(origins, directions, tMax, laneMask);
+	bvh.Intersect(packet);
+
+	float t[4], u[4], v[4];
+	packet.tMax.Store(t);
+	packet.u.Store(u);
+	packet.v.Store(v);
+	HitPoint hits[4];
+	glm::vec3 colors[4];
+	int shadeMask = 0; // lanes need Phong lighting
+	for (int lane = 0; lane < 4; lane++)
+	{
+		colors[lane] = clearColor;
+		if (!(laneMask & (1 << lane)) || packet.triangleID[lane] < 0)
+			continue;
+		GetHitPoint(packet.triangleID[lane], u[lane], v[lane], origins[lane] + directions[lane] * t[lane], hits[lane]);
+		if (hits[lane].object->isPhong)
+			shadeMask |= 1 << lane;
+		else
+			colors[lane] = hits[lane].albedo; // "Simple/simple.fs"
+	}
+
+	if (shadeMask != 0)
+	{
+		glm::vec3 lRes[4] = { glm::vec3(0), glm::vec3(0), glm::vec3(0), glm::vec3(0) };
+		for (auto& light : lights)
+		{
+			float visibility[4] = { 1, 1, 1, 1 };
+			if (light.castShadow)
+				TraceLightVisibility(light, hits, shadeMask, _x, _y, visibility);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (shadeMask & (1 << lane))
+					lRes[lane] += ComputeLighting(light, hits[lane]) * visibility[lane];
+			}
+		}
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (shadeMask & (1 << lane))
+				colors[lane] = (lRes[lane] + ambientLight * hits[lane].object->ka) * hits[lane].albedo;
+		}
+	}
+
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (!(laneMask & (1 << lane)))
+			continue;
+		size_t index = static_cast<size_t>(_y + (lane >> 1)) * width + _x + (lane & 1);
+		glm::vec3 color = glm::clamp(colors[lane], 0.0f, 1.0f);
+		for (int c = 0; c < 3; c++)
+			colorBuffer[index * 4 + c] = static_cast<unsigned char>(color[c] * 255.0f + 0.5f);
+		colorBuffer[index * 4 + 3] = 255;
+	}
+}
+
+void RayTracer::GetHitPoint(const int& _triangleID, const float& _u, const float& _v, const glm::vec3& _pos, HitPoint& _hit) const
+{
+	const TriangleData& tri = triangleData[_triangleID];
+	float w = 1 - _u - _v;
+	_hit.pos = _pos;
+	_hit.faceNormal = tri.faceNormal;
+	glm::vec3 normal = tri.normal[0] * w + tri.normal[1] * _u + tri.normal[2] * _v;
+	float length = glm::length(normal);
+	_hit.normal = length > 0 ? normal / length : tri.faceNormal;
+	_hit.object = &objects[tri.objectIndex];
+	if (_hit.object->albedo != nullptr)
+		_hit.albedo = _hit.object->albedo->Sample(tri.uv[0] * w + tri.uv[1] * _u + tri.uv[2] * _v);
+	else
+		_hit.albedo = _hit.object->color;
+}
+
+glm::vec3 RayTracer::ComputeLighting(const Light& _light, const HitPoint& _hit) const
+{
+	float lI = _light.intensity;
+	glm::vec3 lDir;
+	if (_light.type == static_cast<int>(LightType::POINT))
+	{
+		lDir = _light.position - _hit.pos;
+		float d = glm::length(lDir);
+		lI *= 1.0f / (1 + d * _light.attenuation.x + d * d * _light.attenuation.y);
+	}
+	else
+		lDir = _light.toLight;
+	lDir = glm::normalize(lDir);
+	glm::vec3 lC = _light.color * lI;
+
+	glm::vec3 diffuse(0);
+	float lDirDotN = glm::dot(lDir, _hit.normal);
+	if (lDirDotN > 0)
+		diffuse = _hit.object->kd * lDirDotN * lC;
+
+	glm::vec3 specular(0);
+	glm::vec3 lRef = glm::normalize(2 * lDirDotN * _hit.normal - lDir);
+	float lRefDotV = glm::dot(lRef, glm::normalize(eyePos - _hit.pos));
+	if (lRefDotV > 0)
+		specular = _hit.object->ks * std::pow(lRefDotV, _hit.object->shiness) * lC;
+	return diffuse + specular;
+}
+
+void RayTracer::TraceLightVisibility(const Light& _light, const HitPoint _hits[4], const int& _laneMask, const int& _x, const int& _y, float _visibility[4]) const
+{
+	bool isAreaLight = _light.axisU != glm::vec3(0);
+	int sampleNum = isAreaLight ? lightSampleNum : 1;
+	int gridSize = static_cast<int>(std::round(std::sqrt(static_cast<float>(sampleNum))));
+	bool isPointLight = _light.type == static_cast<int>(LightType::POINT);
+
+	// offset origins along face normal towards the light side, to avoid self-intersection
+	glm::vec3 origins[4];
+	for (int lane = 0; lane < 4; lane++)
+	{
+		_visibility[lane] = 0;
+		origins[lane] = glm::vec3(0);
+		if (!(_laneMask & (1 << lane)))
+			continue;
+		glm::vec3 toLight = isPointLight ? _light.position - _hits[lane].pos : _light.toLight;
+		float side = glm::dot(toLight, _hits[lane].faceNormal) >= 0 ? 1.0f : -1.0f;
+		origins[lane] = _hits[lane].pos + _hits[lane].faceNormal * (rayEpsilon * side);
+	}
+
+	glm::vec3 directions[4];
+	float tMax[4];
+	for (int s = 0; s < sampleNum; s++)
+	{
+		for (int lane = 0; lane < 4; lane++)
+		{
+			directions[lane] = glm::vec3(0, 1, 0);
+			tMax[lane] = 0;
+			if (!(_laneMask & (1 << lane)))
+				continue;
+
+			// stratified sample on light disk, jittered per pixel
+			glm::vec3 offset(0);
+			if (isAreaLight)
+			{
+				uint32_t px = _x + (lane & 1), py = _y + (lane >> 1);
+				float a = ((s % gridSize) + Hash(px, py, s * 2)) / gridSize;
+				float b = ((s / gridSize) + Hash(px, py, s * 2 + 1)) / gridSize;
+				float r = std::sqrt(a), phi = 2.0f * static_cast<float>(M_PI) * b;
+				offset = _light.axisU * (r * std::cos(phi)) + _light.axisV * (r * std::sin(phi));
+			}
+
+			if (isPointLight)
+			{
+				directions[lane] = _light.position + offset - origins[lane];
+				tMax[lane] = 1.0f; // segment to the light
+			}
+			else
+			{
+				// direct light: the disk is at "distance" from scene center, so it covers a cone of directions
+				directions[lane] = isAreaLight ? _light.toLight * _light.distance + offset : _light.toLight;
+				tMax[lane] = std::numeric_limits<float>::max();
+			}
+		}
+		RayPacket packet;
+		packet.Init(origins, directions, tMax, _laneMask);
+		bvh.Occluded(packet);
+		int occludedMask = packet.occluded.GetMask();
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if ((_laneMask & (1 << lane)) && !(occludedMask & (1 << lane)))
+				_visibility[lane] += 1.0f;
+		}
+	}
+	for (int lane = 0; lane < 4; lane++)
+		_visibility[lane] /= sampleNum;
+}
+#pragma endregion
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "bvh.hpp"
+#include "../helpers/threadPool.hpp"
+#include "../helpers/cpuTextureCache.hpp"
+
+namespace IceRender
+{
+	class Mesh;
+
+	/*
+	* CPU ray tracer, used by render method "RenderRayTracing"(see renderMethod.cpp) and command "save_ray_traced_image", as a reference for shadow techniques.
+	*   Reference images can also be saved without window(command line "--ray_trace", see main.cpp), RenderImage() doesn't need OpenGL.
+	* - all scene triangles are put into one BVH in world space, it is only rebuilt when objects or their transforms change
+	* - the image is split into tiles traced in parallel(ThreadPool), each tile traces 2x2 pixels as one packet of 4 rays(SSE2, scalar fallback)
+	* - shading is the same Phong model as "Phong/phong.fs", but light visibility is traced instead of looked up in shadow maps:
+	*   hard shadows, or soft shadows of a disk area light when the shadow config uses PCSS("light_size"). Lights only cast shadows when the shadow config exists.
+	*/
+	class RayTracer
+	{
+	public:
+		static const int tileSize = 16;
+
+	private:
+		struct Object
+		{
+			bool isPhong;
+			glm::vec3 color, ka, kd, ks;
+			float shiness;
+			const CPUTexture* albedo; // null if there is no albedo texture
+		};
+
+		struct TriangleData
+		{
+			int objectIndex;
+			glm::vec3 normal[3]; // world space
+			glm::vec2 uv[3];
+			glm::vec3 faceNormal; // world space, used to offset shadow ray origins
+		};
+
+		struct Light
+		{
+			int type; // same as LightType
+			glm::vec3 color;
+			float intensity;
+			glm::vec2 attenuation;
+			glm::vec3 position; // point light
+			glm::vec3 toLight; // direct light, from surface to light
+			bool castShadow;
+			glm::vec3 axisU, axisV; // half axes of light disk in world space, zero for hard shadows
+			float distance; // direct light only: distance of the light disk used to turn disk size into cone angle
+		};
+
+		struct HitPoint
+		{
+			glm::vec3 pos, normal, faceNormal;
+			glm::vec3 albedo;
+			const Object* object;
+		};
+
+		ThreadPool pool;
+		int threadNum; // worker threads, <= 0 means hardware concurrency
+		bool poolStarted;
+
+		/*scene*/
+		BVH bvh;
+		std::vector<TriangleData> triangleData; // indexed by triangle id of BVH
+		std::vector<std::shared_ptr<Mesh>> builtMeshes; // meshes and transforms used to build BVH, to detect changes
+		std::vector<glm::mat4> builtModelMats;
+		std::vector<Object> objects;
+		CPUTextureCache textureCache; // albedo textures read back from GPU(or decoded from files without OpenGL) once
+		float rayEpsilon; // offset of shadow ray origins, relative to scene size
+
+		/*lighting*/
+		std::vector<Light> lights;
+		glm::vec3 ambientLight;
+		int lightSampleNum; // shadow rays per area light per pixel
+
+		/*camera*/
+		glm::mat4 invViewProjMat;
+		glm::vec3 eyePos;
+
+		int width, height;
+		std::vector<unsigned char> colorBuffer; // RGBA8, bottom row first(same as OpenGL)
+		GLuint outputTex;
+		int outputWidth, outputHeight;
+
+		void PrepareScene(); // rebuild BVH if needed, update materials
+		void PrepareLights();
+		void TraceTile(const int& _tileIndex);
+		void TracePacket(const int& _x, const int& _y); // 2x2 pixels, (_x, _y) is the bottom left one
+		void GetHitPoint(const int& _triangleID, const float& _u, const float& _v, const glm::vec3& _pos, HitPoint& _hit) const;
+		glm::vec3 ComputeLighting(const Light& _light, const HitPoint& _hit) const; // diffuse and specular of "Phong/phong.fs", without shadow
+		// fraction of light samples visible from each hit point of lanes in "_laneMask", (_x, _y) is used to jitter samples per pixel
+		void TraceLightVisibility(const Light& _light, const HitPoint _hits[4], const int& _laneMask, const int& _x, const int& _y, float _visibility[4]) const;
+
+	public:
+		RayTracer();
+		~RayTracer();
+
+		void Clear();
+
+		// trace active camera into a texture of "_width" x "_height", return the texture
+		GLuint Render(const int& _width, const int& _height);
+		// trace active camera into RGBA8 pixels(bottom row first)
+		const std::vector<unsigned char>& RenderImage(const int& _width, const int& _height);
+
+		int GetThreadNum() const; // including calling thread
+		void SetThreadNum(const int& _threadNum); // worker threads, <= 0 means hardware concurrency
+		int GetLightSampleNum() const;
+		void SetLightSampleNum(const int& _sampleNum); // rounded to a square number in [1, 256]
+	};
+}
@@ -10,7 +10,7 @@
 
 using namespace IceRender;
 
-SceneManager::SceneManager() :maxLightNum(5), ambient(0, 0, 0) {}
+SceneManager::SceneManager() :maxLightNum(5), ambient(0, 0, 0), version(0), boundingBox(nullptr), boundingBoxVersions(0), boundsVersion(0) {}
 SceneManager::~SceneManager() { sceneObjs.clear(); lights.clear(); }
 
 void SceneManager::Init()
@@ -24,7 +24,9 @@ vector<shared_ptr<SceneObject>>& SceneManager::GetAllSceneObject() { return scen
 void SceneManager::AddSceneObj(const shared_ptr<SceneObject>& _obj)
 { 
 	sceneObjs.push_back(_obj);
-	GLOBAL.render->InitGPUData(sceneObjs[sceneObjs.size() - 1]);
+	version++;
+	if (!GLOBAL.headless) // CPU renderers read mesh and material data directly
+		GLOBAL.render->InitGPUData(sceneObjs[sceneObjs.size() - 1]);
 }
 
 void SceneManager::RemoveSceneObj(const string& _name)
@@ -33,8 +35,10 @@ void SceneManager::RemoveSceneObj(const string& _name)
 	{
 		auto sceneObj = *iter;
 		if (sceneObj->GetName() == _name) {
-			GLOBAL.render->DeleteGPUData(sceneObj);
+			if (!GLOBAL.headless)
+				GLOBAL.render->DeleteGPUData(sceneObj);
 			sceneObjs.erase(iter);
+			version++;
 			break;
 		}
 	}
@@ -53,9 +57,10 @@ shared_ptr<SceneObject> SceneManager::GetSceneObj(const string& _name) const
 glm::vec3 SceneManager::GetAmbient() const { return ambient; }
 void SceneManager::SetAmbient(const glm::vec3& _ambient) { ambient = _ambient; }
 
-void SceneManager::AddLight(const shared_ptr<BaseLight>& _light) { if (lights.size() < maxLightNum)lights.push_back(_light); }
+void SceneManager::AddLight(const shared_ptr<BaseLight>& _light) { if (static_cast<int>(lights.size()) < maxLightNum)lights.push_back(_light); version++; }
 void SceneManager::RemoveLight(const string& _name)
 {
+	version++;
 	std::remove_if(lights.begin(), lights.end(), [&](const shared_ptr<BaseLight>& _light) {return _light->GetName() == _name; });
 }
 shared_ptr<BaseLight> SceneManager::GetBaseLight(const string& _name) const
@@ -67,16 +72,22 @@ shared_ptr<BaseLight> SceneManager::GetBaseLight(const string& _name) const
 }
 vector<shared_ptr<BaseLight>>& SceneManager::GetAllLight() { return lights; }
 int SceneManager::GetLightNum() const { return lights.size(); }
+int SceneManager::GetMaxLightNum() const { return maxLightNum; }
 
 void SceneManager::ClearAll() 
 { 
 	// clear scene objects,
-	for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
-		GLOBAL.render->DeleteGPUData(*iter); // [Note] don't forget release the GPU data to avoid memory leak
+	if (!GLOBAL.headless)
+	{
+		for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
+			GLOBAL.render->DeleteGPUData(*iter); // [Note] don't forget release the GPU data to avoid memory leak
+	}
 	sceneObjs.clear();
 	
 	// clear lights
 	lights.clear();
+
+	version++;
 }
 
 void SceneManager::LoadFromSceneConfig(const string& _configPath)
@@ -109,6 +120,18 @@ void SceneManager::LoadFromSceneConfig(const string& _configPath)
 				GLOBAL.camCtrller->SetCameraRotation(Utility::LoadVec3FromJsonData(cameraData["rotation"]));
 		}
 
+		// extra camera views(view 0 is "camera"), each has "position" and "rotation"
+		GLOBAL.camCtrller->ClearViews();
+		if (sceneData.contains("views"))
+		{
+			for (auto& viewData : sceneData["views"])
+			{
+				glm::vec3 pos = viewData.contains("position") ? Utility::LoadVec3FromJsonData(viewData["position"]) : Utility::zeroV3;
+				glm::vec3 rot = viewData.contains("rotation") ? Utility::LoadVec3FromJsonData(viewData["rotation"]) : Utility::zeroV3;
+				GLOBAL.camCtrller->AddView(pos, rot);
+			}
+		}
+
 		// set environment ambient (TODO: improve it later)
 		if (sceneData.contains("ambient"))
 			GLOBAL.sceneMgr->SetAmbient(Utility::LoadVec3FromJsonData(sceneData["ambient"]));
@@ -118,6 +141,60 @@ void SceneManager::LoadFromSceneConfig(const string& _configPath)
 		if (sceneData.contains("render_method"))
 			GLOBAL.sceneMgr->SetCurrentRenderMethod(string(sceneData["render_method"]));
 
+		// internal render resolution, must be set before "shadow_config"(shadow maps use render resolution by default)
+		if (sceneData.contains("render_scale"))
+			GLOBAL.render->SetRenderScale(sceneData["render_scale"].get<float>());
+		if (sceneData.contains("upscale_filter"))
+		{
+			UpscaleFilter filter;
+			if (AntiAliasing::ParseUpscaleFilter(string(sceneData["upscale_filter"]), filter))
+				GLOBAL.render->GetAntiAliasing()->SetUpscaleFilter(filter);
+			else
+				Print("[Error] Unknown upscale filter: " + string(sceneData["upscale_filter"]));
+		}
+
+		// in KB per frame, textures are streamed in background and uploaded within it
+		if (sceneData.contains("texture_upload_budget"))
+			GLOBAL.render->GetTextureStreamer()->SetUploadBudget(sceneData["texture_upload_budget"].get<size_t>() * 1024);
+
+		// "OFF", "MSAA2", "MSAA4", "MSAA8", "FXAA" or "TAA"
+		if (sceneData.contains("anti_aliasing"))
+		{
+			AAMode aaMode;
+			if (AntiAliasing::ParseMode(string(sceneData["anti_aliasing"]), aaMode))
+				GLOBAL.render->GetAntiAliasing()->SetMode(aaMode);
+			else
+				Print("[Error] Unknown anti-aliasing mode: " + string(sceneData["anti_aliasing"]));
+		}
+
+		if (sceneData.contains("vertex_pulling"))
+			GLOBAL.render->SetUseVertexPulling(sceneData["vertex_pulling"].get<bool>());
+
+		// e.g. "ssao_config": {"enable": true, "downscale": 2, "sample_num": 8, "radius": 0.5, "intensity": 1.0}
+		if (sceneData.contains("ssao_config"))
+		{
+			nlohmann::json ssaoData = sceneData["ssao_config"];
+			auto ssao = GLOBAL.render->GetSSAO();
+			if (ssaoData.contains("downscale"))
+				ssao->SetDownscale(ssaoData["downscale"].get<int>());
+			if (ssaoData.contains("sample_num"))
+				ssao->SetSampleNum(ssaoData["sample_num"].get<int>());
+			if (ssaoData.contains("radius"))
+				ssao->SetRadius(ssaoData["radius"].get<float>());
+			if (ssaoData.contains("intensity"))
+				ssao->SetIntensity(ssaoData["intensity"].get<float>());
+			ssao->SetEnabled(ssaoData.contains("enable") ? ssaoData["enable"].get<bool>() : true);
+		}
+
+		if (sceneData.contains("software_threads"))
+		{
+			GLOBAL.render->GetSoftwareRasterizer()->SetThreadNum(sceneData["software_threads"].get<int>());
+			GLOBAL.render->GetRayTracer()->SetThreadNum(sceneData["software_threads"].get<int>());
+		}
+
+		if (sceneData.contains("ray_tracer_samples"))
+			GLOBAL.render->GetRayTracer()->SetLightSampleNum(sceneData["ray_tracer_samples"].get<int>());
+
 		// TODO: keep update here
 		if (sceneData.contains("shadow_config"))
 			GLOBAL.shadowMgr->LoadShadowRender(sceneData["shadow_config"]);
@@ -145,6 +222,10 @@ void SceneManager::LoadFromSceneConfig(const string& _configPath)
 					if (lightData.contains("range"))
 						pointLight->SetRange(lightData["range"]);
 
+					// "cube": omnidirectional shadow(6 cube faces in the shadow atlas), "perspective"(default): one frustum toward the scene center
+					if (lightData.contains("shadow_projection"))
+						pointLight->SetCubeShadow(lightData["shadow_projection"].get<string>() == "cube");
+
 					// don't forget to refer it
 					light = pointLight;
 				}
@@ -157,6 +238,14 @@ void SceneManager::LoadFromSceneConfig(const string& _configPath)
 					if (lightData.contains("intensity"))
 						directLight->SetIntensity(lightData["intensity"]);
 
+					// cascaded shadow maps, e.g. "cascade_num": 4, "cascade_split_lambda": 0.75, "cascade_update_interval": 4
+					if (lightData.contains("cascade_num"))
+					{
+						float splitLambda = lightData.contains("cascade_split_lambda") ? lightData["cascade_split_lambda"].get<float>() : 0.75f;
+						int updateInterval = lightData.contains("cascade_update_interval") ? lightData["cascade_update_interval"].get<int>() : 1;
+						directLight->SetCascades(lightData["cascade_num"].get<int>(), splitLambda, updateInterval);
+					}
+
 					// don't forget to refer it
 					light = directLight;
 				}
@@ -166,6 +255,8 @@ void SceneManager::LoadFromSceneConfig(const string& _configPath)
 				{
 					if (lightData.contains("render_shadow"))
 						light->SetRenderShadow(lightData["render_shadow"].get<bool>());
+					if (lightData.contains("shadow_resolution_scale"))
+						light->SetShadowResolutionScale(lightData["shadow_resolution_scale"].get<float>());
 
 					GLOBAL.sceneMgr->AddLight(light);
 				}
@@ -212,9 +303,11 @@ void SceneManager::LoadFromSceneConfig(const string& _configPath)
 						
 						if (materialData.contains("albedo_tex"))
 						{
-							GLuint albedo;
+							// streamed in background, a placeholder is shown until the full texture is uploaded
 							std::string texPath = materialData["albedo_tex"];
-							if (Utility::Load2DTexture(texPath, true, albedo))
+							phongMat->SetAlbedoPath(texPath);
+							GLuint albedo = GLOBAL.headless ? 0 : GLOBAL.render->GetTextureStreamer()->Request(texPath);
+							if (albedo != 0)
 							{
 								phongMat->SetAlbedo(albedo);
 							}
@@ -264,10 +357,33 @@ string SceneManager::GetCurrentRenderMethod() const { return renderMethod; }
 void SceneManager::SetCurrentRenderMethod(const string& _value) { renderMethod = _value; }
 shared_ptr<AABB> SceneManager::GetBoundingBox()
 {
-	// recompute the scene bounding box
-	auto boundingBox = make_shared<AABB>();
+	// recompute the scene bounding box only when objects are added/removed or moved, bounding boxes of unmoved objects are cached by themselves
+	glm::uvec2 versions(version, GetTransformVersion());
+	if (boundingBox != nullptr && versions == boundingBoxVersions)
+		return boundingBox;
+	auto newBox = make_shared<AABB>();
 	for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
-		boundingBox->Extend((*iter)->GetBoundingBox());
+		newBox->Extend((*iter)->GetBoundingBox());
+	if (boundingBox == nullptr || newBox->GetMin() != boundingBox->GetMin() || newBox->GetMax() != boundingBox->GetMax())
+		boundsVersion++;
+	boundingBox = newBox;
+	boundingBoxVersions = versions;
 	return boundingBox;
 }
 
+unsigned int SceneManager::GetBoundsVersion()
+{
+	GetBoundingBox(); // bring the cache up to date
+	return boundsVersion;
+}
+
+unsigned int SceneManager::GetVersion() const { return version; }
+
+unsigned int SceneManager::GetTransformVersion() const
+{
+	// transform versions only increase, so the sum changes if any transform changes(as long as no object is added/removed)
+	unsigned int result = 0;
+	for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
+		result += (*iter)->GetTransform()->GetVersion();
+	return result;
+}
@@ -25,6 +25,12 @@ namespace IceRender
 
 		string renderMethod; // specify current render method
 
+		unsigned int version; // increased when scene objects or lights are added/removed
+
+		shared_ptr<AABB> boundingBox; // cached result of GetBoundingBox()
+		glm::uvec2 boundingBoxVersions; // version and transform version which "boundingBox" was computed with
+		unsigned int boundsVersion; // increased when the scene bounding box really changes(moving an object inside it doesn't)
+
 	public:
 		SceneManager();
 		~SceneManager();
@@ -44,6 +50,7 @@ namespace IceRender
 		shared_ptr<BaseLight> GetBaseLight(const string& _name) const;
 		vector<shared_ptr<BaseLight>>& GetAllLight();
 		int GetLightNum() const;
+		int GetMaxLightNum() const;
 
 		void ClearAll();
 
@@ -53,6 +60,11 @@ namespace IceRender
 		string GetCurrentRenderMethod() const;
 		void SetCurrentRenderMethod(const string& _value);
 
-		shared_ptr<AABB> GetBoundingBox();
+		shared_ptr<AABB> GetBoundingBox(); // cached until objects are added/removed or moved, don't modify it
+		unsigned int GetBoundsVersion(); // used to cache results depending on the scene bounding box(e.g. light space matrices)
+
+		// used to cache results depending on the scene(e.g. shadow maps): the scene is unchanged if both versions are unchanged
+		unsigned int GetVersion() const;
+		unsigned int GetTransformVersion() const; // sum of transform versions of all scene objects, only meaningful while "GetVersion()" is unchanged
 	};
 }
\ No newline at end of file
@@ -2,21 +2,22 @@
 
 using namespace IceRender;
 
-SceneObject::SceneObject(const string& _name) :name(_name), mesh(nullptr), material(nullptr), transform(make_shared<Transform>()), meshAABB(make_shared<AABB>()) {}
+SceneObject::SceneObject(const string& _name) :name(_name), mesh(nullptr), material(nullptr), transform(make_shared<Transform>()), meshAABB(make_shared<AABB>()), boundingBox(nullptr), boundingBoxVersion(0), version(0) {}
 SceneObject::SceneObject(const string& _name, const shared_ptr<Mesh>& _mesh) :
-	name(_name), mesh(_mesh), material(nullptr), transform(make_shared<Transform>()), meshAABB(make_shared<AABB>()) { meshAABB->Recompute(_mesh->GetPositions()); }
+	name(_name), mesh(_mesh), material(nullptr), transform(make_shared<Transform>()), meshAABB(make_shared<AABB>()), boundingBox(nullptr), boundingBoxVersion(0), version(0) { meshAABB->Recompute(_mesh->GetPositions()); }
 SceneObject::SceneObject(const string& _name, const shared_ptr<Mesh>& _mesh, const shared_ptr<Material> _material) : 
-	name(_name), mesh(_mesh), material(_material), transform(make_shared<Transform>()), meshAABB(make_shared<AABB>()) { meshAABB->Recompute(_mesh->GetPositions()); } 
+	name(_name), mesh(_mesh), material(_material), transform(make_shared<Transform>()), meshAABB(make_shared<AABB>()), boundingBox(nullptr), boundingBoxVersion(0), version(0) { meshAABB->Recompute(_mesh->GetPositions()); } 
 SceneObject::~SceneObject()
 {
 	mesh = nullptr;
 	material = nullptr;
 	transform = nullptr;
 	meshAABB = nullptr;
+	boundingBox = nullptr;
 }
 
-void SceneObject::SetMesh(const shared_ptr<Mesh>& _mesh) { mesh = _mesh; meshAABB->Recompute(_mesh->GetPositions()); }
-void SceneObject::SetMaterial(const shared_ptr<Material>& _material) { material = _material; }
+void SceneObject::SetMesh(const shared_ptr<Mesh>& _mesh) { mesh = _mesh; meshAABB->Recompute(_mesh->GetPositions()); boundingBox = nullptr; version++; }
+void SceneObject::SetMaterial(const shared_ptr<Material>& _material) { material = _material; version++; }
 
 shared_ptr<Mesh> SceneObject::GetMesh() const { return mesh; }
 shared_ptr<Material> SceneObject::GetMaterial() const { return material; }
@@ -25,9 +26,13 @@ const string SceneObject::GetName() const { return name; }
 
 shared_ptr<Transform> SceneObject::GetTransform() { return transform; }
 shared_ptr<AABB> SceneObject::GetMeshAABB() { return meshAABB; }
+unsigned int SceneObject::GetVersion() const { return version + transform->GetVersion(); } // both only increase, so the sum changes if any of them changes
 shared_ptr<AABB> SceneObject::GetBoundingBox()
 {
-	// TODO: for better performance, maybe I should optimize here -> after all, scene bounding box will be computed each frame when using ShadowMap technique
+	// scene bounding box is used every frame by shadow maps, so the result is only recomputed when the transform changes
+	if (boundingBox != nullptr && boundingBoxVersion == transform->GetVersion())
+		return boundingBox;
+
 	glm::vec3 min, max, size;
 	min = meshAABB->GetMin();
 	max = meshAABB->GetMax();
@@ -44,7 +49,7 @@ shared_ptr<AABB> SceneObject::GetBoundingBox()
 	p[7] = max - glm::vec3(size.x, size.y, 0);
 
 	// build the bounding box from these 8 corner points
-	shared_ptr<AABB> boundingBox = make_shared<AABB>();
+	boundingBox = make_shared<AABB>(); // a new one, results returned before are not changed
 	glm::mat4 modelMat = transform->ComputeTransformationMatrix();
 	for (int i = 0; i < 8; i++)
 	{
@@ -53,5 +58,6 @@ shared_ptr<AABB> SceneObject::GetBoundingBox()
 		p[i] = glm::vec3(p_homo.x, p_homo.y, p_homo.z);
 		boundingBox->Extend(p[i]);
 	}
+	boundingBoxVersion = transform->GetVersion();
 	return boundingBox;
 }
@@ -19,6 +19,9 @@ namespace IceRender
 		shared_ptr<Transform> transform;
 		shared_ptr<Material> material;
 		shared_ptr<AABB> meshAABB;
+		shared_ptr<AABB> boundingBox; // cached result of GetBoundingBox(), nullptr if it needs to be recomputed
+		unsigned int boundingBoxVersion; // transform version which "boundingBox" was computed with
+		unsigned int version; // increased when mesh or material is replaced, transform and material have their own versions
 
 	public:
 		SceneObject(const string& _name);
@@ -36,7 +39,8 @@ namespace IceRender
 
 		shared_ptr<Transform> GetTransform(); // allow any operation outside to change the transform directly
 		shared_ptr<AABB> GetMeshAABB(); // AABB of mesh
-		shared_ptr<AABB> GetBoundingBox(); // considering the actual mesh will have transformation(translation, rotation, scale), therefore, we need to compute the run-time boundingbox for it
+		unsigned int GetVersion() const; // changes whenever mesh, material or transform changes(not the content of the material, see Material::GetVersion)
+		shared_ptr<AABB> GetBoundingBox(); // considering the actual mesh will have transformation(translation, rotation, scale), therefore, we need to compute the run-time boundingbox for it. It is cached until the transform changes, don't modify it
 	};
 }
 
@@ -49,6 +49,30 @@ bool ShaderManager::CreateShaderProgram(const string& _shaderName)
 	return true;
 }
 
+bool ShaderManager::CreateShaderProgram(const string& _shaderName, const string& _vertexVariant)
+{
+	// fragment shader is shared by all variants(e.g. "Phong/phong.fs" is generated from scene config), only vertex shader differs
+	shared_ptr<ShaderProgram> pShaderPro = make_shared<ShaderProgram>();
+	bool result = pShaderPro->LoadShader(_shaderName + _vertexVariant + ".vs", _shaderName + ".fs");
+	if (!result)
+		return false;
+
+	shaderMap[_shaderName + "(" + _vertexVariant + ")"] = pShaderPro;
+	return true;
+}
+
+bool ShaderManager::CreateComputeProgram(const string& _shaderName)
+{
+	// shaderName should be the prefix of compute shader. E.g. "frustumCulling" for "frustumCulling.cs"
+	shared_ptr<ShaderProgram> pShaderPro = make_shared<ShaderProgram>();
+	bool result = pShaderPro->LoadComputeShader(_shaderName + ".cs");
+	if (!result)
+		return false;
+
+	shaderMap[_shaderName] = pShaderPro;
+	return true;
+}
+
 void ShaderManager::Clear()
 {
 	activeShader.clear();
@@ -114,6 +138,42 @@ shared_ptr<ShaderProgram> ShaderManager::TryActivateShaderProgram(const string&
 	return target;
 }
 
+shared_ptr<ShaderProgram> ShaderManager::TryActivateShaderProgram(const string& _shaderName, const string& _vertexVariant)
+{
+	if (_vertexVariant.empty())
+		return TryActivateShaderProgram(_shaderName);
+
+	string programName = _shaderName + "(" + _vertexVariant + ")"; // not a file name, so it never conflicts with other programs
+	shared_ptr<ShaderProgram> target = nullptr;
+	if (!FindShaderProgram(programName, target))
+	{
+		if (CreateShaderProgram(_shaderName, _vertexVariant))
+			target = shaderMap[programName];
+		else
+			return nullptr; // can not create 
+	}
+	// activate it
+	target->Active();
+	activeShader = programName;
+	return target;
+}
+
+shared_ptr<ShaderProgram> ShaderManager::TryActivateComputeProgram(const string& _shaderName)
+{
+	shared_ptr<ShaderProgram> target = nullptr;
+	if (!FindShaderProgram(_shaderName, target))
+	{
+		if (CreateComputeProgram(_shaderName))
+			target = shaderMap[_shaderName];
+		else
+			return nullptr; // can not create 
+	}
+	// activate it
+	target->Active();
+	activeShader = _shaderName;
+	return target;
+}
+
 void ShaderManager::GenerateShaderFile(const std::string& _outputFileName, const std::string& _mainFileName)
 {
 	// If forget how to use, check "Resources/Shaders/UsageOfGenerateShader.md"
@@ -22,6 +22,8 @@ namespace IceRender
 		void StopShaderProgram();
 		bool ActiveShaderProgram(const string& _shaderName);
 		bool CreateShaderProgram(const string& _shaderName);
+		bool CreateShaderProgram(const string& _shaderName, const string& _vertexVariant); // "_shaderName + _vertexVariant.vs" and "_shaderName.fs"
+		bool CreateComputeProgram(const string& _shaderName);
 		void Clear();
 		void PrintActiveShader();
 		string GetActiveShader() const;
@@ -31,6 +33,9 @@ namespace IceRender
 
 		shared_ptr<ShaderProgram> GetActiveShaderProgram() const;
 		shared_ptr<ShaderProgram> TryActivateShaderProgram(const string& _shaderName); // return a shader program, if not exist, create and activate it.
+		// same as above, but vertex shader is replaced by its variant, e.g. ("Phong/phong", "Pulling") uses "Phong/phongPulling.vs" and "Phong/phong.fs". Empty variant means the default one.
+		shared_ptr<ShaderProgram> TryActivateShaderProgram(const string& _shaderName, const string& _vertexVariant);
+		shared_ptr<ShaderProgram> TryActivateComputeProgram(const string& _shaderName); // same as above, but "_shaderName" refers to a compute shader "_shaderName.cs"
 		// todo: support to use uniform blocks (check RenderNote)
 
 		// generate a shader file by using ".sub_fs/.sub_vs" and ".main_fs/.main_vs"
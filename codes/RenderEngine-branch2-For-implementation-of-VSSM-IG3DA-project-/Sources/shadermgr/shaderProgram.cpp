@@ -85,6 +85,9 @@ bool ShaderProgram::LoadShader(const string& _fPath, const ShaderType& _type, GL
 	case GL_FRAGMENT_SHADER:
 		fShader = _fPath;
 		break;
+	case GL_COMPUTE_SHADER:
+		cShader = _fPath;
+		break;
 	default:
 		break;
 	}
@@ -140,6 +143,43 @@ bool ShaderProgram::Link(const GLuint& _vShaderID, const GLuint& _fShaderID)
 	return true;
 }
 
+bool ShaderProgram::Link(const GLuint& _cShaderID)
+{
+	if (glIsShader(_cShaderID) == GL_FALSE)
+	{
+		Print(NULL, "sds", "[Error]compute shader id: ", _cShaderID, " is no longer a valid shader id.");
+		return false;
+	}
+
+	if (!IsValid())
+		return false;
+
+	glLinkProgram(id);
+
+	GLint isLinked = 0;
+	glGetProgramiv(id, GL_LINK_STATUS, (int*)&isLinked);
+	if (isLinked == GL_FALSE)
+	{
+		GLint maxLength = 0;
+		glGetProgramiv(id, GL_INFO_LOG_LENGTH, &maxLength);
+
+		std::string errorLog;
+		errorLog.resize(maxLength);
+		glGetProgramInfoLog(id, maxLength, &maxLength, &errorLog[0]);
+
+		glDeleteProgram(id); // delet current
+		id = glCreateProgram(); // create new one
+
+		Print("[Link Shader Program Error]:\n" + errorLog);
+
+		return false;
+	}
+
+	glDetachShader(id, _cShaderID);
+
+	return true;
+}
+
 bool ShaderProgram::IsValid()
 {
 	if (glIsProgram(id) == GL_FALSE)
@@ -168,6 +208,20 @@ bool ShaderProgram::LoadShader(const string& _vShaderPath, const string& _fShade
 	return result;
 }
 
+bool ShaderProgram::LoadComputeShader(const string& _cShaderPath)
+{
+	GLuint cShaderID;
+
+	if (!LoadShader(_cShaderPath, GL_COMPUTE_SHADER, cShaderID))
+		return false;
+
+	bool result = Link(cShaderID);
+
+	glDeleteShader(cShaderID);
+
+	return result;
+}
+
 bool ShaderProgram::Active()
 {
 	if (!IsValid())
@@ -180,6 +234,8 @@ void ShaderProgram::PrintShader()
 {
 	Print("Current Active Vertex Shader: " + vShader);
 	Print("Current Active Fragment Shader: " + fShader);
+	if (!cShader.empty())
+		Print("Current Active Compute Shader: " + cShader);
 }
 
 void ShaderProgram::Set(const string& _name, bool _val) { Set(_name, static_cast<int>(_val)); }
@@ -210,6 +266,15 @@ void ShaderProgram::Set(const string& _name, const glm::vec2& _val)
 		Print("Can't not get uniform: " + _name);
 }
 
+void ShaderProgram::Set(const string& _name, const glm::ivec2& _val)
+{
+	GLint location = glGetUniformLocation(id, _name.c_str());
+	if (!CheckGLError() && location != -1)
+		glUniform2iv(location, 1, glm::value_ptr(_val));
+	else
+		Print("Can't not get uniform: " + _name);
+}
+
 void ShaderProgram::Set(const string& _name, const glm::vec3& _val)
 {
 	GLint location = glGetUniformLocation(id, _name.c_str());
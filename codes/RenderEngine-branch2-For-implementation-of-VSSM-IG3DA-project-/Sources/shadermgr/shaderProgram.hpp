@@ -18,10 +18,12 @@ namespace IceRender
 		GLuint id;
 		string vShader; // file path of vertex shader
 		string fShader; // file path of fragment shader
+		string cShader; // file path of compute shader
 
 		string ReadFileToString(const string& _fPath);
 		bool LoadShader(const string& _fPath, const ShaderType& _type, GLuint& _shaderID);
 		bool Link(const GLuint& _vShaderID, const GLuint& _fShaderID);
+		bool Link(const GLuint& _cShaderID);
 		bool IsValid();
 
 	public:
@@ -29,6 +31,7 @@ namespace IceRender
 		~ShaderProgram();
 
 		bool LoadShader(const string& _vShaderPath, const string& _fShaderPath);
+		bool LoadComputeShader(const string& _cShaderPath);
 		bool Active();
 
 		void PrintShader();
@@ -37,6 +40,7 @@ namespace IceRender
 		void Set(const string& _name, int _val);
 		void Set(const string& _name, float _val);
 		void Set(const string& _name, const glm::vec2& _val);
+		void Set(const string& _name, const glm::ivec2& _val);
 		void Set(const string& _name, const glm::vec3& _val);
 		void Set(const string& _name, const glm::vec4& _val);
 		void Set(const string& _name, const glm::mat4& _val);
@@ -0,0 +1,242 @@
+#include "sampleDistribution.hpp"
+#include "../globals.hpp"
+#include "../helpers/utility.hpp"
+#include <cstring>
+#include <limits>
+
+using namespace IceRender;
+using namespace std;
+
+SampleDistribution::SampleDistribution() : enabled(false), boundsBuffer(0), currentReadback(0), hasDepthRange(false), minDepth(0), maxDepth(0), version(0)
+{
+	for (int i = 0; i < readbackNum; i++)
+	{
+		readbackBuffers[i] = 0;
+		readbackPtrs[i] = nullptr;
+		readbackFences[i] = 0;
+	}
+}
+
+SampleDistribution::~SampleDistribution() { Clear(); }
+
+bool SampleDistribution::IsEnabled() const { return enabled; }
+unsigned int SampleDistribution::GetVersion() const { return version; }
+void SampleDistribution::SetEnabled(const bool& _value)
+{
+	enabled = _value;
+	if (!enabled)
+		Clear(); // lights are fitted to the whole scene again
+}
+
+void SampleDistribution::CreateBuffers()
+{
+	glCreateBuffers(1, &boundsBuffer);
+	glNamedBufferStorage(boundsBuffer, sizeof(SampleBounds), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+	// persistently mapped and coherent, the copy is visible to CPU once its fence is signaled
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	for (int i = 0; i < readbackNum; i++)
+	{
+		glCreateBuffers(1, &readbackBuffers[i]);
+		glNamedBufferStorage(readbackBuffers[i], sizeof(SampleBounds), NULL, flags);
+		readbackPtrs[i] = static_cast<SampleBounds*>(glMapNamedBufferRange(readbackBuffers[i], 0, sizeof(SampleBounds), flags));
+		readbackFences[i] = 0;
+	}
+	currentReadback = 0;
+	if (CheckGLError()) { Print("Error in SampleDistribution::CreateBuffers."); return; }
+}
+
+void SampleDistribution::Clear()
+{
+	for (int i = 0; i < readbackNum; i++)
+	{
+		if (readbackFences[i] != 0 && glIsSync(readbackFences[i]))
+			glDeleteSync(readbackFences[i]);
+		readbackFences[i] = 0;
+		if (readbackBuffers[i] != 0 && glIsBuffer(readbackBuffers[i]))
+		{
+			glUnmapNamedBuffer(readbackBuffers[i]);
+			glDeleteBuffers(1, &readbackBuffers[i]);
+		}
+		readbackBuffers[i] = 0;
+		readbackPtrs[i] = nullptr;
+		readbackLights[i].clear();
+	}
+	if (boundsBuffer != 0 && glIsBuffer(boundsBuffer))
+		glDeleteBuffers(1, &boundsBuffer);
+	boundsBuffer = 0;
+
+	hasDepthRange = false;
+	lightBounds.clear();
+	version++;
+}
+
+void SampleDistribution::Update()
+{
+	if (!enabled || boundsBuffer == 0)
+		return;
+
+	// oldest slot first, so the newest finished result is kept. Never waits: a slot which is not finished stops the loop(later ones are newer).
+	for (int i = 0; i < readbackNum; i++)
+	{
+		int slot = (currentReadback + i) % readbackNum;
+		if (readbackFences[slot] == 0)
+			continue;
+		GLenum status = glClientWaitSync(readbackFences[slot], 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(readbackFences[slot]);
+		readbackFences[slot] = 0;
+		ReadResult(slot);
+	}
+}
+
+void SampleDistribution::ReadResult(const int& _slot)
+{
+	const SampleBounds& result = *readbackPtrs[_slot];
+
+	// empty bounds(min > max) mean no visible sample, then the last result is dropped and the whole scene is used
+	float resultMin = OrderedToFloat(result.minDepth), resultMax = OrderedToFloat(result.maxDepth);
+	hasDepthRange = result.minDepth <= result.maxDepth;
+	if (hasDepthRange)
+	{
+		minDepth = resultMin;
+		maxDepth = resultMax;
+	}
+
+	lightBounds.clear();
+	for (int i = 0; i < static_cast<int>(readbackLights[_slot].size()); i++)
+	{
+		const Bounds& bounds = result.lights[i];
+		if (bounds.minX > bounds.maxX || bounds.minY > bounds.maxY || bounds.minZ > bounds.maxZ)
+			continue;
+		LightBounds& light = lightBounds[readbackLights[_slot][i].first];
+		light.lightMat = readbackLights[_slot][i].second;
+		light.ndcMin = glm::vec3(OrderedToFloat(bounds.minX), OrderedToFloat(bounds.minY), OrderedToFloat(bounds.minZ));
+		light.ndcMax = glm::vec3(OrderedToFloat(bounds.maxX), OrderedToFloat(bounds.maxY), OrderedToFloat(bounds.maxZ));
+	}
+	version++;
+}
+
+float SampleDistribution::OrderedToFloat(const GLuint& _value)
+{
+	GLuint bits = (_value & 0x80000000u) != 0 ? _value & 0x7FFFFFFFu : ~_value;
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+void SampleDistribution::AddPasses(FrameGraph& _graph, const FrameGraph::ResourceHandle& _cameraDepth)
+{
+	if (!enabled)
+		return;
+	if (boundsBuffer == 0)
+		CreateBuffers();
+
+	// reduction only writes the readback ring(not tracked by frame graph)
+	_graph.AddPass("SDSMReduce", { _cameraDepth }, {}, [this, depthTex = _cameraDepth, &_graph]() { Reduce(_graph.GetTexture(depthTex)); }, true);
+}
+
+void SampleDistribution::Reduce(const GLuint& _depthTex)
+{
+	// slot is still waiting for GPU(more than "readbackNum" frames behind), skip this frame instead of waiting
+	int slot = currentReadback;
+	if (readbackFences[slot] != 0)
+		return;
+
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "ShadowMap/sampleDistribution");
+	if (shaderPro == nullptr)
+		return;
+
+	// empty bounds: min values are the largest ordered value, max values the smallest one
+	SampleBounds emptyBounds;
+	emptyBounds.minDepth = 0xFFFFFFFFu;
+	emptyBounds.maxDepth = 0;
+	for (auto& bounds : emptyBounds.lights)
+	{
+		bounds.minX = bounds.minY = bounds.minZ = 0xFFFFFFFFu;
+		bounds.maxX = bounds.maxY = bounds.maxZ = 0;
+	}
+	glNamedBufferSubData(boundsBuffer, 0, sizeof(SampleBounds), &emptyBounds);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, boundsBinding, boundsBuffer);
+
+	// light space matrices of this frame(already cropped by the last result), bounds are in their NDC
+	readbackLights[slot].clear();
+	auto lights = GLOBAL.sceneMgr->GetAllLight();
+	for (int i = 0; i < static_cast<int>(lights.size()) && static_cast<int>(readbackLights[slot].size()) < maxLightNum; i++)
+	{
+		if (!lights[i]->IsRenderShadow())
+			continue;
+		LightCamInfo lightCamInfo;
+		glm::mat4 lightMat = lights[i]->GetLightSpaceMat(lightCamInfo);
+		shaderPro->Set("lightMats[" + std::to_string(readbackLights[slot].size()) + "]", lightMat);
+		readbackLights[slot].push_back(std::make_pair(lights[i]->GetName(), lightMat));
+	}
+	shaderPro->Set("lightNum", static_cast<int>(readbackLights[slot].size()));
+
+	glBindTextureUnit(0, _depthTex);
+	shaderPro->Set("depthTex", 0);
+	const int groupSize = 8; // same as local_size_x/y in shader
+	for (int viewIndex = 0; viewIndex < GLOBAL.camCtrller->GetViewNum(); viewIndex++)
+	{
+		glm::ivec4 rect = GLOBAL.render->GetViewRect(viewIndex);
+		auto camera = GLOBAL.camCtrller->GetView(viewIndex);
+		shaderPro->Set("viewRect", glm::vec4(rect));
+		shaderPro->Set("invViewProjMat", glm::inverse(camera->GetProjectionMatrix() * camera->GetViewMatrix()));
+		shaderPro->Set("viewMat", camera->GetViewMatrix());
+		shaderPro->Set("accumulateDepth", viewIndex == 0 ? 1 : 0); // cascades only follow the main camera
+		glDispatchCompute((rect.z + groupSize - 1) / groupSize, (rect.w + groupSize - 1) / groupSize, 1);
+	}
+
+	// copy into the readback slot, CPU reads it in Update() once the fence is signaled(usually next frame)
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(boundsBuffer, readbackBuffers[slot], 0, 0, sizeof(SampleBounds));
+	readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	currentReadback = (currentReadback + 1) % readbackNum;
+	if (CheckGLError()) { Print("Error in SampleDistribution::Reduce."); return; }
+}
+
+bool SampleDistribution::GetDepthRange(float& _minDepth, float& _maxDepth) const
+{
+	if (!enabled || !hasDepthRange)
+		return false;
+	_minDepth = minDepth;
+	_maxDepth = maxDepth;
+	return true;
+}
+
+glm::mat4 SampleDistribution::FitLightSpaceMat(const std::string& _lightName, const glm::mat4& _lightMat) const
+{
+	auto iter = lightBounds.find(_lightName);
+	if (!enabled || iter == lightBounds.end())
+		return _lightMat;
+
+	// bounds are in NDC of the matrix used by the reduction(one frame earlier), move their corners into NDC of "_lightMat". Nothing changes if the light didn't move.
+	const LightBounds& bounds = iter->second;
+	glm::mat4 toLightMat = _lightMat * glm::inverse(bounds.lightMat);
+	glm::vec2 cropMin(std::numeric_limits<float>::max()), cropMax(-std::numeric_limits<float>::max());
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner((i & 1) ? bounds.ndcMax.x : bounds.ndcMin.x, (i & 2) ? bounds.ndcMax.y : bounds.ndcMin.y, (i & 4) ? bounds.ndcMax.z : bounds.ndcMin.z, 1);
+		glm::vec4 p = toLightMat * corner;
+		if (p.w <= 0)
+			return _lightMat; // goes behind a perspective light, keep the whole scene
+		cropMin = glm::min(cropMin, glm::vec2(p) / p.w);
+		cropMax = glm::max(cropMax, glm::vec2(p) / p.w);
+	}
+
+	// quantized outward, so that the crop(and cached shadow maps) only changes when visible samples move by a step
+	const float step = 1.0f / 16.0f;
+	cropMin = glm::clamp(glm::floor(cropMin / step) * step, glm::vec2(-1), glm::vec2(1));
+	cropMax = glm::clamp(glm::ceil(cropMax / step) * step, glm::vec2(-1), glm::vec2(1));
+	if (cropMax.x - cropMin.x < step || cropMax.y - cropMin.y < step)
+		return _lightMat; // visible samples are outside of the light frustum
+
+	// scale and offset xy of NDC, so that the crop rectangle becomes [-1,1]^2. w is not changed, so it also works for perspective lights.
+	glm::mat4 cropMat(1);
+	cropMat[0][0] = 2.0f / (cropMax.x - cropMin.x);
+	cropMat[1][1] = 2.0f / (cropMax.y - cropMin.y);
+	cropMat[3][0] = -(cropMax.x + cropMin.x) / (cropMax.x - cropMin.x);
+	cropMat[3][1] = -(cropMax.y + cropMin.y) / (cropMax.y - cropMin.y);
+	return cropMat * _lightMat;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include "../rasterizer/frameGraph.hpp"
+
+namespace IceRender
+{
+	/*
+	* Sample distribution shadow maps(SDSM): light frustums are fitted to what cameras actually see instead of the whole scene bounding box.
+	* - a compute reduction of the camera depth pre-pass(see Rasterizer::RenderCameraDepth, shared with SSAO) finds:
+	*   view depth range of visible samples of the main camera(splits of cascades, see DirectLight::UpdateCascades),
+	*   and bounds of visible samples in NDC of each shadow light(its light space matrix of that frame).
+	* - results are copied into a small readback ring protected by fences, and read one frame later without waiting(a busy slot is skipped).
+	* - "FitLightSpaceMat" crops the light space matrix of a light(the whole scene) to the last bounds, shadow resolution is only spent on visible receivers.
+	* [Note] only xy of light space is cropped, near/far still cover the whole scene so that casters outside of the view still cast shadow.
+	* Refer: "Sample Distribution Shadow Maps"(Lauritzen, Salvi, Lefohn 2011).
+	*/
+	class SampleDistribution
+	{
+	private:
+		static const int maxLightNum = 5; // same as "maxLightNum" in "ShadowMap/sampleDistribution.cs"
+		static const int boundsBinding = 8; // binding of "SampleBoundsBuffer" in "ShadowMap/sampleDistribution.cs"
+
+		/*floats are stored as ordered unsigned integers(see "ShadowMap/sampleDistribution.cs"), layout is the same as "SampleBoundsBuffer"*/
+		struct Bounds
+		{
+			GLuint minX, minY, minZ;
+			GLuint maxX, maxY, maxZ;
+		};
+		struct SampleBounds
+		{
+			GLuint minDepth, maxDepth;
+			Bounds lights[maxLightNum];
+		};
+
+		/*bounds of visible samples of a light, in NDC of "lightMat"*/
+		struct LightBounds
+		{
+			glm::mat4 lightMat; // light space matrix used by the reduction
+			glm::vec3 ndcMin, ndcMax;
+		};
+
+		bool enabled;
+		GLuint boundsBuffer; // SSBO written by reduction, reset every frame
+
+		/*readback ring*/
+		static const int readbackNum = 3;
+		GLuint readbackBuffers[readbackNum]; // persistently mapped
+		SampleBounds* readbackPtrs[readbackNum];
+		GLsync readbackFences[readbackNum]; // 0 if the slot is free
+		std::vector<std::pair<std::string, glm::mat4>> readbackLights[readbackNum]; // light name and light space matrix of each "lights" element of the slot
+		int currentReadback;
+
+		/*results of the latest readback*/
+		bool hasDepthRange;
+		float minDepth, maxDepth;
+		std::map<std::string, LightBounds> lightBounds; // key is light name
+		unsigned int version; // increased when results change
+
+		void CreateBuffers();
+		void Reduce(const GLuint& _depthTex);
+		void ReadResult(const int& _slot);
+
+		static float OrderedToFloat(const GLuint& _value); // inverse of "FloatToOrdered" in shader
+
+	public:
+		SampleDistribution();
+		~SampleDistribution();
+
+		bool IsEnabled() const;
+		void SetEnabled(const bool& _value);
+
+		void Update(); // once per frame before lights are used(e.g. culling, cascades), read the finished readback
+		void AddPasses(FrameGraph& _graph, const FrameGraph::ResourceHandle& _cameraDepth); // reduction of camera depth, it has side effect(readback) so it is never culled
+		void Clear(); // release buffers and results
+
+		unsigned int GetVersion() const; // fitted light space matrices change with it, used by caches of light space matrices(see BaseLight::GetLightSpaceMat)
+		// view depth range of visible samples of the main camera, false if there is no result yet
+		bool GetDepthRange(float& _minDepth, float& _maxDepth) const;
+		// crop "_lightMat"(light space matrix fitted to the whole scene) to visible samples of light "_lightName", unchanged if there is no result
+		glm::mat4 FitLightSpaceMat(const std::string& _lightName, const glm::mat4& _lightMat) const;
+	};
+}
@@ -2,12 +2,14 @@
 #include "../globals.hpp"
 #include "../helpers/utility.hpp"
 #include "../mesh/meshGenerator.hpp"
+#include "../light/directLight.hpp"
+#include <limits>
 
 
 using namespace IceRender;
 using namespace std;
 
-ShadowManager::ShadowManager() : useTightSpace(false) {}
+ShadowManager::ShadowManager() : useTightSpace(false), sampleDistribution(make_shared<SampleDistribution>()) {}
 
 ShadowManager::~ShadowManager()
 {
@@ -19,6 +21,7 @@ void ShadowManager::RemoveShadowRender()
 	if (shadowRender != nullptr)
 		shadowRender->Clear();
 	shadowRender = nullptr;
+	sampleDistribution->Clear(); // results belong to the removed lights/scene
 }
 
 void ShadowManager::LoadShadowRender(nlohmann::json _data)
@@ -29,6 +32,8 @@ void ShadowManager::LoadShadowRender(nlohmann::json _data)
 	{
 		RemoveShadowRender();
 
+		shadowConfig = _data; // keep it to rebuild shadow render when render resolution changes
+
 		method = string(_data["shadow_method"]);
 
 		if (method == "ShadowMap" || method == "VarianceShadowMap" || method == "VSSM")
@@ -59,6 +64,12 @@ void ShadowManager::LoadShadowRender(nlohmann::json _data)
 				else
 					vsmRender->SetUseSAT(false);
 
+				// "float"(default): RG32F SAT, "fixed": RG32UI fixed-point SAT with exact sums
+				if (_data.contains("sat_format"))
+					vsmRender->SetUseFixedSAT(_data["sat_format"] == "fixed");
+				else
+					vsmRender->SetUseFixedSAT(false);
+
 				// setting PCSS
 				bool usePCSS = false;
 				if (_data.contains("use_pcss"))
@@ -94,11 +105,35 @@ void ShadowManager::LoadShadowRender(nlohmann::json _data)
 					else
 						penumbraRatio = 1.0;
 
+					// min/max depth pyramid skips blocker search of fully lit/blocked receivers
+					if (_data.contains("use_depth_pyramid"))
+						vsmRender->SetUseDepthPyramid(_data["use_depth_pyramid"].get<bool>());
+					else
+						vsmRender->SetUseDepthPyramid(true);
+
 					vsmRender->InitPCSS(true, maxSearchSize, lightSize, minPenumbraSize, maxPenumbraSize, penumbraRatio);
 				}
 				else
 					vsmRender->InitPCSS(false, 0, 0, 0, 0, 0);
 
+				// prefiltered moments: separable blur of "kernel_size" instead of SAT or per-fragment kernel, "use_evsm" for exponential moments
+				if (_data.contains("use_blur") && _data["use_blur"].get<bool>())
+				{
+					if (vsmRender->IsUseSAT() || usePCSS)
+						Print("[Warning] VSM: \"use_blur\" is ignored with \"use_sat\" or \"use_pcss\".");
+					else
+					{
+						bool useEVSM = _data.contains("use_evsm") && _data["use_evsm"].get<bool>();
+						glm::vec2 evsmExponents(40, 5);
+						if (_data.contains("evsm_exponents"))
+						{
+							auto exponents = _data["evsm_exponents"].get<std::vector<float>>();
+							evsmExponents = glm::vec2(exponents[0], exponents[1]);
+						}
+						vsmRender->SetUseBlur(true, useEVSM, evsmExponents);
+					}
+				}
+
 				basicShadowMapRender = vsmRender;
 			}
 			else if (method == "VSSM")
@@ -117,6 +152,12 @@ void ShadowManager::LoadShadowRender(nlohmann::json _data)
 				else
 					vssmRender->SetPMin(0);
 
+				// "float"(default): RG32F SAT, "fixed": RG32UI fixed-point SAT with exact sums
+				if (_data.contains("sat_format"))
+					vssmRender->SetUseFixedSAT(_data["sat_format"] == "fixed");
+				else
+					vssmRender->SetUseFixedSAT(false);
+
 				// setting PCSS
 				int maxSearchSize, lightSize, minPenumbraSize, maxPenumbraSize;
 				float penumbraRatio;
@@ -212,6 +253,12 @@ void ShadowManager::LoadShadowRender(nlohmann::json _data)
 						else
 							penumbraRatio = 1.0;
 
+						// min/max depth pyramid skips blocker search of fully lit/blocked receivers
+						if (_data.contains("use_depth_pyramid"))
+							smRender->SetUseDepthPyramid(_data["use_depth_pyramid"].get<bool>());
+						else
+							smRender->SetUseDepthPyramid(true);
+
 						smRender->InitPCSS(true, maxSearchSize, lightSize, minPenumbraSize, maxPenumbraSize, penumbraRatio);
 					}
 					else
@@ -227,27 +274,54 @@ void ShadowManager::LoadShadowRender(nlohmann::json _data)
 				basicShadowMapRender->SetResolution(res[0], res[1]);
 			}
 			else
-				basicShadowMapRender->SetResolution(GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT);
+				basicShadowMapRender->SetResolution(GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // follow internal render resolution
 
 			if (_data.contains("use_tight_space"))
 				GLOBAL.shadowMgr->SetUseTightSpace(_data["use_tight_space"].get<bool>());
 
+			// fit light frustums to visible samples of cameras(one frame late)
+			if (_data.contains("use_sdsm"))
+				SetUseSDSM(_data["use_sdsm"].get<bool>());
+			else
+				SetUseSDSM(false);
+
 
 			shadowRender = basicShadowMapRender;
 		}
 	}
 }
 
+void ShadowManager::OnRenderResolutionChanged()
+{
+	// only shadow render using the default resolution follows render resolution
+	if (shadowRender == nullptr || shadowConfig.contains("resolution"))
+		return;
+	nlohmann::json config = shadowConfig;
+	LoadShadowRender(config);
+	InitShadowRender();
+}
+
 void ShadowManager::InitShadowRender()
 {
-	if (shadowRender != nullptr)
+	// without OpenGL context only parameters of shadow render are used(e.g. by SoftwareRasterizer), no texture is created
+	if (shadowRender != nullptr && !GLOBAL.headless)
 		shadowRender->Init();
 }
 
-void ShadowManager::RenderShadow()
+void ShadowManager::UpdateShadowViews()
 {
+	sampleDistribution->Update(); // bounds of last frames are used by light space matrices of this frame
 	if (shadowRender)
-		shadowRender->Render();
+		shadowRender->UpdateShadowViews();
+}
+
+void ShadowManager::AddShadowPasses(FrameGraph& _graph, const FrameGraph::ResourceHandle& _cameraDepth, std::vector<FrameGraph::ResourceHandle>& _outputs)
+{
+	if (shadowRender)
+	{
+		sampleDistribution->AddPasses(_graph, _cameraDepth);
+		shadowRender->AddPasses(_graph, _outputs);
+	}
 }
 
 bool ShadowManager::IsNeedShadowRender() { return shadowRender != nullptr; }
@@ -286,22 +360,448 @@ void ShadowManager::SaveShadowMap(const std::string& _lightName) const
 std::shared_ptr<BasicShadowRender> ShadowManager::GetShadowRender() { return shadowRender; }
 
 bool ShadowManager::IsUseTightSpace() const { return useTightSpace; }
-void ShadowManager::SetUseTightSpace(const bool& _value) { useTightSpace = _value; }
+void ShadowManager::SetUseTightSpace(const bool& _value)
+{
+	useTightSpace = _value;
+	if (shadowRender != nullptr)
+		shadowRender->InvalidateCache(); // light space matrices are changed
+}
+
+bool ShadowManager::IsUseSDSM() const { return sampleDistribution->IsEnabled(); }
+// [Note] no need to invalidate cached shadow maps, they are re-rendered once light space matrices change
+void ShadowManager::SetUseSDSM(const bool& _value) { sampleDistribution->SetEnabled(_value); }
+std::shared_ptr<SampleDistribution> ShadowManager::GetSampleDistribution() { return sampleDistribution; }
 
 
 #pragma region Basic Shadow Map Class Definition
+BasicShadowMapRender::BasicShadowMapRender() : resWidth(0), resHeight(0), cachedSceneVersion(0), cachedTransformVersion(0), layeredLightBuffer(0),
+	useDepthPyramid(true), depthPyramidTex(0), depthPyramidLevels(0) {}
+
 void BasicShadowMapRender::GetResolution(int& _width, int& _height) const { _width = resWidth; _height = resHeight; }
 void BasicShadowMapRender::SetResolution(int _w, int _h) { resWidth = _w; resHeight = _h; }
 
 void BasicShadowMapRender::Init() {/*do nothing*/ }
-void BasicShadowMapRender::Render() {/*do nothing*/ }
-void BasicShadowMapRender::Clear() { components.clear(); }
+void BasicShadowMapRender::AddPasses(FrameGraph&, std::vector<FrameGraph::ResourceHandle>&) {/*do nothing*/ }
+void BasicShadowMapRender::Clear()
+{
+	components.clear();
+	InvalidateCache();
+
+	if (layeredLightBuffer != 0 && glIsBuffer(layeredLightBuffer))
+		glDeleteBuffers(1, &layeredLightBuffer);
+	layeredLightBuffer = 0;
+}
+
+void BasicShadowMapRender::InvalidateCache()
+{
+	cachedSceneVersion = cachedTransformVersion = 0;
+	cachedViewVersions.clear();
+	cachedViewMats.clear();
+	dirtyViewAreas.clear();
+	cachedObjectVersions.clear();
+	cachedObjectBounds.clear();
+}
+
+int BasicShadowMapRender::GetShadowViewKey(const int& _lightIndex, const int& _view) { return _lightIndex + _view * GLOBAL.sceneMgr->GetMaxLightNum(); }
+
+void BasicShadowMapRender::UpdateShadowViews()
+{
+	// cascades follow the main camera(view 0). Other views(see CameraController::AddView) only get shadows where they overlap its frustum.
+	auto camera = GLOBAL.camCtrller->GetView(0);
+	auto lights = GLOBAL.sceneMgr->GetAllLight();
+	for (int i = 0; i < static_cast<int>(lights.size()); i++)
+	{
+		if (lights[i]->IsRenderShadow() && lights[i]->GetType() == LightType::DIRECT)
+			static_pointer_cast<DirectLight>(lights[i])->UpdateCascades(camera, GetShadowTileSize(i));
+	}
+}
 GLuint BasicShadowMapRender::GetDepthFrameBuffer(const int& _lightIndex) {/*do nothing*/ return 0; }
 GLuint BasicShadowMapRender::GetDepthTexture(const int& _lightIndex) {/*do nothing*/ return 0; }
 void BasicShadowMapRender::SaveShadowMap(const int& _lightIndex, const std::string& _lightName) {/*do nothing*/ }
 void BasicShadowMapRender::InitComputeLightRatioParameters(shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit) {/*do nothing*/ }
 int BasicShadowMapRender::AddComponent(std::shared_ptr<BasicShadowComponent>& _component) { components.push_back(_component); return components.size() - 1; }
 std::shared_ptr<BasicShadowComponent>& BasicShadowMapRender::GetComponent(const int& _index) { return components[_index]; }
+
+int BasicShadowMapRender::GetLightSize() const { return 0; }
+
+void BasicShadowMapRender::SetUseDepthPyramid(const bool& _value) { useDepthPyramid = _value; }
+bool BasicShadowMapRender::IsUseDepthPyramid() const { return useDepthPyramid; }
+
+int BasicShadowMapRender::GetPCSSLightSize(const int& _pcssIndex) const
+{
+	if (_pcssIndex == -1)
+		return 0;
+	int maxSearchSize, lightSize, minPenumbraSize, maxPenumbraSize;
+	float penumbraRatio;
+	static_pointer_cast<PercentageCloserSoftFilter>(components[_pcssIndex])->GetParams(maxSearchSize, lightSize, minPenumbraSize, maxPenumbraSize, penumbraRatio);
+	return lightSize;
+}
+
+int BasicShadowMapRender::GetPCSSMaxPenumbraSize(const int& _pcssIndex) const
+{
+	if (_pcssIndex == -1)
+		return 0;
+	int maxSearchSize, lightSize, minPenumbraSize, maxPenumbraSize;
+	float penumbraRatio;
+	static_pointer_cast<PercentageCloserSoftFilter>(components[_pcssIndex])->GetParams(maxSearchSize, lightSize, minPenumbraSize, maxPenumbraSize, penumbraRatio);
+	return maxPenumbraSize;
+}
+
+// area of "_bounds" in NDC of "_lightMat"(xy: min, zw: max), return false if it is outside of the light frustum
+static bool ProjectBounds(const glm::mat4& _lightMat, const AABB& _bounds, glm::vec4& _area)
+{
+	glm::vec3 min = _bounds.GetMin(), max = _bounds.GetMax();
+	_area = glm::vec4(1, 1, -1, -1);
+	int behindNum = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 p = _lightMat * glm::vec4(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z, 1);
+		if (p.w <= 0)
+		{
+			behindNum++;
+			continue;
+		}
+		_area = glm::vec4(glm::min(glm::vec2(_area), glm::vec2(p) / p.w), glm::max(glm::vec2(_area.z, _area.w), glm::vec2(p) / p.w));
+	}
+	if (behindNum == 8)
+		return false; // behind a perspective light
+	if (behindNum > 0)
+		_area = glm::vec4(-1, -1, 1, 1); // crosses the plane of a perspective light, its projection is unbounded
+	_area = glm::clamp(_area, glm::vec4(-1), glm::vec4(1));
+	return _area.x < _area.z && _area.y < _area.w;
+}
+
+void BasicShadowMapRender::UpdateCachedScene()
+{
+	// [Note] light space matrices depend on scene bounding box, so a moved object usually changes them. Views are checked against their matrices in IsShadowDirty.
+	unsigned int sceneVersion = GLOBAL.sceneMgr->GetVersion();
+	unsigned int transformVersion = GLOBAL.sceneMgr->GetTransformVersion();
+	auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject();
+	if (sceneVersion != cachedSceneVersion || cachedObjectVersions.size() != sceneObjs.size())
+	{
+		// objects are added or removed, all views are re-rendered
+		cachedViewVersions.clear();
+		cachedViewMats.clear();
+		dirtyViewAreas.clear();
+		cachedObjectVersions.clear();
+		cachedObjectBounds.clear();
+		for (auto& sceneObj : sceneObjs)
+		{
+			cachedObjectVersions.push_back(sceneObj->GetTransform()->GetVersion());
+			cachedObjectBounds.push_back(*sceneObj->GetBoundingBox());
+		}
+		cachedSceneVersion = sceneVersion;
+		cachedTransformVersion = transformVersion;
+		return;
+	}
+	if (transformVersion == cachedTransformVersion)
+		return;
+	cachedTransformVersion = transformVersion;
+
+	// old and new bounding boxes of moved objects are dirty in every cached view
+	for (int i = 0; i < static_cast<int>(sceneObjs.size()); i++)
+	{
+		unsigned int version = sceneObjs[i]->GetTransform()->GetVersion();
+		if (version == cachedObjectVersions[i])
+			continue;
+		AABB bounds = *sceneObjs[i]->GetBoundingBox();
+		for (auto& item : cachedViewMats)
+		{
+			for (const AABB& dirtyBounds : { cachedObjectBounds[i], bounds })
+			{
+				glm::vec4 area;
+				if (!dirtyBounds.IsValid() || !ProjectBounds(item.second, dirtyBounds, area))
+					continue;
+				auto iter = dirtyViewAreas.find(item.first);
+				if (iter == dirtyViewAreas.end())
+					dirtyViewAreas[item.first] = area;
+				else
+					iter->second = glm::vec4(glm::min(glm::vec2(iter->second), glm::vec2(area)), glm::max(glm::vec2(iter->second.z, iter->second.w), glm::vec2(area.z, area.w)));
+			}
+		}
+		cachedObjectVersions[i] = version;
+		cachedObjectBounds[i] = bounds;
+	}
+}
+
+bool BasicShadowMapRender::IsShadowDirty(const ShadowView& _view)
+{
+	auto light = GLOBAL.sceneMgr->GetAllLight()[_view.lightIndex];
+	auto iter = cachedViewVersions.find(_view.key);
+	if (iter == cachedViewVersions.end() || iter->second != light->GetShadowViewVersion(_view.index))
+		return true;
+	LightCamInfo lightCamInfo;
+	return cachedViewMats[_view.key] != light->GetShadowViewMat(_view.index, lightCamInfo);
+}
+
+void BasicShadowMapRender::MarkShadowUpdated(const ShadowView& _view)
+{
+	auto light = GLOBAL.sceneMgr->GetAllLight()[_view.lightIndex];
+	LightCamInfo lightCamInfo;
+	cachedViewVersions[_view.key] = light->GetShadowViewVersion(_view.index);
+	cachedViewMats[_view.key] = light->GetShadowViewMat(_view.index, lightCamInfo);
+	dirtyViewAreas.erase(_view.key);
+}
+
+glm::ivec2 BasicShadowMapRender::GetShadowTileSize(const int& _lightIndex) const
+{
+	float scale = GLOBAL.sceneMgr->GetAllLight()[_lightIndex]->GetShadowResolutionScale();
+	return glm::max(glm::ivec2(glm::round(glm::vec2(resWidth, resHeight) * scale)), glm::ivec2(1));
+}
+
+std::map<int, glm::ivec2> BasicShadowMapRender::GetShadowTileSizes() const
+{
+	// [Note] each view gets the full tile size: cascades and cube faces cover a part of the scene each, so a lower "shadow_resolution_scale" is usually enough
+	std::map<int, glm::ivec2> tileSizes;
+	auto lights = GLOBAL.sceneMgr->GetAllLight();
+	for (int i = 0; i < static_cast<int>(lights.size()); i++)
+	{
+		if (!lights[i]->IsRenderShadow())
+			continue;
+		for (int c = 0; c < lights[i]->GetShadowViewNum(); c++)
+			tileSizes[GetShadowViewKey(i, c)] = GetShadowTileSize(i);
+	}
+	return tileSizes;
+}
+
+std::vector<BasicShadowMapRender::ShadowView> BasicShadowMapRender::GetDirtyShadowViews(const ShadowAtlas& _atlas)
+{
+	UpdateCachedScene();
+
+	std::vector<ShadowView> dirtyViews;
+	auto lights = GLOBAL.sceneMgr->GetAllLight();
+	for (int i = 0; i < static_cast<int>(lights.size()); i++)
+	{
+		if (!lights[i]->IsRenderShadow())
+			continue;
+		for (int c = 0; c < lights[i]->GetShadowViewNum(); c++)
+		{
+			ShadowView view = { i, c, GetShadowViewKey(i, c), false, glm::ivec4(0) };
+			if (!_atlas.HasTile(view.key))
+				continue;
+			view.rect = glm::ivec4(_atlas.GetTileRect(view.key));
+			if (IsShadowDirty(view))
+			{
+				dirtyViews.push_back(view);
+				continue;
+			}
+
+			auto iter = dirtyViewAreas.find(view.key);
+			if (iter == dirtyViewAreas.end())
+				continue;
+			// NDC area to texels of the tile, 1 texel more on each side for conservative rasterization of edges
+			glm::vec4 area = iter->second * 0.5f + 0.5f;
+			glm::ivec2 minTexel = glm::max(glm::ivec2(glm::floor(glm::vec2(area) * glm::vec2(view.rect.z, view.rect.w))) - 1, glm::ivec2(0));
+			glm::ivec2 maxTexel = glm::min(glm::ivec2(glm::ceil(glm::vec2(area.z, area.w) * glm::vec2(view.rect.z, view.rect.w))) + 1, glm::ivec2(view.rect.z, view.rect.w));
+			view.partial = true;
+			view.rect = glm::ivec4(view.rect.x + minTexel.x, view.rect.y + minTexel.y, maxTexel - minTexel);
+			dirtyViews.push_back(view);
+		}
+	}
+	return dirtyViews;
+}
+
+glm::ivec2 BasicShadowMapRender::GetDirtyCorner(const std::vector<ShadowView>& _views)
+{
+	glm::ivec2 corner(std::numeric_limits<int>::max());
+	for (auto& view : _views)
+		corner = glm::min(corner, glm::ivec2(view.rect));
+	return corner;
+}
+
+void BasicShadowMapRender::SetShadowViewport(const ShadowView& _view, const ShadowAtlas& _atlas)
+{
+	// viewport covers the whole tile so that the light frustum maps to it, scissor keeps clearing and drawing inside the changed texels
+	_atlas.SetViewport(_view.key);
+	glScissor(_view.rect.x, _view.rect.y, _view.rect.z, _view.rect.w);
+}
+
+void BasicShadowMapRender::SetShadowViewParameters(shared_ptr<ShaderProgram>& _shaderPro, const int& _lightIndex, const ShadowAtlas& _atlas)
+{
+	// lightRatio sub shaders replace "lightMat"/"atlasTile" by the view containing the fragment(see "ShadowMap/shadowView.sub_fs")
+	auto light = GLOBAL.sceneMgr->GetAllLight()[_lightIndex];
+	std::string prefix = "lightCamInfos[" + std::to_string(_lightIndex) + "].";
+	int viewNum = light->GetShadowViewNum();
+	_shaderPro->Set(prefix + "viewNum", viewNum);
+	for (int v = 0; viewNum > 1 && v < viewNum; v++)
+	{
+		LightCamInfo lightCamInfo;
+		_shaderPro->Set(prefix + "viewMats[" + std::to_string(v) + "]", light->GetShadowViewMat(v, lightCamInfo));
+		_shaderPro->Set(prefix + "viewTiles[" + std::to_string(v) + "]", _atlas.GetTileRect(GetShadowViewKey(_lightIndex, v)));
+	}
+}
+
+void BasicShadowMapRender::RenderLayered(const std::vector<ShadowView>& _views, const ShadowAtlas& _atlas, const std::string& _shaderName)
+{
+	// views re-rendered entirely share one instanced draw(per object, or per batch of maxLayerNum views with GPU culling), a partially dirty view is drawn alone so that the scissor keeps the rest of its tile
+	std::vector<ShadowView> fullViews;
+	for (auto& view : _views)
+	{
+		if (view.partial)
+			continue;
+		fullViews.push_back(view);
+		if (static_cast<int>(fullViews.size()) == GPUCulling::maxLayerNum)
+		{
+			DrawLayered(fullViews, _atlas, _shaderName);
+			fullViews.clear();
+		}
+	}
+	DrawLayered(fullViews, _atlas, _shaderName);
+
+	glEnable(GL_SCISSOR_TEST);
+	for (auto& view : _views)
+	{
+		if (!view.partial)
+			continue;
+		glScissor(view.rect.x, view.rect.y, view.rect.z, view.rect.w);
+		DrawLayered({ view }, _atlas, _shaderName);
+	}
+	glDisable(GL_SCISSOR_TEST);
+}
+
+void BasicShadowMapRender::DrawLayered(const std::vector<ShadowView>& _views, const ShadowAtlas& _atlas, const std::string& _shaderName)
+{
+	if (_views.empty())
+		return;
+
+	auto lights = GLOBAL.sceneMgr->GetAllLight();
+	int width, height;
+	_atlas.GetSize(width, height);
+
+	// light matrices of all views in one buffer, instance i reads element i
+	std::vector<LayeredLight> layeredLights(_views.size());
+	std::vector<glm::mat4> lightMats(_views.size());
+	for (int i = 0; i < static_cast<int>(_views.size()); i++)
+	{
+		LightCamInfo lightCamInfo;
+		layeredLights[i].lightMat = lightMats[i] = lights[_views[i].lightIndex]->GetShadowViewMat(_views[i].index, lightCamInfo);
+		layeredLights[i].lightCamPosNear = glm::vec4(lightCamInfo.lightCamPos, lightCamInfo.near);
+		layeredLights[i].lightViewDirFar = glm::vec4(lightCamInfo.lightViewDir, lightCamInfo.far);
+
+		// [-1,1]^2 of light maps to the tile, same as setting viewport to the tile(see ShadowAtlas::SetViewport)
+		auto tile = _atlas.GetTile(_views[i].key);
+		layeredLights[i].tileTransform = glm::vec4(static_cast<float>(tile.width) / width, static_cast<float>(tile.height) / height,
+			static_cast<float>(2 * tile.x + tile.width) / width - 1.0f, static_cast<float>(2 * tile.y + tile.height) / height - 1.0f);
+	}
+	if (layeredLightBuffer == 0)
+		glCreateBuffers(1, &layeredLightBuffer);
+	glNamedBufferData(layeredLightBuffer, layeredLights.size() * sizeof(LayeredLight), layeredLights.data(), GL_DYNAMIC_DRAW); if (CheckGLError()) { Print("Error in BasicShadowMapRender::DrawLayered."); return; }
+
+	// with GPU culling, objects outside of all views are culled and the rest is drawn by one multi-draw call, each command has one instance per view.
+	// A single view is already culled by Rasterizer(see GPUCulling::GetLightViewIndex), more views are culled together into the layered view.
+	bool useGPUCulling = GLOBAL.render->IsUseGPUCulling();
+	int cullViewIndex = 0;
+	if (useGPUCulling)
+	{
+		auto gpuCulling = GLOBAL.render->GetGPUCulling();
+		cullViewIndex = _views.size() == 1 ? GPUCulling::GetLightViewIndex(_views[0].key) : gpuCulling->GetLayeredViewIndex();
+		if (_views.size() > 1)
+			gpuCulling->CullLayered(cullViewIndex, lightMats);
+	}
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + _shaderName + (useGPUCulling ? "Indirect" : ""), GLOBAL.render->GetVertexVariant());
+	if (shaderPro == nullptr)
+		return;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, layeredLightBinding, layeredLightBuffer); // after culling, which binds its command buffer to the same binding
+
+	// viewport is the whole atlas, each instance is clipped against its light frustum by gl_ClipDistance so that it stays inside its tile
+	glViewport(0, 0, width, height);
+	for (int i = 0; i < 4; i++)
+		glEnable(GL_CLIP_DISTANCE0 + i);
+
+	GLsizei instanceNum = static_cast<GLsizei>(_views.size());
+	if (useGPUCulling)
+		GLOBAL.render->GetGPUCulling()->DrawVisible(cullViewIndex, instanceNum);
+	else
+	{
+		auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
+		for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
+		{
+			auto sceneObj = *iter;
+			glm::mat4 modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
+			shaderPro->Set("modelMat", modelMat);
+			GLOBAL.render->Draw(sceneObj, 0, instanceNum);
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+		glDisable(GL_CLIP_DISTANCE0 + i);
+	CheckGLError();
+}
+
+void BasicShadowMapRender::InitDepthPyramid(const ShadowAtlas& _atlas)
+{
+	ClearDepthPyramid();
+	int width, height;
+	_atlas.GetSize(width, height);
+	if (width == 0 || height == 0)
+		return;
+
+	// enough levels for one texel of the last level to cover the whole atlas
+	depthPyramidLevels = 1;
+	while ((1 << depthPyramidLevels) < std::max(width, height))
+		depthPyramidLevels++;
+	// [Note] mip sizes are floor(size/2), so level 0 is rounded up to a multiple of 2^(levels-1): atlas texel t is always inside texel t>>(k+1) of level k.
+	int blockSize = 1 << depthPyramidLevels;
+	int levelWidth = (width + blockSize - 1) / blockSize * (blockSize / 2);
+	int levelHeight = (height + blockSize - 1) / blockSize * (blockSize / 2);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthPyramidTex); if (CheckGLError()) { Print("Error in BasicShadowMapRender::InitDepthPyramid."); return; };
+	glTextureStorage2D(depthPyramidTex, depthPyramidLevels, GL_RG32F, levelWidth, levelHeight); if (CheckGLError()) { Print("Error in BasicShadowMapRender::InitDepthPyramid."); return; };
+	// only "texelFetch" with explicit levels
+	glTextureParameteri(depthPyramidTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(depthPyramidTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(depthPyramidTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(depthPyramidTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// padding around tiles is never rendered, so texels only covering padding are never reduced. They keep far depth(1) as the atlas.
+	const float farDepth[] = { 1.0f, 1.0f, 0.0f, 0.0f };
+	for (int level = 0; level < depthPyramidLevels; level++)
+		glClearTexImage(depthPyramidTex, level, GL_RG, GL_FLOAT, farDepth);
+	if (CheckGLError()) { Print("Error in BasicShadowMapRender::InitDepthPyramid."); return; }
+}
+
+void BasicShadowMapRender::BuildDepthPyramid(const std::vector<ShadowView>& _views, const GLuint& _depthTex)
+{
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "ShadowMap/depthPyramid");
+	if (shaderPro == nullptr)
+		return;
+	const int groupSize = 8; // same as local_size
+	shaderPro->Set("texInput", 0);
+
+	// level by level, each level only reads the previous one. Texels of a level are re-reduced if they cover the changed texels("rect") of a view.
+	for (int level = 0; level < depthPyramidLevels; level++)
+	{
+		shaderPro->Set("inputLevel", level - 1);
+		glBindTextureUnit(0, level == 0 ? _depthTex : depthPyramidTex);
+		glBindImageTexture(0, depthPyramidTex, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+		for (auto& view : _views)
+		{
+			glm::ivec2 minTexel = glm::ivec2(view.rect.x, view.rect.y) >> (level + 1);
+			glm::ivec2 maxTexel = glm::ivec2(view.rect.x + view.rect.z - 1, view.rect.y + view.rect.w - 1) >> (level + 1);
+			glm::ivec2 size = maxTexel - minTexel + 1;
+			shaderPro->Set("texelRect", glm::vec4(minTexel.x, minTexel.y, size.x, size.y));
+			glDispatchCompute((size.x + groupSize - 1) / groupSize, (size.y + groupSize - 1) / groupSize, 1);
+		}
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+	if (CheckGLError()) { Print("Error in BasicShadowMapRender::BuildDepthPyramid."); return; }
+}
+
+void BasicShadowMapRender::SetDepthPyramidParameters(shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit)
+{
+	// [Note] "depthPyramid" always gets its own unit(even if unused), so it never shares a unit with samplers of other types(e.g. "sampler2DShadow")
+	_shaderPro->Set("useDepthPyramid", depthPyramidTex != 0 ? 1 : 0);
+	_shaderPro->Set("depthPyramidLevels", depthPyramidLevels);
+	_shaderPro->Set("depthPyramid", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, depthPyramidTex);
+}
+
+void BasicShadowMapRender::ClearDepthPyramid()
+{
+	if (depthPyramidTex != 0 && glIsTexture(depthPyramidTex))
+		glDeleteTextures(1, &depthPyramidTex);
+	depthPyramidTex = 0;
+	depthPyramidLevels = 0;
+}
 #pragma endregion
 
 #pragma region Shadow Components
@@ -330,96 +830,121 @@ void PercentageCloserSoftFilter::GetParams(int& _maxSearchSize, int& _lightSize,
 
 
 #pragma region ShadowMap Technique
+ShadowMapRender::ShadowMapRender() : depthFBO(0), compareTex(0), bias(0), pcfIndex(-1), pcssIndex(-1) {}
+
 void ShadowMapRender::Init()
 {
-	depthMap.clear();
+	ClearTextures();
+	InvalidateCache();
 
-	auto lights = GLOBAL.sceneMgr->GetAllLight();
-	// TODO: to improve here, search paper how to solve large number light sources situation
-	// create depth shadow map for each light which need to render shadow
-	for (int i = 0; i < lights.size(); i++)
+	// all lights which need to render shadow share one depth atlas(see ShadowAtlas), each light owns a tile
+	std::map<int, glm::ivec2> tileSizes = GetShadowTileSizes();
+	if (tileSizes.empty())
+		return;
+
+	/*----------------------------------------------------depth relevant start----------------------------------------------------*/
+	bool result = atlas.Init(tileSizes, [](GLuint& _texID, const int& _width, const int& _height)
+		{
+			// create a depth texture
+			glCreateTextures(GL_TEXTURE_2D, 1, &_texID); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
+			// allocate storage for it
+			// [Note] below using 32F for depth component is for float precision. (if i am correct, 32F can be used to store float value including negative and value greater than 1)
+			// [Note]"GL_DEPTH_COMPONENT16" is enough, no need to use 32F. Compared results can be found "Output\ShadowMaps": "ShadowMap-Depth16" vs "ShadowMap-Depth32F".
+			glTextureStorage2D(_texID, 1, GL_DEPTH_COMPONENT16, _width, _height); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
+			//glTextureStorage2D(_texID, 1, GL_DEPTH_COMPONENT32F, _width, _height); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
+			// Set the default filtering modes
+			glTextureParameteri(_texID, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(_texID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			// Set up wrapping modes
+			// not using GL_CLAMP_TOEDGE! If pixel gets outside of Texture, make its depth to 1.
+			// [Note] lookups are clamped inside the tile and its padding in shaders, border only matters for tiles at the atlas edge
+			glTextureParameteri(_texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(_texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			const float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			glTextureParameterfv(_texID, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
+			// padding around tiles is never rendered, it keeps depth 1
+			const float farDepth = 1.0f;
+			glClearTexImage(_texID, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
+			// not using mipmap for depth tex because it is non-linear (after projection). But it can be used to store the true depth(z) before projection then mipmap is possible in VSM
+		});
+	if (!result) { Print("Error in ShadowMapRender::Init."); return; }
+	GLuint depthTex = atlas.GetTexture();
+
+	// A second "sampler" of the same depth storage: texture view with depth comparison, so that lightRatio sub shaders can use "sampler2DShadow".
+	// One lookup returns the bilinear weighted result of comparing 2x2 texels(hardware PCF), used by PCF/PCSS filtering instead of 4 "texture()" fetches.
+	// [Note] a texture view is used instead of a sampler object, because a sampler object stays bound to its texture unit and would affect other textures using this unit later.
+	glGenTextures(1, &compareTex); // texture view requires a name which is not bound yet, so not using glCreateTextures
+	glTextureView(compareTex, GL_TEXTURE_2D, depthTex, GL_DEPTH_COMPONENT16, 0, 1, 0, 1); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
+	glTextureParameteri(compareTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(compareTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(compareTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(compareTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	const float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTextureParameterfv(compareTex, GL_TEXTURE_BORDER_COLOR, borderColor);
+	// result = 1.0 if "refDepth" of lookup < texel depth, i.e. lit. Lookup passes "fragDepth - bias" which is the same as "fragDepth < texelDepth + bias".
+	glTextureParameteri(compareTex, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(compareTex, GL_TEXTURE_COMPARE_FUNC, GL_LESS); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
+
+	// Create FBO to render depth into, all tiles share it(one framebuffer for all lights)
+	glCreateFramebuffers(1, &depthFBO);
+	// Attach the depth texture to it. (OpenGL 4.5 usage, refer: https://registry.khronos.org/OpenGL-Refpages/gl4/html/glFramebufferTexture.xhtml)
+	glNamedFramebufferTexture(depthFBO, GL_DEPTH_ATTACHMENT, depthTex, 0);
+	// Disable color rendering as there are no color attachments
+	glNamedFramebufferDrawBuffer(depthFBO, GL_NONE);
+	//glDrawBuffer(GL_NONE); // don't use it, because it will set current binding framebuffer status, but we just want to set the shadow map framebuffer not the normal framebuffer
+
+	// finally check if framebuffer is complete
+	if (glCheckNamedFramebufferStatus(depthFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("ShadowMapRender:: Framebuffer not complete!"); return; }
+	/*----------------------------------------------------depth relevant done----------------------------------------------------*/
+
+	// min/max depth of the atlas for PCSS blocker search
+	if (useDepthPyramid && pcssIndex != -1)
+		InitDepthPyramid(atlas);
+}
+
+void ShadowMapRender::AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs)
+{
+	if (atlas.GetTexture() == 0)
+		return;
+
+	// one pass for all dirty views(see ShadowView), the atlas is kept because lighting reads it. If no view is dirty, the cached atlas is imported without being written.
+	auto atlasTex = _graph.ImportTexture("ShadowMapAtlas", atlas.GetTexture());
+	std::vector<ShadowView> dirtyViews = GetDirtyShadowViews(atlas);
+	if (!dirtyViews.empty())
+		_graph.AddPass("ShadowMap", {}, { atlasTex }, [this, dirtyViews]() { Render(dirtyViews); });
+	_outputs.push_back(atlasTex);
+
+	if (depthPyramidTex != 0)
 	{
-		if (!lights[i]->IsRenderShadow())
-			continue;
-		
-		/*----------------------------------------------------depth relevant start----------------------------------------------------*/
-		glm::vec<2, GLuint> depthData;
-		GLuint depthTex;
-		// create a depth texture
-		glCreateTextures(GL_TEXTURE_2D, 1, &depthTex); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
-		// allocate storage for it
-		// [Note] below using 32F for depth component is for float precision. (if i am correct, 32F can be used to store float value including negative and value greater than 1)
-		// [Note]"GL_DEPTH_COMPONENT16" is enough, no need to use 32F. Compared results can be found "Output\ShadowMaps": "ShadowMap-Depth16" vs "ShadowMap-Depth32F".
-		glTextureStorage2D(depthTex, 1, GL_DEPTH_COMPONENT16, resWidth, resHeight); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
-		//glTextureStorage2D(depthTex, 1, GL_DEPTH_COMPONENT32F, resWidth, resHeight); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
-		// Set the default filtering modes
-		//glTextureParameteri(depthTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		//glTextureParameteri(depthTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTextureParameteri(depthTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTextureParameteri(depthTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		// Set up wrapping modes
-		// not using GL_CLAMP_TOEDGE! If pixel gets outside of Texture, make its depth to 1.
-		glTextureParameteri(depthTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-		glTextureParameteri(depthTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-		const float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-		glTextureParameterfv(depthTex, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in ShadowMapRender::Init."); return; };
-		// not using mipmap for depth tex because it is non-linear (after projection). But it can be used to store the true depth(z) before projection then mipmap is possible in VSM
-		depthData[0] = depthTex;
-
-		// Create FBO to render depth into
-		GLuint depthFBO;
-		glCreateFramebuffers(1, &depthFBO);
-		// Attach the depth texture to it. (OpenGL 4.5 usage, refer: https://registry.khronos.org/OpenGL-Refpages/gl4/html/glFramebufferTexture.xhtml)
-		glNamedFramebufferTexture(depthFBO, GL_DEPTH_ATTACHMENT, depthTex, 0);
-		// Disable color rendering as there are no color attachments
-		glNamedFramebufferDrawBuffer(depthFBO, GL_NONE);
-		//glDrawBuffer(GL_NONE); // don't use it, because it will set current binding framebuffer status, but we just want to set the shadow map framebuffer not the normal framebuffer
-		
-		// finally check if framebuffer is complete
-		if (glCheckNamedFramebufferStatus(depthFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("ShadowMapRender:: Framebuffer not complete!"); return; }
-		//depthFrameBuffers.push_back(depthFBO);
-		depthData[1] = depthFBO;
-
-		depthMap[i] = depthData;
-		/*----------------------------------------------------depth relevant done----------------------------------------------------*/
+		auto pyramidTex = _graph.ImportTexture("ShadowDepthPyramid", depthPyramidTex);
+		if (!dirtyViews.empty())
+			_graph.AddPass("DepthPyramid", { atlasTex }, { pyramidTex }, [this, dirtyViews]() { BuildDepthPyramid(dirtyViews, atlas.GetTexture()); });
+		_outputs.push_back(pyramidTex);
 	}
 }
 
-void ShadowMapRender::Render()
+void ShadowMapRender::Render(const std::vector<ShadowView>& _views)
 {
 	/*---------------------------------------------- depth texture render start ----------------------------------------------*/
 	// becareful, it seems the driver determines OpenGL clip. That's why the topic about clip the mesh in modeling domain still makes sense.
-	// set the viewport to the size of the depth texture (each time render something into framebuffer, we need to specify its resolution)
-	glViewport(0, 0, resWidth, resHeight);
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "ShadowMap/shadowMap");
-	auto lights = GLOBAL.sceneMgr->GetAllLight();
-	for (int i = 0; i < lights.size(); i++)
+	glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+	glClearDepth(1.0f);
+	for (auto& view : _views)
 	{
-		if (!lights[i]->IsRenderShadow())
-			continue;
-
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMap[i][1]);
-		glClearDepth(1.0f);
+		// viewport to the tile of this view and scissor to its changed texels, so that clearing doesn't touch other tiles
+		SetShadowViewport(view, atlas);
 		glClear(GL_DEPTH_BUFFER_BIT);
+		MarkShadowUpdated(view);
+	}
+	glDisable(GL_SCISSOR_TEST);
 
-		// compute light matrix
-		LightCamInfo lightCamInfo;
-		glm::mat4 lightMat = lights[i]->GetLightSpaceMat(lightCamInfo);
-		shaderPro->Set("lightMat", lightMat);
+	// each object is drawn once for all views instead of once per view
+	RenderLayered(_views, atlas, "ShadowMap/shadowMapLayered");
 
-		auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
-		for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
-		{
-			auto sceneObj = *iter;
-			glm::mat4 modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
-			shaderPro->Set("modelMat", modelMat);
-			GLOBAL.render->Draw(sceneObj);
-		}
-	}
 	// unbind framebuffer
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-	glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
+	glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // set it back to normal
 
 	/*---------------------------------------------- depth texture render done ----------------------------------------------*/
 }
@@ -427,34 +952,53 @@ void ShadowMapRender::Render()
 void ShadowMapRender::Clear()
 {
 	BasicShadowMapRender::Clear();
+	ClearTextures();
+}
 
-	for (auto iter = depthMap.begin(); iter != depthMap.end(); iter++)
-	{
-		auto texID = iter->second[0];
-		if (glIsTexture(texID))
-			glDeleteTextures(1, &texID);
+void ShadowMapRender::ClearTextures()
+{
+	ClearDepthPyramid();
 
-		auto frameBufferID = iter->second[1];
-		if (glIsFramebuffer(frameBufferID))
-			glDeleteFramebuffers(1, &frameBufferID);
-	}
-	depthMap.clear();
+	if (compareTex != 0 && glIsTexture(compareTex))
+		glDeleteTextures(1, &compareTex);
+	compareTex = 0;
+
+	if (depthFBO != 0 && glIsFramebuffer(depthFBO))
+		glDeleteFramebuffers(1, &depthFBO);
+	depthFBO = 0;
+
+	atlas.Clear();
 }
 
-GLuint ShadowMapRender::GetDepthFrameBuffer(const int& _lightIndex) { return depthMap[_lightIndex][1]; }
-GLuint ShadowMapRender::GetDepthTexture(const int& _lightIndex) { return depthMap[_lightIndex][0]; }
+// [Note] all lights share the same atlas texture and framebuffer, use "atlas.GetTile(GetShadowViewKey(_lightIndex, view))" to find the part of a light
+GLuint ShadowMapRender::GetDepthFrameBuffer(const int&) { return depthFBO; }
+GLuint ShadowMapRender::GetDepthTexture(const int&) { return atlas.GetTexture(); }
+GLuint ShadowMapRender::GetCompareTexture(const int&) { return compareTex; }
 
 void ShadowMapRender::SaveShadowMap(const int& _lightIndex, const std::string& _lightName)
 {
-	GLuint fbo = depthMap[_lightIndex][1];
-	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName, resWidth, resHeight, GL_DEPTH_COMPONENT, fbo))
+	auto tile = atlas.GetTile(GetShadowViewKey(_lightIndex, 0)); // first view(e.g. the nearest cascade) of the light
+	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName, tile.width, tile.height, GL_DEPTH_COMPONENT, depthFBO, tile.x, tile.y))
 		Print("ShadowMap saved.");
 }
 
 void ShadowMapRender::SetBias(const float& _bias) { bias = _bias; }
 
+float ShadowMapRender::GetBias() const { return bias; }
+
+int ShadowMapRender::GetPCFKernelSize() const
+{
+	if (pcfIndex == -1)
+		return 0;
+	return static_pointer_cast<PercentageCloserFilter>(components[pcfIndex])->GetPCFKernelSize();
+}
+
 void ShadowMapRender::InitComputeLightRatioParameters(shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit)
 {
+	// atlas is not created if it exceeds GL_MAX_TEXTURE_SIZE(see ShadowAtlas::Init), there is no tile to look up. Same as AddPasses()
+	if (atlas.GetTexture() == 0)
+		return;
+
 	_shaderPro->Set("bias", bias);
 
 	// only focus on "ShadowMap/lightRatioPCF.sub_fs"
@@ -498,10 +1042,20 @@ void ShadowMapRender::InitComputeLightRatioParameters(shared_ptr<ShaderProgram>&
 			_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].lightCamPos", lightCamInfo.lightCamPos);
 		}
 
-		// be careful with this texUnit.
-		_shaderPro->Set("shadowMaps[" + std::to_string(i) + "]", static_cast<int>(_texUnit));
-		glBindTextureUnit(_texUnit++, GetDepthTexture(i));
+		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].atlasTile", atlas.GetTileRect(GetShadowViewKey(i, 0)));
+		SetShadowViewParameters(_shaderPro, i, atlas);
 	}
+
+	// be careful with this texUnit. Atlas contains all lights, so only two units are used whatever the light number is.
+	_shaderPro->Set("shadowAtlasPadding", ShadowAtlas::padding);
+	_shaderPro->Set("shadowAtlas", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, atlas.GetTexture());
+	// "sampler2DShadow" needs its own unit, because it is a different texture(view) with depth comparison
+	_shaderPro->Set("shadowCompareAtlas", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, compareTex);
+
+	if (pcssIndex != -1)
+		SetDepthPyramidParameters(_shaderPro, _texUnit);
 }
 
 void ShadowMapRender::InitPCF(const bool& _usePCF, const int& _pcfKernelSize)
@@ -528,212 +1082,310 @@ void ShadowMapRender::InitPCSS(const bool& _usePCSS, const int& _maxSearchSize,
 		pcssIndex = -1;
 }
 
+int ShadowMapRender::GetLightSize() const { return GetPCSSLightSize(pcssIndex); }
+
 #pragma endregion
 
 #pragma region Variant Shadow Map Techniques
+VarianceShadowMapRender::VarianceShadowMapRender() : kernelSize(1), varMin(0), pMin(0), useSAT(false), useFixedSAT(false), satFixedScale(0), satFixedMaxHalfKernel(0),
+	useBlur(false), useEVSM(false), evsmExponents(40, 5), blurredTex(0), pcssIndex(-1) {}
+
 void VarianceShadowMapRender::Init()
 {
-	depthMap.clear();
-	satGeneratorMap.clear();
+	ClearTextures();
+	InvalidateCache();
+	satFixedScale = 0;
+	satFixedMaxHalfKernel = 0;
+
+	// all lights which need to render shadow share one depth/depthSquare atlas(see ShadowAtlas), each light owns a tile
+	std::map<int, glm::ivec2> tileSizes = GetShadowTileSizes();
+	if (tileSizes.empty())
+		return;
 
-	auto lights = GLOBAL.sceneMgr->GetAllLight();
+	/*----------------------------------------------------VSM-depth/depthSquare relevant start----------------------------------------------------*/
+	bool result = atlas.Init(tileSizes, [](GLuint& _texID, const int& _width, const int& _height)
+		{
+			// create a variant depth texture
+			glCreateTextures(GL_TEXTURE_2D, 1, &_texID); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+
+			// allocate storage for it, one for depth, one for depth_square
+			// [Important] Be careful, here by using SAT-VSM: the depth and depth_square is differernt from original VSM, 
+			// depth is actually considered as mean of the whole pixel(texel), which means it is the E(x)(Moment 1)
+			// [Note]"GL_RG16F" means to store floating-point value. I have tried GLRG, which will normalize the value into range [0.0, 1.0] and it will lose a lot of precision.
+			// [Note]Comparing with "GL_RG32F", "GL_RG16F" is quite enough. --> check "Output/VSM/" "VSM-GL_RB16F.png" and "VSM-GL_RB32F.png"
+			//glTextureStorage2D(_texID, 1, GL_RG16F, _width, _height); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+			glTextureStorage2D(_texID, 1, GL_RG32F, _width, _height); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+
+			// [Note] no mip-map: a mip level of the atlas would mix texels of neighbour tiles. Storage only has one level anyway.
+			// can not use Anisotropic filtering in OpenGL 4.5. It is supported since 4.6- refer: https://www.khronos.org/opengl/wiki/Sampler_Object#Anisotropic_filtering
+			// using GL_LINEAR is better, compare the "VSM_nearest_texture.png" and "VSM_linear_texture.png" in the folder "\Output\VSM\"
+			// linear method will significantly reduce the shadow acne.
+			glTextureParameteri(_texID, GL_TEXTURE_MIN_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+			glTextureParameteri(_texID, GL_TEXTURE_MAG_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+
+			//[TODO]As SAT-VSM proposed, multiple-sampling-anti-aliasing(MSAA) can be used on the shadow maps. e.g. glTexImage2DMultisample(Check OpenGL Red book or online tutorials later)
+
+			// Set up wrapping modes
+			// not using GL_CLAMP_TOEDGE! If pixel gets outside of Texture, make its depth to 1.
+			glTextureParameteri(_texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(_texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			const float borderColor[] = { 1.0f, 1.0f, 0.0f, 0.0f };
+			glTextureParameterfv(_texID, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+			// padding around tiles is never rendered, it keeps the same value as border
+			glClearTexImage(_texID, 0, GL_RGBA, GL_FLOAT, borderColor); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+		});
+	if (!result) { Print("Error in VarianceShadowMapRender::Init."); return; }
 
-	for (int i = 0; i < lights.size(); i++)
+	// [Note] depth buffer for depth testing is a transient texture of frame graph(atlas size), see AddPasses().
+	// The framebuffer(atlas+depth buffer) is cached by FullscreenPass.
+
+	/*----------------------------------------------------VSM-depth/depthSquare relevant done----------------------------------------------------*/
+
+	// min/max depth(first moment) of the atlas for PCSS blocker search
+	if (useDepthPyramid && pcssIndex != -1)
+		InitDepthPyramid(atlas);
+
+	/*----------------------------------------------------blurred moments relevant start----------------------------------------------------*/
+	if (useBlur)
 	{
-		if (!lights[i]->IsRenderShadow())
-			continue;
+		int width, height;
+		atlas.GetSize(width, height);
+		glCreateTextures(GL_TEXTURE_2D, 1, &blurredTex); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+		glTextureStorage2D(blurredTex, 1, useEVSM ? GL_RGBA32F : GL_RG32F, width, height); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+		// linear filtering: one bilinear fetch per fragment in lightRatio shaders
+		glTextureParameteri(blurredTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(blurredTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(blurredTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTextureParameteri(blurredTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		// padding around tiles is never blurred, it keeps the moments of far depth(1), same as the atlas
+		glm::vec4 farMoment(1, 1, 0, 0);
+		if (useEVSM)
+			farMoment = glm::vec4(std::exp(evsmExponents.x), std::exp(2 * evsmExponents.x), -std::exp(-evsmExponents.y), std::exp(-2 * evsmExponents.y));
+		glTextureParameterfv(blurredTex, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(farMoment));
+		glClearTexImage(blurredTex, 0, GL_RGBA, GL_FLOAT, glm::value_ptr(farMoment)); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
+	}
+	/*----------------------------------------------------blurred moments relevant done----------------------------------------------------*/
 
-		/*----------------------------------------------------VSM-depth/depthSquare relevant start----------------------------------------------------*/
-		glm::vec<3, GLuint> data;
-		GLuint depthTex;
-		// create a variant depth texture
-		glCreateTextures(GL_TEXTURE_2D, 1, &depthTex); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-
-		// allocate storage for it, one for depth, one for depth_square
-		// [Important] Be careful, here by using SAT-VSM: the depth and depth_square is differernt from original VSM, 
-		// depth is actually considered as mean of the whole pixel(texel), which means it is the E(x)(Moment 1)
-		// [Note]"GL_RG16F" means to store floating-point value. I have tried GLRG, which will normalize the value into range [0.0, 1.0] and it will lose a lot of precision.
-		// [Note]Comparing with "GL_RG32F", "GL_RG16F" is quite enough. --> check "Output/VSM/" "VSM-GL_RB16F.png" and "VSM-GL_RB32F.png"
-		//glTextureStorage2D(depthTex, 1, GL_RG16F, resWidth, resHeight); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-		glTextureStorage2D(depthTex, 1, GL_RG32F, resWidth, resHeight); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-
-		// enable mip-map
-		glGenerateTextureMipmap(depthTex);
-		// can not use Anisotropic filtering in OpenGL 4.5. It is supported since 4.6- refer: https://www.khronos.org/opengl/wiki/Sampler_Object#Anisotropic_filtering
-		//glTextureParameteri(depthTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		//glTextureParameteri(depthTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		// using GL_LINEAR is better, compare the "VSM_nearest_texture.png" and "VSM_linear_texture.png" in the folder "\Output\VSM\"
-		// linear method will significantly reduce the shadow acne.
-		//glTextureParameteri(depthTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTextureParameteri(depthTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-		glTextureParameteri(depthTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-
-		//[TODO]As SAT-VSM proposed, multiple-sampling-anti-aliasing(MSAA) can be used on the shadow maps. e.g. glTexImage2DMultisample(Check OpenGL Red book or online tutorials later)
-
-		// Set up wrapping modes
-		// not using GL_CLAMP_TOEDGE! If pixel gets outside of Texture, make its depth to 1.
-		glTextureParameteri(depthTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-		glTextureParameteri(depthTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-		const float borderColor[] = { 1.0f, 1.0f, 0.0f, 0.0f };
-		glTextureParameterfv(depthTex, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-		data[0] = depthTex;
-
-		// Create FBO to render depth into
-		GLuint depthFBO;
-		glCreateFramebuffers(1, &depthFBO);
-		// Attach color attachement (OpenGL 4.5 usage, refer: https://registry.khronos.org/OpenGL-Refpages/gl4/html/glFramebufferTexture.xhtml)
-		glNamedFramebufferTexture(depthFBO, GL_COLOR_ATTACHMENT0, depthTex, 0);
-		// enable color attachments
-		glNamedFramebufferDrawBuffer(depthFBO, GL_COLOR_ATTACHMENT0);
-
-		// [Important] We must create and bind a depthbuffer! Otherwise there is no way to update the depth information!!!
-		GLuint depthRB; // this render buffer has the same size as ShadowMap does.
-		glCreateRenderbuffers(1, &depthRB);
-		glNamedRenderbufferStorage(depthRB, GL_DEPTH_COMPONENT, resWidth, resHeight); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-		glNamedFramebufferRenderbuffer(depthFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRB); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::Init."); return; };
-		data[2] = depthRB;
-
-		// finally check if framebuffer is complete
-		if (glCheckNamedFramebufferStatus(depthFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("VarianceShadowMapRender:: Framebuffer not complete!"); return; }
-		//depthFrameBuffers.push_back(depthFBO);
-		data[1] = depthFBO;
-
-		depthMap[i] = data;
-
-		/*----------------------------------------------------VSM-depth/depthSquare relevant done----------------------------------------------------*/
-
-		/*----------------------------------------------------SAT for them relevant start----------------------------------------------------*/
-		// Generate SAT for this VSM
-		if (useSAT)
+	/*----------------------------------------------------SAT for them relevant start----------------------------------------------------*/
+	// Generate one SAT for the whole atlas. Lookups in lightRatio shaders clamp box corners into the tile, so sums never cross tiles.
+	// [Note] sums grow with the atlas area instead of one shadow map, SAT copy shader already centers values(-0.5) to keep float precision.
+	if (useSAT)
+	{
+		SATConfig config;
+		atlas.GetSize(config.resWidth, config.resHeight);
+		config.componentNum = 2; // only depth and depthSquare
+		// fixed-point SAT: exact integer sums, the scale is limited by the largest box looked up: the kernel(or the max penumbra with PCSS), never more than a tile
+		int maxTileArea = 0;
+		for (auto& item : tileSizes)
+			maxTileArea = std::max(maxTileArea, item.second.x * item.second.y);
+		satFixedMaxHalfKernel = std::max(kernelSize, GetPCSSMaxPenumbraSize(pcssIndex)) / 2 + 1;
+		int maxBoxArea = std::min((2 * satFixedMaxHalfKernel + 1) * (2 * satFixedMaxHalfKernel + 1), maxTileArea);
+		satFixedScale = useFixedSAT ? SummedAreaTableGenerator::GetFixedPointScale(maxBoxArea) : 0;
+		config.fixedPointScale = satFixedScale;
+		GLenum satFormat = useFixedSAT ? GL_RG32UI : GL_RG32F;
+		config.texGenerator = [satFormat](GLuint& _texID, const int& _width, const int& _height)
 		{
-			SATConfig config;
-			config.resWidth = resWidth;
-			config.resHeight = resHeight;
-			config.componentNum = 2; // only depth and depthSquare
-			config.texGenerator = [](GLuint& _texID, const int& _width, const int& _height)
-			{
-				glCreateTextures(GL_TEXTURE_2D, 1, &_texID); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
-				// [Important, Note] GL_RG16F is not enough to provide enough floating-point precision for SAT
-				glTextureStorage2D(_texID, 1, GL_RG32F, _width, _height); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
-				glTextureParameteri(_texID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
-				glTextureParameteri(_texID, GL_TEXTURE_MAG_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
-				glTextureParameteri(_texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-				glTextureParameteri(_texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-				const float borderColor[] = { 0,0,0,0 }; // [Important, Note] must be zero value. according to paper. When adding elements outside of range, it should add zero.
-				glTextureParameterfv(_texID, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
-			};
-			config.inputTexID = depthTex;
-
-			std::shared_ptr<SummedAreaTableGenerator> satGenerator = std::make_shared<SummedAreaTableGenerator>();
-			satGenerator->Init(config);
-			satGeneratorMap[i] = satGenerator;
-		}
-		/*----------------------------------------------------SAT for them relevant done----------------------------------------------------*/
+			glCreateTextures(GL_TEXTURE_2D, 1, &_texID); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
+			// [Important, Note] GL_RG16F is not enough to provide enough floating-point precision for SAT, GL_RG32UI for fixed-point SAT
+			glTextureStorage2D(_texID, 1, satFormat, _width, _height); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
+			glTextureParameteri(_texID, GL_TEXTURE_MIN_FILTER, GL_NEAREST); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
+			glTextureParameteri(_texID, GL_TEXTURE_MAG_FILTER, GL_NEAREST); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
+			glTextureParameteri(_texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(_texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			const float borderColor[] = { 0,0,0,0 }; // [Important, Note] must be zero value. according to paper. When adding elements outside of range, it should add zero.
+			glTextureParameterfv(_texID, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VarianceShadowMapRender::texGenerator."); return; };
+		};
+		config.inputTexID = atlas.GetTexture();
+
+		satGenerator = std::make_shared<SummedAreaTableGenerator>();
+		satGenerator->Init(config);
 	}
+	/*----------------------------------------------------SAT for them relevant done----------------------------------------------------*/
 
 	// set some parameter
 	// refer: https://registry.khronos.org/OpenGL-Refpages/gl4/
 	glHint(GL_FRAGMENT_SHADER_DERIVATIVE_HINT, GL_NICEST); // for dFdx, dFdy
-	glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST); 
+	glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
 }
 
-void VarianceShadowMapRender::Render()
+void VarianceShadowMapRender::AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs)
 {
-	/*---------------------------------------------- VSM-depth/depthSquare texture render start ----------------------------------------------*/
-	// TODO: maybe tight light view space is required to improve the precision issue.(for now I just enable it)
-	// set the viewport to the size of the depth texture (each time render something into framebuffer, we need to specify its resolution)
-	// [TODO] future work could be render VSM and its SAT for static scenes from one light source(sun light)-> to improve FPS
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "VarianceShadowMap/varianceShadowMap");
-	auto lights = GLOBAL.sceneMgr->GetAllLight();
-	for (int i = 0; i < lights.size(); i++)
+	if (atlas.GetTexture() == 0)
+		return;
+
+	// all dirty views(see ShadowView) are rendered into their tiles by one pass, then one SAT pass for the whole atlas
+	// VSM and its SAT are cached: passes are only added if some view is dirty(light, view or scene changed), lighting reads the cached textures otherwise
+	/*VSM-depth/depthSquare*/
+	auto momentTex = _graph.ImportTexture("VSMAtlas", atlas.GetTexture());
+	_outputs.push_back(momentTex);
+	FrameGraph::ResourceHandle satTex = -1;
+	if (useSAT)
 	{
-		// [TODO] if render it each frame, it will slow down FPS. For now, only the light info has changed(position change) then generate VSM and its SAT
-		if (!lights[i]->IsRenderShadow())
-			continue;
+		satTex = _graph.ImportTexture("SATAtlas", satGenerator->GetSAT());
+		_outputs.push_back(satTex);
+	}
+	FrameGraph::ResourceHandle blurTex = -1;
+	if (useBlur)
+	{
+		blurTex = _graph.ImportTexture("VSMBlurred", blurredTex);
+		_outputs.push_back(blurTex);
+	}
+	FrameGraph::ResourceHandle pyramidTex = -1;
+	if (depthPyramidTex != 0)
+	{
+		pyramidTex = _graph.ImportTexture("VSMDepthPyramid", depthPyramidTex);
+		_outputs.push_back(pyramidTex);
+	}
 
-		//glBindFramebuffer(GL_FRAMEBUFFER, depthFrameBuffers[i]);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMap[i][1]); CheckGLError();
-		glClearColor(1, 1, 0, 1); // first two component should be 1, because they are corresponding to depth and depth_square, the blue&alpha not used
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-		glViewport(0, 0, resWidth, resHeight); CheckGLError();
+	std::vector<ShadowView> dirtyViews = GetDirtyShadowViews(atlas);
+	if (dirtyViews.empty())
+		return;
 
-		// compute light matrix
-		LightCamInfo lightCamInfo;
-		glm::mat4 lightMat = lights[i]->GetLightSpaceMat(lightCamInfo);
-		shaderPro->Set("lightMat", lightMat); CheckGLError();
+	int width, height;
+	atlas.GetSize(width, height);
+	// depth buffer is only used for depth testing inside this pass
+	auto depthTex = _graph.CreateTexture("VSMAtlasDepth", TransientTextureDesc(width, height, GL_DEPTH_COMPONENT24));
+	_graph.AddPass("VSM", {}, { momentTex, depthTex },
+		[this, dirtyViews, depthTex, &_graph]()
+		{
+			RenderMoment(dirtyViews, _graph.GetTexture(depthTex));
+			if (!useSAT && !useBlur)
+				for (auto& view : dirtyViews)
+					MarkShadowUpdated(view);
+		});
 
-		shaderPro->Set("lightCamInfo.near", lightCamInfo.near); CheckGLError();
-		shaderPro->Set("lightCamInfo.far", lightCamInfo.far); CheckGLError();
-		shaderPro->Set("lightCamInfo.lightCamPos", lightCamInfo.lightCamPos); CheckGLError();
-		shaderPro->Set("lightCamInfo.lightViewDir", lightCamInfo.lightViewDir); CheckGLError();
+	if (depthPyramidTex != 0)
+	{
+		/*min/max depth pyramid*/
+		_graph.AddPass("DepthPyramid", { momentTex }, { pyramidTex }, [this, dirtyViews]() { BuildDepthPyramid(dirtyViews, atlas.GetTexture()); });
+	}
 
-		auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
-		for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
-		{
-			auto sceneObj = *iter;
-			glm::mat4 modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
-			shaderPro->Set("modelMat", modelMat); CheckGLError();
-			GLOBAL.render->Draw(sceneObj);
-		}
-		// unbind framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
+	if (useBlur)
+	{
+		/*blur*/
+		// [Note] horizontal pass is kept in a transient texture, it only lives inside this pass.
+		auto scratchTex = _graph.CreateTexture("VSMBlurScratch", TransientTextureDesc(width, height, useEVSM ? GL_RGBA32F : GL_RG32F));
+		_graph.AddPass("VSMBlur", { momentTex, scratchTex }, { blurTex, scratchTex },
+			[this, dirtyViews, scratchTex, &_graph]()
+			{
+				BlurMoment(dirtyViews, _graph.GetTexture(scratchTex));
+				for (auto& view : dirtyViews)
+					MarkShadowUpdated(view);
+			});
 	}
-	/*---------------------------------------------- VSM-depth/depthSquare texture render done ----------------------------------------------*/
 
-	/*----------------------------------------------------SAT render start----------------------------------------------------*/
-	//[Important] the reason why I do another iteration is that: BoxFilter() will generate a new sceneobj and add into sceneMgr. It will change sceneObjs??
-	// also, waiting all VSM get rendered is normal logic.
 	if (useSAT)
 	{
-		for (int i = 0; i < lights.size(); i++)
-		{
-			// [TODO] if render it each frame, it will slow down FPS. For now, only the light info has changed(position change) then generate VSM and its SAT
-			if (!lights[i]->IsRenderShadow())
-				continue;
-			// create SAT for the depth/depthSquare texture
-			satGeneratorMap[i]->Generate();
-		}
+		/*SAT*/
+		// [Note] scratch texture for ping-pong is transient, it only lives inside this pass.
+		auto scratchTex = _graph.CreateTexture("SATScratch", TransientTextureDesc(width, height, useFixedSAT ? GL_RG32UI : GL_RG32F));
+		_graph.AddPass("SAT", { momentTex, scratchTex }, { satTex, scratchTex },
+			[this, dirtyViews, scratchTex, &_graph]()
+			{
+				satGenerator->Generate(_graph.GetTexture(scratchTex), GetDirtyCorner(dirtyViews)); // only texels after the changed ones
+				for (auto& view : dirtyViews)
+					MarkShadowUpdated(view);
+			});
 	}
-	/*----------------------------------------------------SAT render done----------------------------------------------------*/
+}
+
+void VarianceShadowMapRender::RenderMoment(const std::vector<ShadowView>& _views, const GLuint& _depthTex)
+{
+	// TODO: maybe tight light view space is required to improve the precision issue.(for now I just enable it)
+	// [Important] We must bind a depth buffer! Otherwise there is no way to update the depth information!!!
+	glBindFramebuffer(GL_FRAMEBUFFER, GLOBAL.render->GetFullscreenPass()->GetFrameBuffer(atlas.GetTexture(), _depthTex)); CheckGLError();
+	glClearColor(1, 1, 0, 1); // first two component should be 1, because they are corresponding to depth and depth_square, the blue&alpha not used
+	for (auto& view : _views)
+	{
+		// viewport to the tile of this view and scissor to its changed texels, so that clearing doesn't touch other tiles
+		SetShadowViewport(view, atlas); CheckGLError();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
+	}
+	glDisable(GL_SCISSOR_TEST);
+
+	// each object is drawn once for all views instead of once per view
+	RenderLayered(_views, atlas, "VarianceShadowMap/varianceShadowMapLayered");
+
+	// unbind framebuffer
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // set it back to normal
 }
 
 void VarianceShadowMapRender::Clear()
 {
 	BasicShadowMapRender::Clear();
+	ClearTextures();
+}
 
-	for (auto iter = depthMap.begin(); iter != depthMap.end(); iter++)
+void VarianceShadowMapRender::BlurMoment(const std::vector<ShadowView>& _views, const GLuint& _scratchTex)
+{
+	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateComputeProgram(GLOBAL.shaderPathPrefix + "VarianceShadowMap/momentBlur");
+	if (shaderPro == nullptr)
+		return;
+	int halfKernelSize = kernelSize / 2;
+	GLenum format = useEVSM ? GL_RGBA32F : GL_RG32F;
+	const int groupSize = 8; // same as local_size
+	shaderPro->Set("texInput", 0);
+	shaderPro->Set("halfKernelSize", halfKernelSize);
+	shaderPro->Set("evsmExponents", evsmExponents);
+
+	for (auto& view : _views)
 	{
-		auto texID = iter->second[0];
-		if (glIsTexture(texID))
-			glDeleteTextures(1, &texID);
-
-		auto frameBufferID = iter->second[1];
-		if (glIsFramebuffer(frameBufferID))
-			glDeleteFramebuffers(1, &frameBufferID);
-
-		// be careful, don't forget this one.
-		auto rbID = iter->second[2];
-		if (glIsRenderbuffer(rbID))
-			glDeleteRenderbuffers(1, &rbID);
+		// blurred texels depend on moments inside the kernel, so the changed area("rect" of view) grows by half kernel(inside the tile)
+		glm::ivec4 tile(atlas.GetTileRect(view.key));
+		glm::ivec2 tileMin(tile.x, tile.y), tileMax = tileMin + glm::ivec2(tile.z, tile.w); // "tileMax" is exclusive
+		glm::ivec2 minTexel = glm::max(glm::ivec2(view.rect.x, view.rect.y) - halfKernelSize, tileMin);
+		glm::ivec2 maxTexel = glm::min(glm::ivec2(view.rect.x + view.rect.z, view.rect.y + view.rect.w) + halfKernelSize, tileMax);
+		shaderPro->Set("tileRect", glm::vec4(tile));
+
+		// horizontal: moments(converted to EVSM) -> scratch, also rows read by the vertical pass
+		glm::ivec2 rowMin(minTexel.x, glm::max(minTexel.y - halfKernelSize, tileMin.y)), rowMax(maxTexel.x, glm::min(maxTexel.y + halfKernelSize, tileMax.y));
+		shaderPro->Set("blurRect", glm::vec4(rowMin.x, rowMin.y, rowMax.x - rowMin.x, rowMax.y - rowMin.y));
+		shaderPro->Set("vertical", 0);
+		shaderPro->Set("toEVSM", useEVSM ? 1 : 0);
+		glBindTextureUnit(0, atlas.GetTexture());
+		glBindImageTexture(0, _scratchTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+		glDispatchCompute((rowMax.x - rowMin.x + groupSize - 1) / groupSize, (rowMax.y - rowMin.y + groupSize - 1) / groupSize, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		// vertical: scratch -> blurred moments
+		shaderPro->Set("blurRect", glm::vec4(minTexel.x, minTexel.y, maxTexel.x - minTexel.x, maxTexel.y - minTexel.y));
+		shaderPro->Set("vertical", 1);
+		shaderPro->Set("toEVSM", 0);
+		glBindTextureUnit(0, _scratchTex);
+		glBindImageTexture(0, blurredTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+		glDispatchCompute((maxTexel.x - minTexel.x + groupSize - 1) / groupSize, (maxTexel.y - minTexel.y + groupSize - 1) / groupSize, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 	}
-	depthMap.clear();
+	if (CheckGLError()) { Print("Error in VarianceShadowMapRender::BlurMoment."); return; }
+}
+
+void VarianceShadowMapRender::ClearTextures()
+{
+	satGenerator = nullptr; /*it will automatically release OpenGL objects. Check ~SATGenerator().*/
+	ClearDepthPyramid();
 
-	satGeneratorMap.clear(); /*it will automatically release OpenGL objects. Check ~SATGenerator().*/
+	if (blurredTex != 0 && glIsTexture(blurredTex))
+		glDeleteTextures(1, &blurredTex);
+	blurredTex = 0;
+
+	// its framebuffers are cached by FullscreenPass
+	if (GLOBAL.render != nullptr && atlas.GetTexture() != 0)
+		GLOBAL.render->GetFullscreenPass()->ReleaseTexture(atlas.GetTexture());
+	atlas.Clear();
 }
 
-GLuint VarianceShadowMapRender::GetDepthFrameBuffer(const int& _lightIndex) { return depthMap[_lightIndex][1]; }
-GLuint VarianceShadowMapRender::GetDepthTexture(const int& _lightIndex) { return depthMap[_lightIndex][0]; }
+// [Note] all lights share the same atlas texture, use "atlas.GetTile(GetShadowViewKey(_lightIndex, view))" to find the part of a light
+GLuint VarianceShadowMapRender::GetDepthFrameBuffer(const int&) { return GLOBAL.render->GetFullscreenPass()->GetFrameBuffer(atlas.GetTexture()); }
+GLuint VarianceShadowMapRender::GetDepthTexture(const int&) { return atlas.GetTexture(); }
 
 void VarianceShadowMapRender::SaveShadowMap(const int& _lightIndex, const std::string& _lightName)
 {
-	GLuint fbo = depthMap[_lightIndex][1];
-	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName, resWidth, resHeight, GL_RGB, fbo))
+	// [Note] depth buffer is a transient texture of frame graph, only depth/depthSquare texture can be saved
+	GLuint fbo = GetDepthFrameBuffer(_lightIndex);
+	auto tile = atlas.GetTile(GetShadowViewKey(_lightIndex, 0)); // first view(e.g. the nearest cascade) of the light
+	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName, tile.width, tile.height, GL_RGB, fbo, tile.x, tile.y))
 		Print("VarianceShadowMap saved.");
-
-	// below code will read depth texture from framebuffer not color buffer
-	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName + "_depth_ground_truth", resWidth, resHeight, GL_DEPTH_COMPONENT, fbo))
-		Print("ShadowMap saved.");
 }
 
 void VarianceShadowMapRender::SetKernelSize(const int& _kernelSize) { kernelSize = _kernelSize; }
@@ -742,12 +1394,25 @@ void VarianceShadowMapRender::SetPMin(const float& _pMin) { pMin = _pMin; }
 
 void VarianceShadowMapRender::SetUseSAT(const bool& _value) { useSAT = _value; }
 bool VarianceShadowMapRender::IsUseSAT() const { return useSAT; }
-GLuint VarianceShadowMapRender::GetSAT(const int& _lightIndex) { return satGeneratorMap[_lightIndex]->GetSAT(); }
+void VarianceShadowMapRender::SetUseFixedSAT(const bool& _value) { useFixedSAT = _value; }
+bool VarianceShadowMapRender::IsUseFixedSAT() const { return useFixedSAT; }
+void VarianceShadowMapRender::SetUseBlur(const bool& _useBlur, const bool& _useEVSM, const glm::vec2& _evsmExponents)
+{
+	useBlur = _useBlur;
+	useEVSM = _useBlur && _useEVSM;
+	evsmExponents = glm::vec2(glm::min(_evsmExponents.x, 40.0f), _evsmExponents.y); // e^(2c+) and its derivative must fit in 32-bit float
+}
+bool VarianceShadowMapRender::IsUseBlur() const { return useBlur; }
+GLuint VarianceShadowMapRender::GetSAT(const int&) { return satGenerator->GetSAT(); }
 
-std::shared_ptr<SummedAreaTableGenerator> VarianceShadowMapRender::GetSATGenerator(const int& _lightIndex) { return satGeneratorMap[_lightIndex]; }
+std::shared_ptr<SummedAreaTableGenerator> VarianceShadowMapRender::GetSATGenerator(const int&) { return satGenerator; }
 
 void VarianceShadowMapRender::InitComputeLightRatioParameters(shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit)
 {
+	// atlas is not created if it exceeds GL_MAX_TEXTURE_SIZE(see ShadowAtlas::Init), there is no tile to look up. Same as AddPasses()
+	if (atlas.GetTexture() == 0)
+		return;
+
 	// set VSM relevant parameters
 	_shaderPro->Set("halfKernelSize", kernelSize / 2);
 	_shaderPro->Set("varMin", varMin);
@@ -759,6 +1424,11 @@ void VarianceShadowMapRender::InitComputeLightRatioParameters(shared_ptr<ShaderP
 	else
 		_shaderPro->Set("useSAT", 0);
 
+	// set blur, lighting reads blurred moments as "shadowAtlas"
+	_shaderPro->Set("useBlur", useBlur ? 1 : 0);
+	_shaderPro->Set("useEVSM", useEVSM ? 1 : 0);
+	_shaderPro->Set("evsmExponents", evsmExponents);
+
 	// only focus on "VarianceShadowMap/lightRatioPCSS.sub_fs"
 	if (pcssIndex != -1)
 	{
@@ -789,18 +1459,30 @@ void VarianceShadowMapRender::InitComputeLightRatioParameters(shared_ptr<ShaderP
 		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].far", lightCamInfo.far);
 		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].lightCamPos", lightCamInfo.lightCamPos);
 		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].lightViewDir", lightCamInfo.lightViewDir);
+		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].atlasTile", atlas.GetTileRect(GetShadowViewKey(i, 0)));
+		SetShadowViewParameters(_shaderPro, i, atlas);
+	}
 
-		// set shadow map
-		_shaderPro->Set("shadowMaps[" + std::to_string(i) + "]", static_cast<int>(_texUnit));
-		glBindTextureUnit(_texUnit++, GetDepthTexture(i));
-
-		// set SAT maps
-		if (useSAT)
-		{
-			_shaderPro->Set("SATMaps[" + std::to_string(i) + "]", static_cast<int>(_texUnit));
-			glBindTextureUnit(_texUnit++, GetSAT(i));
-		}
+	// set shadow map, atlas contains all lights
+	_shaderPro->Set("shadowAtlasPadding", ShadowAtlas::padding);
+	_shaderPro->Set("shadowAtlas", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, useBlur ? blurredTex : atlas.GetTexture());
+
+	// set SAT map
+	// [Note] "SATFixedAtlas" is an unsigned integer sampler, it always needs its own unit(even if unused), a unit can't be shared by samplers of different types
+	_shaderPro->Set("useFixedSAT", useSAT && useFixedSAT ? 1 : 0);
+	_shaderPro->Set("SATFixedScale", satFixedScale);
+	_shaderPro->Set("SATFixedMaxHalfKernel", satFixedMaxHalfKernel);
+	_shaderPro->Set("SATFixedAtlas", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, useSAT && useFixedSAT ? satGenerator->GetSAT() : 0);
+	if (useSAT && !useFixedSAT)
+	{
+		_shaderPro->Set("SATAtlas", static_cast<int>(_texUnit));
+		glBindTextureUnit(_texUnit++, satGenerator->GetSAT());
 	}
+
+	if (pcssIndex != -1)
+		SetDepthPyramidParameters(_shaderPro, _texUnit);
 }
 
 void VarianceShadowMapRender::InitPCSS(const bool& _usePCSS, const int& _maxSearchSize, const int& _lightSize, const int& _minPenumbraSize, const int& _maxPenumbraSize, const float& _penumbraRatio)
@@ -814,89 +1496,83 @@ void VarianceShadowMapRender::InitPCSS(const bool& _usePCSS, const int& _maxSear
 	else
 		pcssIndex = -1;
 }
+
+int VarianceShadowMapRender::GetLightSize() const { return GetPCSSLightSize(pcssIndex); }
 #pragma endregion
 
 
 #pragma region VSSM
+VSSMRender::VSSMRender() : useFixedSAT(false), satFixedScale(0), satFixedMaxHalfKernel(0) {}
+
 void VSSMRender::Init()
 {
-	depthMap.clear();
-	satGeneratorMap.clear();
+	ClearTextures();
+	InvalidateCache();
+	satFixedScale = 0;
+	satFixedMaxHalfKernel = 0;
+
+	// all lights which need to render shadow share one depth/depthSquare atlas(see ShadowAtlas), each light owns a tile
+	std::map<int, glm::ivec2> tileSizes = GetShadowTileSizes();
+	if (tileSizes.empty())
+		return;
 
-	auto lights = GLOBAL.sceneMgr->GetAllLight();
+	/*----------------------------------------------------VSM-depth/depthSquare relevant start----------------------------------------------------*/
+	bool result = atlas.Init(tileSizes, [](GLuint& _texID, const int& _width, const int& _height)
+		{
+			// create a variant depth texture
+			glCreateTextures(GL_TEXTURE_2D, 1, &_texID); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
+			glTextureStorage2D(_texID, 1, GL_RG32F, _width, _height); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
 
-	for (int i = 0; i < lights.size(); i++)
-	{
-		if (!lights[i]->IsRenderShadow())
-			continue;
+			// [Note] no mip-map: a mip level of the atlas would mix texels of neighbour tiles. Storage only has one level anyway.
+			glTextureParameteri(_texID, GL_TEXTURE_MIN_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
+			glTextureParameteri(_texID, GL_TEXTURE_MAG_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
 
-		/*----------------------------------------------------VSM-depth/depthSquare relevant start----------------------------------------------------*/
-		glm::vec<3, GLuint> data;
-		GLuint depthTex;
-		// create a variant depth texture
-		glCreateTextures(GL_TEXTURE_2D, 1, &depthTex); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
-		glTextureStorage2D(depthTex, 1, GL_RG32F, resWidth, resHeight); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
-
-		// enable mip-map
-		glGenerateTextureMipmap(depthTex);
-		glTextureParameteri(depthTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
-		glTextureParameteri(depthTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
-
-		glTextureParameteri(depthTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-		glTextureParameteri(depthTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-		const float borderColor[] = { 1.0f, 1.0f, 0.0f, 0.0f };
-		glTextureParameterfv(depthTex, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
-		data[0] = depthTex;
-
-		// Create FBO to render depth into
-		GLuint depthFBO;
-		glCreateFramebuffers(1, &depthFBO);
-		// Attach color attachement (OpenGL 4.5 usage, refer: https://registry.khronos.org/OpenGL-Refpages/gl4/html/glFramebufferTexture.xhtml)
-		glNamedFramebufferTexture(depthFBO, GL_COLOR_ATTACHMENT0, depthTex, 0);
-		// enable color attachments
-		glNamedFramebufferDrawBuffer(depthFBO, GL_COLOR_ATTACHMENT0);
-
-		// [Important] We must create and bind a depthbuffer! Otherwise there is no way to update the depth information!!!
-		GLuint depthRB; // this render buffer has the same size as ShadowMap does.
-		glCreateRenderbuffers(1, &depthRB);
-		glNamedRenderbufferStorage(depthRB, GL_DEPTH_COMPONENT, resWidth, resHeight); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
-		glNamedFramebufferRenderbuffer(depthFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRB); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
-		data[2] = depthRB;
-
-		// finally check if framebuffer is complete
-		if (glCheckNamedFramebufferStatus(depthFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { Print("VSSMRender:: Framebuffer not complete!"); return; }
-		//depthFrameBuffers.push_back(depthFBO);
-		data[1] = depthFBO;
-
-		depthMap[i] = data;
-
-		/*----------------------------------------------------VSM-depth/depthSquare relevant done----------------------------------------------------*/
-
-		/*----------------------------------------------------SAT for them relevant start----------------------------------------------------*/
-		// Generate SAT for this VSM
-		SATConfig config;
-		config.resWidth = resWidth;
-		config.resHeight = resHeight;
-		config.componentNum = 2; // only depth and depthSquare
-		config.texGenerator = [](GLuint& _texID, const int& _width, const int& _height)
-		{
-			glCreateTextures(GL_TEXTURE_2D, 1, &_texID); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
-			// [Important, Note] GL_RG16F is not enough to provide enough floating-point precision for SAT
-			glTextureStorage2D(_texID, 1, GL_RG32F, _width, _height); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
-			glTextureParameteri(_texID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
-			glTextureParameteri(_texID, GL_TEXTURE_MAG_FILTER, GL_LINEAR); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
 			glTextureParameteri(_texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 			glTextureParameteri(_texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-			const float borderColor[] = { 0,0,0,0 }; // [Important, Note] must be zero value. according to paper. When adding elements outside of range, it should add zero.
-			glTextureParameterfv(_texID, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
-		};
-		config.inputTexID = depthTex;
-
-		std::shared_ptr<SummedAreaTableGenerator> satGenerator = std::make_shared<SummedAreaTableGenerator>();
-		satGenerator->Init(config);
-		satGeneratorMap[i] = satGenerator;
-		/*----------------------------------------------------SAT for them relevant done----------------------------------------------------*/
-	}
+			const float borderColor[] = { 1.0f, 1.0f, 0.0f, 0.0f };
+			glTextureParameterfv(_texID, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
+			// padding around tiles is never rendered, it keeps the same value as border
+			glClearTexImage(_texID, 0, GL_RGBA, GL_FLOAT, borderColor); if (CheckGLError()) { Print("Error in VSSMRender::Init."); return; };
+		});
+	if (!result) { Print("Error in VSSMRender::Init."); return; }
+
+	// [Note] depth buffer for depth testing is a transient texture of frame graph(atlas size), see AddPasses().
+	// The framebuffer(atlas+depth buffer) is cached by FullscreenPass.
+
+	/*----------------------------------------------------VSM-depth/depthSquare relevant done----------------------------------------------------*/
+
+	/*----------------------------------------------------SAT for them relevant start----------------------------------------------------*/
+	// Generate one SAT for the whole atlas. Lookups in lightRatio shaders clamp box corners into the tile, so sums never cross tiles.
+	// [Note] sums grow with the atlas area instead of one shadow map, SAT copy shader already centers values(-0.5) to keep float precision.
+	SATConfig config;
+	atlas.GetSize(config.resWidth, config.resHeight);
+	config.componentNum = 2; // only depth and depthSquare
+	// fixed-point SAT: exact integer sums, the scale is limited by the largest box looked up: the light size(or the max penumbra), never more than a tile
+	int maxTileArea = 0;
+	for (auto& item : tileSizes)
+		maxTileArea = std::max(maxTileArea, item.second.x * item.second.y);
+	satFixedMaxHalfKernel = std::max(GetPCSSLightSize(pcssIndex), GetPCSSMaxPenumbraSize(pcssIndex)) / 2 + 1;
+	int maxBoxArea = std::min((2 * satFixedMaxHalfKernel + 1) * (2 * satFixedMaxHalfKernel + 1), maxTileArea);
+	satFixedScale = useFixedSAT ? SummedAreaTableGenerator::GetFixedPointScale(maxBoxArea) : 0;
+	config.fixedPointScale = satFixedScale;
+	GLenum satFormat = useFixedSAT ? GL_RG32UI : GL_RG32F;
+	config.texGenerator = [satFormat](GLuint& _texID, const int& _width, const int& _height)
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &_texID); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
+		// [Important, Note] GL_RG16F is not enough to provide enough floating-point precision for SAT, GL_RG32UI for fixed-point SAT
+		glTextureStorage2D(_texID, 1, satFormat, _width, _height); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
+		glTextureParameteri(_texID, GL_TEXTURE_MIN_FILTER, GL_NEAREST); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
+		glTextureParameteri(_texID, GL_TEXTURE_MAG_FILTER, GL_NEAREST); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
+		glTextureParameteri(_texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTextureParameteri(_texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		const float borderColor[] = { 0,0,0,0 }; // [Important, Note] must be zero value. according to paper. When adding elements outside of range, it should add zero.
+		glTextureParameterfv(_texID, GL_TEXTURE_BORDER_COLOR, borderColor); if (CheckGLError()) { Print("Error in VSSMRender::texGenerator."); return; };
+	};
+	config.inputTexID = atlas.GetTexture();
+
+	satGenerator = std::make_shared<SummedAreaTableGenerator>();
+	satGenerator->Init(config);
+	/*----------------------------------------------------SAT for them relevant done----------------------------------------------------*/
 
 	// set some parameter
 	// refer: https://registry.khronos.org/OpenGL-Refpages/gl4/
@@ -904,109 +1580,106 @@ void VSSMRender::Init()
 	glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
 }
 
-void VSSMRender::Render()
+void VSSMRender::AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs)
 {
-	/*---------------------------------------------- VSM-depth/depthSquare texture render start ----------------------------------------------*/
-	// TODO: maybe tight light view space is required to improve the precision issue.(for now I just enable it)
-	// set the viewport to the size of the depth texture (each time render something into framebuffer, we need to specify its resolution)
-	// [TODO] future work could be render VSM and its SAT for static scenes from one light source(sun light)-> to improve FPS
-	shared_ptr<ShaderProgram> shaderPro = GLOBAL.shaderMgr->TryActivateShaderProgram(GLOBAL.shaderPathPrefix + "VarianceShadowMap/varianceShadowMap");
-	auto lights = GLOBAL.sceneMgr->GetAllLight();
-	for (int i = 0; i < lights.size(); i++)
-	{
-		// [TODO] if render it each frame, it will slow down FPS. For now, only the light info has changed(position change) then generate VSM and its SAT
-		if (!lights[i]->IsRenderShadow())
-			continue;
-
-		//glBindFramebuffer(GL_FRAMEBUFFER, depthFrameBuffers[i]);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMap[i][1]); CheckGLError();
-		glClearColor(1, 1, 0, 1); // first two component should be 1, because they are corresponding to depth and depth_square, the blue&alpha not used
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-		glViewport(0, 0, resWidth, resHeight); CheckGLError();
+	if (atlas.GetTexture() == 0)
+		return;
 
-		// compute light matrix
-		LightCamInfo lightCamInfo;
-		glm::mat4 lightMat = lights[i]->GetLightSpaceMat(lightCamInfo);
-		shaderPro->Set("lightMat", lightMat); CheckGLError();
+	// all dirty views(see ShadowView) are rendered into their tiles by one pass, then one SAT pass for the whole atlas
+	// VSM and its SAT are cached: passes are only added if some view is dirty(light, view or scene changed), lighting reads the cached textures otherwise
+	/*VSM-depth/depthSquare*/
+	auto momentTex = _graph.ImportTexture("VSMAtlas", atlas.GetTexture());
+	_outputs.push_back(momentTex);
+	auto satTex = _graph.ImportTexture("SATAtlas", satGenerator->GetSAT());
+	_outputs.push_back(satTex);
 
-		shaderPro->Set("lightCamInfo.near", lightCamInfo.near); CheckGLError();
-		shaderPro->Set("lightCamInfo.far", lightCamInfo.far); CheckGLError();
-		shaderPro->Set("lightCamInfo.lightCamPos", lightCamInfo.lightCamPos); CheckGLError();
-		shaderPro->Set("lightCamInfo.lightViewDir", lightCamInfo.lightViewDir); CheckGLError();
+	std::vector<ShadowView> dirtyViews = GetDirtyShadowViews(atlas);
+	if (dirtyViews.empty())
+		return;
 
-		auto sceneObjs = GLOBAL.sceneMgr->GetAllSceneObject(); // not copy data, just return reference &
-		for (auto iter = sceneObjs.begin(); iter != sceneObjs.end(); iter++)
+	int width, height;
+	atlas.GetSize(width, height);
+	// depth buffer is only used for depth testing inside this pass
+	auto depthTex = _graph.CreateTexture("VSMAtlasDepth", TransientTextureDesc(width, height, GL_DEPTH_COMPONENT24));
+	_graph.AddPass("VSM", {}, { momentTex, depthTex },
+		[this, dirtyViews, depthTex, &_graph]() { RenderMoment(dirtyViews, _graph.GetTexture(depthTex)); });
+
+	/*SAT*/
+	// [Note] scratch texture for ping-pong is transient, it only lives inside this pass.
+	auto scratchTex = _graph.CreateTexture("SATScratch", TransientTextureDesc(width, height, useFixedSAT ? GL_RG32UI : GL_RG32F));
+	_graph.AddPass("SAT", { momentTex, scratchTex }, { satTex, scratchTex },
+		[this, dirtyViews, scratchTex, &_graph]()
 		{
-			auto sceneObj = *iter;
-			glm::mat4 modelMat = sceneObj->GetTransform()->ComputeTransformationMatrix();
-			shaderPro->Set("modelMat", modelMat); CheckGLError();
-			GLOBAL.render->Draw(sceneObj);
-		}
-		// unbind framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glViewport(0, 0, GLOBAL.WIN_WIDTH, GLOBAL.WIN_HEIGHT); // set it back to normal
-	}
-	/*---------------------------------------------- VSM-depth/depthSquare texture render done ----------------------------------------------*/
+			satGenerator->Generate(_graph.GetTexture(scratchTex), GetDirtyCorner(dirtyViews)); // only texels after the changed ones
+			for (auto& view : dirtyViews)
+				MarkShadowUpdated(view);
+		});
+}
 
-	/*----------------------------------------------------SAT render start----------------------------------------------------*/
-	//[Important] the reason why I do another iteration is that: BoxFilter() will generate a new sceneobj and add into sceneMgr. It will change sceneObjs??
-	// also, waiting all VSM get rendered is normal logic.
-	for (int i = 0; i < lights.size(); i++)
+void VSSMRender::RenderMoment(const std::vector<ShadowView>& _views, const GLuint& _depthTex)
+{
+	// TODO: maybe tight light view space is required to improve the precision issue.(for now I just enable it)
+	// [Important] We must bind a depth buffer! Otherwise there is no way to update the depth information!!!
+	glBindFramebuffer(GL_FRAMEBUFFER, GLOBAL.render->GetFullscreenPass()->GetFrameBuffer(atlas.GetTexture(), _depthTex)); CheckGLError();
+	glClearColor(1, 1, 0, 1); // first two component should be 1, because they are corresponding to depth and depth_square, the blue&alpha not used
+	for (auto& view : _views)
 	{
-		// [TODO] if render it each frame, it will slow down FPS. For now, only the light info has changed(position change) then generate VSM and its SAT
-		if (!lights[i]->IsRenderShadow())
-			continue;
-		// create SAT for the depth/depthSquare texture
-		satGeneratorMap[i]->Generate();
+		// viewport to the tile of this view and scissor to its changed texels, so that clearing doesn't touch other tiles
+		SetShadowViewport(view, atlas); CheckGLError();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
 	}
-	/*----------------------------------------------------SAT render done----------------------------------------------------*/
+	glDisable(GL_SCISSOR_TEST);
+
+	// each object is drawn once for all views instead of once per view
+	RenderLayered(_views, atlas, "VarianceShadowMap/varianceShadowMapLayered");
+
+	// unbind framebuffer
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, GLOBAL.RENDER_WIDTH, GLOBAL.RENDER_HEIGHT); // set it back to normal
 }
 
 void VSSMRender::Clear()
 {
 	BasicShadowMapRender::Clear();
+	ClearTextures();
+}
 
-	for (auto iter = depthMap.begin(); iter != depthMap.end(); iter++)
-	{
-		auto texID = iter->second[0];
-		if (glIsTexture(texID))
-			glDeleteTextures(1, &texID);
-
-		auto frameBufferID = iter->second[1];
-		if (glIsFramebuffer(frameBufferID))
-			glDeleteFramebuffers(1, &frameBufferID);
-
-		// be careful, don't forget this one.
-		auto rbID = iter->second[2];
-		if (glIsRenderbuffer(rbID))
-			glDeleteRenderbuffers(1, &rbID);
-	}
-	depthMap.clear();
+void VSSMRender::ClearTextures()
+{
+	satGenerator = nullptr; /*it will automatically release OpenGL objects. Check ~SATGenerator().*/
 
-	satGeneratorMap.clear(); /*it will automatically release OpenGL objects. Check ~SATGenerator().*/
+	// its framebuffers are cached by FullscreenPass
+	if (GLOBAL.render != nullptr && atlas.GetTexture() != 0)
+		GLOBAL.render->GetFullscreenPass()->ReleaseTexture(atlas.GetTexture());
+	atlas.Clear();
 }
 
-GLuint VSSMRender::GetDepthFrameBuffer(const int& _lightIndex) { return depthMap[_lightIndex][1]; }
-GLuint VSSMRender::GetDepthTexture(const int& _lightIndex) { return depthMap[_lightIndex][0]; }
+// [Note] all lights share the same atlas texture, use "atlas.GetTile(GetShadowViewKey(_lightIndex, view))" to find the part of a light
+GLuint VSSMRender::GetDepthFrameBuffer(const int&) { return GLOBAL.render->GetFullscreenPass()->GetFrameBuffer(atlas.GetTexture()); }
+GLuint VSSMRender::GetDepthTexture(const int&) { return atlas.GetTexture(); }
 
 void VSSMRender::SaveShadowMap(const int& _lightIndex, const std::string& _lightName)
 {
-	GLuint fbo = depthMap[_lightIndex][1];
-	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName, resWidth, resHeight, GL_RGB, fbo))
+	// [Note] depth buffer is a transient texture of frame graph, only depth/depthSquare texture can be saved
+	GLuint fbo = GetDepthFrameBuffer(_lightIndex);
+	auto tile = atlas.GetTile(GetShadowViewKey(_lightIndex, 0)); // first view(e.g. the nearest cascade) of the light
+	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName, tile.width, tile.height, GL_RGB, fbo, tile.x, tile.y))
 		Print("VarianceShadowMap saved.");
-
-	// below code will read depth texture from framebuffer not color buffer
-	if (Utility::SaveTextureToPNG("ShadowMap_light_" + _lightName + "_depth_ground_truth", resWidth, resHeight, GL_DEPTH_COMPONENT, fbo))
-		Print("ShadowMap saved.");
 }
 
 void VSSMRender::SetVarianceMin(const float& _varMin) { varMin = _varMin; }
 void VSSMRender::SetPMin(const float& _pMin) { pMin = _pMin; }
+void VSSMRender::SetUseFixedSAT(const bool& _value) { useFixedSAT = _value; }
+bool VSSMRender::IsUseFixedSAT() const { return useFixedSAT; }
 
-GLuint VSSMRender::GetSAT(const int& _lightIndex) { return satGeneratorMap[_lightIndex]->GetSAT(); }
+GLuint VSSMRender::GetSAT(const int&) { return satGenerator->GetSAT(); }
 
 void VSSMRender::InitComputeLightRatioParameters(shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit)
 {
+	// atlas is not created if it exceeds GL_MAX_TEXTURE_SIZE(see ShadowAtlas::Init), there is no tile to look up. Same as AddPasses()
+	if (atlas.GetTexture() == 0)
+		return;
+
 	// set VSM relevant parameters
 	_shaderPro->Set("varMin", varMin);
 	_shaderPro->Set("pMin", pMin);
@@ -1036,15 +1709,24 @@ void VSSMRender::InitComputeLightRatioParameters(shared_ptr<ShaderProgram>& _sha
 		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].far", lightCamInfo.far);
 		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].lightCamPos", lightCamInfo.lightCamPos);
 		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].lightViewDir", lightCamInfo.lightViewDir);
-
-		// set shadow map
-		_shaderPro->Set("shadowMaps[" + std::to_string(i) + "]", static_cast<int>(_texUnit));
-		glBindTextureUnit(_texUnit++, GetDepthTexture(i));
-
-		// set SAT maps
-		_shaderPro->Set("SATMaps[" + std::to_string(i) + "]", static_cast<int>(_texUnit));
-		glBindTextureUnit(_texUnit++, GetSAT(i));
+		_shaderPro->Set("lightCamInfos[" + std::to_string(i) + "].atlasTile", atlas.GetTileRect(GetShadowViewKey(i, 0)));
+		SetShadowViewParameters(_shaderPro, i, atlas);
 	}
+
+	// set shadow map, atlas contains all lights
+	_shaderPro->Set("shadowAtlasPadding", ShadowAtlas::padding);
+	_shaderPro->Set("shadowAtlas", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, atlas.GetTexture());
+
+	// set SAT map
+	// [Note] "SATFixedAtlas" is an unsigned integer sampler, it always needs its own unit(even if unused), a unit can't be shared by samplers of different types
+	_shaderPro->Set("useFixedSAT", useFixedSAT ? 1 : 0);
+	_shaderPro->Set("SATFixedScale", satFixedScale);
+	_shaderPro->Set("SATFixedMaxHalfKernel", satFixedMaxHalfKernel);
+	_shaderPro->Set("SATFixedAtlas", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, useFixedSAT ? satGenerator->GetSAT() : 0);
+	_shaderPro->Set("SATAtlas", static_cast<int>(_texUnit));
+	glBindTextureUnit(_texUnit++, useFixedSAT ? 0 : satGenerator->GetSAT());
 }
 
 void VSSMRender::InitPCSS(const bool& _usePCSS, const int& _maxSearchSize, const int& _lightSize, const int& _minPenumbraSize, const int& _maxPenumbraSize, const float& _penumbraRatio)
@@ -1059,6 +1741,8 @@ void VSSMRender::InitPCSS(const bool& _usePCSS, const int& _maxSearchSize, const
 		pcssIndex = -1;
 }
 
+int VSSMRender::GetLightSize() const { return GetPCSSLightSize(pcssIndex); }
+
 void VSSMRender::InitSubdivision(const int& _M, const int& _N) { M = _M; N = _N; }
 
 #pragma endregion
@@ -6,6 +6,10 @@
 #include "../shadermgr/shaderProgram.hpp"
 #include <map>
 #include "../helpers/satGenerator.hpp"
+#include "shadowAtlas.hpp"
+#include "sampleDistribution.hpp"
+#include "../rasterizer/frameGraph.hpp"
+#include "../spatial_structure/AABB.hpp"
 #include <utility>
 
 namespace IceRender
@@ -14,8 +18,11 @@ namespace IceRender
 	{
 	public:
 		virtual void Init() = 0;
-		virtual void Render() = 0;
+		// declare shadow passes into the frame graph of current frame, "_outputs" are the textures read by lighting(shadow maps, SATs)
+		virtual void AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs) = 0;
 		virtual void Clear() = 0;
+		virtual void InvalidateCache() = 0; // shadow maps are cached across frames, force them to be re-rendered next frame
+		virtual void UpdateShadowViews() = 0; // update shadow views of lights(e.g. fit cascades of DirectLight to the camera), called once per frame before culling and AddPasses
 	};
 
 	// TODO: don't ask me why I designed things like this, I have no idea just want to make it work first. To recontruct this codes later when I have more experience.
@@ -24,6 +31,8 @@ namespace IceRender
 	private:
 		std::shared_ptr<BasicShadowRender> shadowRender;
 		bool useTightSpace;
+		std::shared_ptr<SampleDistribution> sampleDistribution; // SDSM: light frustums fitted to visible samples, see SampleDistribution
+		nlohmann::json shadowConfig; // the last loaded config
 
 	public:
 		ShadowManager();
@@ -36,7 +45,12 @@ namespace IceRender
 
 		void InitShadowRender(); // each time light sources change, we should call it
 
-		void RenderShadow();
+		void OnRenderResolutionChanged(); // rebuild shadow maps if their resolution follows render resolution
+
+		void UpdateShadowViews(); // once per frame, before lights are culled and shadow passes are added
+
+		// "_cameraDepth" is the camera depth pre-pass(read by SDSM), "_outputs" are the shadow textures which scene pass should read
+		void AddShadowPasses(FrameGraph& _graph, const FrameGraph::ResourceHandle& _cameraDepth, std::vector<FrameGraph::ResourceHandle>& _outputs);
 
 		bool IsNeedShadowRender(); // if there exists ShadowRender, it means we need to render shadow
 
@@ -47,6 +61,10 @@ namespace IceRender
 
 		bool IsUseTightSpace() const;
 		void SetUseTightSpace(const bool& _value);
+
+		bool IsUseSDSM() const;
+		void SetUseSDSM(const bool& _value);
+		std::shared_ptr<SampleDistribution> GetSampleDistribution();
 	};
 
 #pragma region Shadow Components
@@ -94,13 +112,79 @@ namespace IceRender
 
 		std::vector<std::shared_ptr<BasicShadowComponent>> components;
 
+		/*shadow view: one shadow map in the atlas, i.e. a light or one of its views(see BaseLight::GetShadowViewNum). "key" identifies it in atlas tiles, cache and GPU culling views*/
+		struct ShadowView
+		{
+			int lightIndex;
+			int index; // index of the view in its light, 0 if the light has only one view
+			int key; // see GetShadowViewKey
+			bool partial; // only a part of its shadow map changed, see "rect"
+			glm::ivec4 rect; // texels to re-render in atlas(x, y, width, height): the whole tile, or only the changed part of it if "partial"
+		};
+
+		/*cache: shadow maps(and SATs) are kept across frames, a view is only re-rendered when its light(or the view) or the scene(objects and their transforms) changes*/
+		unsigned int cachedSceneVersion;
+		unsigned int cachedTransformVersion;
+		std::map<int, unsigned int> cachedViewVersions; // key is the shadow view key, value is the view version its shadow map was rendered with
+		/*dirty rectangles: when objects move but the light space matrix of a cached view is unchanged, only the area covered by their old and new bounding boxes is re-rendered*/
+		std::map<int, glm::mat4> cachedViewMats; // key is the shadow view key, value is the light space matrix its shadow map was rendered with
+		std::map<int, glm::vec4> dirtyViewAreas; // key is the shadow view key, value is the changed area of its cached shadow map in NDC of light(xy: min, zw: max)
+		std::vector<unsigned int> cachedObjectVersions; // transform version of each scene object, when the scene was last checked
+		std::vector<AABB> cachedObjectBounds; // bounding box of each scene object, when the scene was last checked
+
+		void UpdateCachedScene(); // find moved objects and mark their areas dirty in cached views, re-render everything if objects are added/removed
+
+		int GetPCSSLightSize(const int& _pcssIndex) const; // light size of PCSS component at "_pcssIndex", 0 if index is -1
+		int GetPCSSMaxPenumbraSize(const int& _pcssIndex) const; // max penumbra size of PCSS component at "_pcssIndex", 0 if index is -1
+		glm::ivec2 GetShadowTileSize(const int& _lightIndex) const; // shadow map size of one view of this light(resolution * light shadow resolution scale)
+		std::map<int, glm::ivec2> GetShadowTileSizes() const; // key is the shadow view key, value is the shadow map size. One tile per view of lights rendering shadow
+		std::vector<ShadowView> GetDirtyShadowViews(const ShadowAtlas& _atlas); // views of lights rendering shadow whose shadow maps need to be re-rendered(entirely or partially)
+		static glm::ivec2 GetDirtyCorner(const std::vector<ShadowView>& _views); // bottom left texel of all "rect" of views, SAT only changes at or after it
+		void SetShadowViewport(const ShadowView& _view, const ShadowAtlas& _atlas); // viewport to the tile of the view, scissor to its "rect"
+		void SetShadowViewParameters(shared_ptr<ShaderProgram>& _shaderPro, const int& _lightIndex, const ShadowAtlas& _atlas); // "viewNum/viewMats/viewTiles" of "lightCamInfos[_lightIndex]"
+
+		/*layered pass: all lights are rendered by one pass, each scene object is drawn once with one instance per light*/
+		struct LayeredLight
+		{
+			glm::mat4 lightMat;
+			glm::vec4 tileTransform; // xy: scale, zw: offset from NDC of light to NDC of its tile in atlas
+			glm::vec4 lightCamPosNear; // xyz: lightCamPos, w: near
+			glm::vec4 lightViewDirFar; // xyz: lightViewDir, w: far
+		};
+		static const int layeredLightBinding = 1; // binding of "ShadowLightBuffer" in layered shaders(e.g. "ShadowMap/shadowMapLayered.vs")
+		GLuint layeredLightBuffer; // "LayeredLight" of views rendered by current layered pass, indexed by gl_InstanceID
+
+		// draw scene objects into tiles of "_views" by shader "_shaderName"(vertex variant is added, and "Indirect" with GPU culling). Framebuffer must be bound and tiles(or rects) must be cleared before.
+		void RenderLayered(const std::vector<ShadowView>& _views, const ShadowAtlas& _atlas, const std::string& _shaderName);
+		// one instanced draw per object for all "_views", or one multi-draw call of culled objects(see GPUCulling::CullLayered) with GPU culling
+		void DrawLayered(const std::vector<ShadowView>& _views, const ShadowAtlas& _atlas, const std::string& _shaderName);
+		bool IsShadowDirty(const ShadowView& _view); // whether shadow map of this view needs to be re-rendered
+		void MarkShadowUpdated(const ShadowView& _view); // call it once shadow map of this view is rendered(in frame graph pass, which may be culled)
+
+		/*min/max depth pyramid: PCSS blocker search reads (min, max) depth of its region first, and skips the search if the receiver is fully lit(search region) or fully blocked(widest penumbra filter region)*/
+		bool useDepthPyramid; // only built with PCSS
+		GLuint depthPyramidTex; // RG32F, level k stores (min, max) depth of 2^(k+1) x 2^(k+1) atlas texels, see "ShadowMap/depthPyramid.cs"
+		int depthPyramidLevels;
+
+		void InitDepthPyramid(const ShadowAtlas& _atlas); // create the pyramid of the whole atlas, filled with far depth
+		void BuildDepthPyramid(const std::vector<ShadowView>& _views, const GLuint& _depthTex); // reduce changed texels("rect") of views of "_depthTex"(atlas, depth in r) into all levels
+		void SetDepthPyramidParameters(shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit); // "ShadowMap/depthPyramid.sub_fs", only for PCSS shaders
+		void ClearDepthPyramid();
+
 	public:
+		BasicShadowMapRender();
+
+		// light index for the first view, so lights with only one view are keyed by their light index
+		static int GetShadowViewKey(const int& _lightIndex, const int& _view);
+
 		void GetResolution(int& _width, int& _height) const;
 		void SetResolution(int _w, int _h);
 
 		void Init() override;
-		void Render() override;
+		void AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs) override;
 		void Clear() override;
+		void InvalidateCache() override;
+		void UpdateShadowViews() override;
 		virtual GLuint GetDepthFrameBuffer(const int& _lightIndex);
 		virtual GLuint GetDepthTexture(const int& _lightIndex);
 		virtual void SaveShadowMap(const int& _lightIndex, const std::string& _lightName); // use command "save_shadow_map lightName" to check output
@@ -110,6 +194,12 @@ namespace IceRender
 
 		int AddComponent(std::shared_ptr<BasicShadowComponent>& _component);
 		std::shared_ptr<BasicShadowComponent>& GetComponent(const int& _index);
+
+		virtual int GetLightSize() const; // area light size of PCSS(in shadow map texels at light near plane), 0 means point light(no PCSS)
+
+		// call "ShadowManager::InitShadowRender" after it to rebuild the pyramid
+		void SetUseDepthPyramid(const bool& _value);
+		bool IsUseDepthPyramid() const;
 	};
 
 
@@ -117,9 +207,9 @@ namespace IceRender
 	class ShadowMapRender : public BasicShadowMapRender
 	{
 	private:
-		//[TODO] maybe it is better to use one framebuffer and bind different textures to it. E.g, if we now need to render 5 lights, we can just create one FBO, then bind 5 depthTextures to it.
-		// (split lighting and shadowing into two seperated passes)
-		std::map<int, glm::vec<2, GLuint>> depthMap; // key is the light index, depth texture at index=0 (X component), its framebuffer id at index=1 (Y component).
+		ShadowAtlas atlas; // depth of all lights, one tile per shadow view
+		GLuint depthFBO; // one framebuffer for the whole atlas, each light renders into its tile
+		GLuint compareTex; // a view of the atlas with depth comparison, sampled as "sampler2DShadow" with hardware bilinear PCF.
 
 		float bias; // bias
 
@@ -127,15 +217,22 @@ namespace IceRender
 		int pcfIndex;
 		int pcssIndex;
 
+		void Render(const std::vector<ShadowView>& _views); // render depth of views whose shadow maps are dirty
+		void ClearTextures(); // release atlas and framebuffer, components are kept
+
 	public:
+		ShadowMapRender();
 		void Init() override;
-		void Render() override;
+		void AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs) override;
 		void Clear() override;
 		GLuint GetDepthFrameBuffer(const int& _lightIndex) override;
 		GLuint GetDepthTexture(const int& _lightIndex) override;
+		GLuint GetCompareTexture(const int& _lightIndex); // same storage as depth texture, but with GL_TEXTURE_COMPARE_MODE and linear filtering
 		void SaveShadowMap(const int& _lightIndex, const std::string& _lightName) override; // use command "save_shadow_map lightName" to check output
 		
 		void SetBias(const float& _biasMin);
+		float GetBias() const;
+		int GetPCFKernelSize() const; // 0 if PCF is not used
 		
 		void InitComputeLightRatioParameters(shared_ptr<ShaderProgram>& _shaderPro, GLuint& _texUnit) override;
 
@@ -144,6 +241,7 @@ namespace IceRender
 
 		/*PCSS*/
 		void InitPCSS(const bool& _usePCSS, const int& _maxSearchSize, const int& _lightSize, const int& _minPenumbraSize, const int& _maxPenumbraSize, const float& _penumbraRatio);
+		int GetLightSize() const override;
 	};
 #pragma endregion
 
@@ -154,7 +252,7 @@ namespace IceRender
 	{
 	private:
 		// [Note] to see the results, we can use "Utility::RenderScreenQuad(GetDepthTexture(i));", where i is light index.
-		std::map<int, glm::vec<3, GLuint>> depthMap; // key is the light index, depth texture at index=0 (X component), its framebuffer id at index=1 (Y component), depthRenderBuffer at index=2(Z component)
+		ShadowAtlas atlas; // depth/depthSquare of all lights, one tile per shadow view. Depth buffer is a transient texture of frame graph.
 
 		int kernelSize; // use to compute the mean of depth over a kernel area, this size is the length of one edge, must be odd number. EX: kernelSize=5, means filter area contains 5*5 texels in total
 		// dependent on scene
@@ -163,14 +261,28 @@ namespace IceRender
 
 		/*SAT relevant*/
 		bool useSAT;
-		std::map<int, std::shared_ptr<SummedAreaTableGenerator>> satGeneratorMap; // summed-area table generator for (depth,depth_square)
+		std::shared_ptr<SummedAreaTableGenerator> satGenerator; // summed-area table generator for (depth,depth_square) of the whole atlas
+		bool useFixedSAT; // RG32UI fixed-point SAT(exact integer sums) instead of RG32F, see SATConfig::fixedPointScale
+		float satFixedScale; // quantization scale of fixed-point SAT, 0 if not used
+		int satFixedMaxHalfKernel; // largest half kernel size whose box sums are exact with "satFixedScale", lookups are clamped to it
+
+		/*prefiltered VSM: moments are blurred once in light space(separable box blur of "kernelSize"), lighting does one bilinear fetch instead of kernelSize^2 fetches per fragment*/
+		bool useBlur; // not used with SAT or PCSS
+		bool useEVSM; // exponential VSM, blurred moments are (e^(c+ d), e^(2c+ d), -e^(-c- d), e^(-2c- d)) to reduce light bleeding. Only with blur
+		glm::vec2 evsmExponents; // c+, c-. c+ must be <= 40 for 32-bit float
+		GLuint blurredTex; // blurred moments of the whole atlas(RG32F, or RGBA32F for EVSM), same tiles as atlas
 
 		/*PCSS*/
 		int pcssIndex; //[TODO] I have tried integrate PCSS into vsm, actually there is no big difference. VSM is enough(sometimes we even don't need the SAT)//may be delete relevant codes later
 
+		void RenderMoment(const std::vector<ShadowView>& _views, const GLuint& _depthTex); // render depth/depthSquare of views into their tiles, "_depthTex"(atlas size) is used for depth testing
+		void BlurMoment(const std::vector<ShadowView>& _views, const GLuint& _scratchTex); // blur moments of views into "blurredTex", "_scratchTex"(atlas size, same format) keeps the horizontal pass
+		void ClearTextures(); // release atlas, SAT and blurred moments, components are kept
+
 	public:
+		VarianceShadowMapRender();
 		void Init() override;
-		void Render() override;
+		void AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs) override;
 		void Clear() override;
 		GLuint GetDepthFrameBuffer(const int& _lightIndex) override;
 		GLuint GetDepthTexture(const int& _lightIndex) override;
@@ -182,8 +294,14 @@ namespace IceRender
 
 		void SetUseSAT(const bool& _value);
 		bool IsUseSAT() const;
+		void SetUseFixedSAT(const bool& _value); // call "ShadowManager::InitShadowRender" after it to rebuild the SAT
+		bool IsUseFixedSAT() const;
 		GLuint GetSAT(const int& _lightIndex);
 
+		// call "ShadowManager::InitShadowRender" after it to rebuild the blurred moments
+		void SetUseBlur(const bool& _useBlur, const bool& _useEVSM, const glm::vec2& _evsmExponents);
+		bool IsUseBlur() const;
+
 		// for debug
 		std::shared_ptr<SummedAreaTableGenerator> GetSATGenerator(const int& _lightIndex);
 
@@ -191,20 +309,24 @@ namespace IceRender
 
 		/*PCSS*/
 		void InitPCSS(const bool& _usePCSS, const int& _maxSearchSize, const int& _lightSize, const int& _minPenumbraSize, const int& _maxPenumbraSize, const float& _penumbraRatio);
+		int GetLightSize() const override;
 	};
 
 	class VSSMRender : public BasicShadowMapRender
 	{
 	private:
 		// [Note] to see the results, we can use "Utility::RenderScreenQuad(GetDepthTexture(i));", where i is light index.
-		std::map<int, glm::vec<3, GLuint>> depthMap; // key is the light index, depth texture at index=0 (X component), its framebuffer id at index=1 (Y component), depthRenderBuffer at index=2(Z component)
+		ShadowAtlas atlas; // depth/depthSquare of all lights, one tile per shadow view. Depth buffer is a transient texture of frame graph.
 
 		// dependent on scene
 		float varMin; // setting a minimum variance can eliminate the shadow acne issue(biasing)
 		float pMin; // setting a minimum upper bound "p" can reduce the "light bleeding" issue, but it darken the penumbra area.
 
 		/*SAT relevant*/
-		std::map<int, std::shared_ptr<SummedAreaTableGenerator>> satGeneratorMap; // summed-area table generator for (depth,depth_square)
+		std::shared_ptr<SummedAreaTableGenerator> satGenerator; // summed-area table generator for (depth,depth_square) of the whole atlas
+		bool useFixedSAT; // RG32UI fixed-point SAT(exact integer sums) instead of RG32F, see SATConfig::fixedPointScale
+		float satFixedScale; // quantization scale of fixed-point SAT, 0 if not used
+		int satFixedMaxHalfKernel; // largest half kernel size whose box sums are exact with "satFixedScale", lookups are clamped to it
 
 		/*PCSS*/
 		int pcssIndex; //[TODO] I have tried integrate PCSS into vsm, actually there is no big difference. VSM is enough(sometimes we even don't need the SAT)//may be delete relevant codes later
@@ -213,9 +335,13 @@ namespace IceRender
 		int M;
 		int N;
 
+		void RenderMoment(const std::vector<ShadowView>& _views, const GLuint& _depthTex); // render depth/depthSquare of views into their tiles, "_depthTex"(atlas size) is used for depth testing
+		void ClearTextures(); // release atlas and SAT, components are kept
+
 	public:
+		VSSMRender();
 		void Init() override;
-		void Render() override;
+		void AddPasses(FrameGraph& _graph, std::vector<FrameGraph::ResourceHandle>& _outputs) override;
 		void Clear() override;
 		GLuint GetDepthFrameBuffer(const int& _lightIndex) override;
 		GLuint GetDepthTexture(const int& _lightIndex) override;
@@ -223,6 +349,8 @@ namespace IceRender
 
 		void SetVarianceMin(const float& _varMin);
 		void SetPMin(const float& _pMin);
+		void SetUseFixedSAT(const bool& _value); // call "ShadowManager::InitShadowRender" after it to rebuild the SAT
+		bool IsUseFixedSAT() const;
 
 		GLuint GetSAT(const int& _lightIndex);
 
@@ -230,6 +358,7 @@ namespace IceRender
 
 		/*PCSS*/
 		void InitPCSS(const bool& _usePCSS, const int& _maxSearchSize, const int& _lightSize, const int& _minPenumbraSize, const int& _maxPenumbraSize, const float& _penumbraRatio);
+		int GetLightSize() const override;
 
 		void InitSubdivision(const int& _M, const int& _N);
 	};
@@ -0,0 +1,107 @@
+#include "shadowAtlas.hpp"
+#include "../helpers/utility.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace IceRender;
+
+ShadowAtlas::ShadowAtlas() : texID(0), width(0), height(0) {}
+
+ShadowAtlas::~ShadowAtlas() { Clear(); }
+
+bool ShadowAtlas::Pack(const std::map<int, glm::ivec2>& _tileSizes)
+{
+	tiles.clear();
+	width = height = 0;
+	if (_tileSizes.empty())
+		return true;
+
+	// tallest first, so that each shelf wastes less space
+	std::vector<std::pair<int, glm::ivec2>> sortedSizes(_tileSizes.begin(), _tileSizes.end());
+	std::stable_sort(sortedSizes.begin(), sortedSizes.end(), [](const std::pair<int, glm::ivec2>& _a, const std::pair<int, glm::ivec2>& _b) { return _a.second.y > _b.second.y; });
+
+	// atlas width: close to a square atlas, but at least the widest tile
+	float area = 0;
+	int maxWidth = 0;
+	for (auto& item : sortedSizes)
+	{
+		area += static_cast<float>(item.second.x + 2 * padding) * static_cast<float>(item.second.y + 2 * padding);
+		maxWidth = std::max(maxWidth, item.second.x + 2 * padding);
+	}
+	width = std::max(maxWidth, static_cast<int>(std::ceil(std::sqrt(area))));
+
+	int shelfX = 0, shelfY = 0, shelfHeight = 0;
+	for (auto& item : sortedSizes)
+	{
+		int paddedWidth = item.second.x + 2 * padding;
+		int paddedHeight = item.second.y + 2 * padding;
+		if (shelfX + paddedWidth > width)
+		{
+			// start a new shelf above the current one
+			shelfY += shelfHeight;
+			shelfX = shelfHeight = 0;
+		}
+		Tile tile;
+		tile.x = shelfX + padding;
+		tile.y = shelfY + padding;
+		tile.width = item.second.x;
+		tile.height = item.second.y;
+		tiles[item.first] = tile;
+		shelfX += paddedWidth;
+		shelfHeight = std::max(shelfHeight, paddedHeight);
+	}
+	height = shelfY + shelfHeight;
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (width > maxSize || height > maxSize)
+	{
+		Print("[Error] ShadowAtlas: atlas " + std::to_string(width) + "x" + std::to_string(height) + " is larger than GL_MAX_TEXTURE_SIZE, reduce shadow resolution.");
+		tiles.clear();
+		width = height = 0;
+		return false;
+	}
+	return true;
+}
+
+bool ShadowAtlas::Init(const std::map<int, glm::ivec2>& _tileSizes, const std::function<void(GLuint& _texID, const int& _width, const int& _height)>& _texGenerator)
+{
+	Clear();
+	if (!Pack(_tileSizes))
+		return false;
+	if (tiles.empty())
+		return true; // no light renders shadow
+
+	_texGenerator(texID, width, height);
+	if (CheckGLError()) { Print("Error in ShadowAtlas::Init."); return false; }
+	return true;
+}
+
+void ShadowAtlas::Clear()
+{
+	if (texID != 0 && glIsTexture(texID))
+		glDeleteTextures(1, &texID);
+	texID = 0;
+	tiles.clear();
+	width = height = 0;
+}
+
+GLuint ShadowAtlas::GetTexture() const { return texID; }
+void ShadowAtlas::GetSize(int& _width, int& _height) const { _width = width; _height = height; }
+bool ShadowAtlas::HasTile(const int& _viewKey) const { return tiles.find(_viewKey) != tiles.end(); }
+ShadowAtlas::Tile ShadowAtlas::GetTile(const int& _viewKey) const { return tiles.at(_viewKey); }
+
+glm::vec4 ShadowAtlas::GetTileRect(const int& _viewKey) const
+{
+	const Tile& tile = tiles.at(_viewKey);
+	return glm::vec4(tile.x, tile.y, tile.width, tile.height);
+}
+
+void ShadowAtlas::SetViewport(const int& _viewKey) const
+{
+	const Tile& tile = tiles.at(_viewKey);
+	glViewport(tile.x, tile.y, tile.width, tile.height);
+	glScissor(tile.x, tile.y, tile.width, tile.height);
+	glEnable(GL_SCISSOR_TEST);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <map>
+
+namespace IceRender
+{
+	/*
+	* Shadow atlas: shadow maps of all lights are packed into one texture, each shadow view(light, cascade or cube face) renders into its own tile(viewport + scissor).
+	* - tiles are keyed by shadow view key(see BasicShadowMapRender::GetShadowViewKey), which is only the light index for the first view of a light
+	* - tiles can have different sizes, they are packed into shelves(rows) from the tallest one
+	* - each tile is surrounded by "padding" texels which are never rendered. They keep the cleared value(far depth), so lookups clamped
+	*   inside a tile and its padding(see "ShadowMap/shadowAtlas.sub_fs") behave like GL_CLAMP_TO_BORDER of a separate shadow map.
+	* - one texture and one framebuffer for all lights: less framebuffer switches and texture bindings, and only one sampler unit is used by lighting.
+	*/
+	class ShadowAtlas
+	{
+	public:
+		static const int padding = 2; // must be >= 2, so that the bilinear footprint of a clamped lookup only covers padding texels
+
+		struct Tile
+		{
+			int x, y; // bottom left texel of tile in atlas(padding excluded)
+			int width, height;
+		};
+
+	private:
+		GLuint texID;
+		int width, height;
+		std::map<int, Tile> tiles; // key is the shadow view key
+
+		bool Pack(const std::map<int, glm::ivec2>& _tileSizes); // compute tiles and atlas size
+
+	public:
+		ShadowAtlas();
+		~ShadowAtlas();
+
+		// pack tiles("_tileSizes": key is the shadow view key, value is the tile size), then create the atlas texture by "_texGenerator"(same as SATConfig::texGenerator).
+		// Return false if the atlas is larger than GL_MAX_TEXTURE_SIZE.
+		bool Init(const std::map<int, glm::ivec2>& _tileSizes, const std::function<void(GLuint& _texID, const int& _width, const int& _height)>& _texGenerator);
+		void Clear(); // delete the texture, framebuffers using it must be released by their owners first
+
+		GLuint GetTexture() const;
+		void GetSize(int& _width, int& _height) const;
+		bool HasTile(const int& _viewKey) const;
+		Tile GetTile(const int& _viewKey) const;
+		glm::vec4 GetTileRect(const int& _viewKey) const; // xy: bottom left texel, zw: size. Same as "atlasTile" in shaders
+
+		// set viewport and scissor to the tile of a shadow view, scissor test is enabled so that glClear only clears this tile. Disable it after rendering all tiles.
+		void SetViewport(const int& _viewKey) const;
+	};
+}
@@ -5,7 +5,7 @@
 
 using namespace IceRender;
 
-TimeManager::TimeManager() { currentTime = 0; deltaTime = 0; frameStartTime = 0; frameCount = 0; isShowFPS = false; }
+TimeManager::TimeManager() { currentTime = 0; deltaTime = 0; frameIndex = 0; frameStartTime = 0; frameCount = 0; isShowFPS = false; }
 TimeManager::~TimeManager() {}
 
 void TimeManager::Init()
@@ -19,6 +19,7 @@ void TimeManager::Update()
 	double newCurTime = glfwGetTime();
 	deltaTime = newCurTime - currentTime;
 	currentTime = newCurTime;
+	frameIndex++;
 
 	// FPS
 	if (isShowFPS) 
@@ -58,6 +59,7 @@ void TimeManager::SetShowFPS(bool _show)
 
 double TimeManager::GetCurrentTime() const { return currentTime; }
 double TimeManager::GetDeltaTime() const { return deltaTime; }
+unsigned int TimeManager::GetFrameIndex() const { return frameIndex; }
 
 void TimeManager::StartRecord() { recordPoint = std::chrono::high_resolution_clock::now(); }
 double TimeManager::EndRecord()
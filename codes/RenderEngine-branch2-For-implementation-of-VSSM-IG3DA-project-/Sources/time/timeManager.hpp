@@ -9,6 +9,7 @@ namespace IceRender
 		// Frame related
 		double currentTime; // current time in seconds
 		double deltaTime; // elapsed time in seconds
+		unsigned int frameIndex; // increased by each Update(), never reset
 
 		// FPS relevant
 		double frameStartTime;
@@ -30,6 +31,7 @@ namespace IceRender
 		// Frame related
 		double GetCurrentTime() const;
 		double GetDeltaTime() const;
+		unsigned int GetFrameIndex() const; // used by per-frame caches(e.g. light space matrices)
 
 		// record current time point
 		void StartRecord();
@@ -10,6 +10,7 @@ Transform::Transform()
 	position = Utility::zeroV3;
 	rotation = Utility::zeroV3;
 	scale = Utility::oneV3;
+	version = 0;
 }
 
 Transform::Transform(const glm::vec3& _pos, const glm::vec3& _rot, const glm::vec3& _scale)
@@ -17,14 +18,15 @@ Transform::Transform(const glm::vec3& _pos, const glm::vec3& _rot, const glm::ve
 	position = _pos;
 	rotation = _rot;
 	scale = _scale;
+	version = 0;
 }
 
-void Transform::SetPosition(const glm::vec3& _pos) { position = _pos; }
-void Transform::SetSubPosition(const float& _value, const int& _idx) { position[_idx] = _value; }
-void Transform::SetRotation(const glm::vec3& _rot) { rotation = _rot; }
-void Transform::SetSubRotation(const float& _value, const int& _idx) { rotation[_idx] = _value; }
-void Transform::SetScale(const glm::vec3& _scale) { scale = _scale; }
-void Transform::SetSubScale(const float& _value, const int& _idx) { scale[_idx] = _value; }
+void Transform::SetPosition(const glm::vec3& _pos) { position = _pos; version++; }
+void Transform::SetSubPosition(const float& _value, const int& _idx) { position[_idx] = _value; version++; }
+void Transform::SetRotation(const glm::vec3& _rot) { rotation = _rot; version++; }
+void Transform::SetSubRotation(const float& _value, const int& _idx) { rotation[_idx] = _value; version++; }
+void Transform::SetScale(const glm::vec3& _scale) { scale = _scale; version++; }
+void Transform::SetSubScale(const float& _value, const int& _idx) { scale[_idx] = _value; version++; }
 
 glm::vec3 Transform::GetPosition() const { return position; }
 float Transform::GetSubPosition(const int& _idx) const { return position[_idx]; }
@@ -57,3 +59,5 @@ glm::mat4 Transform::ComputeTransformationMatrix() const
 	return transMat * rotMat * scaleMat;
 }
 
+unsigned int Transform::GetVersion() const { return version; }
+
@@ -12,6 +12,7 @@ namespace IceRender
 		glm::vec3 scale;
 		glm::vec3 position;
 		glm::vec3 rotation; // euler angles in radians. [rotation order: x-y-z~pitch-yaw-roll]
+		unsigned int version; // increased by each setter, so that results computed from this transform(e.g. shadow maps) can be cached
 
 	public:
 		Transform();
@@ -34,5 +35,7 @@ namespace IceRender
 		glm::mat4 Transform::GetRotationMat4() const;
 
 		glm::mat4 ComputeTransformationMatrix() const;
+
+		unsigned int GetVersion() const;
 	};
 }
\ No newline at end of file